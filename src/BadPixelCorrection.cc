@@ -0,0 +1,268 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+#include "BadPixelCorrection.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        double median(std::vector<float>& values) {
+            const size_t mid = values.size() / 2;
+            std::nth_element(values.begin(), values.begin() + mid, values.end());
+            return values[mid];
+        }
+
+
+        template <class T>
+        inline typename std::enable_if<std::is_integral<T>::value, T>::type toPixel(double value) {
+            return static_cast<T>(std::round(value)); // the mean of valid pixels is within the range of T
+        }
+
+
+        template <class T>
+        inline typename std::enable_if<std::is_floating_point<T>::value, T>::type toPixel(double value) {
+            return static_cast<T>(value);
+        }
+
+    } // namespace
+
+
+    void util::BadPixelCorrection::setDefects(const std::vector<Defect>& defects) {
+        m_defects = defects;
+        m_shape = Dims(); // the stencils are obsolete
+    }
+
+
+    size_t util::BadPixelCorrection::detect(const Dims& shape, const float* dark, double nSigma) {
+        if (shape.rank() != 2) {
+            throw KARABO_PARAMETER_EXCEPTION("Can only detect bad pixels in monochromatic references");
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const size_t size = height * width;
+        if (size == 0) {
+            this->setDefects({});
+            return 0;
+        }
+
+        std::vector<float> values(dark, dark + size);
+        const double med = median(values);
+        for (size_t i = 0; i < size; ++i) {
+            values[i] = std::fabs(dark[i] - med);
+        }
+        const double sigma = 1.4826 * median(values);
+        const double limit = nSigma * sigma;
+
+        std::vector<Defect> defects;
+        for (size_t y = 0; y < height; ++y) {
+            const float* row = dark + y * width;
+            for (size_t x = 0; x < width; ++x) {
+                if (std::fabs(row[x] - med) > limit) {
+                    defects.push_back({static_cast<unsigned int>(x), static_cast<unsigned int>(y)});
+                }
+            }
+        }
+
+        this->setDefects(defects);
+        return m_defects.size();
+    }
+
+
+    void util::BadPixelCorrection::compile(const Dims& shape, const Dims& roiOffsets, unsigned int binY,
+                                           unsigned int binX) {
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const size_t y0 = roiOffsets.x1();
+        const size_t x0 = roiOffsets.x2();
+
+        // The defects in the coordinates of the image, without duplicates (several defects can fall in one bin)
+        std::vector<bool> isDefect(height * width, false);
+        std::vector<Defect> defects;
+        for (const Defect& d : m_defects) {
+            if (d.y < y0 || d.x < x0) {
+                continue;
+            }
+            const size_t y = (d.y - y0) / binY;
+            const size_t x = (d.x - x0) / binX;
+            if (y < height && x < width && !isDefect[y * width + x]) {
+                isDefect[y * width + x] = true;
+                defects.push_back({static_cast<unsigned int>(x), static_cast<unsigned int>(y)});
+            }
+        }
+
+        m_targets.clear();
+        m_offsets.assign(1, 0);
+        m_neighbours.clear();
+        for (const Defect& d : defects) {
+            m_targets.push_back(d.y * width + d.x);
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const long long y = static_cast<long long>(d.y) + dy;
+                    const long long x = static_cast<long long>(d.x) + dx;
+                    if ((dx == 0 && dy == 0) || y < 0 || x < 0 || y >= static_cast<long long>(height) ||
+                        x >= static_cast<long long>(width)) {
+                        continue;
+                    }
+                    const size_t idx = y * width + x;
+                    if (!isDefect[idx]) {
+                        m_neighbours.push_back(idx);
+                    }
+                }
+            }
+            m_offsets.push_back(m_neighbours.size());
+        }
+
+        m_shape = shape;
+        m_roiOffsets = roiOffsets;
+        m_binY = binY;
+        m_binX = binX;
+    }
+
+
+    void util::BadPixelCorrection::apply(NDArray& arr) {
+        this->apply(arr, Dims(0, 0), 1, 1);
+    }
+
+
+    void util::BadPixelCorrection::apply(NDArray& arr, const Dims& roiOffsets, unsigned int binY,
+                                         unsigned int binX) {
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2 && shape.rank() != 3) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot correct image of rank " + std::to_string(shape.rank()));
+        }
+
+        if (m_defects.empty()) {
+            return;
+        }
+
+        binY = std::max(binY, 1u);
+        binX = std::max(binX, 1u);
+        const Dims pixels(shape.x1(), shape.x2());
+        if (pixels != m_shape || roiOffsets != m_roiOffsets || binY != m_binY || binX != m_binX) {
+            this->compile(pixels, roiOffsets, binY, binX);
+        }
+
+        const size_t channels = (shape.rank() == 3) ? shape.x3() : 1;
+        switch (arr.getType()) {
+            case Types::UINT8:
+                util::correct_bad_pixels(arr.getData<uint8_t>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::INT8:
+                util::correct_bad_pixels(arr.getData<int8_t>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::UINT16:
+                util::correct_bad_pixels(arr.getData<uint16_t>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::INT16:
+                util::correct_bad_pixels(arr.getData<int16_t>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::UINT32:
+                util::correct_bad_pixels(arr.getData<uint32_t>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::INT32:
+                util::correct_bad_pixels(arr.getData<int32_t>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::UINT64:
+                util::correct_bad_pixels(arr.getData<unsigned long long>(), channels, m_targets, m_offsets,
+                                         m_neighbours);
+                break;
+            case Types::INT64:
+                util::correct_bad_pixels(arr.getData<long long>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::FLOAT:
+                util::correct_bad_pixels(arr.getData<float>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            case Types::DOUBLE:
+                util::correct_bad_pixels(arr.getData<double>(), channels, m_targets, m_offsets, m_neighbours);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot correct images of type " + toString(arr.getType()));
+        }
+    }
+
+
+    void util::BadPixelCorrection::save(const std::string& filename) const {
+        std::ofstream ofs(filename, std::fstream::trunc);
+        if (!ofs) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename + " for writing");
+        }
+
+        ofs << "# x y\n";
+        for (const Defect& d : m_defects) {
+            ofs << d.x << " " << d.y << "\n";
+        }
+
+        if (!ofs) {
+            throw KARABO_IO_EXCEPTION("Could not write bad pixels to file " + filename);
+        }
+    }
+
+
+    void util::BadPixelCorrection::load(const std::string& filename) {
+        std::ifstream ifs(filename);
+        if (!ifs) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename);
+        }
+
+        std::vector<Defect> defects;
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(ifs, line)) {
+            ++lineNumber;
+            const size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+
+            std::istringstream iss(line);
+            long long x, y;
+            if (!(iss >> x >> y) || x < 0 || y < 0) {
+                throw KARABO_IO_EXCEPTION("Invalid bad pixel at line " + std::to_string(lineNumber) + " of file " +
+                                          filename);
+            }
+            defects.push_back({static_cast<unsigned int>(x), static_cast<unsigned int>(y)});
+        }
+
+        this->setDefects(defects);
+    }
+
+
+    template <class T>
+    void util::correct_bad_pixels(T* data, size_t channels, const std::vector<size_t>& targets,
+                                  const std::vector<size_t>& offsets, const std::vector<size_t>& neighbours) {
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const size_t begin = offsets[i];
+            const size_t end = offsets[i + 1];
+            if (begin == end) {
+                continue; // No valid neighbour: leave the pixel as it is
+            }
+
+            const double norm = 1. / (end - begin);
+            for (size_t c = 0; c < channels; ++c) {
+                double sum = 0.;
+                for (size_t k = begin; k < end; ++k) {
+                    sum += data[neighbours[k] * channels + c];
+                }
+                data[targets[i] * channels + c] = toPixel<T>(sum * norm);
+            }
+        }
+    }
+
+} // namespace karabo
@@ -0,0 +1,130 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_BADPIXELCORRECTION_HH
+#define KARABO_BADPIXELCORRECTION_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Correction of bad (e.g. hot or dead) pixels.
+         *
+         * Each defective pixel is replaced by the mean of its valid 8-neighbours. The neighbours are
+         * precompiled into stencils of linear offsets, for a given image shape: the cost of the correction is
+         * proportional to the number of defects, not to the frame size.
+         *
+         * The class is not thread-safe.
+         */
+        class BadPixelCorrection {
+           public:
+            /**
+             * @brief A defective pixel, i.e. its column and row.
+             */
+            struct Defect {
+                unsigned int x;
+                unsigned int y;
+            };
+
+            BadPixelCorrection() {}
+
+            /**
+             * @brief Set the list of defective pixels.
+             */
+            void setDefects(const std::vector<Defect>& defects);
+
+            const std::vector<Defect>& defects() const {
+                return m_defects;
+            }
+
+            /**
+             * @brief Detect the defective pixels in a dark reference.
+             *
+             * The pixels deviating from the median by more than nSigma robust standard deviations (1.4826 times
+             * the median absolute deviation) are considered defective. Both hot and dead pixels are detected.
+             *
+             * @param shape The shape of the reference, i.e. (height, width).
+             * @param dark The pointer to the reference data.
+             * @param nSigma The detection threshold.
+             * @return The number of defects found.
+             */
+            size_t detect(const karabo::util::Dims& shape, const float* dark, double nSigma);
+
+            /**
+             * @brief Correct an image, in place.
+             *
+             * @param arr The NDArray object - to be corrected. It must be of rank 2 or 3: for images with more than
+             * one channel, each channel is corrected independently. The defects outside the image are ignored.
+             */
+            void apply(karabo::util::NDArray& arr);
+
+            /**
+             * @brief Correct a cropped and binned image, in place.
+             *
+             * The defects are given in the coordinates of the full frame: they are mapped to the Region-of-Interest,
+             * then to the bins, so that the processed image is corrected without copying the frame. A bin containing
+             * a defect is replaced by the mean of its valid neighbouring bins.
+             *
+             * @param arr The NDArray object - to be corrected, as above.
+             * @param roiOffsets The offset of the ROI in the full frame, i.e. (roiY, roiX).
+             * @param binY The vertical binning factor.
+             * @param binX The horizontal binning factor.
+             */
+            void apply(karabo::util::NDArray& arr, const karabo::util::Dims& roiOffsets, unsigned int binY,
+                       unsigned int binX);
+
+            /**
+             * @brief Save the list of defective pixels to a local text file, with one "x y" pair per line.
+             */
+            void save(const std::string& filename) const;
+
+            /**
+             * @brief Load the list of defective pixels from a local text file, with one "x y" pair per line.
+             * Empty lines and lines starting with '#' are ignored.
+             */
+            void load(const std::string& filename);
+
+           private:
+            void compile(const karabo::util::Dims& shape, const karabo::util::Dims& roiOffsets, unsigned int binY,
+                         unsigned int binX);
+
+            std::vector<Defect> m_defects;
+
+            // The stencils compiled for m_shape, m_roiOffsets and the binning: the defect i is at m_targets[i], and
+            // its valid neighbours are at m_neighbours[m_offsets[i]] ... m_neighbours[m_offsets[i + 1] - 1]. All
+            // indices are in pixels of the processed image.
+            karabo::util::Dims m_shape;
+            karabo::util::Dims m_roiOffsets;
+            unsigned int m_binY = 1;
+            unsigned int m_binX = 1;
+            std::vector<size_t> m_targets;
+            std::vector<size_t> m_offsets;
+            std::vector<size_t> m_neighbours;
+        };
+
+        /**
+         * @brief Replace each target pixel by the mean of its neighbours.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * @param data The pointer to the image data, to be corrected in place.
+         * @param channels The number of values per pixel.
+         * @param targets The defective pixels.
+         * @param offsets The start of the neighbours of each target, plus the end of the last one.
+         * @param neighbours The valid neighbours.
+         */
+        template <class T>
+        void correct_bad_pixels(T* data, size_t channels, const std::vector<size_t>& targets,
+                                const std::vector<size_t>& offsets, const std::vector<size_t>& neighbours);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <cmath>
+
+#include "BeamProperties.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    void util::computeBeamProperties(const NDArray& arr, BeamProperties& props, double threshold,
+                                     double background) {
+        switch (arr.getType()) {
+            case Types::UINT8:
+                util::beam_properties<uint8_t>(arr, props, threshold, background);
+                break;
+            case Types::INT8:
+                util::beam_properties<int8_t>(arr, props, threshold, background);
+                break;
+            case Types::UINT16:
+                util::beam_properties<uint16_t>(arr, props, threshold, background);
+                break;
+            case Types::INT16:
+                util::beam_properties<int16_t>(arr, props, threshold, background);
+                break;
+            case Types::UINT32:
+                util::beam_properties<uint32_t>(arr, props, threshold, background);
+                break;
+            case Types::INT32:
+                util::beam_properties<int32_t>(arr, props, threshold, background);
+                break;
+            case Types::UINT64:
+                util::beam_properties<unsigned long long>(arr, props, threshold, background);
+                break;
+            case Types::INT64:
+                util::beam_properties<long long>(arr, props, threshold, background);
+                break;
+            case Types::FLOAT:
+                util::beam_properties<float>(arr, props, threshold, background);
+                break;
+            case Types::DOUBLE:
+                util::beam_properties<double>(arr, props, threshold, background);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot compute beam properties of images of type " +
+                                                 toString(arr.getType()));
+        }
+    }
+
+
+    template <class T>
+    void util::beam_properties(const NDArray& arr, BeamProperties& props, double threshold, double background) {
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2) {
+            throw KARABO_NOT_IMPLEMENTED_EXCEPTION("Can only compute beam properties of monochromatic images");
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const T* data = arr.getData<T>();
+
+        props.projectionX.assign(width, 0.);
+        props.projectionY.assign(height, 0.);
+        double* projX = props.projectionX.data();
+        double* projY = props.projectionY.data();
+
+        // Weights of the current row, and the column index, for the row first moment. NB The sums are in double
+        // precision: in float, the row moment of a 4k x 16-bit row would already lose the low-order digits.
+        std::vector<double> weights(width);
+        std::vector<double> columns(width);
+        for (size_t x = 0; x < width; ++x) {
+            columns[x] = static_cast<double>(x);
+        }
+        double* w = weights.data();
+        const double* xs = columns.data();
+
+        double sumXY = 0.; // sum of x * y * weight
+        for (size_t y = 0; y < height; ++y) {
+            const T* row = data + y * width;
+
+            double rowSum = 0.;
+            double rowMoment = 0.;
+            for (size_t x = 0; x < width; ++x) {
+                const double v = static_cast<double>(row[x]) - background;
+                w[x] = (v >= threshold) ? v : 0.;
+                rowSum += w[x];
+                rowMoment += w[x] * xs[x];
+            }
+
+            for (size_t x = 0; x < width; ++x) {
+                projX[x] += w[x];
+            }
+
+            projY[y] = rowSum;
+            sumXY += y * rowMoment;
+        }
+
+        // Moments from the projections
+        double integral = 0., sumX = 0., sumXX = 0., sumY = 0., sumYY = 0.;
+        for (size_t x = 0; x < width; ++x) {
+            integral += projX[x];
+            sumX += x * projX[x];
+            sumXX += static_cast<double>(x) * x * projX[x];
+        }
+        for (size_t y = 0; y < height; ++y) {
+            sumY += y * projY[y];
+            sumYY += static_cast<double>(y) * y * projY[y];
+        }
+
+        props.integral = integral;
+        if (integral <= 0.) {
+            props.centroidX = props.centroidY = 0.;
+            props.sigmaX = props.sigmaY = props.sigmaXY = props.tilt = 0.;
+            return;
+        }
+
+        const double cx = sumX / integral;
+        const double cy = sumY / integral;
+        const double varX = sumXX / integral - cx * cx;
+        const double varY = sumYY / integral - cy * cy;
+        const double covXY = sumXY / integral - cx * cy;
+
+        props.centroidX = cx;
+        props.centroidY = cy;
+        props.sigmaX = std::sqrt(std::max(varX, 0.));
+        props.sigmaY = std::sqrt(std::max(varY, 0.));
+        props.sigmaXY = covXY;
+        props.tilt = 0.5 * std::atan2(2. * covXY, varX - varY) * 180. / M_PI;
+    }
+
+} // namespace karabo
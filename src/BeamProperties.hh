@@ -0,0 +1,63 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_BEAMPROPERTIES_HH
+#define KARABO_BEAMPROPERTIES_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief The projections and moments of an image. Positions and sizes are in pixels of the image.
+         */
+        struct BeamProperties {
+            std::vector<double> projectionX; // sum of the weights in each column
+            std::vector<double> projectionY; // sum of the weights in each row
+            double integral = 0.;            // sum of all the weights
+            double centroidX = 0.;
+            double centroidY = 0.;
+            double sigmaX = 0.;  // standard deviation along X
+            double sigmaY = 0.;  // standard deviation along Y
+            double sigmaXY = 0.; // covariance
+            double tilt = 0.;    // angle of the major axis w.r.t. the X axis [deg]
+        };
+
+        /**
+         * @brief Compute the X/Y projections, the intensity-weighted centroid and the second moments of an image,
+         * in a single pass.
+         *
+         * The weight of each pixel is (value - background), or zero if this is below threshold. Each row is
+         * converted into weights, which are added to the X projection and reduced to the row sum and the
+         * row first moment: the Y projection and all the moments are then obtained from these, without going
+         * through the image again.
+         *
+         * @param arr The NDArray object - to be analysed. It must be a monochromatic image.
+         * @param props The computed properties. Its vectors are reused, to avoid allocations.
+         * @param threshold The minimum weight of a pixel to be taken into account.
+         * @param background The background level, to be subtracted from the pixel values.
+         */
+        void computeBeamProperties(const karabo::util::NDArray& arr, BeamProperties& props, double threshold = 0.,
+                                   double background = 0.);
+
+        /**
+         * @brief Compute the beam properties of an image.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * See computeBeamProperties for the other parameters.
+         */
+        template <class T>
+        void beam_properties(const karabo::util::NDArray& arr, BeamProperties& props, double threshold,
+                             double background);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
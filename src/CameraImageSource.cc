@@ -21,7 +21,7 @@ namespace karabo {
     void CameraImageSource::expectedParameters(Schema& expected) {
         VECTOR_STRING_ELEMENT(expected).key("availableScenes")
             .setSpecialDisplayType(KARABO_SCHEMA_DISPLAY_TYPE_SCENES)
-            .readOnly().initialValue(std::vector<std::string>({"scene"}))
+            .readOnly().initialValue(std::vector<std::string>({"scene", "overview"}))
             .commit();
     }
 
@@ -29,6 +29,7 @@ namespace karabo {
     CameraImageSource::CameraImageSource(const karabo::util::Hash& config) : ImageSource(config) {
         KARABO_SLOT(requestScene, karabo::util::Hash)
         this->registerScene(boost::bind(&Self::scene, this), "scene");
+        this->registerScene(boost::bind(&Self::overviewScene, this), "overview");
     }
 
 
@@ -50,7 +51,6 @@ namespace karabo {
         payload.set("success", false);
 
         // see if the scene requested is in the map of available scenes
-        // NOTE: This is overkill for the moment since there is only one scene.
         if (it != m_scenes.end()) {
             const SceneFunction& f = it->second;
             if (!f.empty()) {
@@ -41,6 +41,8 @@ namespace karabo {
         void registerScene(const SceneFunction& sceneFunction, const std::string& funcName);
         // the main scene
         std::string scene();
+        // a compact scene, showing the thumbnail instead of the full-rate output
+        std::string overviewScene();
     };
 
 
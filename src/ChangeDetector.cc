@@ -0,0 +1,145 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ChangeDetector.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // Sum of absolute differences, in blocks to limit the rounding errors of the float sums. There are no
+        // branches in the inner loop, so that it can be vectorized.
+        double sumAbsDiff(const float* a, const float* b, size_t size) {
+            const size_t blockSize = 65536;
+            double total = 0.;
+            for (size_t begin = 0; begin < size; begin += blockSize) {
+                const size_t end = std::min(begin + blockSize, size);
+                float sum = 0.f;
+                for (size_t i = begin; i < end; ++i) {
+                    sum += std::fabs(a[i] - b[i]);
+                }
+                total += sum;
+            }
+            return total;
+        }
+
+    } // namespace
+
+
+    util::ChangeDetector::ChangeDetector() : m_tolerance(0.), m_step(1), m_difference(0.), m_kType(Types::UNKNOWN) {}
+
+
+    void util::ChangeDetector::configure(double tolerance, unsigned int step) {
+        if (tolerance < 0.) {
+            throw KARABO_PARAMETER_EXCEPTION("The tolerance must not be negative");
+        }
+
+        m_tolerance = tolerance;
+        m_step = (step > 0) ? step : 1;
+        this->reset();
+    }
+
+
+    void util::ChangeDetector::reset() {
+        m_shape = Dims();
+        m_kType = Types::UNKNOWN;
+        m_reference.clear();
+        m_difference = 0.;
+    }
+
+
+    bool util::ChangeDetector::hasChanged(const NDArray& arr) {
+        switch (arr.getType()) {
+            case Types::UINT8:
+                util::sample_frame<uint8_t>(arr, m_step, m_samples);
+                break;
+            case Types::INT8:
+                util::sample_frame<int8_t>(arr, m_step, m_samples);
+                break;
+            case Types::UINT16:
+                util::sample_frame<uint16_t>(arr, m_step, m_samples);
+                break;
+            case Types::INT16:
+                util::sample_frame<int16_t>(arr, m_step, m_samples);
+                break;
+            case Types::UINT32:
+                util::sample_frame<uint32_t>(arr, m_step, m_samples);
+                break;
+            case Types::INT32:
+                util::sample_frame<int32_t>(arr, m_step, m_samples);
+                break;
+            case Types::FLOAT:
+                util::sample_frame<float>(arr, m_step, m_samples);
+                break;
+            case Types::DOUBLE:
+                util::sample_frame<double>(arr, m_step, m_samples);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot compare images of type " + toString(arr.getType()));
+        }
+
+        const Dims shape = arr.getShape();
+        if (m_reference.empty() || shape != m_shape || arr.getType() != m_kType ||
+            m_samples.size() != m_reference.size()) {
+            m_difference = 0.;
+        } else {
+            const size_t size = m_samples.size();
+            m_difference = (size > 0) ? sumAbsDiff(m_samples.data(), m_reference.data(), size) / size : 0.;
+            if (m_difference <= m_tolerance) {
+                return false;
+            }
+        }
+
+        // New reference
+        m_shape = shape;
+        m_kType = arr.getType();
+        m_reference.swap(m_samples);
+        return true;
+    }
+
+
+    template <class T>
+    void util::sample_frame(const NDArray& arr, unsigned int step, std::vector<float>& samples) {
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2 && shape.rank() != 3) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot compare image of rank " + std::to_string(shape.rank()));
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const size_t channels = (shape.rank() == 3) ? shape.x3() : 1;
+        const size_t rowLength = width * channels;
+        const T* data = arr.getData<T>();
+
+        samples.resize(((height + step - 1) / step) * ((width + step - 1) / step) * channels);
+        float* out = samples.data();
+        for (size_t y = 0; y < height; y += step) {
+            const T* row = data + y * rowLength;
+            if (step == 1) {
+                for (size_t i = 0; i < rowLength; ++i) {
+                    out[i] = static_cast<float>(row[i]);
+                }
+                out += rowLength;
+            } else {
+                for (size_t x = 0; x < width; x += step) {
+                    for (size_t c = 0; c < channels; ++c) {
+                        *out++ = static_cast<float>(row[x * channels + c]);
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace karabo
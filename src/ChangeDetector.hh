@@ -0,0 +1,87 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_CHANGEDETECTOR_HH
+#define KARABO_CHANGEDETECTOR_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Detection of the frames which differ from the last published one.
+         *
+         * Every step-th row and column of the frame is sampled, and the mean absolute difference to the samples
+         * of the reference frame - i.e. the last frame found to be changed - is computed. Comparing to the
+         * reference, rather than to the previous frame, ensures that slow drifts are eventually detected.
+         *
+         * The class is not thread-safe.
+         */
+        class ChangeDetector {
+           public:
+            ChangeDetector();
+
+            /**
+             * @brief Set the detection parameters. The reference is discarded.
+             *
+             * @param tolerance A frame is changed if its mean absolute difference to the reference is larger
+             * than tolerance.
+             * @param step Only compare every step-th row and column.
+             */
+            void configure(double tolerance, unsigned int step);
+
+            /**
+             * @brief Discard the reference: the next frame is considered as changed.
+             */
+            void reset();
+
+            /**
+             * @brief Compare a frame to the reference.
+             *
+             * The frame is considered as changed - and becomes the new reference - if there is no reference, if
+             * its shape or type differs from the reference, or if the difference exceeds the tolerance.
+             *
+             * @param arr The NDArray object - to be compared. It must be of rank 2 or 3.
+             * @return true if the frame has changed.
+             */
+            bool hasChanged(const karabo::util::NDArray& arr);
+
+            /**
+             * @brief The mean absolute difference computed for the last frame.
+             */
+            double difference() const {
+                return m_difference;
+            }
+
+           private:
+            double m_tolerance;
+            unsigned int m_step;
+            double m_difference;
+            karabo::util::Dims m_shape;
+            karabo::util::Types::ReferenceType m_kType;
+            std::vector<float> m_reference; // The sampled values of the reference frame
+            std::vector<float> m_samples;   // The sampled values of the current frame
+        };
+
+        /**
+         * @brief Sample every step-th row and column of an image.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * @param arr The NDArray object - to be sampled. It must be of rank 2 or 3.
+         * @param step The sampling step.
+         * @param samples The sampled values. The vector is reused, to avoid allocations.
+         */
+        template <class T>
+        void sample_frame(const karabo::util::NDArray& arr, unsigned int step, std::vector<float>& samples);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
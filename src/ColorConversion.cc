@@ -0,0 +1,286 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "ColorConversion.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // The rows are converted in parallel bands, each one covering at least this number of values
+        constexpr size_t BAND_SIZE = 1 << 16;
+
+
+        double nStripes(size_t rows, size_t rowSize) {
+            return std::max<double>(1., std::min<double>(rows, double(rows) * rowSize / BAND_SIZE));
+        }
+
+
+        void checkType(const NDArray& arr) {
+            const Types::ReferenceType kType = arr.getType();
+            if (kType != Types::UINT8 && kType != Types::UINT16) {
+                throw KARABO_PARAMETER_EXCEPTION("Cannot convert images of type " + toString(kType) +
+                                                 ": only UINT8 and UINT16 are supported");
+            }
+        }
+
+
+        template <class T>
+        inline T clip(float value) {
+            const float hi = static_cast<float>(std::numeric_limits<T>::max());
+            return static_cast<T>(std::min(std::max(value, 0.f), hi) + 0.5f);
+        }
+
+    } // namespace
+
+
+    void util::demosaicBayer(karabo::xms::ImageData& imd, BayerPattern pattern, bool edgeAware) {
+        const NDArray& arr = imd.getData();
+        checkType(arr);
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2 || shape.x1() < 2 || shape.x2() < 2) {
+            throw KARABO_PARAMETER_EXCEPTION("A Bayer image must be of shape (height, width), with height and "
+                                             "width not smaller than 2");
+        }
+
+        const int height = shape.x1();
+        const int width = shape.x2();
+        const bool is8bit = (arr.getType() == Types::UINT8);
+
+        // NB OpenCV names the patterns after the second and third pixels of the second row
+        int code;
+        switch (pattern) {
+            case BayerPattern::RGGB:
+                code = edgeAware ? cv::COLOR_BayerBG2RGB_EA : cv::COLOR_BayerBG2RGB;
+                break;
+            case BayerPattern::GRBG:
+                code = edgeAware ? cv::COLOR_BayerGB2RGB_EA : cv::COLOR_BayerGB2RGB;
+                break;
+            case BayerPattern::GBRG:
+                code = edgeAware ? cv::COLOR_BayerGR2RGB_EA : cv::COLOR_BayerGR2RGB;
+                break;
+            case BayerPattern::BGGR:
+                code = edgeAware ? cv::COLOR_BayerRG2RGB_EA : cv::COLOR_BayerRG2RGB;
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Invalid Bayer pattern");
+        }
+
+        const Dims outShape(height, width, 3);
+        NDArray out(outShape, arr.getType());
+
+        // OpenCV converts in parallel, and with SIMD instructions
+        cv::Mat in(height, width, is8bit ? CV_8UC1 : CV_16UC1, (void*)arr.getData<char>());
+        cv::Mat rgb(height, width, is8bit ? CV_8UC3 : CV_16UC3, (void*)out.getData<char>());
+        cv::cvtColor(in, rgb, code);
+
+        imd.setData(out);
+        imd.setDimensions(outShape);
+        imd.setEncoding(Encoding::RGB);
+    }
+
+
+    void util::bayerToGray(karabo::xms::ImageData& imd, BayerPattern pattern) {
+        const NDArray& arr = imd.getData();
+        checkType(arr);
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2 || shape.x1() < 2 || shape.x2() < 2) {
+            throw KARABO_PARAMETER_EXCEPTION("A Bayer image must be of shape (height, width), with height and "
+                                             "width not smaller than 2");
+        }
+
+        const size_t width = shape.x2();
+        const size_t outHeight = shape.x1() / 2;
+        const size_t outWidth = width / 2;
+        const Dims outShape(outHeight, outWidth);
+        NDArray out(outShape, arr.getType());
+
+        cv::parallel_for_(
+              cv::Range(0, outHeight),
+              [&](const cv::Range& band) {
+                  if (arr.getType() == Types::UINT8) {
+                      util::bayer_to_gray(arr.getData<uint8_t>(), width, pattern, band.start, band.end,
+                                          out.getData<uint8_t>());
+                  } else {
+                      util::bayer_to_gray(arr.getData<uint16_t>(), width, pattern, band.start, band.end,
+                                          out.getData<uint16_t>());
+                  }
+              },
+              nStripes(outHeight, 2 * width));
+
+        const Dims binning = imd.getBinning();
+        imd.setData(out);
+        imd.setDimensions(outShape);
+        imd.setEncoding(Encoding::GRAY);
+        if (binning.rank() == 2) {
+            imd.setBinning(Dims(2 * binning.x1(), 2 * binning.x2()));
+        }
+    }
+
+
+    void util::yuv422ToRgb(karabo::xms::ImageData& imd, YuvOrder order) {
+        const NDArray& arr = imd.getData();
+        checkType(arr);
+        const Dims shape = arr.getShape();
+
+        size_t width;
+        if (shape.rank() == 3 && shape.x3() == 2) {
+            width = shape.x2();
+        } else if (shape.rank() == 2 && shape.x2() % 2 == 0) {
+            width = shape.x2() / 2;
+        } else {
+            throw KARABO_PARAMETER_EXCEPTION("A YUV 4:2:2 image must be of shape (height, width, 2) or "
+                                             "(height, 2 * width)");
+        }
+        if (width % 2 != 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The width of a YUV 4:2:2 image must be even");
+        }
+
+        const size_t height = shape.x1();
+        const Dims outShape(height, width, 3);
+        NDArray out(outShape, arr.getType());
+
+        cv::parallel_for_(
+              cv::Range(0, height),
+              [&](const cv::Range& band) {
+                  if (arr.getType() == Types::UINT8) {
+                      util::yuv422_to_rgb(arr.getData<uint8_t>(), width, order, band.start, band.end,
+                                          out.getData<uint8_t>());
+                  } else {
+                      util::yuv422_to_rgb(arr.getData<uint16_t>(), width, order, band.start, band.end,
+                                          out.getData<uint16_t>());
+                  }
+              },
+              nStripes(height, 3 * width));
+
+        imd.setData(out);
+        imd.setDimensions(outShape);
+        imd.setEncoding(Encoding::RGB);
+    }
+
+
+    void util::rgbToGray(karabo::xms::ImageData& imd) {
+        const NDArray& arr = imd.getData();
+        checkType(arr);
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 3 || shape.x3() != 3) {
+            throw KARABO_PARAMETER_EXCEPTION("An RGB image must be of shape (height, width, 3)");
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const Dims outShape(height, width);
+        NDArray out(outShape, arr.getType());
+
+        cv::parallel_for_(
+              cv::Range(0, height),
+              [&](const cv::Range& band) {
+                  if (arr.getType() == Types::UINT8) {
+                      util::rgb_to_gray(arr.getData<uint8_t>(), width, band.start, band.end, out.getData<uint8_t>());
+                  } else {
+                      util::rgb_to_gray(arr.getData<uint16_t>(), width, band.start, band.end,
+                                        out.getData<uint16_t>());
+                  }
+              },
+              nStripes(height, 3 * width));
+
+        imd.setData(out);
+        imd.setDimensions(outShape);
+        imd.setEncoding(Encoding::GRAY);
+    }
+
+
+    template <class T>
+    void util::bayer_to_gray(const T* in, size_t width, BayerPattern pattern, size_t y0, size_t y1, T* out) {
+        // Luma weights (x256) of the four pixels of a cell: R 77, G 75 + 75, B 29
+        uint32_t w[4];
+        switch (pattern) {
+            case BayerPattern::RGGB:
+                w[0] = 77, w[1] = 75, w[2] = 75, w[3] = 29;
+                break;
+            case BayerPattern::GRBG:
+                w[0] = 75, w[1] = 77, w[2] = 29, w[3] = 75;
+                break;
+            case BayerPattern::GBRG:
+                w[0] = 75, w[1] = 29, w[2] = 77, w[3] = 75;
+                break;
+            default: // BGGR
+                w[0] = 29, w[1] = 75, w[2] = 75, w[3] = 77;
+        }
+
+        const size_t outWidth = width / 2;
+        for (size_t y = y0; y < y1; ++y) {
+            const T* r0 = in + 2 * y * width;
+            const T* r1 = r0 + width;
+            T* o = out + y * outWidth;
+            for (size_t x = 0; x < outWidth; ++x) {
+                const uint32_t sum = w[0] * r0[2 * x] + w[1] * r0[2 * x + 1] + w[2] * r1[2 * x] +
+                                     w[3] * r1[2 * x + 1];
+                o[x] = static_cast<T>((sum + 128) >> 8);
+            }
+        }
+    }
+
+
+    template <class T>
+    void util::yuv422_to_rgb(const T* in, size_t width, YuvOrder order, size_t y0, size_t y1, T* out) {
+        // Positions of the components in a 4-value group: Y0 U Y1 V (YUYV) or U Y0 V Y1 (UYVY)
+        const size_t iY = (order == YuvOrder::YUYV) ? 0 : 1;
+        const size_t iU = (order == YuvOrder::YUYV) ? 1 : 0;
+        const size_t iV = iU + 2;
+
+        // Limited range offsets, scaled to the bit depth
+        const float scale = static_cast<float>(1 << (8 * (sizeof(T) - 1)));
+        const float yOffset = 16.f * scale;
+        const float cOffset = 128.f * scale;
+
+        for (size_t y = y0; y < y1; ++y) {
+            const T* row = in + 2 * y * width;
+            T* o = out + 3 * y * width;
+            for (size_t x = 0; x < width; x += 2) {
+                const T* g = row + 2 * x;
+                const float u = g[iU] - cOffset;
+                const float v = g[iV] - cOffset;
+                const float dr = 1.596f * v;
+                const float dg = -0.392f * u - 0.813f * v;
+                const float db = 2.017f * u;
+                for (size_t k = 0; k < 2; ++k) {
+                    const float luma = 1.164f * (g[iY + 2 * k] - yOffset);
+                    T* p = o + 3 * (x + k);
+                    p[0] = clip<T>(luma + dr);
+                    p[1] = clip<T>(luma + dg);
+                    p[2] = clip<T>(luma + db);
+                }
+            }
+        }
+    }
+
+
+    template <class T>
+    void util::rgb_to_gray(const T* in, size_t width, size_t y0, size_t y1, T* out) {
+        for (size_t y = y0; y < y1; ++y) {
+            const T* row = in + 3 * y * width;
+            T* o = out + y * width;
+            for (size_t x = 0; x < width; ++x) {
+                const uint32_t sum = 77u * row[3 * x] + 150u * row[3 * x + 1] + 29u * row[3 * x + 2];
+                o[x] = static_cast<T>((sum + 128) >> 8);
+            }
+        }
+    }
+
+} // namespace karabo
@@ -0,0 +1,115 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_COLORCONVERSION_HH
+#define KARABO_COLORCONVERSION_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief The colour filter pattern of a Bayer sensor, i.e. the colours of its top-left 2x2 pixels, row
+         * by row.
+         */
+        enum class BayerPattern { RGGB = 0, GRBG, GBRG, BGGR };
+
+        /**
+         * @brief The byte order of packed YUV 4:2:2 data.
+         */
+        enum class YuvOrder { UYVY = 0, YUYV };
+
+        /**
+         * @brief Demosaic a Bayer image to RGB, at full resolution.
+         *
+         * @param imd The ImageData object - to be converted. It must be a UINT8 or UINT16 image of shape
+         * (height, width). A new (height, width, 3) array is assigned to it, and its encoding is set to RGB.
+         * @param pattern The colour filter pattern.
+         * @param edgeAware If true, use an edge-aware interpolation instead of the bilinear one. It reduces
+         * the colour artefacts at sharp edges, at a higher cost.
+         */
+        void demosaicBayer(karabo::xms::ImageData& imd, BayerPattern pattern, bool edgeAware = false);
+
+        /**
+         * @brief Convert a Bayer image to GRAY, at half resolution.
+         *
+         * Each 2x2 cell is converted to a pixel: Y = 0.299 R + 0.587 (G1 + G2) / 2 + 0.114 B. This is
+         * much cheaper than demosaicing, and the binning of the ImageData is doubled accordingly.
+         *
+         * @param imd The ImageData object - to be converted. It must be a UINT8 or UINT16 image of shape
+         * (height, width). A new (height / 2, width / 2) array is assigned to it, and its encoding is set to
+         * GRAY.
+         * @param pattern The colour filter pattern.
+         */
+        void bayerToGray(karabo::xms::ImageData& imd, BayerPattern pattern);
+
+        /**
+         * @brief Convert a packed YUV 4:2:2 image to RGB (ITU-R BT.601, limited range).
+         *
+         * @param imd The ImageData object - to be converted. It must be a UINT8 or UINT16 image of shape
+         * (height, width, 2) or (height, 2 * width). A new (height, width, 3) array is assigned to it, and its
+         * encoding is set to RGB.
+         * @param order The order of the components.
+         */
+        void yuv422ToRgb(karabo::xms::ImageData& imd, YuvOrder order);
+
+        /**
+         * @brief Convert an RGB image to GRAY: Y = 0.299 R + 0.587 G + 0.114 B.
+         *
+         * @param imd The ImageData object - to be converted. It must be a UINT8 or UINT16 image of shape
+         * (height, width, 3). A new (height, width) array is assigned to it, and its encoding is set to GRAY.
+         */
+        void rgbToGray(karabo::xms::ImageData& imd);
+
+        /**
+         * @brief Convert rows [y0, y1) of a Bayer image to GRAY at half resolution.
+         *
+         * @param T The pixel data type, i.e. uint8_t or uint16_t.
+         * @param in The pointer to the input data
+         * @param width The input width
+         * @param pattern The colour filter pattern
+         * @param y0 The first output row
+         * @param y1 The output row after the last one
+         * @param out The pointer to the output data, of width width / 2
+         */
+        template <class T>
+        void bayer_to_gray(const T* in, size_t width, BayerPattern pattern, size_t y0, size_t y1, T* out);
+
+        /**
+         * @brief Convert rows [y0, y1) of a packed YUV 4:2:2 image to RGB.
+         *
+         * @param T The pixel data type, i.e. uint8_t or uint16_t.
+         * @param in The pointer to the input data, 2 * width values per row
+         * @param width The image width, in pixels. It must be even.
+         * @param order The order of the components
+         * @param y0 The first row
+         * @param y1 The row after the last one
+         * @param out The pointer to the output data, 3 * width values per row
+         */
+        template <class T>
+        void yuv422_to_rgb(const T* in, size_t width, YuvOrder order, size_t y0, size_t y1, T* out);
+
+        /**
+         * @brief Convert rows [y0, y1) of an RGB image to GRAY.
+         *
+         * @param T The pixel data type, i.e. uint8_t or uint16_t.
+         * @param in The pointer to the input data, 3 * width values per row
+         * @param width The image width
+         * @param y0 The first row
+         * @param y1 The row after the last one
+         * @param out The pointer to the output data
+         */
+        template <class T>
+        void rgb_to_gray(const T* in, size_t width, size_t y0, size_t y1, T* out);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
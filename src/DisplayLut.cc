@@ -0,0 +1,173 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "DisplayLut.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // The smallest value such that the given fraction of the values is not larger than it
+        double quantile(const std::vector<unsigned int>& histogram, unsigned long long count, double fraction) {
+            const double target = std::min(std::max(fraction, 0.), 1.) * count;
+            unsigned long long cumulative = 0;
+            for (size_t value = 0; value < histogram.size(); ++value) {
+                cumulative += histogram[value];
+                if (cumulative > 0 && cumulative >= target) {
+                    return value;
+                }
+            }
+            return histogram.size() - 1;
+        }
+
+
+        template <class T>
+        void percentile_range(const NDArray& arr, double lowFraction, double highFraction, double& low,
+                              double& high, unsigned int step, std::vector<unsigned int>& histogram) {
+            const T* data = arr.getData<T>();
+            const size_t size = arr.size();
+            const size_t bins = size_t(std::numeric_limits<T>::max()) + 1;
+            if (histogram.size() != bins) {
+                histogram.assign(bins, 0);
+            }
+            unsigned int* h = histogram.data();
+            for (size_t i = 0; i < size; i += step) {
+                ++h[data[i]];
+            }
+            const unsigned long long count = (size + step - 1) / step;
+
+            low = quantile(histogram, count, lowFraction);
+            high = quantile(histogram, count, highFraction);
+
+            // Leave the buffer zeroed for the next call, by the cheaper of the two ways
+            if (count < bins) {
+                for (size_t i = 0; i < size; i += step) {
+                    h[data[i]] = 0;
+                }
+            } else {
+                std::fill(histogram.begin(), histogram.end(), 0u);
+            }
+        }
+
+    } // namespace
+
+
+    void util::buildDisplayLut(std::vector<uint8_t>& lut, double low, double high, LutMode mode, double gamma,
+                               size_t size) {
+        if (mode == LutMode::GAMMA && !(gamma > 0.)) {
+            throw KARABO_PARAMETER_EXCEPTION("The gamma exponent must be positive");
+        }
+
+        lut.resize(size);
+        if (!(high > low)) {
+            for (size_t v = 0; v < size; ++v) {
+                lut[v] = (v > low) ? 255 : 0;
+            }
+            return;
+        }
+
+        const double scale = 1. / (high - low);
+        const double logNorm = 1. / std::log1p(high - low);
+        for (size_t v = 0; v < size; ++v) {
+            const double t = std::min(std::max((v - low) * scale, 0.), 1.);
+            double f;
+            switch (mode) {
+                case LutMode::GAMMA:
+                    f = std::pow(t, gamma);
+                    break;
+                case LutMode::LOG:
+                    f = std::log1p(t * (high - low)) * logNorm;
+                    break;
+                default:
+                    f = t;
+            }
+            lut[v] = static_cast<uint8_t>(255. * f + 0.5);
+        }
+    }
+
+
+    void util::percentileRange(const NDArray& arr, double lowPercentile, double highPercentile, double& low,
+                               double& high, unsigned int step) {
+        std::vector<unsigned int> histogram;
+        util::percentileRange(arr, lowPercentile, highPercentile, low, high, step, histogram);
+    }
+
+
+    void util::percentileRange(const NDArray& arr, double lowPercentile, double highPercentile, double& low,
+                               double& high, unsigned int step, std::vector<unsigned int>& histogram) {
+        if (step == 0) {
+            step = 1;
+        }
+
+        switch (arr.getType()) {
+            case Types::UINT8:
+                percentile_range<uint8_t>(arr, 0.01 * lowPercentile, 0.01 * highPercentile, low, high, step,
+                                          histogram);
+                break;
+            case Types::UINT16:
+                percentile_range<uint16_t>(arr, 0.01 * lowPercentile, 0.01 * highPercentile, low, high, step,
+                                           histogram);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot compute the percentiles of images of type " +
+                                                 toString(arr.getType()));
+        }
+    }
+
+
+    bool util::displayWindowMoved(double previousLow, double previousHigh, double low, double high) {
+        const double deadband = std::max(previousHigh - previousLow, 0.) / 256.;
+        return std::abs(low - previousLow) > deadband || std::abs(high - previousHigh) > deadband;
+    }
+
+
+    void util::applyDisplayLut(karabo::xms::ImageData& imd, const std::vector<uint8_t>& lut) {
+        const NDArray& arr = imd.getData();
+        const Dims dims = arr.getShape();
+        NDArray mapped(dims, Types::UINT8);
+
+        switch (arr.getType()) {
+            case Types::UINT8:
+                if (lut.size() < 256) {
+                    throw KARABO_PARAMETER_EXCEPTION("The look-up table is too small for UINT8 images");
+                }
+                util::apply_display_lut(arr.getData<uint8_t>(), arr.size(), lut.data(), mapped.getData<uint8_t>());
+                break;
+            case Types::UINT16:
+                if (lut.size() < 65536) {
+                    throw KARABO_PARAMETER_EXCEPTION("The look-up table is too small for UINT16 images");
+                }
+                util::apply_display_lut(arr.getData<uint16_t>(), arr.size(), lut.data(), mapped.getData<uint8_t>());
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot map images of type " + toString(arr.getType()));
+        }
+
+        imd.setData(mapped);
+        imd.setDimensions(dims);
+        imd.setBitsPerPixel(8);
+    }
+
+
+    template <class T>
+    void util::apply_display_lut(const T* data, size_t size, const uint8_t* lut, uint8_t* mapped) {
+        // The table covers the full range of T: no bounds check is needed, and it stays in cache (64 kB at most)
+        for (size_t i = 0; i < size; ++i) {
+            mapped[i] = lut[data[i]];
+        }
+    }
+
+} // namespace karabo
@@ -0,0 +1,97 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_DISPLAYLUT_HH
+#define KARABO_DISPLAYLUT_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        enum class LutMode {
+            LINEAR = 0, // linear mapping of the window
+            GAMMA,      // t^gamma, t being the position in the window in [0, 1]
+            LOG         // logarithmic mapping of the window
+        };
+
+        /**
+         * @brief Build a look-up table mapping pixel values to 8 bits.
+         *
+         * The values in the window [low, high] are mapped to [0, 255]; the ones outside it are clipped.
+         *
+         * @param lut The look-up table. It is resized to the requested size.
+         * @param low The lower edge of the window.
+         * @param high The upper edge of the window. If it is not larger than low, a step function is built.
+         * @param mode The mapping function.
+         * @param gamma The exponent, for GAMMA mode. It must be positive.
+         * @param size The number of entries, i.e. 256 for 8-bit or 65536 for 16-bit images.
+         */
+        void buildDisplayLut(std::vector<uint8_t>& lut, double low, double high, LutMode mode, double gamma = 1.,
+                             size_t size = 65536);
+
+        /**
+         * @brief Compute the window containing a given fraction of the pixel values, from a subsampled histogram.
+         *
+         * @param arr The NDArray object - to be analysed. It must be of type UINT8 or UINT16.
+         * @param lowPercentile The percentage of values below the window.
+         * @param highPercentile The percentage of values below the upper edge of the window.
+         * @param low The lower edge of the window.
+         * @param high The upper edge of the window.
+         * @param step Only analyse every step-th value.
+         */
+        void percentileRange(const karabo::util::NDArray& arr, double lowPercentile, double highPercentile,
+                             double& low, double& high, unsigned int step = 4);
+
+        /**
+         * @brief Compute the window containing a given fraction of the pixel values, reusing a histogram buffer.
+         *
+         * As above, for frame rate use: the histogram is neither allocated nor fully cleared at each call.
+         *
+         * @param histogram The buffer of the histogram. It is resized on the first call, and left zeroed.
+         */
+        void percentileRange(const karabo::util::NDArray& arr, double lowPercentile, double highPercentile,
+                             double& low, double& high, unsigned int step, std::vector<unsigned int>& histogram);
+
+        /**
+         * @brief Return true if a display window moved enough for the look-up table to be rebuilt, i.e. if an edge
+         * moved by more than one output level of the previous window, (previousHigh - previousLow) / 256.
+         *
+         * @param previousLow The lower edge of the window the table was built for.
+         * @param previousHigh The upper edge of the window the table was built for.
+         * @param low The lower edge of the new window.
+         * @param high The upper edge of the new window.
+         */
+        bool displayWindowMoved(double previousLow, double previousHigh, double low, double high);
+
+        /**
+         * @brief Map an UINT8 or UINT16 image to UINT8, via a look-up table.
+         *
+         * @param imd The ImageData object - to be mapped. The input data are not modified: a new array is
+         * assigned to it, and its bits-per-pixel is set to 8.
+         * @param lut The look-up table. Its size must be at least 256 for UINT8 and 65536 for UINT16 images.
+         */
+        void applyDisplayLut(karabo::xms::ImageData& imd, const std::vector<uint8_t>& lut);
+
+        /**
+         * @brief Map an array of pixels via a look-up table.
+         *
+         * @param T The input pixel data type, i.e. uint8_t or uint16_t.
+         * @param data The pointer to the input data
+         * @param size The number of values
+         * @param lut The pointer to the look-up table, covering the full range of T
+         * @param mapped The pointer to the output data
+         */
+        template <class T>
+        void apply_display_lut(const T* data, size_t size, const uint8_t* lut, uint8_t* mapped);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,362 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+#include "FlatFieldCorrection.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        const char FILE_MAGIC[8] = {'K', 'R', 'B', 'F', 'F', 'C', '0', '1'};
+
+
+        template <class Out>
+        inline typename std::enable_if<std::is_floating_point<Out>::value, Out>::type toPixel(float value) {
+            return value;
+        }
+
+
+        template <class Out>
+        inline typename std::enable_if<std::is_integral<Out>::value, Out>::type toPixel(float value) {
+            // Clip, then round half away from zero. Written without branches, so that the loop can be vectorized.
+            const float lo = static_cast<float>(std::numeric_limits<Out>::min());
+            // NB the maximum of 32-bit types is not representable as float: use the largest float below it
+            const float max = static_cast<float>(std::numeric_limits<Out>::max());
+            const float hi = (sizeof(Out) < 4) ? max : std::nextafter(max, 0.f);
+            value = std::min(std::max(value, lo), hi);
+            return static_cast<Out>(value + std::copysign(0.5f, value));
+        }
+
+
+        template <class T>
+        void accumulate(const NDArray& frame, std::vector<double>& sum) {
+            const T* data = frame.getData<T>();
+            const size_t size = sum.size();
+            for (size_t i = 0; i < size; ++i) {
+                sum[i] += data[i];
+            }
+        }
+
+
+        template <class T>
+        NDArray correct(const NDArray& arr, const float* offset, const float* gain, bool toFloat,
+                        util::FramePool* pool) {
+            const T* raw = arr.getData<T>();
+            const size_t size = arr.size();
+            const Types::ReferenceType outType = (offset == nullptr || toFloat) ? Types::FLOAT : arr.getType();
+            NDArray out = pool ? pool->allocate(arr.getShape(), outType) : NDArray(arr.getShape(), outType);
+
+            if (offset == nullptr) {
+                // No references: convert to FLOAT only
+                float* data = out.getData<float>();
+                for (size_t i = 0; i < size; ++i) {
+                    data[i] = static_cast<float>(raw[i]);
+                }
+            } else if (toFloat) {
+                util::flat_field_correct(raw, offset, gain, size, out.getData<float>());
+            } else {
+                util::flat_field_correct(raw, offset, gain, size, out.getData<T>());
+            }
+            return out;
+        }
+
+    } // namespace
+
+
+    util::FlatFieldCorrection::FlatFieldCorrection()
+        : m_isAcquiring(false), m_reference(DARK), m_nFrames(0), m_frameCount(0) {}
+
+
+    void util::FlatFieldCorrection::acquire(Reference reference, unsigned int nFrames) {
+        if (nFrames == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The number of frames to be averaged must be positive");
+        }
+
+        m_reference = reference;
+        m_nFrames = nFrames;
+        m_frameCount = 0;
+        m_sumShape = Dims();
+        m_sum.clear();
+        m_isAcquiring = true;
+    }
+
+
+    bool util::FlatFieldCorrection::isSupported(Types::ReferenceType type) {
+        switch (type) {
+            case Types::UINT8:
+            case Types::INT8:
+            case Types::UINT16:
+            case Types::INT16:
+            case Types::UINT32:
+            case Types::INT32:
+            case Types::FLOAT:
+            case Types::DOUBLE:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    bool util::FlatFieldCorrection::addFrame(const NDArray& frame) {
+        if (!m_isAcquiring) {
+            return false;
+        }
+
+        if (!isSupported(frame.getType())) {
+            m_isAcquiring = false;
+            throw KARABO_PARAMETER_EXCEPTION("Cannot build a reference from images of type " +
+                                             toString(frame.getType()));
+        }
+
+        const Dims shape = frame.getShape();
+        if (m_sum.empty() || shape != m_sumShape) {
+            // First frame, or the image shape changed: (re)start the acquisition
+            m_sumShape = shape;
+            m_sum.assign(frame.size(), 0.);
+            m_frameCount = 0;
+        }
+
+        switch (frame.getType()) {
+            case Types::UINT8:
+                accumulate<uint8_t>(frame, m_sum);
+                break;
+            case Types::INT8:
+                accumulate<int8_t>(frame, m_sum);
+                break;
+            case Types::UINT16:
+                accumulate<uint16_t>(frame, m_sum);
+                break;
+            case Types::INT16:
+                accumulate<int16_t>(frame, m_sum);
+                break;
+            case Types::UINT32:
+                accumulate<uint32_t>(frame, m_sum);
+                break;
+            case Types::INT32:
+                accumulate<int32_t>(frame, m_sum);
+                break;
+            case Types::FLOAT:
+                accumulate<float>(frame, m_sum);
+                break;
+            default: // DOUBLE
+                accumulate<double>(frame, m_sum);
+                break;
+        }
+
+        if (++m_frameCount < m_nFrames) {
+            return false;
+        }
+
+        // Reference completed
+        std::vector<float>& ref = (m_reference == DARK) ? m_dark : m_flat;
+        ref.resize(m_sum.size());
+        const double norm = 1. / m_frameCount;
+        for (size_t i = 0; i < m_sum.size(); ++i) {
+            ref[i] = static_cast<float>(m_sum[i] * norm);
+        }
+
+        // References of a different shape are obsolete
+        if (m_shape != m_sumShape) {
+            ((m_reference == DARK) ? m_flat : m_dark).clear();
+            m_shape = m_sumShape;
+        }
+
+        m_isAcquiring = false;
+        m_sum.clear();
+        m_sum.shrink_to_fit();
+
+        this->update_gain();
+        return true;
+    }
+
+
+    bool util::FlatFieldCorrection::matches(const Dims& shape) const {
+        return (this->hasDark() || this->hasFlat()) && shape == m_shape;
+    }
+
+
+    void util::FlatFieldCorrection::reset() {
+        m_shape = Dims();
+        m_dark.clear();
+        m_flat.clear();
+        m_offset.clear();
+        m_gain.clear();
+        m_isAcquiring = false;
+        m_frameCount = 0;
+        m_sum.clear();
+    }
+
+
+    void util::FlatFieldCorrection::update_gain() {
+        const size_t size = m_shape.size();
+
+        m_offset = m_dark.empty() ? std::vector<float>(size, 0.f) : m_dark;
+        m_gain.assign(size, 1.f);
+
+        if (!m_flat.empty()) {
+            double sum = 0.;
+            size_t count = 0;
+            for (size_t i = 0; i < size; ++i) {
+                const float signal = m_flat[i] - m_offset[i];
+                if (signal > 0.f) {
+                    sum += signal;
+                    ++count;
+                }
+            }
+
+            const float mean = (count > 0) ? static_cast<float>(sum / count) : 0.f;
+            for (size_t i = 0; i < size; ++i) {
+                const float signal = m_flat[i] - m_offset[i];
+                m_gain[i] = (signal > 0.f) ? mean / signal : 0.f;
+            }
+        }
+    }
+
+
+    void util::FlatFieldCorrection::apply(karabo::xms::ImageData& imd, bool toFloat, FramePool* pool) const {
+        if (!imd.isIndexable()) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot correct non-indexable image");
+        }
+
+        const NDArray& arr = imd.getData();
+        if (!isSupported(arr.getType())) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot correct images of type " + toString(arr.getType()));
+        }
+
+        const float* pOffset = m_offset.data();
+        const float* pGain = m_gain.data();
+        if (!this->matches(arr.getShape())) {
+            if (this->hasDark() || this->hasFlat()) {
+                throw KARABO_PARAMETER_EXCEPTION("The image shape " + toString(arr.getShape().toVector()) +
+                                                 " does not match the references " + toString(m_shape.toVector()));
+            }
+            // Missing references, i.e. zero offset and unity gain: the image is only converted to FLOAT
+            if (!toFloat || arr.getType() == Types::FLOAT) {
+                return;
+            }
+            pOffset = nullptr;
+            pGain = nullptr;
+        }
+
+        NDArray corrected;
+        switch (arr.getType()) {
+            case Types::UINT8:
+                corrected = correct<uint8_t>(arr, pOffset, pGain, toFloat, pool);
+                break;
+            case Types::INT8:
+                corrected = correct<int8_t>(arr, pOffset, pGain, toFloat, pool);
+                break;
+            case Types::UINT16:
+                corrected = correct<uint16_t>(arr, pOffset, pGain, toFloat, pool);
+                break;
+            case Types::INT16:
+                corrected = correct<int16_t>(arr, pOffset, pGain, toFloat, pool);
+                break;
+            case Types::UINT32:
+                corrected = correct<uint32_t>(arr, pOffset, pGain, toFloat, pool);
+                break;
+            case Types::INT32:
+                corrected = correct<int32_t>(arr, pOffset, pGain, toFloat, pool);
+                break;
+            case Types::FLOAT:
+                corrected = correct<float>(arr, pOffset, pGain, toFloat, pool);
+                break;
+            default: // DOUBLE
+                corrected = correct<double>(arr, pOffset, pGain, toFloat, pool);
+                break;
+        }
+
+        const Dims dims = corrected.getShape();
+        imd.setData(corrected);
+        imd.setDimensions(dims);
+    }
+
+
+    void util::FlatFieldCorrection::save(const std::string& filename) const {
+        std::ofstream ofs(filename, std::fstream::binary | std::fstream::trunc);
+        if (!ofs) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename + " for writing");
+        }
+
+        const std::vector<unsigned long long>& shape = m_shape.toVector();
+        const uint32_t rank = shape.size();
+        const uint8_t hasDark = this->hasDark();
+        const uint8_t hasFlat = this->hasFlat();
+
+        ofs.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        ofs.write(reinterpret_cast<const char*>(&rank), sizeof(rank));
+        ofs.write(reinterpret_cast<const char*>(shape.data()), rank * sizeof(unsigned long long));
+        ofs.write(reinterpret_cast<const char*>(&hasDark), sizeof(hasDark));
+        ofs.write(reinterpret_cast<const char*>(&hasFlat), sizeof(hasFlat));
+        ofs.write(reinterpret_cast<const char*>(m_dark.data()), m_dark.size() * sizeof(float));
+        ofs.write(reinterpret_cast<const char*>(m_flat.data()), m_flat.size() * sizeof(float));
+
+        if (!ofs) {
+            throw KARABO_IO_EXCEPTION("Could not write references to file " + filename);
+        }
+    }
+
+
+    void util::FlatFieldCorrection::load(const std::string& filename) {
+        std::ifstream ifs(filename, std::fstream::binary);
+        if (!ifs) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename);
+        }
+
+        char magic[sizeof(FILE_MAGIC)];
+        uint32_t rank = 0;
+        ifs.read(magic, sizeof(magic));
+        ifs.read(reinterpret_cast<char*>(&rank), sizeof(rank));
+        if (!ifs || std::memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || rank > 3) {
+            throw KARABO_IO_EXCEPTION("File " + filename + " does not contain flat-field references");
+        }
+
+        std::vector<unsigned long long> shape(rank);
+        uint8_t hasDark = 0, hasFlat = 0;
+        ifs.read(reinterpret_cast<char*>(shape.data()), rank * sizeof(unsigned long long));
+        ifs.read(reinterpret_cast<char*>(&hasDark), sizeof(hasDark));
+        ifs.read(reinterpret_cast<char*>(&hasFlat), sizeof(hasFlat));
+
+        const size_t size = std::accumulate(shape.begin(), shape.end(), 1ull, std::multiplies<unsigned long long>());
+        std::vector<float> dark(hasDark ? size : 0);
+        std::vector<float> flat(hasFlat ? size : 0);
+        ifs.read(reinterpret_cast<char*>(dark.data()), dark.size() * sizeof(float));
+        ifs.read(reinterpret_cast<char*>(flat.data()), flat.size() * sizeof(float));
+        if (!ifs) {
+            throw KARABO_IO_EXCEPTION("File " + filename + " is truncated");
+        }
+
+        this->reset();
+        m_shape = Dims(shape);
+        m_dark.swap(dark);
+        m_flat.swap(flat);
+        if (this->hasDark() || this->hasFlat()) {
+            this->update_gain();
+        }
+    }
+
+
+    template <class T, class Out>
+    void util::flat_field_correct(const T* raw, const float* offset, const float* gain, size_t size, Out* out) {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = toPixel<Out>((static_cast<float>(raw[i]) - offset[i]) * gain[i]);
+        }
+    }
+
+} // namespace karabo
@@ -0,0 +1,160 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_FLATFIELDCORRECTION_HH
+#define KARABO_FLATFIELDCORRECTION_HH
+
+#include <karabo/karabo.hpp>
+
+#include "NumaPlacement.hh"
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Dark-frame subtraction and flat-field correction.
+         *
+         * The dark and flat references are built by averaging a number of frames. The corrected image is then
+         * computed as (raw - dark) * gain, where gain = mean(flat - dark) / (flat - dark). Pixels not responding
+         * in the flat reference (flat <= dark) have zero gain.
+         *
+         * The class is not thread-safe.
+         */
+        class FlatFieldCorrection {
+           public:
+            enum Reference { DARK = 0, FLAT };
+
+            FlatFieldCorrection();
+
+            /**
+             * @brief Return true if images of a given type can be corrected, and averaged into references: the
+             * 8, 16 and 32-bit integer types, FLOAT and DOUBLE.
+             */
+            static bool isSupported(karabo::util::Types::ReferenceType type);
+
+            /**
+             * @brief Start the acquisition of a reference. The following frames passed to addFrame will be
+             * averaged.
+             *
+             * @param reference The reference to be acquired.
+             * @param nFrames The number of frames to be averaged.
+             */
+            void acquire(Reference reference, unsigned int nFrames);
+
+            /**
+             * @brief Add a frame to the reference being acquired.
+             *
+             * @param frame The raw frame. If its shape is different from the one of the previous frames, the
+             * acquisition is restarted.
+             * @return true if the frame completed the reference.
+             * @throw KARABO_PARAMETER_EXCEPTION if the frame type is not supported. The acquisition is stopped.
+             */
+            bool addFrame(const karabo::util::NDArray& frame);
+
+            bool isAcquiring() const {
+                return m_isAcquiring;
+            }
+
+            unsigned int acquiredFrames() const {
+                return m_frameCount;
+            }
+
+            bool hasDark() const {
+                return !m_dark.empty();
+            }
+
+            bool hasFlat() const {
+                return !m_flat.empty();
+            }
+
+            /**
+             * @brief The dark reference, empty if not available.
+             */
+            const std::vector<float>& dark() const {
+                return m_dark;
+            }
+
+            /**
+             * @brief The shape of the references.
+             */
+            const karabo::util::Dims& shape() const {
+                return m_shape;
+            }
+
+            /**
+             * @brief Return true if the available references can be applied to images of a given shape.
+             */
+            bool matches(const karabo::util::Dims& shape) const;
+
+            /**
+             * @brief Clear the references, and stop any acquisition.
+             */
+            void reset();
+
+            /**
+             * @brief Correct an image.
+             *
+             * Missing references are replaced by zero dark and unity gain: without any reference, the image is
+             * only converted to FLOAT if requested, and left untouched otherwise.
+             *
+             * @param imd The ImageData object - to be corrected. The input data are not modified: a new array is
+             * assigned to it.
+             * @param toFloat If true the corrected image is FLOAT, otherwise its type is kept (the values are
+             * rounded and clipped to the range of the type).
+             * @param pool The pool the corrected image is allocated from, if any.
+             * @throw KARABO_PARAMETER_EXCEPTION if the image type is not supported, or its shape does not match
+             * the references.
+             */
+            void apply(karabo::xms::ImageData& imd, bool toFloat, FramePool* pool = nullptr) const;
+
+            /**
+             * @brief Save the references to a local file.
+             */
+            void save(const std::string& filename) const;
+
+            /**
+             * @brief Load the references from a local file, previously created by save.
+             */
+            void load(const std::string& filename);
+
+           private:
+            void update_gain();
+
+            karabo::util::Dims m_shape; // the shape of the references
+            std::vector<float> m_dark;
+            std::vector<float> m_flat;
+            std::vector<float> m_offset; // dark, or zero
+            std::vector<float> m_gain;   // gain, or unity
+
+            bool m_isAcquiring;
+            Reference m_reference;
+            unsigned int m_nFrames;
+            unsigned int m_frameCount;
+            karabo::util::Dims m_sumShape;
+            std::vector<double> m_sum;
+        };
+
+        /**
+         * @brief Apply the correction (raw - offset) * gain to an array of pixels, in a single pass.
+         *
+         * @param T The input pixel data type, e.g. uint16_t.
+         * @param Out The output pixel data type. If it is an integer type, the values are rounded and clipped.
+         * @param raw The pointer to the input data
+         * @param offset The pointer to the per-pixel offset (dark)
+         * @param gain The pointer to the per-pixel gain
+         * @param size The number of pixels
+         * @param out The pointer to the output data
+         */
+        template <class T, class Out>
+        void flat_field_correct(const T* raw, const float* offset, const float* gain, size_t size, Out* out);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "FrameAccumulator.hh"
+#include "ImageBinning.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // The accumulator type used for a given pixel type. It matches binnedType(kType, BinningMode::SUM).
+        template <class T>
+        struct AccTraits;
+
+        template <>
+        struct AccTraits<uint8_t> {
+            using Acc = uint32_t;
+        };
+        template <>
+        struct AccTraits<int8_t> {
+            using Acc = int32_t;
+        };
+        template <>
+        struct AccTraits<uint16_t> {
+            using Acc = uint32_t;
+        };
+        template <>
+        struct AccTraits<int16_t> {
+            using Acc = int32_t;
+        };
+        template <>
+        struct AccTraits<uint32_t> {
+            using Acc = uint64_t;
+        };
+        template <>
+        struct AccTraits<int32_t> {
+            using Acc = int64_t;
+        };
+        template <>
+        struct AccTraits<float> {
+            using Acc = double;
+        };
+        template <>
+        struct AccTraits<double> {
+            using Acc = double;
+        };
+
+
+        template <class Out>
+        inline typename std::enable_if<std::is_floating_point<Out>::value, Out>::type toPixel(double value) {
+            return static_cast<Out>(value);
+        }
+
+
+        template <class Out>
+        inline typename std::enable_if<std::is_integral<Out>::value, Out>::type toPixel(double value) {
+            // Round half away from zero. The values are within the range of Out, being averages of Out values.
+            return static_cast<Out>(value + std::copysign(0.5, value));
+        }
+
+    } // namespace
+
+
+    util::FrameAccumulator::FrameAccumulator()
+        : m_mode(AccumulationMode::MEAN), m_nFrames(1), m_count(0), m_published(0), m_kType(Types::UNKNOWN) {}
+
+
+    void util::FrameAccumulator::configure(AccumulationMode mode, unsigned int nFrames) {
+        if (nFrames == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The number of frames to be accumulated must be positive");
+        }
+
+        m_mode = mode;
+        m_nFrames = nFrames;
+        this->reset();
+    }
+
+
+    void util::FrameAccumulator::reset() {
+        m_count = 0;
+        m_shape = Dims();
+        m_kType = Types::UNKNOWN;
+    }
+
+
+    Types::ReferenceType util::FrameAccumulator::accumulatedType(const Types::ReferenceType& kType,
+                                                                 AccumulationMode mode) {
+        return (mode == AccumulationMode::SUM) ? util::binnedType(kType, BinningMode::SUM) : kType;
+    }
+
+
+    bool util::FrameAccumulator::add(karabo::xms::ImageData& imd, FramePool* pool) {
+        switch (imd.getData().getType()) {
+            case Types::UINT8:
+                return this->add_frame<uint8_t>(imd, pool);
+            case Types::INT8:
+                return this->add_frame<int8_t>(imd, pool);
+            case Types::UINT16:
+                return this->add_frame<uint16_t>(imd, pool);
+            case Types::INT16:
+                return this->add_frame<int16_t>(imd, pool);
+            case Types::UINT32:
+                return this->add_frame<uint32_t>(imd, pool);
+            case Types::INT32:
+                return this->add_frame<int32_t>(imd, pool);
+            case Types::FLOAT:
+                return this->add_frame<float>(imd, pool);
+            case Types::DOUBLE:
+                return this->add_frame<double>(imd, pool);
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot accumulate images of type " +
+                                                 toString(imd.getData().getType()));
+        }
+    }
+
+
+    template <class T>
+    bool util::FrameAccumulator::add_frame(karabo::xms::ImageData& imd, FramePool* pool) {
+        using Acc = typename AccTraits<T>::Acc;
+
+        const NDArray& arr = imd.getData();
+        const Dims shape = arr.getShape();
+        const size_t size = arr.size();
+        const T* data = arr.getData<T>();
+
+        if (shape != m_shape || arr.getType() != m_kType) {
+            // First frame, or the image changed: (re)start. NB The buffers only grow.
+            m_shape = shape;
+            m_kType = arr.getType();
+            m_count = 0;
+            if (m_mode == AccumulationMode::EMA) {
+                m_average.resize(size);
+            } else {
+                m_sum.resize((size * sizeof(Acc) + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            }
+        }
+
+        if (m_mode == AccumulationMode::EMA) {
+            // The first frame initializes the average. NB The smoothing factor is larger for the first frames,
+            // until N frames have been averaged, so that the average is not biased towards the first one.
+            if (m_count == 0) {
+                std::copy(data, data + size, m_average.begin());
+                m_count = 1;
+            } else {
+                m_count = std::min(m_count + 1, m_nFrames);
+                util::update_moving_average(data, size, 1.f / m_count, m_average.data());
+            }
+
+            NDArray out = pool ? pool->allocate(shape, arr.getType()) : NDArray(shape, arr.getType());
+            T* o = out.getData<T>();
+            for (size_t i = 0; i < size; ++i) {
+                o[i] = toPixel<T>(m_average[i]);
+            }
+            imd.setData(out);
+            imd.setDimensions(shape);
+            m_published = m_count;
+            return true;
+        }
+
+        Acc* sum = reinterpret_cast<Acc*>(m_sum.data());
+        if (m_count == 0) {
+            std::fill(sum, sum + size, Acc(0));
+        }
+        util::accumulate_frame(data, size, sum);
+
+        if (++m_count < m_nFrames) {
+            return false;
+        }
+
+        // Accumulation completed
+        if (m_mode == AccumulationMode::SUM) {
+            const Types::ReferenceType outType = accumulatedType(arr.getType(), m_mode);
+            NDArray out = pool ? pool->allocate(shape, outType) : NDArray(shape, outType);
+            std::memcpy(out.getData<char>(), sum, size * sizeof(Acc));
+
+            // The sum of N frames needs up to ceil(log2(N)) more bits
+            const unsigned short bpp = imd.getBitsPerPixel();
+            if (bpp > 0) {
+                const unsigned short extraBits = static_cast<unsigned short>(std::ceil(std::log2(m_nFrames)));
+                const unsigned short maxBits = 8 * out.itemSize();
+                imd.setBitsPerPixel(std::min<unsigned short>(bpp + extraBits, maxBits));
+            }
+            imd.setData(out);
+        } else {
+            NDArray out = pool ? pool->allocate(shape, arr.getType()) : NDArray(shape, arr.getType());
+            T* o = out.getData<T>();
+            const double norm = 1. / m_nFrames;
+            for (size_t i = 0; i < size; ++i) {
+                o[i] = toPixel<T>(sum[i] * norm);
+            }
+            imd.setData(out);
+        }
+        imd.setDimensions(shape);
+
+        m_published = m_count;
+        m_count = 0;
+        return true;
+    }
+
+
+    template <class T, class Acc>
+    void util::accumulate_frame(const T* data, size_t size, Acc* sum) {
+        for (size_t i = 0; i < size; ++i) {
+            sum[i] += static_cast<Acc>(data[i]);
+        }
+    }
+
+
+    template <class T>
+    void util::update_moving_average(const T* data, size_t size, float alpha, float* average) {
+        for (size_t i = 0; i < size; ++i) {
+            average[i] += alpha * (static_cast<float>(data[i]) - average[i]);
+        }
+    }
+
+} // namespace karabo
@@ -0,0 +1,122 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_FRAMEACCUMULATOR_HH
+#define KARABO_FRAMEACCUMULATOR_HH
+
+#include <karabo/karabo.hpp>
+
+#include "NumaPlacement.hh"
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief How consecutive frames are combined.
+         */
+        enum class AccumulationMode {
+            SUM = 0, // The sum of N frames is published, in a wider type (as for BinningMode::SUM)
+            MEAN,    // The mean of N frames is published, the type is kept
+            EMA      // The exponential moving average, with smoothing factor 1/N, is published at every frame
+        };
+
+        /**
+         * @brief Accumulation of consecutive frames.
+         *
+         * The frames are added to a preallocated accumulator: a wide integer one for integer images, a floating
+         * point one otherwise or in EMA mode. No memory is allocated per frame if the published images are allocated
+         * from a frame pool.
+         *
+         * The class is not thread-safe.
+         */
+        class FrameAccumulator {
+           public:
+            FrameAccumulator();
+
+            /**
+             * @brief Set the accumulation mode and the number of frames. The accumulation is restarted.
+             *
+             * @param mode The accumulation mode.
+             * @param nFrames The number of frames to be combined. It must be positive.
+             */
+            void configure(AccumulationMode mode, unsigned int nFrames);
+
+            /**
+             * @brief Restart the accumulation.
+             */
+            void reset();
+
+            /**
+             * @brief Add a frame.
+             *
+             * If the frame shape or type differs from the ones of the previous frames, the accumulation is
+             * restarted.
+             *
+             * @param imd The ImageData object - to be accumulated. If the accumulation is completed, the result
+             * is assigned to it (the input data are not modified), and true is returned.
+             * @param pool The pool the accumulated image is allocated from, if any.
+             * @return true if imd contains the accumulated image, to be published.
+             */
+            bool add(karabo::xms::ImageData& imd, FramePool* pool = nullptr);
+
+            /**
+             * @brief The number of frames accumulated so far.
+             */
+            unsigned int count() const {
+                return m_count;
+            }
+
+            /**
+             * @brief The number of frames combined in the last accumulated image.
+             */
+            unsigned int publishedFrames() const {
+                return m_published;
+            }
+
+            /**
+             * @brief The type of the accumulated images, for a given input type and accumulation mode.
+             */
+            static karabo::util::Types::ReferenceType accumulatedType(const karabo::util::Types::ReferenceType& kType,
+                                                                      AccumulationMode mode);
+
+           private:
+            template <class T>
+            bool add_frame(karabo::xms::ImageData& imd, FramePool* pool);
+
+            AccumulationMode m_mode;
+            unsigned int m_nFrames;
+            unsigned int m_count;
+            unsigned int m_published;
+            karabo::util::Dims m_shape;
+            karabo::util::Types::ReferenceType m_kType;
+            std::vector<uint64_t> m_sum; // Raw storage of the wide accumulator
+            std::vector<float> m_average;
+        };
+
+        /**
+         * @brief Add an array of pixels to a wider accumulator.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * @param Acc The accumulator type, e.g. uint32_t.
+         */
+        template <class T, class Acc>
+        void accumulate_frame(const T* data, size_t size, Acc* sum);
+
+        /**
+         * @brief Update an exponential moving average: average += alpha * (data - average).
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         */
+        template <class T>
+        void update_moving_average(const T* data, size_t size, float alpha, float* average);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
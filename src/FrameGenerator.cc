@@ -0,0 +1,343 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "FrameGenerator.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        const size_t NOISE_OFFSETS = 1 << 16; // The number of distinct rows of noise
+        const size_t FRAME_PADDING = 8; // unpackMonoXXp reads 16 bits at a time
+
+        uint64_t xorshift(uint64_t& state) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+
+        // Pack pixels bit by bit, from pixel 'first' on. The output from the first byte written must be zeroed.
+        void packBits(const uint16_t* data, size_t first, size_t size, uint8_t bpp, uint8_t* packedData) {
+            const uint32_t mask = 0xFFFF >> (16 - bpp);
+            size_t bits = first * bpp;
+            for (size_t px = first; px < size; ++px) {
+                const uint32_t value = (data[px] & mask) << (bits % 8);
+                uint8_t* p = packedData + bits / 8;
+                p[0] |= value;
+                p[1] |= value >> 8;
+                p[2] |= value >> 16;
+                bits += bpp;
+            }
+        }
+
+    } // namespace
+
+
+    util::PixelFormat util::toPixelFormat(const std::string& name) {
+        if (name == "Mono8") {
+            return PixelFormat::MONO8;
+        } else if (name == "Mono16") {
+            return PixelFormat::MONO16;
+        } else if (name == "Mono12Packed") {
+            return PixelFormat::MONO12_PACKED;
+        } else if (name == "Mono10p") {
+            return PixelFormat::MONO10P;
+        } else if (name == "Mono12p") {
+            return PixelFormat::MONO12P;
+        } else if (name == "RGB8") {
+            return PixelFormat::RGB8;
+        }
+        throw KARABO_PARAMETER_EXCEPTION("Unknown pixel format: " + name);
+    }
+
+
+    unsigned short util::bitsPerPixel(PixelFormat format) {
+        switch (format) {
+            case PixelFormat::MONO8:
+            case PixelFormat::RGB8:
+                return 8;
+            case PixelFormat::MONO10P:
+                return 10;
+            case PixelFormat::MONO12_PACKED:
+            case PixelFormat::MONO12P:
+                return 12;
+            default:
+                return 16;
+        }
+    }
+
+
+    util::FrameGenerator::FrameGenerator()
+        : m_width(0),
+          m_height(0),
+          m_format(PixelFormat::MONO16),
+          m_channels(1),
+          m_maxValue(0xFFFF),
+          m_gradient(true),
+          m_nSpots(0),
+          m_spotSigma(1.),
+          m_spotSpeed(0.),
+          m_noise(0.),
+          m_random(0x9E3779B97F4A7C15ull) {}
+
+
+    void util::FrameGenerator::configure(unsigned int width, unsigned int height, PixelFormat format) {
+        if (width == 0 || height == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid frame size: " + toString(width) + "x" + toString(height));
+        }
+        if (format == PixelFormat::MONO12_PACKED && (static_cast<size_t>(width) * height) % 2 != 0) {
+            throw KARABO_PARAMETER_EXCEPTION("MONO12PACKED frames must have an even number of pixels");
+        }
+
+        m_width = width;
+        m_height = height;
+        m_format = format;
+        m_channels = (format == PixelFormat::RGB8) ? 3 : 1;
+        m_maxValue = (1 << util::bitsPerPixel(format)) - 1;
+        this->prepare();
+    }
+
+
+    void util::FrameGenerator::setPattern(bool gradient, unsigned int nSpots, double spotSigma, double spotSpeed,
+                                          double noise) {
+        m_gradient = gradient;
+        m_nSpots = nSpots;
+        m_spotSigma = spotSigma;
+        m_spotSpeed = spotSpeed;
+        m_noise = noise;
+        this->prepare();
+    }
+
+
+    size_t util::FrameGenerator::frameSize() const {
+        const size_t size = static_cast<size_t>(m_width) * m_height;
+        switch (m_format) {
+            case PixelFormat::MONO8:
+                return size;
+            case PixelFormat::MONO12_PACKED:
+                return size * 3 / 2;
+            case PixelFormat::MONO10P:
+            case PixelFormat::MONO12P:
+                return (size * util::bitsPerPixel(m_format) + 7) / 8;
+            case PixelFormat::RGB8:
+                return 3 * size;
+            default:
+                return 2 * size;
+        }
+    }
+
+
+    void util::FrameGenerator::prepare() {
+        if (m_width == 0) {
+            return; // Not configured yet
+        }
+
+        // The background: a horizontal and vertical ramp up to half the full scale
+        const size_t rowSize = static_cast<size_t>(m_width) * m_channels;
+        m_background.assign(rowSize * m_height, 0);
+        if (m_gradient) {
+            const double xScale = 0.5 * m_maxValue / std::max(1u, m_width - 1);
+            const double yScale = 0.5 * m_maxValue / std::max(1u, m_height - 1);
+            for (unsigned int y = 0; y < m_height; ++y) {
+                uint16_t* row = &m_background[y * rowSize];
+                for (unsigned int x = 0; x < m_width; ++x) {
+                    if (m_channels == 1) {
+                        row[x] = static_cast<uint16_t>(0.5 * (x * xScale + y * yScale));
+                    } else {
+                        // Red along X, green along Y, constant blue
+                        row[3 * x] = static_cast<uint16_t>(x * xScale);
+                        row[3 * x + 1] = static_cast<uint16_t>(y * yScale);
+                        row[3 * x + 2] = static_cast<uint16_t>(0.25 * m_maxValue);
+                    }
+                }
+            }
+        }
+
+        // Triangular noise samples, read contiguously from a random offset on every row
+        m_noiseTable.clear();
+        if (m_noise > 0.) {
+            const double amplitude = std::min(m_noise * m_maxValue, 32767.);
+            m_noiseTable.resize(NOISE_OFFSETS + rowSize);
+            uint64_t state = 0x2545F4914F6CDD1Dull;
+            for (int16_t& sample : m_noiseTable) {
+                const double u1 = (xorshift(state) >> 11) * (1. / 9007199254740992.);
+                const double u2 = (xorshift(state) >> 11) * (1. / 9007199254740992.);
+                sample = static_cast<int16_t>(std::lround(amplitude * (u1 + u2 - 1.)));
+            }
+        }
+
+        m_pixels.resize(m_background.size());
+        m_frame.resize(this->frameSize() + FRAME_PADDING);
+    }
+
+
+    const std::vector<uint8_t>& util::FrameGenerator::generate(unsigned long long frameNumber) {
+        if (m_width == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The frame generator is not configured");
+        }
+
+        const size_t rowSize = static_cast<size_t>(m_width) * m_channels;
+        if (m_noiseTable.empty()) {
+            std::memcpy(m_pixels.data(), m_background.data(), m_pixels.size() * sizeof(uint16_t));
+        } else {
+            const int16_t* table = m_noiseTable.data();
+            const int maxValue = m_maxValue;
+            for (unsigned int y = 0; y < m_height; ++y) {
+                const uint16_t* src = &m_background[y * rowSize];
+                uint16_t* dst = &m_pixels[y * rowSize];
+                const int16_t* noise = table + (xorshift(m_random) & (NOISE_OFFSETS - 1));
+                for (size_t i = 0; i < rowSize; ++i) {
+                    const int value = src[i] + noise[i];
+                    dst[i] = static_cast<uint16_t>(std::min(std::max(value, 0), maxValue));
+                }
+            }
+        }
+
+        this->add_spots(static_cast<double>(frameNumber));
+        this->convert();
+        return m_frame;
+    }
+
+
+    void util::FrameGenerator::add_spots(double t) {
+        if (m_nSpots == 0 || m_spotSigma <= 0.) {
+            return;
+        }
+
+        const double amplitude = 0.5 * m_maxValue;
+        const double radius = std::ceil(3. * m_spotSigma);
+        const double halfInvVar = 0.5 / (m_spotSigma * m_spotSigma);
+        // The spots follow Lissajous curves, at about m_spotSpeed pixels per frame
+        const double omega = m_spotSpeed / (0.35 * std::max(m_width, m_height));
+        const size_t rowSize = static_cast<size_t>(m_width) * m_channels;
+
+        for (unsigned int k = 0; k < m_nSpots; ++k) {
+            const double phase = 2.39996 * k;
+            const double cx = 0.5 * m_width + 0.35 * m_width * std::sin(omega * (1. + 0.31 * k) * t + phase);
+            const double cy = 0.5 * m_height + 0.35 * m_height * std::cos(omega * (1. + 0.17 * k) * t + 1.3 * phase);
+
+            const int x0 = std::max(0, static_cast<int>(std::floor(cx - radius)));
+            const int x1 = std::min(static_cast<int>(m_width) - 1, static_cast<int>(std::ceil(cx + radius)));
+            const int y0 = std::max(0, static_cast<int>(std::floor(cy - radius)));
+            const int y1 = std::min(static_cast<int>(m_height) - 1, static_cast<int>(std::ceil(cy + radius)));
+            if (x0 > x1 || y0 > y1) {
+                continue;
+            }
+
+            // The profile is separable
+            m_gx.resize(x1 - x0 + 1);
+            m_gy.resize(y1 - y0 + 1);
+            for (int x = x0; x <= x1; ++x) {
+                m_gx[x - x0] = static_cast<float>(amplitude * std::exp(-(x - cx) * (x - cx) * halfInvVar));
+            }
+            for (int y = y0; y <= y1; ++y) {
+                m_gy[y - y0] = static_cast<float>(std::exp(-(y - cy) * (y - cy) * halfInvVar));
+            }
+
+            for (int y = y0; y <= y1; ++y) {
+                uint16_t* row = &m_pixels[y * rowSize];
+                const float gy = m_gy[y - y0];
+                for (int x = x0; x <= x1; ++x) {
+                    const int add = static_cast<int>(gy * m_gx[x - x0]);
+                    for (unsigned int c = 0; c < m_channels; ++c) {
+                        uint16_t& px = row[x * m_channels + c];
+                        px = static_cast<uint16_t>(std::min(px + add, m_maxValue));
+                    }
+                }
+            }
+        }
+    }
+
+
+    void util::FrameGenerator::convert() {
+        switch (m_format) {
+            case PixelFormat::MONO8:
+            case PixelFormat::RGB8:
+                std::copy(m_pixels.begin(), m_pixels.end(), m_frame.begin()); // NB The values are below 256
+                break;
+            case PixelFormat::MONO16:
+                std::memcpy(m_frame.data(), m_pixels.data(), m_pixels.size() * sizeof(uint16_t));
+                break;
+            case PixelFormat::MONO12_PACKED:
+                util::packMono12Packed(m_pixels.data(), m_width, m_height, m_frame.data());
+                break;
+            case PixelFormat::MONO10P:
+                util::packMonoXXp(m_pixels.data(), m_width, m_height, 10, m_frame.data());
+                break;
+            case PixelFormat::MONO12P:
+                util::packMonoXXp(m_pixels.data(), m_width, m_height, 12, m_frame.data());
+                break;
+        }
+    }
+
+
+    void util::packMono12Packed(const uint16_t* data, const uint32_t width, const uint32_t height,
+                                uint8_t* packedData) {
+        size_t idx = 0, px = 0, image_size = static_cast<size_t>(width) * height;
+        while (px + 1 < image_size) {
+            const uint16_t p0 = data[px];
+            const uint16_t p1 = data[px + 1];
+            packedData[idx] = p0 >> 4;
+            packedData[idx + 1] = (p0 & 0xF) | ((p1 & 0xF) << 4);
+            packedData[idx + 2] = p1 >> 4;
+            idx += 3;
+            px += 2;
+        }
+    }
+
+
+    void util::packMonoXXp(const uint16_t* data, const uint32_t width, const uint32_t height, const uint8_t bpp,
+                           uint8_t* packedData) {
+        if (bpp < 9 || bpp > 15) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid bpp value: " + std::to_string(bpp) + ". It must be in [9, 15].");
+        }
+
+        const size_t image_size = static_cast<size_t>(width) * height;
+        size_t px = 0;
+        uint8_t* p = packedData;
+        if (bpp == 12) {
+            // 2 pixels in 3 bytes
+            for (; px + 1 < image_size; px += 2, p += 3) {
+                const uint16_t p0 = data[px] & 0xFFF;
+                const uint16_t p1 = data[px + 1] & 0xFFF;
+                p[0] = p0;
+                p[1] = (p0 >> 8) | (p1 << 4);
+                p[2] = p1 >> 4;
+            }
+        } else if (bpp == 10) {
+            // 4 pixels in 5 bytes
+            for (; px + 3 < image_size; px += 4, p += 5) {
+                const uint16_t p0 = data[px] & 0x3FF;
+                const uint16_t p1 = data[px + 1] & 0x3FF;
+                const uint16_t p2 = data[px + 2] & 0x3FF;
+                const uint16_t p3 = data[px + 3] & 0x3FF;
+                p[0] = p0;
+                p[1] = (p0 >> 8) | (p1 << 2);
+                p[2] = (p1 >> 6) | (p2 << 4);
+                p[3] = (p2 >> 4) | (p3 << 6);
+                p[4] = p3 >> 2;
+            }
+        }
+
+        // The remaining pixels, bit by bit
+        const size_t end = (image_size * bpp + 7) / 8 + 2;
+        std::memset(p, 0, end - (p - packedData));
+        packBits(data, px, image_size, bpp, packedData);
+    }
+
+} // namespace karabo
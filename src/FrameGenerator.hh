@@ -0,0 +1,140 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_FRAMEGENERATOR_HH
+#define KARABO_FRAMEGENERATOR_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief The pixel formats of the generated frames, as delivered by cameras.
+         */
+        enum class PixelFormat { MONO8, MONO16, MONO12_PACKED, MONO10P, MONO12P, RGB8 };
+
+        /**
+         * @brief Convert a pixel format name (e.g. "Mono12Packed") to PixelFormat.
+         */
+        PixelFormat toPixelFormat(const std::string& name);
+
+        /**
+         * @brief The bits-per-pixel of a pixel format, e.g. 12 for MONO12_PACKED.
+         */
+        unsigned short bitsPerPixel(PixelFormat format);
+
+        /**
+         * @brief Generate synthetic camera frames: a gradient, moving Gaussian spots and noise.
+         *
+         * The frames are generated as 16-bit pixels, then converted to the camera pixel format, i.e. packed if
+         * needed. The gradient and the noise samples are computed when the generator is configured: generating a
+         * frame costs a copy, a table look-up per pixel, and the spot areas.
+         *
+         * The class is not thread-safe.
+         */
+        class FrameGenerator {
+           public:
+            FrameGenerator();
+
+            /**
+             * @brief Set the frame size and pixel format.
+             *
+             * @param width The frame width.
+             * @param height The frame height. For MONO12_PACKED, width * height must be even.
+             * @param format The pixel format.
+             */
+            void configure(unsigned int width, unsigned int height, PixelFormat format);
+
+            /**
+             * @brief Set the frame content.
+             *
+             * @param gradient Whether the background is a gradient, or zero.
+             * @param nSpots The number of Gaussian spots.
+             * @param spotSigma The standard deviation of the spots, in pixels.
+             * @param spotSpeed The speed of the spots, in pixels per frame.
+             * @param noise The amplitude of the noise, relative to the full scale.
+             */
+            void setPattern(bool gradient, unsigned int nSpots, double spotSigma, double spotSpeed, double noise);
+
+            /**
+             * @brief Generate a frame.
+             *
+             * @param frameNumber The frame number, which sets the spot positions.
+             * @return The frame, in the camera pixel format. It is valid until the next call.
+             */
+            const std::vector<uint8_t>& generate(unsigned long long frameNumber);
+
+            /**
+             * @brief The size of the frames in the camera pixel format, in bytes.
+             */
+            size_t frameSize() const;
+
+            /**
+             * @brief The frames before conversion to the camera pixel format, i.e. one 16-bit value per pixel and
+             * channel. It is valid until the next call to generate.
+             */
+            const std::vector<uint16_t>& pixels() const {
+                return m_pixels;
+            }
+
+           private:
+            void prepare();
+
+            void add_spots(double t);
+
+            void convert();
+
+            unsigned int m_width;
+            unsigned int m_height;
+            PixelFormat m_format;
+            unsigned int m_channels;
+            int m_maxValue;
+            bool m_gradient;
+            unsigned int m_nSpots;
+            double m_spotSigma;
+            double m_spotSpeed;
+            double m_noise;
+            std::vector<uint16_t> m_background;
+            std::vector<int16_t> m_noiseTable; // 2^16 samples more than a row
+            std::vector<uint16_t> m_pixels;
+            std::vector<uint8_t> m_frame;
+            std::vector<float> m_gx; // separable spot profiles
+            std::vector<float> m_gy;
+            uint64_t m_random; // xorshift state
+        };
+
+        /**
+         * @brief Pack 12-bit pixels to MONO12PACKED, i.e. the inverse of unpackMono12Packed.
+         *
+         * @param data The pointer to the input pixels. width * height must be even.
+         * @param width The image width
+         * @param height The image height
+         * @param packedData The pointer to the output, of size (width * height * 3 / 2)
+         */
+        void packMono12Packed(const uint16_t* data, const uint32_t width, const uint32_t height,
+                              uint8_t* packedData);
+
+        /**
+         * @brief Pack pixels to MonoXXp, i.e. the inverse of unpackMonoXXp.
+         *
+         * @param data The pointer to the input pixels
+         * @param width The image width
+         * @param height The image height
+         * @param bpp The bits-per-pixel, normally 10 or 12
+         * @param packedData The pointer to the output, of size (width * height * bpp / 8) rounded up, plus two
+         * bytes of padding. It is overwritten.
+         */
+        void packMonoXXp(const uint16_t* data, const uint32_t width, const uint32_t height, const uint8_t bpp,
+                         uint8_t* packedData);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
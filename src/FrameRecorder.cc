@@ -0,0 +1,403 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FrameRecorder.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        const char FILE_MAGIC[8] = {'K', 'R', 'B', 'R', 'A', 'W', '0', '1'};
+        const size_t FILE_HEADER_SIZE = 64; // The magic, then zeros
+        const size_t ALIGNMENT = 64; // The records and their pixel data are aligned to cache lines
+        const size_t CHUNK_SIZE = 256ul << 20; // The file is grown by at least 256 MiB
+        const unsigned int MAX_RANK = 4;
+
+
+        struct RecordHeader {
+            uint64_t size; // The size of the whole record, written last. Zero for an incomplete record.
+            uint64_t seconds;
+            uint64_t fractionalSeconds;
+            uint64_t trainId;
+            int32_t kType;
+            int32_t encoding;
+            uint16_t bitsPerPixel;
+            uint16_t rank;
+            uint16_t binningRank;
+            uint16_t roiRank;
+            uint64_t shape[MAX_RANK];
+            uint64_t binning[MAX_RANK];
+            uint64_t roiOffsets[MAX_RANK];
+            uint64_t headerSize; // The serialized header follows the record header
+            uint64_t dataSize; // The pixel data follow, aligned
+        };
+
+
+        size_t aligned(size_t size) {
+            return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+
+
+        size_t dataOffset(const RecordHeader& rh) {
+            return aligned(sizeof(RecordHeader) + rh.headerSize);
+        }
+
+
+        void copyDims(const Dims& dims, uint64_t* dst, uint16_t& rank) {
+            if (dims.rank() > MAX_RANK) {
+                throw KARABO_PARAMETER_EXCEPTION("Cannot record dimensions of rank " + toString(dims.rank()));
+            }
+            rank = dims.rank();
+            for (size_t i = 0; i < dims.rank(); ++i) {
+                dst[i] = dims.extentIn(i);
+            }
+        }
+
+
+        Dims toDims(const uint64_t* src, uint16_t rank) {
+            return Dims(std::vector<unsigned long long>(src, src + rank));
+        }
+
+
+        // Index the complete records of a mapped file. Stop at the first incomplete or invalid record.
+        size_t indexRecords(const char* map, size_t size, std::vector<size_t>* offsets) {
+            size_t offset = FILE_HEADER_SIZE;
+            while (offset + sizeof(RecordHeader) <= size) {
+                const RecordHeader& rh = *reinterpret_cast<const RecordHeader*>(map + offset);
+                if (rh.size == 0 || rh.size % ALIGNMENT != 0 || rh.size > size - offset || rh.rank > MAX_RANK ||
+                    rh.binningRank > MAX_RANK || rh.roiRank > MAX_RANK ||
+                    rh.headerSize > rh.size - sizeof(RecordHeader) || rh.dataSize > rh.size - dataOffset(rh)) {
+                    break;
+                }
+                if (offsets) {
+                    offsets->push_back(offset);
+                }
+                offset += rh.size;
+            }
+            return offset;
+        }
+
+
+        // Wrap the mapped pixel data, without copying them. The NDArray keeps the mapping alive.
+        template <class T>
+        NDArray mappedArray(const char* data, size_t dataSize, const Dims& shape,
+                            const std::shared_ptr<void>& keeper) {
+            const size_t size = shape.rank() > 0 ? shape.size() : 0;
+            if (size * sizeof(T) != dataSize) {
+                throw KARABO_IO_EXCEPTION("The recorded pixel data do not match their shape");
+            }
+            return NDArray(reinterpret_cast<const T*>(data), size, [keeper](const void*) {}, shape);
+        }
+
+    } // namespace
+
+
+    class util::FrameRecording::Mapping {
+       public:
+        Mapping(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+        ~Mapping() {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+
+        const char* data() const {
+            return m_data;
+        }
+
+        size_t size() const {
+            return m_size;
+        }
+
+       private:
+        const char* m_data;
+        size_t m_size;
+    };
+
+
+    util::FrameRecorder::FrameRecorder()
+        : m_fd(-1),
+          m_map(nullptr),
+          m_mapSize(0),
+          m_end(0),
+          m_frames(0),
+          m_serializer(BinarySerializer<Hash>::create("Bin")) {}
+
+
+    util::FrameRecorder::~FrameRecorder() {
+        this->close();
+    }
+
+
+    void util::FrameRecorder::open(const std::string& filename) {
+        this->close();
+
+        m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+        if (m_fd < 0) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename + " for writing: " + std::strerror(errno));
+        }
+        m_filename = filename;
+
+        try {
+            struct stat st;
+            if (::fstat(m_fd, &st) != 0) {
+                throw KARABO_IO_EXCEPTION("Could not stat file " + filename + ": " + std::strerror(errno));
+            }
+
+            const size_t fileSize = st.st_size;
+            if (fileSize == 0) {
+                this->map(CHUNK_SIZE);
+                std::memcpy(m_map, FILE_MAGIC, sizeof(FILE_MAGIC));
+                m_end = FILE_HEADER_SIZE;
+                m_frames = 0;
+                return;
+            }
+
+            // Append to the frames already recorded
+            this->map(std::max(fileSize, FILE_HEADER_SIZE));
+            if (std::memcmp(m_map, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+                throw KARABO_IO_EXCEPTION("File " + filename + " does not contain recorded frames");
+            }
+            std::vector<size_t> offsets;
+            m_end = indexRecords(m_map, fileSize, &offsets);
+            m_frames = offsets.size();
+
+            // Discard any incomplete record, and make room for the next ones
+            this->unmap();
+            if (::ftruncate(m_fd, m_end) != 0) {
+                throw KARABO_IO_EXCEPTION("Could not truncate file " + filename + ": " + std::strerror(errno));
+            }
+            this->map(m_end + CHUNK_SIZE);
+        } catch (...) {
+            this->unmap();
+            ::close(m_fd);
+            m_fd = -1;
+            m_end = 0;
+            m_frames = 0;
+            throw;
+        }
+    }
+
+
+    void util::FrameRecorder::close() {
+        if (m_fd < 0) {
+            return;
+        }
+
+        this->unmap();
+        if (::ftruncate(m_fd, m_end) != 0) {
+            KARABO_LOG_FRAMEWORK_WARN << "Could not truncate file " << m_filename << ": " << std::strerror(errno);
+        }
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+
+    void util::FrameRecorder::swap(FrameRecorder& other) {
+        std::swap(m_filename, other.m_filename);
+        std::swap(m_fd, other.m_fd);
+        std::swap(m_map, other.m_map);
+        std::swap(m_mapSize, other.m_mapSize);
+        std::swap(m_end, other.m_end);
+        std::swap(m_frames, other.m_frames);
+        std::swap(m_serializer, other.m_serializer);
+        std::swap(m_archive, other.m_archive);
+    }
+
+
+    void util::FrameRecorder::map(size_t size) {
+        if (::ftruncate(m_fd, size) != 0) {
+            throw KARABO_IO_EXCEPTION("Could not resize file " + m_filename + ": " + std::strerror(errno));
+        }
+
+        void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (map == MAP_FAILED) {
+            throw KARABO_IO_EXCEPTION("Could not map file " + m_filename + ": " + std::strerror(errno));
+        }
+        m_map = static_cast<char*>(map);
+        m_mapSize = size;
+    }
+
+
+    void util::FrameRecorder::unmap() {
+        if (m_map) {
+            ::munmap(m_map, m_mapSize);
+            m_map = nullptr;
+            m_mapSize = 0;
+        }
+    }
+
+
+    void util::FrameRecorder::append(const NDArray& data, const Dims& binning, const unsigned short bpp,
+                                     const EncodingType& encoding, const Dims& roiOffsets,
+                                     const Timestamp& timestamp, const Hash& header) {
+        if (m_fd < 0) {
+            throw KARABO_PARAMETER_EXCEPTION("No recording file is open");
+        }
+
+        RecordHeader rh;
+        std::memset(&rh, 0, sizeof(rh));
+        rh.seconds = timestamp.getSeconds();
+        rh.fractionalSeconds = timestamp.getFractionalSeconds();
+        rh.trainId = timestamp.getTrainId();
+        rh.kType = data.getType();
+        rh.encoding = encoding;
+        rh.bitsPerPixel = bpp;
+        copyDims(data.getShape(), rh.shape, rh.rank);
+        copyDims(binning, rh.binning, rh.binningRank);
+        copyDims(roiOffsets, rh.roiOffsets, rh.roiRank);
+
+        m_archive.clear();
+        if (!header.empty()) {
+            m_serializer->save(header, m_archive);
+        }
+        rh.headerSize = m_archive.size();
+        rh.dataSize = data.byteSize();
+
+        const size_t offset = dataOffset(rh);
+        const size_t recordSize = aligned(offset + rh.dataSize);
+        if (m_end + recordSize > m_mapSize) {
+            const size_t mapSize = m_mapSize;
+            this->unmap();
+            this->map(mapSize + std::max(CHUNK_SIZE, aligned(recordSize)));
+        }
+
+        char* record = m_map + m_end;
+        std::memcpy(record, &rh, sizeof(rh));
+        if (!m_archive.empty()) {
+            std::memcpy(record + sizeof(rh), m_archive.data(), m_archive.size());
+        }
+        std::memcpy(record + offset, data.getData<char>(), rh.dataSize);
+
+        // The record is complete once its size is set
+        std::atomic_thread_fence(std::memory_order_release);
+        reinterpret_cast<RecordHeader*>(record)->size = recordSize;
+
+        m_end += recordSize;
+        ++m_frames;
+    }
+
+
+    void util::FrameRecording::open(const std::string& filename) {
+        this->close();
+
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename + ": " + std::strerror(errno));
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < FILE_HEADER_SIZE) {
+            ::close(fd);
+            throw KARABO_IO_EXCEPTION("File " + filename + " does not contain recorded frames");
+        }
+
+        const size_t size = st.st_size;
+        void* map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // NB The mapping remains valid
+        if (map == MAP_FAILED) {
+            throw KARABO_IO_EXCEPTION("Could not map file " + filename + ": " + std::strerror(errno));
+        }
+        ::madvise(map, size, MADV_SEQUENTIAL);
+        m_mapping = std::make_shared<Mapping>(static_cast<const char*>(map), size);
+
+        if (std::memcmp(m_mapping->data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+            this->close();
+            throw KARABO_IO_EXCEPTION("File " + filename + " does not contain recorded frames");
+        }
+
+        indexRecords(m_mapping->data(), size, &m_offsets);
+        if (!m_serializer) {
+            m_serializer = BinarySerializer<Hash>::create("Bin");
+        }
+    }
+
+
+    void util::FrameRecording::close() {
+        m_offsets.clear();
+        m_mapping.reset(); // NB The frames still in use keep the file mapped
+    }
+
+
+    void util::FrameRecording::frame(size_t index, RecordedFrame& frame) const {
+        if (index >= m_offsets.size()) {
+            throw KARABO_PARAMETER_EXCEPTION("Frame index " + toString(index) + " out of range [0, " +
+                                             toString(m_offsets.size()) + ")");
+        }
+
+        const char* record = m_mapping->data() + m_offsets[index];
+        const RecordHeader& rh = *reinterpret_cast<const RecordHeader*>(record);
+
+        frame.timestamp = Timestamp(Epochstamp(rh.seconds, rh.fractionalSeconds), Trainstamp(rh.trainId));
+        frame.encoding = static_cast<EncodingType>(rh.encoding);
+        frame.bitsPerPixel = rh.bitsPerPixel;
+        frame.binning = toDims(rh.binning, rh.binningRank);
+        frame.roiOffsets = toDims(rh.roiOffsets, rh.roiRank);
+
+        frame.header.clear();
+        if (rh.headerSize > 0) {
+            m_serializer->load(frame.header, record + sizeof(RecordHeader), rh.headerSize);
+        }
+
+        const char* data = record + dataOffset(rh);
+        const Dims shape = toDims(rh.shape, rh.rank);
+        switch (rh.kType) {
+            case Types::UINT8:
+                frame.data = mappedArray<uint8_t>(data, rh.dataSize, shape, m_mapping);
+                break;
+            case Types::INT8:
+                frame.data = mappedArray<int8_t>(data, rh.dataSize, shape, m_mapping);
+                break;
+            case Types::UINT16:
+                frame.data = mappedArray<uint16_t>(data, rh.dataSize, shape, m_mapping);
+                break;
+            case Types::INT16:
+                frame.data = mappedArray<int16_t>(data, rh.dataSize, shape, m_mapping);
+                break;
+            case Types::UINT32:
+                frame.data = mappedArray<uint32_t>(data, rh.dataSize, shape, m_mapping);
+                break;
+            case Types::INT32:
+                frame.data = mappedArray<int32_t>(data, rh.dataSize, shape, m_mapping);
+                break;
+            case Types::FLOAT:
+                frame.data = mappedArray<float>(data, rh.dataSize, shape, m_mapping);
+                break;
+            case Types::DOUBLE:
+                frame.data = mappedArray<double>(data, rh.dataSize, shape, m_mapping);
+                break;
+            default:
+                throw KARABO_NOT_IMPLEMENTED_EXCEPTION("Recorded data type " + toString(rh.kType) +
+                                                       " is not supported");
+        }
+    }
+
+
+    Timestamp util::FrameRecording::timestamp(size_t index) const {
+        if (index >= m_offsets.size()) {
+            throw KARABO_PARAMETER_EXCEPTION("Frame index " + toString(index) + " out of range [0, " +
+                                             toString(m_offsets.size()) + ")");
+        }
+
+        const RecordHeader& rh = *reinterpret_cast<const RecordHeader*>(m_mapping->data() + m_offsets[index]);
+        return Timestamp(Epochstamp(rh.seconds, rh.fractionalSeconds), Trainstamp(rh.trainId));
+    }
+
+} // namespace karabo
@@ -0,0 +1,164 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_FRAMERECORDER_HH
+#define KARABO_FRAMERECORDER_HH
+
+#include <memory>
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief A frame, as passed to ImageSource::writeChannels.
+         */
+        struct RecordedFrame {
+            karabo::util::NDArray data;
+            karabo::util::Dims binning;
+            unsigned short bitsPerPixel;
+            karabo::xms::EncodingType encoding;
+            karabo::util::Dims roiOffsets;
+            karabo::util::Timestamp timestamp;
+            karabo::util::Hash header;
+        };
+
+        /**
+         * @brief Record frames and their metadata to an append-only file.
+         *
+         * The file is memory-mapped, and grown by large chunks: appending a frame is a copy of its pixel data. The
+         * size of each record is written last, so that a file whose recording was interrupted can still be read up
+         * to the last complete frame.
+         *
+         * The pixel data are recorded as they are, i.e. packed data can be recorded as a UINT8 array.
+         *
+         * The class is not thread-safe.
+         */
+        class FrameRecorder {
+           public:
+            FrameRecorder();
+
+            FrameRecorder(const FrameRecorder&) = delete;
+            FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+            ~FrameRecorder();
+
+            /**
+             * @brief Open a file for recording. If the file already contains recorded frames, the new frames are
+             * appended.
+             *
+             * @param filename The file name.
+             */
+            void open(const std::string& filename);
+
+            /**
+             * @brief Close the file, which is truncated to the recorded frames.
+             */
+            void close();
+
+            bool isOpen() const {
+                return m_fd >= 0;
+            }
+
+            /**
+             * @brief Exchange the files of two recorders, e.g. to replace a recording by one opened beforehand.
+             */
+            void swap(FrameRecorder& other);
+
+            /**
+             * @brief Append a frame to the file.
+             *
+             * The parameters are the ones of ImageSource::writeChannels.
+             */
+            void append(const karabo::util::NDArray& data, const karabo::util::Dims& binning,
+                        const unsigned short bpp, const karabo::xms::EncodingType& encoding,
+                        const karabo::util::Dims& roiOffsets, const karabo::util::Timestamp& timestamp,
+                        const karabo::util::Hash& header);
+
+            /**
+             * @brief The number of frames in the file.
+             */
+            unsigned long long frames() const {
+                return m_frames;
+            }
+
+            /**
+             * @brief The size of the recorded frames in the file, in bytes.
+             */
+            unsigned long long bytes() const {
+                return m_end;
+            }
+
+           private:
+            void map(size_t size);
+
+            void unmap();
+
+            std::string m_filename;
+            int m_fd;
+            char* m_map;
+            size_t m_mapSize;
+            size_t m_end; // where the next record is written
+            unsigned long long m_frames;
+            karabo::io::BinarySerializer<karabo::util::Hash>::Pointer m_serializer;
+            std::vector<char> m_archive;
+        };
+
+        /**
+         * @brief Read the frames from a file written by FrameRecorder.
+         *
+         * The file is memory-mapped, and the pixel data of the frames are not copied: they remain valid as long
+         * as the frames are used, even after the recording is closed.
+         */
+        class FrameRecording {
+           public:
+            FrameRecording() = default;
+
+            /**
+             * @brief Open a recording, and index its frames.
+             *
+             * @param filename The file name.
+             */
+            void open(const std::string& filename);
+
+            void close();
+
+            /**
+             * @brief The number of frames in the recording.
+             */
+            size_t size() const {
+                return m_offsets.size();
+            }
+
+            /**
+             * @brief Get a frame from the recording.
+             *
+             * @param index The frame index, from 0 (the first recorded frame) to size() - 1.
+             * @param frame The frame. Its pixel data are shared with the recording.
+             */
+            void frame(size_t index, RecordedFrame& frame) const;
+
+            /**
+             * @brief Get the timestamp of a frame, without reading it.
+             */
+            karabo::util::Timestamp timestamp(size_t index) const;
+
+           private:
+            class Mapping;
+
+            std::shared_ptr<Mapping> m_mapping;
+            std::vector<size_t> m_offsets; // the offset of each record in the file
+            karabo::io::BinarySerializer<karabo::util::Hash>::Pointer m_serializer;
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <cstring>
+#include <fstream>
+
+#include "FrameRing.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        const char FILE_MAGIC[8] = {'K', 'R', 'B', 'R', 'I', 'N', 'G', '1'};
+
+
+        template <class T>
+        void writeValue(std::ofstream& ofs, const T& value) {
+            ofs.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+
+        template <class T>
+        T readValue(std::ifstream& ifs) {
+            T value = T();
+            ifs.read(reinterpret_cast<char*>(&value), sizeof(value));
+            return value;
+        }
+
+
+        void writeDims(std::ofstream& ofs, const Dims& dims, size_t rank) {
+            for (size_t i = 0; i < rank; ++i) {
+                writeValue<unsigned long long>(ofs, i < dims.rank() ? dims.extentIn(i) : 0);
+            }
+        }
+
+
+        std::vector<unsigned long long> readDims(std::ifstream& ifs, size_t rank) {
+            std::vector<unsigned long long> dims(rank);
+            ifs.read(reinterpret_cast<char*>(dims.data()), rank * sizeof(unsigned long long));
+            return dims;
+        }
+
+    } // namespace
+
+
+    util::FrameRing::FrameRing(unsigned int capacity)
+        : m_slots(capacity),
+          m_next(0),
+          m_size(0),
+          m_triggered(false),
+          m_postFrames(0),
+          m_frozen(false),
+          m_kType(Types::UNKNOWN) {}
+
+
+    void util::FrameRing::setCapacity(unsigned int capacity) {
+        m_slots.clear();
+        m_slots.resize(capacity);
+        m_shape = Dims();
+        m_kType = Types::UNKNOWN;
+        this->clear();
+    }
+
+
+    void util::FrameRing::clear() {
+        m_next = 0;
+        m_size = 0;
+        this->release();
+    }
+
+
+    void util::FrameRing::allocate(const Dims& shape, const Types::ReferenceType& kType) {
+        // The whole pool is allocated at once
+        for (Slot& slot : m_slots) {
+            slot.data = NDArray(shape, kType);
+        }
+        m_shape = shape;
+        m_kType = kType;
+        m_next = 0;
+        m_size = 0;
+    }
+
+
+    bool util::FrameRing::push(const karabo::xms::ImageData& imd, const Timestamp& timestamp) {
+        if (m_frozen || m_slots.empty()) {
+            return false;
+        }
+
+        if (!imd.isIndexable()) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot record non-indexable image");
+        }
+
+        const NDArray& arr = imd.getData();
+        const Dims shape = arr.getShape();
+        if (shape != m_shape || arr.getType() != m_kType) {
+            this->allocate(shape, arr.getType());
+        }
+
+        Slot& slot = m_slots[m_next];
+        std::memcpy(slot.data.getData<char>(), arr.getData<char>(), arr.byteSize());
+        slot.timestamp = timestamp;
+        slot.encoding = imd.getEncoding();
+        slot.bitsPerPixel = imd.getBitsPerPixel();
+        slot.roiOffsets = imd.getROIOffsets();
+        slot.binning = imd.getBinning();
+
+        m_next = (m_next + 1) % m_slots.size();
+        m_size = std::min<unsigned int>(m_size + 1, m_slots.size());
+
+        if (m_triggered && --m_postFrames == 0) {
+            m_triggered = false;
+            m_frozen = true;
+            return true;
+        }
+
+        return false;
+    }
+
+
+    void util::FrameRing::trigger(unsigned int postFrames) {
+        if (m_frozen || m_triggered) {
+            return; // Already triggered
+        }
+
+        if (postFrames == 0) {
+            m_frozen = true;
+        } else {
+            m_triggered = true;
+            m_postFrames = postFrames;
+        }
+    }
+
+
+    void util::FrameRing::release() {
+        m_triggered = false;
+        m_postFrames = 0;
+        m_frozen = false;
+    }
+
+
+    Timestamp util::FrameRing::frame(unsigned int index, karabo::xms::ImageData& imd) const {
+        if (index >= m_size) {
+            throw KARABO_PARAMETER_EXCEPTION("Frame index " + toString(index) + " out of range [0, " +
+                                             toString(m_size) + ")");
+        }
+
+        const unsigned int capacity = m_slots.size();
+        const Slot& slot = m_slots[(m_next + capacity - m_size + index) % capacity];
+        imd = karabo::xms::ImageData(slot.data, static_cast<karabo::xms::EncodingType>(slot.encoding));
+        imd.setBitsPerPixel(slot.bitsPerPixel);
+        imd.setROIOffsets(slot.roiOffsets);
+        imd.setBinning(slot.binning);
+        return slot.timestamp;
+    }
+
+
+    void util::FrameRing::save(const std::string& filename) const {
+        std::ofstream ofs(filename, std::fstream::binary | std::fstream::trunc);
+        if (!ofs) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename + " for writing");
+        }
+
+        const size_t rank = m_shape.rank();
+        ofs.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        writeValue<uint32_t>(ofs, m_size);
+        writeValue<uint32_t>(ofs, rank);
+        writeDims(ofs, m_shape, rank);
+        writeValue<int32_t>(ofs, m_kType);
+
+        karabo::xms::ImageData imd;
+        for (unsigned int i = 0; i < m_size; ++i) {
+            const Timestamp timestamp = this->frame(i, imd);
+            writeValue<unsigned long long>(ofs, timestamp.getTrainId());
+            writeValue<unsigned long long>(ofs, timestamp.getSeconds());
+            writeValue<unsigned long long>(ofs, timestamp.getFractionalSeconds());
+            writeValue<int32_t>(ofs, imd.getEncoding());
+            writeValue<uint16_t>(ofs, imd.getBitsPerPixel());
+            writeDims(ofs, imd.getROIOffsets(), rank);
+            writeDims(ofs, imd.getBinning(), rank);
+            const NDArray& arr = imd.getData();
+            ofs.write(arr.getData<char>(), arr.byteSize());
+        }
+
+        if (!ofs) {
+            throw KARABO_IO_EXCEPTION("Could not write frames to file " + filename);
+        }
+    }
+
+
+    void util::FrameRing::load(const std::string& filename) {
+        std::ifstream ifs(filename, std::fstream::binary);
+        if (!ifs) {
+            throw KARABO_IO_EXCEPTION("Could not open file " + filename);
+        }
+
+        char magic[sizeof(FILE_MAGIC)];
+        ifs.read(magic, sizeof(magic));
+        const uint32_t nFrames = readValue<uint32_t>(ifs);
+        const uint32_t rank = readValue<uint32_t>(ifs);
+        if (!ifs || std::memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || rank > 3) {
+            throw KARABO_IO_EXCEPTION("File " + filename + " does not contain recorded frames");
+        }
+        const Dims shape(readDims(ifs, rank));
+        const Types::ReferenceType kType = static_cast<Types::ReferenceType>(readValue<int32_t>(ifs));
+
+        if (nFrames > m_slots.size()) {
+            m_slots.resize(nFrames);
+        }
+        this->allocate(shape, kType);
+        this->release();
+
+        for (unsigned int i = 0; i < nFrames; ++i) {
+            Slot& slot = m_slots[i];
+            const unsigned long long trainId = readValue<unsigned long long>(ifs);
+            const unsigned long long seconds = readValue<unsigned long long>(ifs);
+            const unsigned long long fractional = readValue<unsigned long long>(ifs);
+            slot.timestamp = Timestamp(Epochstamp(seconds, fractional), Trainstamp(trainId));
+            slot.encoding = readValue<int32_t>(ifs);
+            slot.bitsPerPixel = readValue<uint16_t>(ifs);
+            slot.roiOffsets = Dims(readDims(ifs, rank));
+            slot.binning = Dims(readDims(ifs, rank));
+            ifs.read(slot.data.getData<char>(), slot.data.byteSize());
+            if (!ifs) {
+                this->clear();
+                throw KARABO_IO_EXCEPTION("File " + filename + " is truncated");
+            }
+        }
+
+        m_size = nFrames;
+        m_next = m_slots.empty() ? 0 : nFrames % m_slots.size();
+        m_frozen = true;
+    }
+
+} // namespace karabo
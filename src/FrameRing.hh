@@ -0,0 +1,143 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_FRAMERING_HH
+#define KARABO_FRAMERING_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Ring buffer of the most recent frames, which can be frozen when an event occurs.
+         *
+         * The frames are copied into a pool of buffers, which is allocated when the first frame is pushed, and
+         * then only when the frame size or type changes: no memory is allocated per frame.
+         *
+         * When triggered, the ring keeps recording a given number of frames - i.e. the frames after the event -
+         * and then freezes, until it is released.
+         *
+         * The class is not thread-safe.
+         */
+        class FrameRing {
+           public:
+            /**
+             * @param capacity The maximum number of frames in the ring.
+             */
+            explicit FrameRing(unsigned int capacity = 0);
+
+            /**
+             * @brief Set the maximum number of frames in the ring. The ring is cleared and released.
+             */
+            void setCapacity(unsigned int capacity);
+
+            unsigned int capacity() const {
+                return m_slots.size();
+            }
+
+            /**
+             * @brief The number of frames in the ring.
+             */
+            unsigned int size() const {
+                return m_size;
+            }
+
+            /**
+             * @brief Remove all the frames, and release the ring.
+             */
+            void clear();
+
+            /**
+             * @brief Copy a frame into the ring, replacing the oldest one if the ring is full.
+             *
+             * If the frame size or type differs from the ones of the frames in the ring, the ring is cleared.
+             *
+             * @param imd The ImageData object - to be recorded. It must be indexable.
+             * @param timestamp The frame timestamp.
+             * @return true if the ring froze after this frame, i.e. this was the last frame after the trigger.
+             */
+            bool push(const karabo::xms::ImageData& imd, const karabo::util::Timestamp& timestamp);
+
+            /**
+             * @brief Freeze the ring after a number of frames.
+             *
+             * @param postFrames The number of frames to be recorded before freezing. Zero to freeze now.
+             */
+            void trigger(unsigned int postFrames = 0);
+
+            /**
+             * @brief Return true if the ring is frozen, i.e. does not record frames.
+             */
+            bool isFrozen() const {
+                return m_frozen;
+            }
+
+            /**
+             * @brief Return true if the ring has been triggered, and is not frozen yet.
+             */
+            bool isTriggered() const {
+                return m_triggered;
+            }
+
+            /**
+             * @brief Resume recording.
+             */
+            void release();
+
+            /**
+             * @brief Get a frame from the ring.
+             *
+             * @param index The frame index, from 0 (the oldest frame) to size() - 1 (the newest one).
+             * @param imd The frame. Its pixel data are shared with the ring: they are only valid while the ring is
+             * frozen.
+             * @return The frame timestamp.
+             */
+            karabo::util::Timestamp frame(unsigned int index, karabo::xms::ImageData& imd) const;
+
+            /**
+             * @brief Save the frames in the ring to a file, from the oldest to the newest one.
+             *
+             * @param filename The file name.
+             */
+            void save(const std::string& filename) const;
+
+            /**
+             * @brief Load frames from a file written by save. The ring is resized if needed, and frozen.
+             *
+             * @param filename The file name.
+             */
+            void load(const std::string& filename);
+
+           private:
+            struct Slot {
+                karabo::util::NDArray data;
+                karabo::util::Timestamp timestamp;
+                int encoding;
+                unsigned short bitsPerPixel;
+                karabo::util::Dims roiOffsets;
+                karabo::util::Dims binning;
+            };
+
+            void allocate(const karabo::util::Dims& shape, const karabo::util::Types::ReferenceType& kType);
+
+            std::vector<Slot> m_slots;
+            unsigned int m_next; // the slot the next frame is written to
+            unsigned int m_size;
+            bool m_triggered;
+            unsigned int m_postFrames; // frames still to be recorded after the trigger
+            bool m_frozen;
+            karabo::util::Dims m_shape; // the shape and type the slots are allocated for
+            karabo::util::Types::ReferenceType m_kType;
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <cstring>
+
+#include "FrameStack.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    util::FrameStack::FrameStack(unsigned int depth) : m_depth(1), m_size(0) {
+        this->setDepth(depth);
+    }
+
+
+    void util::FrameStack::setDepth(unsigned int depth) {
+        if (depth == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The number of frames per stack must be positive");
+        }
+
+        m_depth = depth;
+        m_size = 0;
+        m_stack = NDArray();
+    }
+
+
+    bool util::FrameStack::accepts(const karabo::xms::ImageData& imd, const Timestamp& timestamp) const {
+        if (m_size == 0) {
+            return true;
+        }
+
+        const NDArray& arr = imd.getData();
+        const NDArray& first = m_first.getData();
+        return timestamp.getTrainId() == m_timestamp.getTrainId() && arr.getShape() == first.getShape() &&
+               arr.getType() == first.getType() && imd.getEncoding() == m_first.getEncoding();
+    }
+
+
+    bool util::FrameStack::add(const karabo::xms::ImageData& imd, const Timestamp& timestamp) {
+        if (!this->accepts(imd, timestamp)) {
+            throw KARABO_PARAMETER_EXCEPTION("The frame does not belong to the current stack");
+        }
+
+        const NDArray& arr = imd.getData();
+        if (m_size == 0) {
+            // A new stack: NB it is allocated per stack, not per frame, as the published one is handed over
+            std::vector<unsigned long long> shape = arr.getShape().toVector();
+            shape.insert(shape.begin(), m_depth);
+            m_stack = NDArray(Dims(shape), arr.getType());
+            m_first = imd;
+            m_timestamp = timestamp;
+            m_frameTimestamps.assign(m_depth, 0ull);
+        }
+
+        const size_t frameBytes = arr.byteSize();
+        std::memcpy(m_stack.getData<char>() + m_size * frameBytes, arr.getData<char>(), frameBytes);
+
+        const Epochstamp& epoch = timestamp.getEpochstamp();
+        // NB the fractional seconds are in attoseconds
+        m_frameTimestamps[m_size] = epoch.getSeconds() * 1000000000ull + epoch.getFractionalSeconds() / 1000000000ull;
+
+        return ++m_size == m_depth;
+    }
+
+
+    Timestamp util::FrameStack::take(karabo::xms::ImageData& imd, std::vector<unsigned long long>& frameTimestamps) {
+        if (m_size == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The stack is empty");
+        }
+
+        // The missing frames are zeros
+        const size_t frameBytes = m_first.getData().byteSize();
+        std::memset(m_stack.getData<char>() + m_size * frameBytes, 0, (m_depth - m_size) * frameBytes);
+
+        imd = m_first;
+        const Dims dims = m_stack.getShape();
+        imd.setData(m_stack);
+        imd.setDimensions(dims);
+        frameTimestamps.swap(m_frameTimestamps);
+
+        m_size = 0;
+        m_stack = NDArray();
+        m_first = karabo::xms::ImageData();
+        return m_timestamp;
+    }
+
+} // namespace karabo
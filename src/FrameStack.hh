@@ -0,0 +1,86 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_FRAMESTACK_HH
+#define KARABO_FRAMESTACK_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Stack of the frames belonging to one train, to be published as a single 3D array of shape
+         * (frames, height, width) or (frames, height, width, channel).
+         *
+         * The stack has a fixed depth, so that its shape does not change: if a train has fewer frames, the
+         * remaining ones are filled with zeros.
+         *
+         * The class is not thread-safe.
+         */
+        class FrameStack {
+           public:
+            /**
+             * @param depth The number of frames per stack. It must be positive.
+             */
+            explicit FrameStack(unsigned int depth = 1);
+
+            /**
+             * @brief Set the number of frames per stack. The current stack is discarded.
+             */
+            void setDepth(unsigned int depth);
+
+            unsigned int depth() const {
+                return m_depth;
+            }
+
+            /**
+             * @brief The number of frames in the current stack.
+             */
+            unsigned int size() const {
+                return m_size;
+            }
+
+            /**
+             * @brief Return true if a frame can be added to the current stack, i.e. the stack is empty, or the
+             * frame belongs to the same train and has the same shape and type as the stacked ones.
+             */
+            bool accepts(const karabo::xms::ImageData& imd, const karabo::util::Timestamp& timestamp) const;
+
+            /**
+             * @brief Add a frame to the current stack. The frame data are copied.
+             *
+             * @return true if the stack is full.
+             */
+            bool add(const karabo::xms::ImageData& imd, const karabo::util::Timestamp& timestamp);
+
+            /**
+             * @brief Take the current stack, and start a new one.
+             *
+             * @param imd The stacked frames. Their metadata (encoding, ROI, binning, bits-per-pixel, header)
+             * are the ones of the first frame.
+             * @param frameTimestamps The time of each frame, in ns since the epoch. Zero for missing frames.
+             * @return The timestamp of the first frame.
+             */
+            karabo::util::Timestamp take(karabo::xms::ImageData& imd,
+                                         std::vector<unsigned long long>& frameTimestamps);
+
+           private:
+            unsigned int m_depth;
+            unsigned int m_size;
+            karabo::util::NDArray m_stack;
+            karabo::xms::ImageData m_first; // the first frame: shape, type and metadata of the stack
+            karabo::util::Timestamp m_timestamp;
+            std::vector<unsigned long long> m_frameTimestamps;
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
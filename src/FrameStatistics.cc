@@ -0,0 +1,219 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include "FrameStatistics.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // Accumulator types: exact integer sums for integer pixels (so that the reductions can be vectorized),
+        // double otherwise.
+        template <class T, class Enable = void>
+        struct StatTraits {
+            using Sum = double;
+            using SumSq = double;
+        };
+
+        template <class T>
+        struct StatTraits<T, typename std::enable_if<std::is_integral<T>::value && (sizeof(T) <= 2)>::type> {
+            using Sum = typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type;
+            using SumSq = Sum;
+        };
+
+        template <class T>
+        struct StatTraits<T, typename std::enable_if<std::is_integral<T>::value && (sizeof(T) > 2)>::type> {
+            using Sum = typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type;
+            using SumSq = double;
+        };
+
+
+        template <class T>
+        T saturationThreshold(double level) {
+            if (std::is_integral<T>::value) {
+                const double hi = static_cast<double>(std::numeric_limits<T>::max());
+                return static_cast<T>(std::min(std::ceil(level), hi));
+            } else {
+                return static_cast<T>(level);
+            }
+        }
+
+
+        template <class T>
+        struct RowAccumulator {
+            using Sum = typename StatTraits<T>::Sum;
+            using SumSq = typename StatTraits<T>::SumSq;
+
+            T min = std::numeric_limits<T>::max();
+            T max = std::numeric_limits<T>::lowest();
+            Sum sum = 0;
+            SumSq sumSq = 0;
+            unsigned long long saturated = 0;
+
+            // Contiguous values: no branches in the loop, so that it can be vectorized
+            void add(const T* values, size_t n, T saturation) {
+                T rMin = min, rMax = max;
+                Sum rSum = 0;
+                SumSq rSumSq = 0;
+                unsigned long long rSaturated = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    const T v = values[i];
+                    rMin = std::min(rMin, v);
+                    rMax = std::max(rMax, v);
+                    rSum += v;
+                    rSumSq += static_cast<SumSq>(v) * static_cast<SumSq>(v);
+                    rSaturated += (v >= saturation);
+                }
+                min = rMin;
+                max = rMax;
+                sum += rSum;
+                sumSq += rSumSq;
+                saturated += rSaturated;
+            }
+        };
+
+    } // namespace
+
+
+    void util::computeFrameStatistics(const NDArray& arr, FrameStatistics& stats, unsigned int bins,
+                                      double histogramMin, double histogramMax, double saturationLevel,
+                                      unsigned int step) {
+        if (bins == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The number of histogram bins must be positive");
+        }
+
+        if (!(histogramMax > histogramMin)) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid histogram range [" + toString(histogramMin) + ", " +
+                                             toString(histogramMax) + "]");
+        }
+
+        if (step == 0) {
+            step = 1;
+        }
+
+        switch (arr.getType()) {
+            case Types::UINT8:
+                util::frame_statistics<uint8_t>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            case Types::INT8:
+                util::frame_statistics<int8_t>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            case Types::UINT16:
+                util::frame_statistics<uint16_t>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            case Types::INT16:
+                util::frame_statistics<int16_t>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            case Types::UINT32:
+                util::frame_statistics<uint32_t>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            case Types::INT32:
+                util::frame_statistics<int32_t>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            case Types::UINT64:
+                util::frame_statistics<unsigned long long>(arr, stats, bins, histogramMin, histogramMax,
+                                                           saturationLevel, step);
+                break;
+            case Types::INT64:
+                util::frame_statistics<long long>(arr, stats, bins, histogramMin, histogramMax, saturationLevel,
+                                                  step);
+                break;
+            case Types::FLOAT:
+                util::frame_statistics<float>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            case Types::DOUBLE:
+                util::frame_statistics<double>(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot compute statistics of images of type " +
+                                                 toString(arr.getType()));
+        }
+    }
+
+
+    template <class T>
+    void util::frame_statistics(const NDArray& arr, FrameStatistics& stats, unsigned int bins, double histogramMin,
+                                double histogramMax, double saturationLevel, unsigned int step) {
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2 && shape.rank() != 3) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot compute statistics of image of rank " +
+                                             std::to_string(shape.rank()));
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const size_t channels = (shape.rank() == 3) ? shape.x3() : 1;
+        const size_t rowLength = width * channels;
+        const T* data = arr.getData<T>();
+
+        // If the saturation level is not positive, no value can be counted as saturated
+        const bool countSaturation = (saturationLevel > 0.);
+        const T saturation = countSaturation ? saturationThreshold<T>(saturationLevel) : std::numeric_limits<T>::max();
+
+        stats.histogram.assign(bins, 0);
+        stats.histogramMin = histogramMin;
+        stats.histogramMax = histogramMax;
+        unsigned int* histogram = stats.histogram.data();
+        const double scale = bins / (histogramMax - histogramMin);
+        const double lastBin = bins - 1;
+
+        RowAccumulator<T> acc;
+
+        // Buffer for the sampled values of one row
+        std::vector<T> sampled(step > 1 ? (width + step - 1) / step * channels : 0);
+
+        for (size_t y = 0; y < height; y += step) {
+            const T* row = data + y * rowLength;
+            size_t n = rowLength;
+
+            if (step > 1) {
+                size_t k = 0;
+                for (size_t x = 0; x < width; x += step) {
+                    for (size_t c = 0; c < channels; ++c) {
+                        sampled[k++] = row[x * channels + c];
+                    }
+                }
+                row = sampled.data();
+                n = k;
+            }
+
+            acc.add(row, n, saturation);
+
+            for (size_t i = 0; i < n; ++i) {
+                const double bin = (static_cast<double>(row[i]) - histogramMin) * scale;
+                ++histogram[static_cast<int>(std::min(std::max(bin, 0.), lastBin))];
+            }
+        }
+
+        const size_t sampledRows = (height + step - 1) / step;
+        const size_t sampledColumns = (width + step - 1) / step;
+        const unsigned long long pixels = sampledRows * sampledColumns * channels;
+
+        stats.pixels = pixels;
+        stats.saturatedPixels = countSaturation ? acc.saturated : 0;
+        if (pixels == 0) {
+            stats.min = stats.max = stats.mean = stats.stdDev = 0.;
+            return;
+        }
+
+        stats.min = static_cast<double>(acc.min);
+        stats.max = static_cast<double>(acc.max);
+        stats.mean = static_cast<double>(acc.sum) / pixels;
+        const double variance = static_cast<double>(acc.sumSq) / pixels - stats.mean * stats.mean;
+        stats.stdDev = std::sqrt(std::max(variance, 0.));
+    }
+
+} // namespace karabo
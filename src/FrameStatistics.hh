@@ -0,0 +1,68 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_FRAMESTATISTICS_HH
+#define KARABO_FRAMESTATISTICS_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief The statistics of an image.
+         */
+        struct FrameStatistics {
+            double min = 0.;
+            double max = 0.;
+            double mean = 0.;
+            double stdDev = 0.;
+            unsigned long long saturatedPixels = 0; // number of values >= saturation level
+            unsigned long long pixels = 0;          // number of values analysed
+            double histogramMin = 0.;               // lower edge of the first bin
+            double histogramMax = 0.;               // upper edge of the last bin
+            std::vector<unsigned int> histogram;    // values out of range are counted in the first or last bin
+        };
+
+        /**
+         * @brief Compute min, max, mean, standard deviation, histogram and saturated-pixel count of an image, in a
+         * single pass.
+         *
+         * The image is processed row by row: the reductions are done first, in a loop that the compiler can
+         * vectorize, then the histogram is filled from the same row, which is still in cache.
+         *
+         * For images with more than one channel (e.g. RGB) all the values are considered together.
+         *
+         * @param arr The NDArray object - to be analysed. It must be of rank 2 or 3.
+         * @param stats The computed statistics. Its histogram vector is reused, to avoid allocations.
+         * @param bins The number of histogram bins. It must be positive.
+         * @param histogramMin The lower edge of the histogram.
+         * @param histogramMax The upper edge of the histogram. It must be larger than histogramMin.
+         * @param saturationLevel The values larger or equal to it are counted as saturated. If it is not positive,
+         * the saturated pixels are not counted.
+         * @param step Only analyse every step-th row and column.
+         */
+        void computeFrameStatistics(const karabo::util::NDArray& arr, FrameStatistics& stats, unsigned int bins,
+                                    double histogramMin, double histogramMax, double saturationLevel,
+                                    unsigned int step = 1);
+
+        /**
+         * @brief Compute the statistics of an image.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * See computeFrameStatistics for the other parameters.
+         */
+        template <class T>
+        void frame_statistics(const karabo::util::NDArray& arr, FrameStatistics& stats, unsigned int bins,
+                              double histogramMin, double histogramMax, double saturationLevel, unsigned int step);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,376 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <cmath>
+#include <type_traits>
+
+#include "ImageBinning.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // The accumulator type used for a given pixel type
+        template <class T>
+        struct BinTraits;
+
+        template <>
+        struct BinTraits<uint8_t> {
+            using Acc = uint32_t;
+        };
+        template <>
+        struct BinTraits<int8_t> {
+            using Acc = int32_t;
+        };
+        template <>
+        struct BinTraits<uint16_t> {
+            using Acc = uint32_t;
+        };
+        template <>
+        struct BinTraits<int16_t> {
+            using Acc = int32_t;
+        };
+        template <>
+        struct BinTraits<uint32_t> {
+            using Acc = uint64_t;
+        };
+        template <>
+        struct BinTraits<int32_t> {
+            using Acc = int64_t;
+        };
+        template <>
+        struct BinTraits<unsigned long long> {
+            using Acc = unsigned long long;
+        };
+        template <>
+        struct BinTraits<long long> {
+            using Acc = long long;
+        };
+        template <>
+        struct BinTraits<float> {
+            using Acc = double;
+        };
+        template <>
+        struct BinTraits<double> {
+            using Acc = double;
+        };
+
+
+        template <class Acc>
+        inline typename std::enable_if<std::is_integral<Acc>::value, Acc>::type roundedMean(Acc sum, Acc area) {
+            const Acc half = area / 2;
+            return (sum >= 0) ? (sum + half) / area : -((-sum + half) / area);
+        }
+
+
+        template <class Acc>
+        inline typename std::enable_if<std::is_floating_point<Acc>::value, Acc>::type roundedMean(Acc sum,
+                                                                                                 Acc area) {
+            return sum / area;
+        }
+
+
+        // Sum groups of BX consecutive pixels (of 'channels' components each) in the row accumulator.
+        // BX is a compile-time constant for the common factors, so that the inner loop can be unrolled and
+        // vectorized by the compiler; BX = 0 means that the run-time value binX is used.
+        template <unsigned int BX, class Acc, class Out>
+        void reduceRow(const Acc* acc, size_t outWidth, size_t channels, unsigned int binX, bool mean, Acc area,
+                       Out* out) {
+            const unsigned int bx = (BX == 0) ? binX : BX;
+            const size_t step = bx * channels;
+            for (size_t ox = 0; ox < outWidth; ++ox) {
+                const Acc* a = acc + ox * step;
+                for (size_t c = 0; c < channels; ++c) {
+                    Acc sum = 0;
+                    for (unsigned int k = 0; k < bx; ++k) {
+                        sum += a[k * channels + c];
+                    }
+                    out[ox * channels + c] = static_cast<Out>(mean ? roundedMean(sum, area) : sum);
+                }
+            }
+        }
+
+
+        template <class T, class Out>
+        void binKernel(const T* in, size_t height, size_t width, size_t channels, unsigned int binY,
+                       unsigned int binX, bool mean, Out* out) {
+            using Acc = typename BinTraits<T>::Acc;
+
+            const size_t outHeight = height / binY;
+            const size_t outWidth = width / binX;
+            const size_t rowLength = width * channels;
+            const size_t usedLength = outWidth * binX * channels;
+            const Acc area = static_cast<Acc>(binY) * binX;
+
+            // One row of wide accumulators: the vertical sum is done element-wise on contiguous memory, which
+            // the compiler can vectorize, and the horizontal reduction is then done once per output row.
+            std::vector<Acc> acc(usedLength);
+
+            for (size_t oy = 0; oy < outHeight; ++oy) {
+                const T* row = in + oy * binY * rowLength;
+                for (size_t i = 0; i < usedLength; ++i) {
+                    acc[i] = row[i];
+                }
+                for (unsigned int k = 1; k < binY; ++k) {
+                    row += rowLength;
+                    for (size_t i = 0; i < usedLength; ++i) {
+                        acc[i] += row[i];
+                    }
+                }
+
+                Out* outRow = out + oy * outWidth * channels;
+                switch (binX) {
+                    case 1:
+                        reduceRow<1>(acc.data(), outWidth, channels, binX, mean, area, outRow);
+                        break;
+                    case 2:
+                        reduceRow<2>(acc.data(), outWidth, channels, binX, mean, area, outRow);
+                        break;
+                    case 4:
+                        reduceRow<4>(acc.data(), outWidth, channels, binX, mean, area, outRow);
+                        break;
+                    default:
+                        reduceRow<0>(acc.data(), outWidth, channels, binX, mean, area, outRow);
+                }
+            }
+        }
+
+
+        void checkShape(const Dims& shape, const std::string& what) {
+            if (shape.rank() != 2 && shape.rank() != 3) {
+                throw KARABO_PARAMETER_EXCEPTION("Cannot " + what + " image of rank " + std::to_string(shape.rank()));
+            }
+        }
+
+    } // namespace
+
+
+    void util::cropImage(karabo::xms::ImageData& imd, const Dims& roiOffsets, const Dims& roiSize, FramePool* pool) {
+        if (!imd.isIndexable()) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot crop non-indexable image");
+        }
+
+        const NDArray& arr = imd.getData();
+        NDArray cropped;
+
+        switch (arr.getType()) {
+            case Types::UINT8:
+            case Types::INT8:
+                cropped = util::crop_image<uint8_t>(arr, roiOffsets, roiSize, pool);
+                break;
+            case Types::UINT16:
+            case Types::INT16:
+                cropped = util::crop_image<uint16_t>(arr, roiOffsets, roiSize, pool);
+                break;
+            case Types::UINT32:
+            case Types::INT32:
+            case Types::FLOAT:
+                cropped = util::crop_image<uint32_t>(arr, roiOffsets, roiSize, pool);
+                break;
+            case Types::UINT64:
+            case Types::INT64:
+            case Types::DOUBLE:
+                cropped = util::crop_image<unsigned long long>(arr, roiOffsets, roiSize, pool);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot crop images of type " + toString(arr.getType()));
+        }
+
+        const Dims binning = imd.getBinning();
+        std::vector<unsigned long long> offsets = imd.getROIOffsets().toVector();
+        for (size_t i = 0; i < offsets.size() && i < 2; ++i) {
+            const unsigned long long bin = (i < binning.rank() && binning.extentIn(i) > 0) ? binning.extentIn(i) : 1;
+            offsets[i] += roiOffsets.extentIn(i) * bin;
+        }
+
+        const Dims dims = cropped.getShape();
+        imd.setData(cropped);
+        imd.setDimensions(dims);
+        imd.setROIOffsets(Dims(offsets));
+    }
+
+
+    template <class T>
+    NDArray util::crop_image(const NDArray& arr, const Dims& roiOffsets, const Dims& roiSize, FramePool* pool) {
+        const Dims shape = arr.getShape();
+        checkShape(shape, "crop");
+
+        if (roiOffsets.rank() < 2 || roiSize.rank() < 2) {
+            throw KARABO_PARAMETER_EXCEPTION("ROI offsets and size must be of the form (y, x)");
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const size_t channels = (shape.rank() == 3) ? shape.x3() : 1;
+        const size_t y0 = roiOffsets.x1();
+        const size_t x0 = roiOffsets.x2();
+        const size_t roiHeight = roiSize.x1();
+        const size_t roiWidth = roiSize.x2();
+
+        if (roiHeight == 0 || roiWidth == 0 || y0 + roiHeight > height || x0 + roiWidth > width) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid ROI: offsets (" + std::to_string(y0) + ", " +
+                                             std::to_string(x0) + "), size (" + std::to_string(roiHeight) + ", " +
+                                             std::to_string(roiWidth) + ") for image of size (" +
+                                             std::to_string(height) + ", " + std::to_string(width) + ")");
+        }
+
+        const Dims outShape = (shape.rank() == 3) ? Dims(roiHeight, roiWidth, channels) : Dims(roiHeight, roiWidth);
+        // T is only used for its size: keep the original type
+        NDArray out = pool ? pool->allocate(outShape, arr.getType()) : NDArray(outShape, arr.getType());
+
+        const T* in = arr.getData<T>();
+        T* data = out.getData<T>();
+        const size_t rowLength = width * channels;
+        const size_t roiRowLength = roiWidth * channels;
+        for (size_t y = 0; y < roiHeight; ++y) {
+            std::memcpy(data + y * roiRowLength, in + (y0 + y) * rowLength + x0 * channels, roiRowLength * sizeof(T));
+        }
+
+        return out;
+    }
+
+
+    void util::binImage(karabo::xms::ImageData& imd, unsigned int binY, unsigned int binX, BinningMode mode,
+                        FramePool* pool) {
+        if (!imd.isIndexable()) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot bin non-indexable image");
+        }
+
+        if (binY < 1 || binY > 256 || binX < 1 || binX > 256) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid binning (" + std::to_string(binY) + ", " +
+                                             std::to_string(binX) + "). Factors must be in [1, 256].");
+        }
+
+        if (binY == 1 && binX == 1) {
+            // nothing to be done
+            return;
+        }
+
+        const NDArray& arr = imd.getData();
+        NDArray binned;
+
+        switch (arr.getType()) {
+            case Types::UINT8:
+                binned = util::bin_image<uint8_t>(arr, binY, binX, mode, pool);
+                break;
+            case Types::INT8:
+                binned = util::bin_image<int8_t>(arr, binY, binX, mode, pool);
+                break;
+            case Types::UINT16:
+                binned = util::bin_image<uint16_t>(arr, binY, binX, mode, pool);
+                break;
+            case Types::INT16:
+                binned = util::bin_image<int16_t>(arr, binY, binX, mode, pool);
+                break;
+            case Types::UINT32:
+                binned = util::bin_image<uint32_t>(arr, binY, binX, mode, pool);
+                break;
+            case Types::INT32:
+                binned = util::bin_image<int32_t>(arr, binY, binX, mode, pool);
+                break;
+            case Types::UINT64:
+                binned = util::bin_image<unsigned long long>(arr, binY, binX, mode, pool);
+                break;
+            case Types::INT64:
+                binned = util::bin_image<long long>(arr, binY, binX, mode, pool);
+                break;
+            case Types::FLOAT:
+                binned = util::bin_image<float>(arr, binY, binX, mode, pool);
+                break;
+            case Types::DOUBLE:
+                binned = util::bin_image<double>(arr, binY, binX, mode, pool);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot bin images of type " + toString(arr.getType()));
+        }
+
+        std::vector<unsigned long long> binning = imd.getBinning().toVector();
+        if (binning.size() < 2) {
+            binning.resize(2, 1);
+        }
+        binning[0] *= binY;
+        binning[1] *= binX;
+
+        if (mode == BinningMode::SUM) {
+            // The sum of N pixels needs up to ceil(log2(N)) more bits
+            const unsigned short bpp = imd.getBitsPerPixel();
+            if (bpp > 0) {
+                const unsigned short extraBits = static_cast<unsigned short>(std::ceil(std::log2(binY * binX)));
+                const unsigned short maxBits = 8 * binned.itemSize();
+                imd.setBitsPerPixel(std::min<unsigned short>(bpp + extraBits, maxBits));
+            }
+        }
+
+        const Dims dims = binned.getShape();
+        imd.setData(binned);
+        imd.setDimensions(dims);
+        imd.setBinning(Dims(binning));
+    }
+
+
+    template <class T>
+    NDArray util::bin_image(const NDArray& arr, unsigned int binY, unsigned int binX, BinningMode mode,
+                            FramePool* pool) {
+        const Dims shape = arr.getShape();
+        checkShape(shape, "bin");
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const size_t channels = (shape.rank() == 3) ? shape.x3() : 1;
+        const size_t outHeight = height / binY;
+        const size_t outWidth = width / binX;
+
+        if (outHeight == 0 || outWidth == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("Binning (" + std::to_string(binY) + ", " + std::to_string(binX) +
+                                             ") is larger than the image");
+        }
+
+        const Dims outShape = (shape.rank() == 3) ? Dims(outHeight, outWidth, channels) : Dims(outHeight, outWidth);
+        const Types::ReferenceType outType = util::binnedType(arr.getType(), mode);
+        NDArray out = pool ? pool->allocate(outShape, outType) : NDArray(outShape, outType);
+
+        const T* in = arr.getData<T>();
+        const bool mean = (mode == BinningMode::MEAN);
+        if (mean) {
+            binKernel(in, height, width, channels, binY, binX, mean, out.getData<T>());
+        } else {
+            binKernel(in, height, width, channels, binY, binX, mean, out.getData<typename BinTraits<T>::Acc>());
+        }
+
+        return out;
+    }
+
+
+    Types::ReferenceType util::binnedType(const Types::ReferenceType& kType, BinningMode mode) {
+        if (mode == BinningMode::MEAN) {
+            return kType;
+        }
+
+        switch (kType) {
+            case Types::UINT8:
+            case Types::UINT16:
+                return Types::UINT32;
+            case Types::INT8:
+            case Types::INT16:
+                return Types::INT32;
+            case Types::UINT32:
+                return Types::UINT64;
+            case Types::INT32:
+                return Types::INT64;
+            case Types::FLOAT:
+                return Types::DOUBLE;
+            default:
+                return kType;
+        }
+    }
+
+} // namespace karabo
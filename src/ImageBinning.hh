@@ -0,0 +1,106 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_IMAGEBINNING_HH
+#define KARABO_IMAGEBINNING_HH
+
+#include <karabo/karabo.hpp>
+
+#include "NumaPlacement.hh"
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief How the pixels falling into one bin are combined.
+         */
+        enum class BinningMode {
+            SUM = 0, // The pixel values are summed, in a wider type
+            MEAN     // The pixel values are averaged, the type is kept
+        };
+
+        /**
+         * @brief Crop an image to a Region-of-Interest.
+         *
+         * The ROI offsets of the image are updated, taking into account the binning already applied, so that
+         * they still refer to the sensor coordinates.
+         *
+         * @param imd The ImageData object - to be cropped. It must be indexable, with shape (height, width) or
+         * (height, width, channel).
+         * @param roiOffsets The offset of the ROI in the image, i.e. (roiY, roiX).
+         * @param roiSize The size of the ROI, i.e. (height, width).
+         * @param pool The pool the cropped image is allocated from, if any.
+         */
+        void cropImage(karabo::xms::ImageData& imd, const karabo::util::Dims& roiOffsets,
+                       const karabo::util::Dims& roiSize, FramePool* pool = nullptr);
+
+        /**
+         * @brief Crop an image to a Region-of-Interest.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * @param arr The NDArray object - to be cropped.
+         * @param roiOffsets The offset of the ROI in the image, i.e. (roiY, roiX).
+         * @param roiSize The size of the ROI, i.e. (height, width).
+         * @param pool The pool the new NDArray is allocated from, if any.
+         * @return A new NDArray containing the cropped image.
+         */
+        template <class T>
+        karabo::util::NDArray crop_image(const karabo::util::NDArray& arr, const karabo::util::Dims& roiOffsets,
+                                         const karabo::util::Dims& roiSize, FramePool* pool = nullptr);
+
+        /**
+         * @brief Bin an image by (binY, binX).
+         *
+         * Rows and columns not filling a complete bin are discarded, as done by the camera hardware.
+         * In SUM mode the pixel type is widened, so that no overflow can occur (see binnedType). In MEAN mode
+         * the pixels are accumulated in a wider type, and the rounded average is stored in the original type.
+         *
+         * The binning of the image is updated and, in SUM mode, also its bits-per-pixel.
+         *
+         * @param imd The ImageData object - to be binned. It must be indexable, with shape (height, width) or
+         * (height, width, channel).
+         * @param binY The vertical binning factor, in [1, 256].
+         * @param binX The horizontal binning factor, in [1, 256].
+         * @param mode The binning mode.
+         * @param pool The pool the binned image is allocated from, if any.
+         */
+        void binImage(karabo::xms::ImageData& imd, unsigned int binY, unsigned int binX,
+                      BinningMode mode = BinningMode::MEAN, FramePool* pool = nullptr);
+
+        /**
+         * @brief Bin an image by (binY, binX).
+         *
+         * @param T The input pixel data type, e.g. uint16_t.
+         * @param arr The NDArray object - to be binned.
+         * @param binY The vertical binning factor.
+         * @param binX The horizontal binning factor.
+         * @param mode The binning mode.
+         * @param pool The pool the new NDArray is allocated from, if any.
+         * @return A new NDArray containing the binned image. Its type is given by binnedType.
+         */
+        template <class T>
+        karabo::util::NDArray bin_image(const karabo::util::NDArray& arr, unsigned int binY, unsigned int binX,
+                                        BinningMode mode, FramePool* pool = nullptr);
+
+        /**
+         * @brief Return the pixel type of an image after binning.
+         *
+         * In MEAN mode the type is unchanged. In SUM mode 8- and 16-bit integers are widened to 32 bits, and
+         * 32-bit integers to 64 bits.
+         *
+         * @param kType The pixel type of the input image.
+         * @param mode The binning mode.
+         */
+        karabo::util::Types::ReferenceType binnedType(const karabo::util::Types::ReferenceType& kType,
+                                                      BinningMode mode);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,225 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <type_traits>
+
+#include "ImagePyramid.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // The accumulator type used for a given pixel type. Wide enough for the sums of 256 x 256 pixels.
+        template <class T>
+        struct PyramidTraits;
+
+        template <>
+        struct PyramidTraits<uint8_t> {
+            using Acc = uint32_t;
+        };
+        template <>
+        struct PyramidTraits<int8_t> {
+            using Acc = int32_t;
+        };
+        template <>
+        struct PyramidTraits<uint16_t> {
+            using Acc = uint64_t;
+        };
+        template <>
+        struct PyramidTraits<int16_t> {
+            using Acc = int64_t;
+        };
+        template <>
+        struct PyramidTraits<uint32_t> {
+            using Acc = uint64_t;
+        };
+        template <>
+        struct PyramidTraits<int32_t> {
+            using Acc = int64_t;
+        };
+        template <>
+        struct PyramidTraits<float> {
+            using Acc = double;
+        };
+        template <>
+        struct PyramidTraits<double> {
+            using Acc = double;
+        };
+
+
+        template <class Acc>
+        inline typename std::enable_if<std::is_integral<Acc>::value, Acc>::type roundedMean(Acc sum, Acc area) {
+            const Acc half = area / 2;
+            return (sum >= 0) ? (sum + half) / area : -((-sum + half) / area);
+        }
+
+
+        template <class Acc>
+        inline typename std::enable_if<std::is_floating_point<Acc>::value, Acc>::type roundedMean(Acc sum,
+                                                                                                 Acc area) {
+            return sum / area;
+        }
+
+
+        template <class T>
+        class PyramidBuilder {
+           public:
+            using Acc = typename PyramidTraits<T>::Acc;
+
+            PyramidBuilder(std::vector<NDArray>& levels, size_t channels) : m_levels(levels), m_channels(channels) {
+                for (const NDArray& level : levels) {
+                    const Dims shape = level.getShape();
+                    m_heights.push_back(shape.x1());
+                    m_widths.push_back(shape.x2());
+                    m_sums.emplace_back(shape.x2() * channels);
+                }
+            }
+
+            // The 2x2 sums of two rows of the image, i.e. one row of the first level
+            Acc* firstSums() {
+                return m_sums[0].data();
+            }
+
+            // Write the row y of level k from its sums, and add the sums to the ones of the next level
+            void emitRow(size_t k, size_t y) {
+                const size_t length = m_widths[k] * m_channels;
+                const Acc* sums = m_sums[k].data();
+                const Acc area = static_cast<Acc>(1ull << (2 * (k + 1)));
+                T* out = m_levels[k].getData<T>() + y * length;
+                for (size_t i = 0; i < length; ++i) {
+                    out[i] = static_cast<T>(roundedMean(sums[i], area));
+                }
+
+                if (k + 1 == m_levels.size() || y >= 2 * m_heights[k + 1]) {
+                    return;
+                }
+
+                // Horizontal pairs of sums, accumulated over two rows
+                Acc* next = m_sums[k + 1].data();
+                const size_t nextWidth = m_widths[k + 1];
+                const size_t c = m_channels;
+                if (y % 2 == 0) {
+                    for (size_t x = 0; x < nextWidth; ++x) {
+                        for (size_t ch = 0; ch < c; ++ch) {
+                            next[x * c + ch] = sums[2 * x * c + ch] + sums[(2 * x + 1) * c + ch];
+                        }
+                    }
+                } else {
+                    for (size_t x = 0; x < nextWidth; ++x) {
+                        for (size_t ch = 0; ch < c; ++ch) {
+                            next[x * c + ch] += sums[2 * x * c + ch] + sums[(2 * x + 1) * c + ch];
+                        }
+                    }
+                    this->emitRow(k + 1, y / 2);
+                }
+            }
+
+           private:
+            std::vector<NDArray>& m_levels;
+            const size_t m_channels;
+            std::vector<size_t> m_heights;
+            std::vector<size_t> m_widths;
+            std::vector<std::vector<Acc>> m_sums; // one row of sums per level
+        };
+
+    } // namespace
+
+
+    void util::buildPyramid(const NDArray& arr, std::vector<NDArray>& levels, unsigned int nLevels) {
+        if (nLevels < 1 || nLevels > 8) {
+            throw KARABO_PARAMETER_EXCEPTION("The number of pyramid levels must be in [1, 8]");
+        }
+
+        switch (arr.getType()) {
+            case Types::UINT8:
+                util::build_pyramid<uint8_t>(arr, levels, nLevels);
+                break;
+            case Types::INT8:
+                util::build_pyramid<int8_t>(arr, levels, nLevels);
+                break;
+            case Types::UINT16:
+                util::build_pyramid<uint16_t>(arr, levels, nLevels);
+                break;
+            case Types::INT16:
+                util::build_pyramid<int16_t>(arr, levels, nLevels);
+                break;
+            case Types::UINT32:
+                util::build_pyramid<uint32_t>(arr, levels, nLevels);
+                break;
+            case Types::INT32:
+                util::build_pyramid<int32_t>(arr, levels, nLevels);
+                break;
+            case Types::FLOAT:
+                util::build_pyramid<float>(arr, levels, nLevels);
+                break;
+            case Types::DOUBLE:
+                util::build_pyramid<double>(arr, levels, nLevels);
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot downsample images of type " + toString(arr.getType()));
+        }
+    }
+
+
+    template <class T>
+    void util::build_pyramid(const NDArray& arr, std::vector<NDArray>& levels, unsigned int nLevels) {
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2 && shape.rank() != 3) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot downsample image of rank " + std::to_string(shape.rank()));
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const size_t channels = (shape.rank() == 3) ? shape.x3() : 1;
+        if ((height >> nLevels) == 0 || (width >> nLevels) == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("Image of shape " + toString(shape.toVector()) + " is too small for " +
+                                             std::to_string(nLevels) + " pyramid levels");
+        }
+
+        levels.clear();
+        for (unsigned int k = 1; k <= nLevels; ++k) {
+            std::vector<unsigned long long> levelShape = shape.toVector();
+            levelShape[0] = height >> k;
+            levelShape[1] = width >> k;
+            levels.emplace_back(Dims(levelShape), arr.getType());
+        }
+
+        using Acc = typename PyramidBuilder<T>::Acc;
+        PyramidBuilder<T> builder(levels, channels);
+
+        const size_t rowLength = width * channels;
+        const size_t firstHeight = height / 2;
+        const size_t firstWidth = width / 2;
+        const T* data = arr.getData<T>();
+        Acc* sums = builder.firstSums();
+        for (size_t y = 0; y < firstHeight; ++y) {
+            const T* row0 = data + 2 * y * rowLength;
+            const T* row1 = row0 + rowLength;
+            if (channels == 1) {
+                for (size_t x = 0; x < firstWidth; ++x) {
+                    sums[x] = static_cast<Acc>(row0[2 * x]) + row0[2 * x + 1] + row1[2 * x] +
+                              row1[2 * x + 1];
+                }
+            } else {
+                for (size_t x = 0; x < firstWidth; ++x) {
+                    for (size_t c = 0; c < channels; ++c) {
+                        const size_t i = 2 * x * channels + c;
+                        sums[x * channels + c] = static_cast<Acc>(row0[i]) + row0[i + channels] +
+                                                 row1[i] + row1[i + channels];
+                    }
+                }
+            }
+            builder.emitRow(0, y);
+        }
+    }
+
+} // namespace karabo
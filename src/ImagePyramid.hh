@@ -0,0 +1,50 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_IMAGEPYRAMID_HH
+#define KARABO_IMAGEPYRAMID_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Build a multi-resolution pyramid of an image, i.e. the image downsampled by 2, 4, 8, ...
+         *
+         * Each level is the mean of the 2^k x 2^k blocks of pixels of the image (box filter), as for binImage in
+         * MEAN mode. All the levels are computed in a single pass over the image: the 2x2 sums of each pair of
+         * rows are computed first, and are then summed pairwise into the sums of the next level. The sums are
+         * exact, so that the levels do not accumulate rounding errors.
+         *
+         * Rows and columns not filling a whole block are discarded.
+         *
+         * @param arr The NDArray object - to be downsampled. Its shape must be (height, width) or
+         * (height, width, channel), with height and width not smaller than 2^nLevels.
+         * @param levels The levels, of shape (height / 2^k, width / 2^k[, channel]) for k = 1..nLevels, and of the
+         * same type as the image.
+         * @param nLevels The number of levels, in [1, 8].
+         */
+        void buildPyramid(const karabo::util::NDArray& arr, std::vector<karabo::util::NDArray>& levels,
+                          unsigned int nLevels = 3);
+
+        /**
+         * @brief Build a multi-resolution pyramid of an image.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * See buildPyramid for the other parameters.
+         */
+        template <class T>
+        void build_pyramid(const karabo::util::NDArray& arr, std::vector<karabo::util::NDArray>& levels,
+                           unsigned int nLevels);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -6,11 +6,11 @@
  * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
-
-extern "C" {
-#include <jpeglib.h>
-}
+#include <fstream>
 
 #include <opencv2/core.hpp>
 
@@ -25,6 +25,110 @@ namespace karabo {
     KARABO_REGISTER_FOR_CONFIGURATION(BaseDevice, Device<>, ImageSource)
 
 
+    namespace {
+
+        bool isProcessable(const std::vector<unsigned long long>& shape, int encoding) {
+            if (shape.size() != 2 && shape.size() != 3) {
+                return false;
+            }
+
+            switch (encoding) {
+                case Encoding::JPEG:
+                case Encoding::PNG:
+                case Encoding::BMP:
+                case Encoding::TIFF:
+                    // Compressed data cannot be processed
+                    return false;
+                default:
+                    return true;
+            }
+        }
+
+
+        // The image properties as compared in a PropertySnapshot, i.e. (dims..., encoding, kType). Return their
+        // number, more than the capacity of the snapshot - i.e. never matching - for too many dimensions.
+        typedef std::array<unsigned long long, util::PropertySnapshot::CAPACITY> SnapshotValues;
+        size_t snapshotValues(const std::vector<unsigned long long>& shape, int encoding, int kType,
+                              SnapshotValues& values) {
+            const size_t size = shape.size() + 2;
+            if (size > values.size()) {
+                return size;
+            }
+            std::copy(shape.begin(), shape.end(), values.begin());
+            values[shape.size()] = static_cast<unsigned long long>(encoding);
+            values[shape.size() + 1] = static_cast<unsigned long long>(kType);
+            return size;
+        }
+
+
+        // The output image properties, as compared in a PropertySnapshot, i.e. (dims..., encoding, kType,
+        // outputKType, outputEncoding, burstDepth)
+        size_t outputSnapshotValues(const std::vector<unsigned long long>& shape, int encoding, int kType,
+                                    int outputKType, int outputEncoding, unsigned int burstDepth,
+                                    SnapshotValues& values) {
+            const size_t size = snapshotValues(shape, encoding, kType, values);
+            if (size + 3 <= values.size()) {
+                values[size] = static_cast<unsigned long long>(outputKType);
+                values[size + 1] = static_cast<unsigned long long>(outputEncoding);
+                values[size + 2] = burstDepth;
+            }
+            return size + 3;
+        }
+
+
+        // Whether a configuration change may affect the output image properties, i.e. the output schema
+        bool affectsOutputSchema(const Hash& config) {
+            return config.has("softwareRoi") || config.has("softwareBinning") || config.has("flatField") ||
+                   config.has("accumulation") || config.has("displayLut") || config.has("burstMode") ||
+                   config.has("jpegCompression");
+        }
+
+
+        // The number of output schema updates kept, e.g. for switching back and forth between two ROIs
+        const size_t SCHEMA_CACHE_SIZE = 16;
+
+
+        // The output channels of the pyramid levels, i.e. the images downsampled by 2, 4 and 8
+        const unsigned int PYRAMID_LEVELS = 3;
+        const char* const PYRAMID_CHANNELS[PYRAMID_LEVELS] = {"pyramid2", "pyramid4", "pyramid8"};
+
+
+        // Only 8 and 16-bit GRAY and RGB images can be encoded as JPEG (see encodeJPEG)
+        bool isCompressible(const std::vector<unsigned long long>& shape, int encoding, int kType) {
+            if (encoding != Encoding::GRAY && encoding != Encoding::RGB) {
+                return false;
+            }
+
+            return isProcessable(shape, encoding) && (kType == Types::UINT8 || kType == Types::UINT16);
+        }
+
+
+        // Clip the software ROI to the image. Return false if the ROI is not set, or covers the full image.
+        bool effectiveRoi(const std::vector<unsigned long long>& shape, const Dims& roiOffsets, const Dims& roiSize,
+                          Dims& offsets, Dims& size) {
+            if (roiSize.x1() == 0 || roiSize.x2() == 0) {
+                return false;
+            }
+
+            const unsigned long long height = shape[0];
+            const unsigned long long width = shape[1];
+            const unsigned long long y0 = std::min(roiOffsets.x1(), height);
+            const unsigned long long x0 = std::min(roiOffsets.x2(), width);
+            const unsigned long long roiHeight = std::min(roiSize.x1(), height - y0);
+            const unsigned long long roiWidth = std::min(roiSize.x2(), width - x0);
+
+            if (roiHeight == 0 || roiWidth == 0 || (roiHeight == height && roiWidth == width)) {
+                return false;
+            }
+
+            offsets = Dims(y0, x0);
+            size = Dims(roiHeight, roiWidth);
+            return true;
+        }
+
+    } // namespace
+
+
     void ImageSource::expectedParameters(Schema& expected) {
         Schema data;
 
@@ -52,281 +156,3152 @@ namespace karabo {
             .displayedName("DAQ Output")
             .dataSchema(data)
             .commit();
-    }
 
+        // Frames frozen in the snapshot ring (see 'snapshot')
+        OUTPUT_CHANNEL(expected).key("snapshotOutput")
+            .displayedName("Snapshot Output")
+            .dataSchema(data)
+            .commit();
 
-    ImageSource::ImageSource(const karabo::util::Hash& config) : Device<>(config),
-            m_shape(config.get<std::vector<unsigned long long>>("output.schema.data.image.dims")),
-            m_encoding(config.get<int>("output.schema.data.image.encoding")),
-            m_kType(config.get<int>("output.schema.data.image.pixels.type")) {
-    }
+        // Downsampled images, for zoomable views (see 'pyramid')
+        for (unsigned int k = 0; k < PYRAMID_LEVELS; ++k) {
+            OUTPUT_CHANNEL(expected).key(PYRAMID_CHANNELS[k])
+                .displayedName("Pyramid " + std::to_string(2u << k) + "x")
+                .dataSchema(data)
+                .commit();
+        }
 
+        // Notifications of the frames placed in the shared memory ring (see 'sharedMemory')
+        Schema notification;
 
-    ImageSource::~ImageSource() {
-    }
+        NODE_ELEMENT(notification).key("data")
+            .displayedName("Data")
+            .commit();
 
+        STRING_ELEMENT(notification).key("data.name")
+            .displayedName("Ring Name")
+            .readOnly()
+            .commit();
 
-    void ImageSource::updateOutputSchema(const std::vector<unsigned long long>& shape, const EncodingType& encoding,
-                                         const Types::ReferenceType& kType) {
+        UINT64_ELEMENT(notification).key("data.ringId")
+            .displayedName("Ring ID")
+            .readOnly()
+            .commit();
 
-        boost::mutex::scoped_lock lock(m_updateSchemaMtx);
+        UINT32_ELEMENT(notification).key("data.slot")
+            .displayedName("Slot")
+            .readOnly()
+            .commit();
 
-        if (shape == m_shape && encoding == m_encoding && kType == m_kType) {
-            // Nothing to be updated
-            KARABO_LOG_FRAMEWORK_DEBUG << "No need to update the output schema";
-            return;
-        }
+        UINT64_ELEMENT(notification).key("data.sequence")
+            .displayedName("Sequence")
+            .readOnly()
+            .commit();
 
-        Schema schemaUpdate;
-        this->schema_update_helper(schemaUpdate, "output", "Output", shape, encoding, kType);
+        VECTOR_UINT8_ELEMENT(notification).key("data.trace")
+            .displayedName("Latency Trace")
+            .description("The latency trace of the frame, if 'tracing' is enabled (see karabo::util::LatencyTrace).")
+            .readOnly()
+            .commit();
 
-        std::vector<unsigned long long> daqShape = shape;
-        std::reverse(daqShape.begin(), daqShape.end()); // NB DAQ wants fastest changing index first, e.g. (width,
-                                                        // height) or (channel, width, height)
-        this->schema_update_helper(schemaUpdate, "daqOutput", "DAQ Output", daqShape, encoding, kType);
+        OUTPUT_CHANNEL(expected).key("shmOutput")
+            .displayedName("Shared Memory Output")
+            .dataSchema(notification)
+            .commit();
 
-        this->appendSchema(schemaUpdate);
+        UINT64_ELEMENT(expected).key("heldBackFrames")
+            .displayedName("Held Back Frames")
+            .description("The number of frames not written, as the output schema was being updated for their "
+                         "shape, encoding or type.")
+            .readOnly().initialValue(0ull)
+            .commit();
 
-        m_shape = shape;
-        m_encoding = encoding;
-        m_kType = kType;
-    }
+        UINT64_ELEMENT(expected).key("outputSchemaUpdates")
+            .displayedName("Output Schema Updates")
+            .description("The number of output schema updates applied. Successive changes of the image "
+                         "properties are coalesced into a single update.")
+            .expertAccess()
+            .readOnly().initialValue(0ull)
+            .commit();
 
+        NODE_ELEMENT(expected).key("softwareRoi")
+            .displayedName("Software ROI")
+            .description("Region-of-Interest applied in software to the images, before the software binning. "
+                         "A zero width or height means the full image.")
+            .commit();
 
-    void ImageSource::schema_update_helper(Schema& schemaUpdate, const std::string& nodeKey,
-                                           const std::string& displayedName,
-                                           const std::vector<unsigned long long>& shape, const EncodingType& encoding,
-                                           const Types::ReferenceType& kType) {
-        Schema dataSchema;
-        NODE_ELEMENT(dataSchema).key("data")
-            .displayedName("Data")
-            .setDaqDataType(DaqDataType::TRAIN)
+        UINT32_ELEMENT(expected).key("softwareRoi.x")
+            .displayedName("X Offset")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(0)
+            .reconfigurable()
             .commit();
 
-        IMAGEDATA(dataSchema).key("data.image")
-            .displayedName("Image")
-            .setDimensions(karabo::util::toString(shape))
-            .setType(kType)
-            .setEncoding(encoding)
+        UINT32_ELEMENT(expected).key("softwareRoi.y")
+            .displayedName("Y Offset")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(0)
+            .reconfigurable()
             .commit();
 
-        OUTPUT_CHANNEL(schemaUpdate).key(nodeKey)
-            .displayedName(displayedName)
-            .dataSchema(dataSchema)
+        UINT32_ELEMENT(expected).key("softwareRoi.width")
+            .displayedName("Width")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(0)
+            .reconfigurable()
             .commit();
-    }
 
+        UINT32_ELEMENT(expected).key("softwareRoi.height")
+            .displayedName("Height")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(0)
+            .reconfigurable()
+            .commit();
 
-    void ImageSource::writeChannels(const NDArray& data, const Dims& binning, const unsigned short bpp,
-                                    const EncodingType& encoding, const Dims& roiOffsets, const Timestamp& timestamp,
-                                    const Hash& header) {
+        NODE_ELEMENT(expected).key("softwareBinning")
+            .displayedName("Software Binning")
+            .description("Binning applied in software to the images, after the software ROI.")
+            .commit();
 
-        karabo::xms::ImageData imageData(data, encoding);
-        imageData.setBitsPerPixel(bpp);
-        imageData.setROIOffsets(roiOffsets);
-        imageData.setBinning(binning);
-        if (!header.empty()) {
-            imageData.setHeader(header);
-        }
+        UINT32_ELEMENT(expected).key("softwareBinning.x")
+            .displayedName("X Binning")
+            .assignmentOptional().defaultValue(1)
+            .minInc(1).maxInc(256)
+            .reconfigurable()
+            .commit();
 
-        this->writeChannel("output", Hash("data.image", imageData), timestamp);
+        UINT32_ELEMENT(expected).key("softwareBinning.y")
+            .displayedName("Y Binning")
+            .assignmentOptional().defaultValue(1)
+            .minInc(1).maxInc(256)
+            .reconfigurable()
+            .commit();
 
-        // NB DAQ wants fastest changing index first, e.g. (width, height) or (channel, width, height)
-        Dims daqShape = data.getShape();
-        daqShape.reverse();
+        STRING_ELEMENT(expected).key("softwareBinning.mode")
+            .displayedName("Binning Mode")
+            .description("MEAN keeps the pixel type. SUM widens it (e.g. from UINT16 to UINT32), so that no "
+                         "overflow can occur.")
+            .assignmentOptional().defaultValue("MEAN")
+            .options("MEAN,SUM")
+            .reconfigurable()
+            .commit();
 
-        imageData.setDimensions(daqShape);
-        this->writeChannel("daqOutput", Hash("data.image", imageData), timestamp);
-    }
+        NODE_ELEMENT(expected).key("flatField")
+            .displayedName("Flat-Field Correction")
+            .description("Dark-frame subtraction and flat-field correction, applied in software to the images, "
+                         "before the software ROI and binning. The corrected image is (raw - dark) * gain, where "
+                         "gain = mean(flat - dark) / (flat - dark).")
+            .commit();
 
+        BOOL_ELEMENT(expected).key("flatField.enable")
+            .displayedName("Enable")
+            .description("Apply the correction. Missing references are replaced by zero dark and unity gain.")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
 
-    void ImageSource::signalEOS() {
-        this->signalEndOfStream("output");
-        this->signalEndOfStream("daqOutput");
-    }
+        UINT32_ELEMENT(expected).key("flatField.nFrames")
+            .displayedName("Frames to Average")
+            .description("The number of frames averaged to build a reference.")
+            .assignmentOptional().defaultValue(10)
+            .minInc(1)
+            .reconfigurable()
+            .commit();
 
+        STRING_ELEMENT(expected).key("flatField.outputType")
+            .displayedName("Output Type")
+            .description("INPUT keeps the pixel type of the input images, the corrected values being rounded and "
+                         "clipped. FLOAT outputs FLOAT images.")
+            .assignmentOptional().defaultValue("INPUT")
+            .options("INPUT,FLOAT")
+            .reconfigurable()
+            .commit();
 
-    void util::unpackMono12Packed(const uint8_t* data, const uint32_t width, const uint32_t height,
-                                  uint16_t* unpackedData) {
-        size_t idx = 0, px = 0, image_size = width * height;
-        while (px + 1 < image_size) {
-            unpackedData[px] = (data[idx] << 4) | (data[idx + 1] & 0xF);
-            unpackedData[px + 1] = (data[idx + 2] << 4) | (data[idx + 1] >> 4);
-            idx += 3;
-            px += 2;
-        }
-    }
+        STRING_ELEMENT(expected).key("flatField.referenceFile")
+            .displayedName("Reference File")
+            .description("The local file where the references are saved to, and loaded from. If the file exists, "
+                         "the references are loaded at initialization.")
+            .assignmentOptional().defaultValue("")
+            .reconfigurable()
+            .commit();
 
+        BOOL_ELEMENT(expected).key("flatField.darkAvailable")
+            .displayedName("Dark Available")
+            .readOnly().initialValue(false)
+            .commit();
 
-    void util::unpackMonoXXp(const uint8_t* data, const uint32_t width, const uint32_t height, const uint8_t bpp,
-                             uint16_t* unpackedData) {
-        if (bpp < 9 || bpp > 15) {
-            throw KARABO_PARAMETER_EXCEPTION("Invalid bpp value: " + std::to_string(bpp) + ". It must be in [9, 15].");
-        }
+        BOOL_ELEMENT(expected).key("flatField.flatAvailable")
+            .displayedName("Flat Available")
+            .readOnly().initialValue(false)
+            .commit();
 
-        const uint16_t mask = 0xFFFF >> (16 - bpp);
-        size_t bits = 0, px = 0, image_size = width * height;
-        while (px < image_size) {
-            const size_t idx = bits / 8;
-            const size_t shift = bits % 8;
-            unpackedData[px] = (*reinterpret_cast<const uint16_t*>(data + idx) >> shift) & mask;
+        UINT32_ELEMENT(expected).key("flatField.acquiredFrames")
+            .displayedName("Acquired Frames")
+            .description("The number of frames acquired for the reference being built.")
+            .readOnly().initialValue(0)
+            .commit();
 
-            bits += bpp;
-            px += 1;
-        }
-    }
+        NODE_ELEMENT(expected).key("accumulation")
+            .displayedName("Accumulation")
+            .description("Combine consecutive processed frames before writing them. In SUM and MEAN modes one image "
+                         "is written every N frames; in EMA mode the exponential moving average is written at every "
+                         "frame.")
+            .commit();
 
+        BOOL_ELEMENT(expected).key("accumulation.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
 
-    void util::unpackMono10p(const uint8_t* data, const uint32_t width, const uint32_t height, uint16_t* unpackedData) {
-        util::unpackMonoXXp(data, width, height, 10, unpackedData);
-    }
+        STRING_ELEMENT(expected).key("accumulation.mode")
+            .displayedName("Mode")
+            .description("SUM: the sum of N frames, in a wider data type. MEAN: the mean of N frames. EMA: the "
+                         "exponential moving average, with smoothing factor 1/N.")
+            .options("SUM,MEAN,EMA")
+            .assignmentOptional().defaultValue("MEAN")
+            .reconfigurable()
+            .commit();
 
+        UINT32_ELEMENT(expected).key("accumulation.nFrames")
+            .displayedName("Frames")
+            .assignmentOptional().defaultValue(10)
+            .minInc(1).maxInc(65536)
+            .reconfigurable()
+            .commit();
 
-    void util::unpackMono12p(const uint8_t* data, const uint32_t width, const uint32_t height, uint16_t* unpackedData) {
-        util::unpackMonoXXp(data, width, height, 12, unpackedData);
-    }
+        NODE_ELEMENT(expected).key("burstMode")
+            .displayedName("Burst Mode")
+            .description("Stack the frames belonging to one train, and write them to 'daqOutput' as a single "
+                         "(frames, height, width) image, with the time of each frame. Trains with fewer frames are "
+                         "filled with zeros. 'output' is not affected.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("burstMode.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
 
+        UINT32_ELEMENT(expected).key("burstMode.framesPerTrain")
+            .displayedName("Frames per Train")
+            .assignmentOptional().defaultValue(10)
+            .minInc(1).maxInc(10000)
+            .reconfigurable()
+            .commit();
 
-    void util::decodeJPEG(karabo::xms::ImageData& imd) {
-        // The array which we assign the decoded JPEG stream to
-        NDArray ndarr(imd.getDimensions(), Types::UINT8);
+        NODE_ELEMENT(expected).key("frameStatistics")
+            .displayedName("Frame Statistics")
+            .description("Statistics of the output images. They are attached to every image header, and published "
+                         "as properties at a limited rate.")
+            .commit();
 
-        NDArray& arr = const_cast<NDArray&>(imd.getData()); // from 2.12 on, can remove the `const_cast`
-        unsigned char* cdata = arr.getData<unsigned char>();
-        struct jpeg_decompress_struct cinfo;
-        struct jpeg_error_mgr jerr;
+        BOOL_ELEMENT(expected).key("frameStatistics.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
 
-        const unsigned long jpg_size = arr.byteSize();
+        UINT32_ELEMENT(expected).key("frameStatistics.step")
+            .displayedName("Subsampling")
+            .description("Only analyse every n-th row and column.")
+            .assignmentOptional().defaultValue(1)
+            .minInc(1)
+            .reconfigurable()
+            .commit();
 
-        cinfo.err = jpeg_std_error(&jerr);
-        jpeg_create_decompress(&cinfo);
+        UINT32_ELEMENT(expected).key("frameStatistics.bins")
+            .displayedName("Histogram Bins")
+            .assignmentOptional().defaultValue(256)
+            .minInc(1).maxInc(65536)
+            .reconfigurable()
+            .commit();
 
-        // We can directly source the data, but need to const_cast here as cdata is returned as const.
-        // This is not a problem though, as we create and assign a new NDarray to the image data
-        // object in the process of conversion.
-        jpeg_mem_src(&cinfo, cdata, jpg_size);
+        DOUBLE_ELEMENT(expected).key("frameStatistics.histogramMin")
+            .displayedName("Histogram Min")
+            .description("The lower edge of the histogram. If it is equal to the upper edge, the range is set "
+                         "automatically: [0, 2^bpp) for unsigned integer images, the range of the previous frame "
+                         "for floating-point ones.")
+            .assignmentOptional().defaultValue(0.)
+            .reconfigurable()
+            .commit();
 
-        // Test if this is a valid JPEG before we fail miserably
-        const int rc = jpeg_read_header(&cinfo, TRUE);
+        DOUBLE_ELEMENT(expected).key("frameStatistics.histogramMax")
+            .displayedName("Histogram Max")
+            .description("The upper edge of the histogram.")
+            .assignmentOptional().defaultValue(0.)
+            .reconfigurable()
+            .commit();
 
-        if (rc != 1) {
-            throw KARABO_PARAMETER_EXCEPTION("Image advertised as JPEG, but does not seem to be JPEG data");
-        }
-        jpeg_start_decompress(&cinfo);
-        const int width = cinfo.output_width;
-        const int pixel_size = cinfo.output_components;
+        DOUBLE_ELEMENT(expected).key("frameStatistics.saturationLevel")
+            .displayedName("Saturation Level")
+            .description("The values larger or equal to it are counted as saturated. If zero, 2^bpp - 1 is used "
+                         "for integer images, bpp being the bits-per-pixel.")
+            .assignmentOptional().defaultValue(0.)
+            .minInc(0.)
+            .reconfigurable()
+            .commit();
 
-        // We directly read into the NDArray to avoid further copies
-        unsigned char* bmp_buffer = ndarr.getData<unsigned char>();
+        UINT32_ELEMENT(expected).key("frameStatistics.updatePeriod")
+            .displayedName("Update Period")
+            .description("The minimum time between updates of the statistics properties.")
+            .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+            .assignmentOptional().defaultValue(1000)
+            .reconfigurable()
+            .commit();
 
-        // The row_stride is the total number of bytes it takes to store an
-        // entire scanline (row).
-        const int row_stride = width * pixel_size;
+        DOUBLE_ELEMENT(expected).key("frameStatistics.min")
+            .displayedName("Min")
+            .readOnly().initialValue(0.)
+            .commit();
 
-        while (cinfo.output_scanline < cinfo.output_height) {
-            unsigned char* buffer_array[1];
-            buffer_array[0] = bmp_buffer + cinfo.output_scanline * row_stride;
-            jpeg_read_scanlines(&cinfo, buffer_array, 1);
-        }
+        DOUBLE_ELEMENT(expected).key("frameStatistics.max")
+            .displayedName("Max")
+            .readOnly().initialValue(0.)
+            .commit();
 
-        // Clean up
-        jpeg_finish_decompress(&cinfo);
-        jpeg_destroy_decompress(&cinfo);
+        DOUBLE_ELEMENT(expected).key("frameStatistics.mean")
+            .displayedName("Mean")
+            .readOnly().initialValue(0.)
+            .commit();
 
-        // Karabo-ize our data.
-        // Any raw pointer referenced to previous NDarray data
-        // of imd have been destroyed at this point.
-        imd.setData(ndarr);
-        imd.setEncoding(Encoding::GRAY);
-    }
+        DOUBLE_ELEMENT(expected).key("frameStatistics.stdDev")
+            .displayedName("Standard Deviation")
+            .readOnly().initialValue(0.)
+            .commit();
 
+        UINT64_ELEMENT(expected).key("frameStatistics.saturatedPixels")
+            .displayedName("Saturated Pixels")
+            .readOnly().initialValue(0ull)
+            .commit();
 
-    void util::encodeJPEG(karabo::xms::ImageData& imd, unsigned int quality, const std::string& comment) {
-        NDArray& arr = const_cast<NDArray&>(imd.getData()); // from 2.12 on, can remove the `const_cast`
+        VECTOR_DOUBLE_ELEMENT(expected).key("frameStatistics.histogramRange")
+            .displayedName("Histogram Range")
+            .description("The lower edge of the first bin, and the upper edge of the last one.")
+            .readOnly().initialValue(std::vector<double>({0., 0.}))
+            .commit();
 
-        const Types::ReferenceType kType = arr.getType();
-        std::shared_ptr<unsigned char[]> sdata;
-        if (kType == Types::UINT8) {
-            sdata = std::shared_ptr<unsigned char[]>(arr.getData<unsigned char>(), [](unsigned char* p) {});
-        } else if (kType == Types::UINT16) {
-            const size_t pixels = arr.size();
-            sdata = std::shared_ptr<unsigned char[]>(new unsigned char[pixels]);
-            const unsigned short* ldata = arr.getData<unsigned short>();
-
-            if (arr.isBigEndian()) {
-                for (size_t i = 0; i < pixels; ++i) {
-                    sdata[i] = ldata[i] & 0xFF; // MSB is 0
-                }
-            } else {
-                for (size_t i = 0; i < pixels; ++i) {
-                    sdata[i] = ldata[i] >> 8; // MSB is 1
-                }
-            }
-        } else {
-            throw KARABO_PARAMETER_EXCEPTION("Conversion from Type " + toString(kType) + " is not implemented.");
-        }
+        VECTOR_UINT32_ELEMENT(expected).key("frameStatistics.histogram")
+            .displayedName("Histogram")
+            .readOnly().initialValue(std::vector<unsigned int>())
+            .commit();
 
-        struct jpeg_compress_struct cinfo;
-        struct jpeg_error_mgr jerr;
+        NODE_ELEMENT(expected).key("beamProperties")
+            .displayedName("Beam Properties")
+            .description("Projections, centroid and second moments of the output images, for beam diagnostics. "
+                         "They are computed for monochromatic images only, and expressed in pixels of the output "
+                         "image. They are attached to every image header, and published as properties at a limited "
+                         "rate.")
+            .commit();
 
-        cinfo.err = jpeg_std_error(&jerr);
-        jpeg_create_compress(&cinfo);
+        BOOL_ELEMENT(expected).key("beamProperties.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
 
-        const int encoding = imd.getEncoding();
-        switch (encoding) {
-            case Encoding::GRAY:
-                cinfo.input_components = 1;
-                cinfo.in_color_space = JCS_GRAYSCALE;
-                break;
-            case Encoding::RGB:
-                cinfo.input_components = 3;
-                cinfo.in_color_space = JCS_RGB;
-                break;
-            default:
-                throw KARABO_PARAMETER_EXCEPTION("Conversion from " + toString(encoding)
-                                                 + " to JPEG is not implemented.");
-        }
+        DOUBLE_ELEMENT(expected).key("beamProperties.background")
+            .displayedName("Background")
+            .description("The background level, subtracted from the pixel values.")
+            .assignmentOptional().defaultValue(0.)
+            .reconfigurable()
+            .commit();
 
-        const Dims& dims = imd.getDimensions();
-        cinfo.image_width = dims.x2();
-        cinfo.image_height = dims.x1();
+        DOUBLE_ELEMENT(expected).key("beamProperties.threshold")
+            .displayedName("Threshold")
+            .description("The pixels below threshold, after background subtraction, are not taken into account.")
+            .assignmentOptional().defaultValue(0.)
+            .reconfigurable()
+            .commit();
 
-        jpeg_set_defaults(&cinfo);
-        jpeg_set_quality(&cinfo, quality, TRUE);
+        UINT32_ELEMENT(expected).key("beamProperties.updatePeriod")
+            .displayedName("Update Period")
+            .description("The minimum time between updates of the beam properties.")
+            .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+            .assignmentOptional().defaultValue(1000)
+            .reconfigurable()
+            .commit();
 
-        // Instruct libjpeg to encode to memory.
-        // The library will allocate the memory.
-        unsigned char* jpeg_buffer = nullptr;
-        unsigned long jpeg_size;
-        jpeg_mem_dest(&cinfo, &jpeg_buffer, &jpeg_size);
+        DOUBLE_ELEMENT(expected).key("beamProperties.integral")
+            .displayedName("Integral")
+            .readOnly().initialValue(0.)
+            .commit();
 
-        jpeg_start_compress(&cinfo, TRUE);
+        DOUBLE_ELEMENT(expected).key("beamProperties.centroidX")
+            .displayedName("Centroid X")
+            .unit(Unit::PIXEL)
+            .readOnly().initialValue(0.)
+            .commit();
 
-        // Add comment section if any
-        if (comment.size() > 0) {
-            // The comment can be (0xFF-2) Bytes long. Truncate if longer.
-            const size_t commentSize = std::min<size_t>(65533, comment.size());
-            jpeg_write_marker(&cinfo, JPEG_COM, (const JOCTET*)comment.data(), commentSize);
-        }
+        DOUBLE_ELEMENT(expected).key("beamProperties.centroidY")
+            .displayedName("Centroid Y")
+            .unit(Unit::PIXEL)
+            .readOnly().initialValue(0.)
+            .commit();
 
-        // The row_stride is the total number of bytes it takes to store an
-        // entire scanline (row).
-        const int row_stride = cinfo.input_components * cinfo.image_width;
+        DOUBLE_ELEMENT(expected).key("beamProperties.sigmaX")
+            .displayedName("Sigma X")
+            .description("The standard deviation along X.")
+            .unit(Unit::PIXEL)
+            .readOnly().initialValue(0.)
+            .commit();
 
-        while (cinfo.next_scanline < cinfo.image_height) {
-            unsigned char* buffer_array[1];
-            buffer_array[0] = sdata.get() + cinfo.next_scanline * row_stride;
-            jpeg_write_scanlines(&cinfo, buffer_array, 1);
-        }
+        DOUBLE_ELEMENT(expected).key("beamProperties.sigmaY")
+            .displayedName("Sigma Y")
+            .description("The standard deviation along Y.")
+            .unit(Unit::PIXEL)
+            .readOnly().initialValue(0.)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("beamProperties.sigmaXY")
+            .displayedName("Covariance XY")
+            .readOnly().initialValue(0.)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("beamProperties.tilt")
+            .displayedName("Tilt")
+            .description("The angle of the major axis with respect to the X axis.")
+            .unit(Unit::DEGREE)
+            .readOnly().initialValue(0.)
+            .commit();
+
+        VECTOR_DOUBLE_ELEMENT(expected).key("beamProperties.projectionX")
+            .displayedName("Projection X")
+            .description("The sum of each column.")
+            .readOnly().initialValue(std::vector<double>())
+            .commit();
+
+        VECTOR_DOUBLE_ELEMENT(expected).key("beamProperties.projectionY")
+            .displayedName("Projection Y")
+            .description("The sum of each row.")
+            .readOnly().initialValue(std::vector<double>())
+            .commit();
+
+        NODE_ELEMENT(expected).key("spotFinder")
+            .displayedName("Spot Finder")
+            .description("Find the bright spots in the output images, i.e. the connected sets of pixels above "
+                         "threshold. Monochromatic images only. The spots, sorted by decreasing integral, are "
+                         "attached to every image header as a table of vectors, and published as properties at a "
+                         "limited rate.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("spotFinder.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("spotFinder.threshold")
+            .displayedName("Threshold")
+            .description("The pixels with value larger than threshold belong to spots.")
+            .assignmentOptional().defaultValue(0.)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("spotFinder.minArea")
+            .displayedName("Min Area")
+            .description("The spots with fewer pixels are discarded.")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(1)
+            .minInc(1)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("spotFinder.maxSpots")
+            .displayedName("Max Spots")
+            .description("The maximum number of spots published. The brightest ones are kept.")
+            .assignmentOptional().defaultValue(100)
+            .minInc(1).maxInc(10000)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("spotFinder.updatePeriod")
+            .displayedName("Update Period")
+            .description("The minimum time between updates of the spot properties.")
+            .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+            .assignmentOptional().defaultValue(1000)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("spotFinder.nSpots")
+            .displayedName("Spots Found")
+            .description("The number of spots found, which can be larger than the number published.")
+            .readOnly().initialValue(0)
+            .commit();
+
+        VECTOR_DOUBLE_ELEMENT(expected).key("spotFinder.x")
+            .displayedName("X")
+            .description("The centroid X of each spot.")
+            .unit(Unit::PIXEL)
+            .readOnly().initialValue(std::vector<double>())
+            .commit();
+
+        VECTOR_DOUBLE_ELEMENT(expected).key("spotFinder.y")
+            .displayedName("Y")
+            .description("The centroid Y of each spot.")
+            .unit(Unit::PIXEL)
+            .readOnly().initialValue(std::vector<double>())
+            .commit();
+
+        VECTOR_DOUBLE_ELEMENT(expected).key("spotFinder.integral")
+            .displayedName("Integral")
+            .readOnly().initialValue(std::vector<double>())
+            .commit();
+
+        VECTOR_DOUBLE_ELEMENT(expected).key("spotFinder.peak")
+            .displayedName("Peak")
+            .readOnly().initialValue(std::vector<double>())
+            .commit();
+
+        VECTOR_UINT32_ELEMENT(expected).key("spotFinder.area")
+            .displayedName("Area")
+            .unit(Unit::PIXEL)
+            .readOnly().initialValue(std::vector<unsigned int>())
+            .commit();
+
+        NODE_ELEMENT(expected).key("displayLut")
+            .displayedName("Display Mapping")
+            .description("Map the images written to 'output' to 8 bits via a look-up table, for display. It applies "
+                         "to UINT8 and UINT16 images only. 'daqOutput' is not affected.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("displayLut.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("displayLut.mode")
+            .displayedName("Mode")
+            .description("The mapping function of the window to [0, 255].")
+            .options("LINEAR,GAMMA,LOG")
+            .assignmentOptional().defaultValue("LINEAR")
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("displayLut.gamma")
+            .displayedName("Gamma")
+            .description("The exponent, in GAMMA mode. Values smaller than one enhance the low intensities.")
+            .assignmentOptional().defaultValue(1.)
+            .minExc(0.)
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("displayLut.range")
+            .displayedName("Range")
+            .description("How the window is set. BPP: [0, 2^bpp - 1], bpp being the bits-per-pixel. WINDOW: the "
+                         "window min and max. PERCENTILE: auto-contrast, from the low and high percentiles of each "
+                         "image.")
+            .options("BPP,WINDOW,PERCENTILE")
+            .assignmentOptional().defaultValue("BPP")
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("displayLut.windowMin")
+            .displayedName("Window Min")
+            .assignmentOptional().defaultValue(0.)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("displayLut.windowMax")
+            .displayedName("Window Max")
+            .assignmentOptional().defaultValue(65535.)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("displayLut.lowPercentile")
+            .displayedName("Low Percentile")
+            .unit(Unit::PERCENT)
+            .assignmentOptional().defaultValue(1.)
+            .minInc(0.).maxInc(100.)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("displayLut.highPercentile")
+            .displayedName("High Percentile")
+            .unit(Unit::PERCENT)
+            .assignmentOptional().defaultValue(99.)
+            .minInc(0.).maxInc(100.)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("displayLut.step")
+            .displayedName("Subsampling")
+            .description("Only use every n-th value, to compute the percentiles.")
+            .assignmentOptional().defaultValue(4)
+            .minInc(1)
+            .reconfigurable()
+            .commit();
+
+        VECTOR_DOUBLE_ELEMENT(expected).key("displayLut.window")
+            .displayedName("Applied Window")
+            .readOnly().initialValue(std::vector<double>({0., 0.}))
+            .commit();
 
-        jpeg_finish_compress(&cinfo);
-        jpeg_destroy_compress(&cinfo);
+        NODE_ELEMENT(expected).key("changeDetection")
+            .displayedName("Change Detection")
+            .description("Do not write to 'output' the frames which do not differ from the last written one, "
+                         "e.g. for static scenes. The difference is the mean absolute difference of the pixels, "
+                         "sampled on a grid. 'daqOutput' is not affected.")
+            .commit();
 
-        // Karabo-ize our data.
-        NDArray ndarr(jpeg_buffer, jpeg_size);
-        imd.setData(ndarr);
-        imd.setEncoding(Encoding::JPEG);
-        imd.setDimensions(dims);
+        BOOL_ELEMENT(expected).key("changeDetection.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("changeDetection.tolerance")
+            .displayedName("Tolerance")
+            .description("The frames whose mean absolute difference to the last written frame is not larger "
+                         "than the tolerance are considered as unchanged.")
+            .assignmentOptional().defaultValue(1.)
+            .minInc(0.)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("changeDetection.step")
+            .displayedName("Sampling Step")
+            .description("Only compare every step-th row and column.")
+            .assignmentOptional().defaultValue(4)
+            .minInc(1).maxInc(64)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("changeDetection.heartbeatPeriod")
+            .displayedName("Heartbeat Period")
+            .description("An unchanged frame is written anyway if nothing was written for this time, so that the "
+                         "clients can tell that the source is alive. Zero for never.")
+            .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+            .assignmentOptional().defaultValue(10000)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("changeDetection.difference")
+            .displayedName("Difference")
+            .description("The difference of the last frame to the last written one.")
+            .readOnly().initialValue(0.)
+            .commit();
+
+        UINT64_ELEMENT(expected).key("changeDetection.suppressedFrames")
+            .displayedName("Suppressed Frames")
+            .description("The number of unchanged frames not written to 'output'.")
+            .readOnly().initialValue(0ull)
+            .commit();
+
+        NODE_ELEMENT(expected).key("jpegCompression")
+            .displayedName("JPEG Compression")
+            .description("Encode the images written to 'output' as JPEG, adjusting the quality - and optionally "
+                         "downscaling the images - frame by frame, so that the encoded images fit in a bandwidth "
+                         "budget. Only 8 and 16-bit GRAY or RGB images are encoded, e.g. after display mapping. "
+                         "'daqOutput' is not affected.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("jpegCompression.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("jpegCompression.budget")
+            .displayedName("Budget")
+            .description("The bandwidth budget, in bytes per second or per frame.")
+            .assignmentOptional().defaultValue(1.e6)
+            .minExc(0.)
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("jpegCompression.budgetUnit")
+            .displayedName("Budget Unit")
+            .assignmentOptional().defaultValue("BYTES_PER_SECOND")
+            .options("BYTES_PER_SECOND,BYTES_PER_FRAME")
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("jpegCompression.minQuality")
+            .displayedName("Min Quality")
+            .assignmentOptional().defaultValue(20)
+            .minInc(1).maxInc(100)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("jpegCompression.maxQuality")
+            .displayedName("Max Quality")
+            .assignmentOptional().defaultValue(95)
+            .minInc(1).maxInc(100)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("jpegCompression.maxDownscale")
+            .displayedName("Max Downscale")
+            .description("The maximum downscale factor, used if the budget cannot be met at the minimum quality. "
+                         "1 for no downscaling.")
+            .assignmentOptional().defaultValue(1)
+            .options("1,2,4,8")
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("jpegCompression.quality")
+            .displayedName("Quality")
+            .description("The current JPEG quality.")
+            .readOnly().initialValue(0)
+            .commit();
+
+        UINT32_ELEMENT(expected).key("jpegCompression.downscale")
+            .displayedName("Downscale")
+            .description("The current downscale factor.")
+            .readOnly().initialValue(1)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("jpegCompression.bytesPerFrame")
+            .displayedName("Bytes per Frame")
+            .description("The average size of the encoded images.")
+            .readOnly().initialValue(0.)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("jpegCompression.bytesPerSecond")
+            .displayedName("Bytes per Second")
+            .description("The average rate of the encoded images.")
+            .readOnly().initialValue(0.)
+            .commit();
+
+        NODE_ELEMENT(expected).key("pyramid")
+            .displayedName("Pyramid")
+            .description("Write the images downsampled by 2, 4 and 8 - by averaging blocks of pixels - to the "
+                         "'pyramid2', 'pyramid4' and 'pyramid8' output channels, each at its own rate. The "
+                         "clients can subscribe to the resolution they need, e.g. for zoomable views.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("pyramid.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        for (unsigned int k = 0; k < PYRAMID_LEVELS; ++k) {
+            const std::string factor = std::to_string(2u << k);
+            UINT32_ELEMENT(expected).key("pyramid.period" + factor)
+                .displayedName("Update Period " + factor + "x")
+                .description("The minimum time between images downsampled by " + factor + ". Zero for every "
+                             "frame.")
+                .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+                .assignmentOptional().defaultValue(100u << k)
+                .reconfigurable()
+                .commit();
+        }
+
+        NODE_ELEMENT(expected).key("thumbnail")
+            .displayedName("Thumbnail")
+            .description("A small JPEG image of the latest frame, updated at a low rate, e.g. for overview "
+                         "scenes showing many cameras. The frame is downscaled in the image processing thread, "
+                         "and encoded in the event loop.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("thumbnail.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("thumbnail.size")
+            .displayedName("Size")
+            .description("The maximum width and height of the thumbnail.")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(256)
+            .minInc(16).maxInc(1024)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("thumbnail.quality")
+            .displayedName("JPEG Quality")
+            .assignmentOptional().defaultValue(75)
+            .minInc(1).maxInc(100)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("thumbnail.updatePeriod")
+            .displayedName("Update Period")
+            .description("The minimum time between updates of the thumbnail.")
+            .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+            .assignmentOptional().defaultValue(1000)
+            .minInc(100)
+            .reconfigurable()
+            .commit();
+
+        IMAGEDATA_ELEMENT(expected).key("thumbnail.image")
+            .displayedName("Image")
+            .setDimensions("0, 0")
+            .setType(Types::UINT8)
+            .setEncoding(Encoding::JPEG)
+            .commit();
+
+        NODE_ELEMENT(expected).key("snapshot")
+            .displayedName("Snapshot")
+            .description("Keep the most recent frames in memory. When triggered - e.g. by an interlock - a number "
+                         "of further frames is recorded, then the frames are frozen, and are either written to a "
+                         "local file or replayed on 'snapshotOutput'. The recording is then resumed.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("snapshot.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("snapshot.nFrames")
+            .displayedName("Frames")
+            .description("The number of frames kept in memory.")
+            .assignmentOptional().defaultValue(100)
+            .minInc(1).maxInc(10000)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("snapshot.postTriggerFrames")
+            .displayedName("Post-Trigger Frames")
+            .description("The number of frames recorded after the trigger.")
+            .assignmentOptional().defaultValue(10)
+            .maxInc(10000)
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("snapshot.action")
+            .displayedName("Action")
+            .description("What is done with the frozen frames: FILE to write them to the snapshot file, CHANNEL "
+                         "to replay them on 'snapshotOutput'.")
+            .assignmentOptional().defaultValue("FILE")
+            .options("FILE,CHANNEL")
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("snapshot.file")
+            .displayedName("Snapshot File")
+            .description("The file the frozen frames are written to. The train ID of the trigger is appended to "
+                         "the file name.")
+            .assignmentOptional().defaultValue("")
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("snapshot.status")
+            .displayedName("Status")
+            .readOnly().initialValue("IDLE")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("triggerSnapshot")
+            .displayedName("Trigger Snapshot")
+            .description("Freeze the snapshot frames, after the post-trigger frames have been recorded.")
+            .commit();
+
+        NODE_ELEMENT(expected).key("recorder")
+            .displayedName("Recorder")
+            .description("Record the frames passed to writeChannels - i.e. before the software processing - and "
+                         "their metadata to a local file, to be replayed by a ReplayImageSource. The file is "
+                         "memory-mapped, and the frames are appended to it.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("recorder.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("recorder.file")
+            .displayedName("Recording File")
+            .description("The file the frames are appended to.")
+            .assignmentOptional().defaultValue("")
+            .reconfigurable()
+            .commit();
+
+        UINT64_ELEMENT(expected).key("recorder.frames")
+            .displayedName("Recorded Frames")
+            .readOnly().initialValue(0)
+            .commit();
+
+        UINT64_ELEMENT(expected).key("recorder.bytes")
+            .displayedName("Recorded Bytes")
+            .unit(Unit::BYTE)
+            .readOnly().initialValue(0)
+            .commit();
+
+        NODE_ELEMENT(expected).key("sharedMemory")
+            .displayedName("Shared Memory")
+            .description("Also place the processed frames in a POSIX shared memory ring, for the consumers on the "
+                         "same host: each frame is notified on 'shmOutput', and the consumers map it without "
+                         "copying it. A frame is not overwritten while a consumer holds it. The other output "
+                         "channels are not affected, e.g. for the remote consumers.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("sharedMemory.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("sharedMemory.name")
+            .displayedName("Name")
+            .description("The shared memory object name, e.g. '/camera'. If empty, derived from the device ID.")
+            .assignmentOptional().defaultValue("")
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("sharedMemory.slots")
+            .displayedName("Slots")
+            .description("The number of frames in the ring. The frames held by the consumers are skipped, i.e. "
+                         "more slots give the consumers more time.")
+            .assignmentOptional().defaultValue(8)
+            .minInc(2).maxInc(1024)
+            .reconfigurable()
+            .commit();
+
+        UINT64_ELEMENT(expected).key("sharedMemory.frames")
+            .displayedName("Shared Frames")
+            .readOnly().initialValue(0)
+            .commit();
+
+        UINT64_ELEMENT(expected).key("sharedMemory.droppedFrames")
+            .displayedName("Dropped Frames")
+            .description("The number of frames not placed in the ring, as the consumers held all its slots.")
+            .readOnly().initialValue(0)
+            .commit();
+
+        NODE_ELEMENT(expected).key("tracing")
+            .displayedName("Latency Tracing")
+            .description("Trace the latency of the frames: the monotonic time of each stage - acquisition, "
+                         "unpacking, orientation, processing, encoding, and each write to 'output', 'daqOutput' and "
+                         "'shmOutput' - is appended to the image header under 'trace', in a compact binary form "
+                         "(see karabo::util::LatencyTrace). The stages before writeChannels are traced by the "
+                         "derived classes supporting it.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("tracing.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        VECTOR_STRING_ELEMENT(expected).key("tracing.stages")
+            .displayedName("Stage Latencies")
+            .description("The latency of each stage since the previous one, and of the whole trace, over the last "
+                         "second.")
+            .readOnly().initialValue(std::vector<std::string>())
+            .commit();
+
+        NODE_ELEMENT(expected).key("placement")
+            .displayedName("Placement")
+            .description("Place the device threads and the frame buffers, e.g. on the NUMA node of the camera "
+                         "interface. The threads are pinned when they start, e.g. when the acquisition starts.")
+            .commit();
+
+        STRING_ELEMENT(expected).key("placement.cpus")
+            .displayedName("CPUs")
+            .description("The CPUs the threads are restricted to, e.g. '0-3,8'. If empty, the CPUs of the NUMA "
+                         "node, if any.")
+            .assignmentOptional().defaultValue("")
+            .reconfigurable()
+            .commit();
+
+        INT32_ELEMENT(expected).key("placement.numaNode")
+            .displayedName("NUMA Node")
+            .description("The NUMA node the frame buffers are preferably allocated on, -1 for no preference.")
+            .assignmentOptional().defaultValue(-1)
+            .minInc(-1)
+            .reconfigurable()
+            .commit();
+
+        BOOL_ELEMENT(expected).key("placement.hugePages")
+            .displayedName("Huge Pages")
+            .description("Back the frame buffers with transparent hugepages, if the kernel supports them.")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        VECTOR_STRING_ELEMENT(expected).key("placement.threads")
+            .displayedName("Threads")
+            .description("The CPUs each thread is restricted to, and the CPU and node it runs on.")
+            .readOnly().initialValue(std::vector<std::string>())
+            .commit();
+
+        STRING_ELEMENT(expected).key("placement.frameMemory")
+            .displayedName("Frame Memory")
+            .description("The node the frame buffers are allocated on, and whether they are backed by hugepages.")
+            .readOnly().initialValue("")
+            .commit();
+
+        NODE_ELEMENT(expected).key("badPixels")
+            .displayedName("Bad Pixels")
+            .description("Replace the defective (e.g. hot or dead) pixels by the mean of their valid neighbours. "
+                         "The correction is applied to the raw images, after the flat-field correction.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("badPixels.enable")
+            .displayedName("Enable")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        STRING_ELEMENT(expected).key("badPixels.file")
+            .displayedName("Bad Pixel File")
+            .description("The local text file containing the bad pixels, one 'x y' pair per line. If the file "
+                         "exists, it is loaded at initialization.")
+            .assignmentOptional().defaultValue("")
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("badPixels.nSigma")
+            .displayedName("Detection Threshold")
+            .description("The pixels of the dark reference deviating from its median by more than this number of "
+                         "(robust) standard deviations are considered defective.")
+            .assignmentOptional().defaultValue(5.)
+            .minExc(0.)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("badPixels.nDefects")
+            .displayedName("Bad Pixels")
+            .description("The number of bad pixels in the current list.")
+            .readOnly().initialValue(0)
+            .commit();
+
+        SLOT_ELEMENT(expected).key("detectBadPixels")
+            .displayedName("Detect Bad Pixels")
+            .description("Detect the bad pixels in the dark reference (see Acquire Dark).")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("clearBadPixels")
+            .displayedName("Clear Bad Pixels")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("saveBadPixels")
+            .displayedName("Save Bad Pixels")
+            .description("Save the bad pixels to the bad pixel file.")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("loadBadPixels")
+            .displayedName("Load Bad Pixels")
+            .description("Load the bad pixels from the bad pixel file.")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("acquireDark")
+            .displayedName("Acquire Dark")
+            .description("Build the dark reference from the next frames.")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("acquireFlat")
+            .displayedName("Acquire Flat")
+            .description("Build the flat reference from the next frames.")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("resetFlatField")
+            .displayedName("Reset References")
+            .description("Clear the dark and flat references.")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("saveFlatField")
+            .displayedName("Save References")
+            .description("Save the dark and flat references to the reference file.")
+            .commit();
+
+        SLOT_ELEMENT(expected).key("loadFlatField")
+            .displayedName("Load References")
+            .description("Load the dark and flat references from the reference file.")
+            .commit();
+    }
+
+
+    ImageSource::ImageSource(const karabo::util::Hash& config) : Device<>(config),
+            m_shape(config.get<std::vector<unsigned long long>>("output.schema.data.image.dims")),
+            m_encoding(config.get<int>("output.schema.data.image.encoding")),
+            m_kType(config.get<int>("output.schema.data.image.pixels.type")),
+            m_outputKType(m_kType), m_outputEncoding(m_encoding), m_daqBurstDepth(0), 
+            m_inputShape(m_shape), m_inputEncoding(m_encoding), m_inputKType(m_kType), m_schemaUpdates(0),
+            m_pendingShape(m_shape), m_pendingEncoding(m_encoding), m_pendingKType(m_kType),
+            m_schemaUpdateRunning(false), m_schemaPending(false), m_heldBackFrames(0), m_configGeneration(0),
+            m_schemaGeneration(0),
+            m_roiOffsets(0, 0), m_roiSize(0, 0), m_binY(1), m_binX(1), m_binningMode(util::BinningMode::MEAN),
+            m_flatFieldEnabled(false), m_flatFieldToFloat(false), m_badPixelsEnabled(false),
+            m_accumulationEnabled(false), m_accumulationMode(util::AccumulationMode::MEAN), m_accumulationFrames(10),
+            m_burstEnabled(false), m_framesPerTrain(10), m_burstDepth(0),
+            m_changeDetectionEnabled(false), m_changeTolerance(1.), m_changeStep(4), m_heartbeatPeriod(10000),
+            m_jpegEnabled(false), m_pyramidEnabled(false), m_pyramidPeriods({100, 200, 400}),
+            m_thumbnailEnabled(false), m_thumbnailSize(256), m_thumbnailQuality(75), m_thumbnailPeriod(1000),
+            m_snapshotEnabled(false), m_snapshotFrames(100), m_postTriggerFrames(10), m_snapshotToChannel(false),
+            m_recorderEnabled(false),
+            m_statisticsEnabled(false), m_statisticsStep(1), m_statisticsBins(256), m_histogramMin(0.),
+            m_histogramMax(0.), m_saturationLevel(0.), m_statisticsPeriod(1000),
+            m_beamEnabled(false), m_beamThreshold(0.), m_beamBackground(0.), m_beamPeriod(1000),
+            m_spotsEnabled(false), m_spotThreshold(0.), m_spotMinArea(1), m_maxSpots(100), m_spotsPeriod(1000),
+            m_lutEnabled(false), m_lutMode(util::LutMode::LINEAR), m_lutGamma(1.), m_lutRange(LutRange::BPP),
+            m_windowMin(0.), m_windowMax(65535.), m_lowPercentile(1.), m_highPercentile(99.), m_lutStep(4),
+            m_lastMin(0.), m_lastMax(0.), m_lutLow(0.), m_lutHigh(0.), m_lutBuiltMode(util::LutMode::LINEAR),
+            m_lutBuiltGamma(1.), m_suppressedFrames(0), m_jpegBudget(1.e6),
+            m_jpegBudgetUnit(util::RateBudget::BYTES_PER_SECOND), m_jpegMinQuality(20), m_jpegMaxQuality(95),
+            m_jpegMaxDownscale(1), m_thumbnailPending(false), m_triggerTrainId(0),
+            m_sharedMemoryEnabled(false), m_sharedMemorySlots(8), m_sharedFrames(0), m_droppedSharedFrames(0),
+            m_tracingEnabled(false) {
+        // NB The input snapshot is invalid, i.e. the first updateOutputSchema call takes the lock
+        this->configure_processing(config);
+        m_schemaGeneration = m_configGeneration.load(); // The schema is updated on the first updateOutputSchema
+
+        KARABO_SLOT(acquireDark)
+        KARABO_SLOT(acquireFlat)
+        KARABO_SLOT(resetFlatField)
+        KARABO_SLOT(saveFlatField)
+        KARABO_SLOT(loadFlatField)
+        KARABO_SLOT(detectBadPixels)
+        KARABO_SLOT(clearBadPixels)
+        KARABO_SLOT(saveBadPixels)
+        KARABO_SLOT(loadBadPixels)
+        KARABO_SLOT(triggerSnapshot)
+
+        KARABO_INITIAL_FUNCTION(initializeImageSource)
+    }
+
+
+    ImageSource::~ImageSource() {
+        boost::mutex::scoped_lock lock(m_snapshotThreadMtx);
+        if (m_snapshotThread.joinable()) {
+            m_snapshotThread.join();
+        }
+    }
+
+
+    void ImageSource::initializeImageSource() {
+        const std::string& filename = this->get<std::string>("flatField.referenceFile");
+        if (!filename.empty() && std::ifstream(filename).good()) {
+            try {
+                this->loadFlatField();
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_WARN << "Could not load flat-field references: " << e.what();
+            }
+        }
+
+        const std::string& badPixelFile = this->get<std::string>("badPixels.file");
+        if (!badPixelFile.empty() && std::ifstream(badPixelFile).good()) {
+            try {
+                this->loadBadPixels();
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_WARN << "Could not load bad pixels: " << e.what();
+            }
+        }
+    }
+
+
+    void ImageSource::updateOutputSchema(const std::vector<unsigned long long>& shape, const EncodingType& encoding,
+                                         const Types::ReferenceType& kType) {
+
+        if (!m_schemaPending.load(std::memory_order_acquire) && this->is_current_input(shape, encoding, kType)) {
+            // Fast path: the schema is up-to-date
+            return;
+        }
+
+        boost::mutex::scoped_lock lock(m_pendingSchemaMtx);
+        m_pendingShape = shape;
+        m_pendingEncoding = encoding;
+        m_pendingKType = kType;
+        this->request_schema_update();
+    }
+
+
+    void ImageSource::request_schema_update() {
+        // NB m_pendingSchemaMtx must be locked by the caller
+
+        // The schema is updated in the event loop, not to block the caller, and only for the latest properties
+        // and configuration
+        m_schemaPending = true;
+        if (!m_schemaUpdateRunning) {
+            m_schemaUpdateRunning = true;
+            karabo::net::EventLoop::getIOService().post(
+                  karabo::util::bind_weak(&ImageSource::apply_schema_updates, this));
+        }
+    }
+
+
+    void ImageSource::apply_schema_updates() {
+        while (true) {
+            std::vector<unsigned long long> shape;
+            int encoding;
+            int kType;
+            bool done = false;
+            {
+                boost::mutex::scoped_lock lock(m_pendingSchemaMtx);
+                if (m_schemaPending) {
+                    shape = m_pendingShape;
+                    encoding = m_pendingEncoding;
+                    kType = m_pendingKType;
+                } else {
+                    m_schemaUpdateRunning = false;
+                    done = true;
+                }
+            }
+            if (done) {
+                unsigned long long schemaUpdates;
+                {
+                    boost::mutex::scoped_lock lock(m_updateSchemaMtx);
+                    schemaUpdates = m_schemaUpdates;
+                }
+                this->set(Hash("heldBackFrames", m_heldBackFrames.load(), "outputSchemaUpdates", schemaUpdates));
+                return;
+            }
+
+            // NB The schema is built with the configuration of at least this generation, as both are written
+            // under m_processingMtx
+            const unsigned long long generation = m_configGeneration.load();
+            {
+                boost::mutex::scoped_lock lock(m_updateSchemaMtx);
+                m_inputShape = shape;
+                m_inputEncoding = encoding;
+                m_inputKType = kType;
+                try {
+                    this->update_output_schema();
+                    this->publish_input();
+                    this->publish_output();
+                } catch (const std::exception& e) {
+                    KARABO_LOG_FRAMEWORK_ERROR << "Could not update the output schema: " << e.what();
+                }
+                m_schemaGeneration = generation; // NB Even on failure, not to hold back the frames forever
+            }
+
+            boost::mutex::scoped_lock lock(m_pendingSchemaMtx);
+            if (m_pendingShape == shape && m_pendingEncoding == encoding && m_pendingKType == kType &&
+                m_configGeneration == generation) {
+                // NB Else the properties or the configuration changed meanwhile: apply the latest ones
+                m_schemaPending = false;
+            }
+        }
+    }
+
+
+    bool ImageSource::is_input_held_back(const NDArray& data, const EncodingType& encoding) {
+        if (!m_schemaPending.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (this->is_current_input(data.getShape().toVector(), encoding, data.getType())) {
+            return false; // The schema may still be valid for this frame, once processed
+        }
+
+        ++m_heldBackFrames;
+        KARABO_LOG_FRAMEWORK_DEBUG << "Frame held back, as the output schema is being updated";
+        return true;
+    }
+
+
+    bool ImageSource::is_output_held_back(const karabo::xms::ImageData& imageData) {
+        // NB The generation is read after the processing: a frame processed with a new configuration sees its
+        // generation, as both are written under m_processingMtx
+        if (!m_schemaPending.load(std::memory_order_acquire) &&
+            m_configGeneration.load() == m_schemaGeneration.load()) {
+            return false;
+        }
+
+        // The schema is being updated: only the frames it is still valid for are written, e.g. not those with a
+        // new ROI or binning
+        const std::vector<unsigned long long> shape = imageData.getDimensions().toVector();
+        const EncodingType encoding = static_cast<EncodingType>(imageData.getEncoding());
+        const Types::ReferenceType kType = imageData.getData().getType();
+        const Types::ReferenceType outputKType = this->display_type(shape, encoding, kType);
+        const EncodingType outputEncoding = this->output_encoding(shape, encoding, outputKType);
+        unsigned int burstDepth;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            burstDepth = isProcessable(shape, encoding) ? m_burstDepth : 0;
+        }
+
+        SnapshotValues values;
+        const size_t size =
+              outputSnapshotValues(shape, encoding, kType, outputKType, outputEncoding, burstDepth, values);
+        if (m_outputSnapshot.matches(values.data(), size)) {
+            return false;
+        }
+
+        ++m_heldBackFrames;
+        KARABO_LOG_FRAMEWORK_DEBUG << "Processed frame held back, as the output schema is being updated";
+        return true;
+    }
+
+
+    bool ImageSource::is_current_input(const std::vector<unsigned long long>& shape, int encoding,
+                                       int kType) const {
+        SnapshotValues values;
+        const size_t size = snapshotValues(shape, encoding, kType, values);
+        return m_inputSnapshot.matches(values.data(), size);
+    }
+
+
+    void ImageSource::publish_input() {
+        // NB m_updateSchemaMtx must be locked by the caller
+        SnapshotValues values;
+        const size_t size = snapshotValues(m_inputShape, m_inputEncoding, m_inputKType, values);
+        m_inputSnapshot.publish(values.data(), size);
+    }
+
+
+    void ImageSource::publish_output() {
+        // NB m_updateSchemaMtx must be locked by the caller
+        SnapshotValues values;
+        const size_t size = outputSnapshotValues(m_shape, m_encoding, m_kType, m_outputKType, m_outputEncoding,
+                                                 m_daqBurstDepth, values);
+        m_outputSnapshot.publish(values.data(), size);
+    }
+
+
+    void ImageSource::update_output_schema() {
+        // NB m_updateSchemaMtx must be locked by the caller
+
+        std::vector<unsigned long long> shape = m_inputShape;
+        const EncodingType encoding = static_cast<EncodingType>(m_inputEncoding);
+        Types::ReferenceType kType = static_cast<Types::ReferenceType>(m_inputKType);
+        this->processed_properties(shape, encoding, kType);
+        const Types::ReferenceType outputKType = this->display_type(shape, encoding, kType);
+        const EncodingType outputEncoding = this->output_encoding(shape, encoding, outputKType);
+        unsigned int burstDepth;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            burstDepth = isProcessable(shape, encoding) ? m_burstDepth : 0;
+        }
+
+        if (shape == m_shape && encoding == m_encoding && kType == m_kType && outputKType == m_outputKType &&
+            outputEncoding == m_outputEncoding && burstDepth == m_daqBurstDepth) {
+            // Nothing to be updated
+            KARABO_LOG_FRAMEWORK_DEBUG << "No need to update the output schema";
+            return;
+        }
+
+        // The schema updates are kept, as building them is not free either
+        std::vector<unsigned long long> key = {static_cast<unsigned long long>(encoding),
+                                               static_cast<unsigned long long>(kType),
+                                               static_cast<unsigned long long>(outputKType),
+                                               static_cast<unsigned long long>(outputEncoding), burstDepth};
+        key.insert(key.end(), shape.begin(), shape.end());
+        auto cached = m_schemaCache.find(key);
+        if (cached == m_schemaCache.end()) {
+            if (m_schemaCacheKeys.size() >= SCHEMA_CACHE_SIZE) {
+                m_schemaCache.erase(m_schemaCacheKeys.front());
+                m_schemaCacheKeys.pop_front();
+            }
+            cached = m_schemaCache.emplace(key, this->build_schema_update(shape, encoding, kType, outputKType,
+                                                                          outputEncoding, burstDepth)).first;
+            m_schemaCacheKeys.push_back(key);
+        }
+
+        this->appendSchema(cached->second);
+        ++m_schemaUpdates;
+
+        m_shape = shape;
+        m_encoding = encoding;
+        m_kType = kType;
+        m_outputKType = outputKType;
+        m_outputEncoding = outputEncoding;
+        m_daqBurstDepth = burstDepth;
+    }
+
+
+    Schema ImageSource::build_schema_update(const std::vector<unsigned long long>& shape,
+                                            const EncodingType& encoding, const Types::ReferenceType& kType,
+                                            const Types::ReferenceType& outputKType,
+                                            const EncodingType& outputEncoding, unsigned int burstDepth) {
+        Schema schemaUpdate;
+        this->schema_update_helper(schemaUpdate, "output", "Output", shape, outputEncoding, outputKType);
+
+        std::vector<unsigned long long> daqShape = shape;
+        if (burstDepth > 0) {
+            daqShape.insert(daqShape.begin(), burstDepth); // i.e. (frames, height, width)
+        }
+        std::reverse(daqShape.begin(), daqShape.end()); // NB DAQ wants fastest changing index first, e.g. (width,
+                                                        // height) or (channel, width, height)
+        this->schema_update_helper(schemaUpdate, "daqOutput", "DAQ Output", daqShape, encoding, kType,
+                                   burstDepth > 0);
+
+        if (isProcessable(shape, encoding)) {
+            this->schema_update_helper(schemaUpdate, "snapshotOutput", "Snapshot Output", shape, encoding, kType);
+            for (unsigned int k = 0; k < PYRAMID_LEVELS; ++k) {
+                std::vector<unsigned long long> levelShape = shape;
+                levelShape[0] >>= k + 1;
+                levelShape[1] >>= k + 1;
+                this->schema_update_helper(schemaUpdate, PYRAMID_CHANNELS[k],
+                                           "Pyramid " + std::to_string(2u << k) + "x", levelShape, encoding, kType);
+            }
+        }
+
+        return schemaUpdate;
+    }
+
+
+    void ImageSource::schema_update_helper(Schema& schemaUpdate, const std::string& nodeKey,
+                                           const std::string& displayedName,
+                                           const std::vector<unsigned long long>& shape, const EncodingType& encoding,
+                                           const Types::ReferenceType& kType, bool burst) {
+        Schema dataSchema;
+        NODE_ELEMENT(dataSchema).key("data")
+            .displayedName("Data")
+            .setDaqDataType(DaqDataType::TRAIN)
+            .commit();
+
+        IMAGEDATA(dataSchema).key("data.image")
+            .displayedName("Image")
+            .setDimensions(karabo::util::toString(shape))
+            .setType(kType)
+            .setEncoding(encoding)
+            .commit();
+
+        if (burst) {
+            VECTOR_UINT64_ELEMENT(dataSchema).key("data.frameTimestamps")
+                .displayedName("Frame Timestamps")
+                .description("The time of each frame in ns since the epoch. Zero for missing frames.")
+                .readOnly()
+                .commit();
+
+            UINT32_ELEMENT(dataSchema).key("data.nFrames")
+                .displayedName("Frames")
+                .description("The number of frames in the stack, the remaining ones being zeros.")
+                .readOnly()
+                .commit();
+        }
+
+        OUTPUT_CHANNEL(schemaUpdate).key(nodeKey)
+            .displayedName(displayedName)
+            .dataSchema(dataSchema)
+            .commit();
+    }
+
+
+    void ImageSource::writeChannels(const NDArray& data, const Dims& binning, const unsigned short bpp,
+                                    const EncodingType& encoding, const Dims& roiOffsets, const Timestamp& timestamp,
+                                    const Hash& header) {
+        util::LatencyTrace trace; // Empty if not tracing
+        if (m_tracingEnabled.load(std::memory_order_relaxed)) {
+            util::LatencyTrace::extract(header, trace); // The stages traced by the derived class, if any
+            trace.mark(util::TraceStage::SUBMITTED);
+        }
+
+        if (this->is_input_held_back(data, encoding)) {
+            return; // Until the output schema matches the frame
+        }
+
+        this->record_raw(data, binning, bpp, encoding, roiOffsets, timestamp, header);
+
+        karabo::xms::ImageData imageData(data, encoding);
+        imageData.setBitsPerPixel(bpp);
+        imageData.setROIOffsets(roiOffsets);
+        imageData.setBinning(binning);
+
+        this->process_image(imageData);
+
+        unsigned int accumulatedFrames = 0;
+        if (!this->accumulate_image(imageData, accumulatedFrames)) {
+            return; // The frame was added to the accumulator
+        }
+
+        if (this->is_output_held_back(imageData)) {
+            return; // Until the output schema matches the processed frame
+        }
+
+        Hash imageHeader(header);
+        if (accumulatedFrames > 0) {
+            imageHeader.set("accumulation.nFrames", accumulatedFrames);
+        }
+        this->analyze_image(imageData, imageHeader, timestamp);
+        if (!trace.empty()) {
+            trace.mark(util::TraceStage::PROCESSED);
+            trace.attach(imageHeader);
+        }
+        if (!imageHeader.empty()) {
+            imageData.setHeader(imageHeader);
+        }
+
+        if (!this->is_unchanged(imageData, timestamp)) {
+            karabo::xms::ImageData preview(imageData); // NB The pixel data are shared, not copied
+            this->map_for_display(preview, timestamp);
+            this->update_thumbnail(preview, timestamp);
+            this->compress_for_output(preview, timestamp);
+            if (!trace.empty()) {
+                trace.mark(util::TraceStage::ENCODED);
+            }
+            this->trace_image(preview, trace, util::TraceStage::OUTPUT);
+            this->writeChannel("output", Hash("data.image", preview), timestamp);
+
+            this->write_pyramid(imageData, timestamp);
+        }
+
+        this->record_frame(imageData, timestamp);
+
+        this->share_frame(imageData, timestamp, trace);
+
+        if (this->stack_frame(imageData, timestamp)) {
+            this->aggregate_trace(trace, timestamp);
+            return; // Burst mode: the stack is written to 'daqOutput' when complete
+        }
+
+        // NB DAQ wants fastest changing index first, e.g. (width, height) or (channel, width, height)
+        Dims daqShape = imageData.getDimensions();
+        daqShape.reverse();
+
+        imageData.setDimensions(daqShape);
+        this->trace_image(imageData, trace, util::TraceStage::DAQ_OUTPUT);
+        this->writeChannel("daqOutput", Hash("data.image", imageData), timestamp);
+
+        this->aggregate_trace(trace, timestamp);
+    }
+
+
+    bool ImageSource::is_unchanged(const karabo::xms::ImageData& imageData, const Timestamp& timestamp) {
+        std::chrono::milliseconds heartbeatPeriod;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_changeDetectionEnabled) {
+                return false;
+            }
+            heartbeatPeriod = std::chrono::milliseconds(m_heartbeatPeriod);
+        }
+
+        if (!isProcessable(imageData.getDimensions().toVector(), imageData.getEncoding())) {
+            return false;
+        }
+
+        bool unchanged = false;
+        bool publish = false;
+        double difference;
+        unsigned long long suppressedFrames;
+        {
+            boost::mutex::scoped_lock lock(m_changeMtx);
+            const auto now = std::chrono::steady_clock::now();
+            try {
+                unchanged = !m_changeDetector.hasChanged(imageData.getData());
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_DEBUG << "Could not compare the image: " << e.what();
+            }
+
+            if (unchanged && heartbeatPeriod.count() > 0 && now - m_lastWriteTime >= heartbeatPeriod) {
+                unchanged = false; // Heartbeat
+            }
+
+            if (unchanged) {
+                ++m_suppressedFrames;
+            } else {
+                m_lastWriteTime = now;
+            }
+
+            // Do not publish the difference at frame rate
+            if (now - m_changeUpdateTime >= std::chrono::seconds(1)) {
+                m_changeUpdateTime = now;
+                publish = true;
+            }
+            difference = m_changeDetector.difference();
+            suppressedFrames = m_suppressedFrames;
+        }
+
+        if (publish) {
+            this->set(Hash("changeDetection.difference", difference, "changeDetection.suppressedFrames",
+                           suppressedFrames),
+                      timestamp);
+        }
+
+        return unchanged;
+    }
+
+
+    void ImageSource::update_thumbnail(const karabo::xms::ImageData& imageData, const Timestamp& timestamp) {
+        unsigned int size, quality;
+        std::chrono::milliseconds period;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_thumbnailEnabled) {
+                return;
+            }
+            size = m_thumbnailSize;
+            quality = m_thumbnailQuality;
+            period = std::chrono::milliseconds(m_thumbnailPeriod);
+        }
+
+        if (!isCompressible(imageData.getDimensions().toVector(), imageData.getEncoding(),
+                            imageData.getData().getType())) {
+            return;
+        }
+
+        {
+            boost::mutex::scoped_lock lock(m_thumbnailMtx);
+            const auto now = std::chrono::steady_clock::now();
+            if (m_thumbnailPending || now - m_thumbnailTime < period) {
+                return;
+            }
+            m_thumbnailTime = now;
+            m_thumbnailPending = true;
+        }
+
+        // Downscale here, which also copies the pixel data, then encode in the event loop
+        karabo::xms::ImageData thumbnail(imageData);
+        try {
+            util::downscaleImage(thumbnail, size);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not downscale the thumbnail: " << e.what();
+            boost::mutex::scoped_lock lock(m_thumbnailMtx);
+            m_thumbnailPending = false;
+            return;
+        }
+
+        karabo::net::EventLoop::getIOService().post(
+              karabo::util::bind_weak(&ImageSource::encode_thumbnail, this, thumbnail, quality, timestamp));
+    }
+
+
+    void ImageSource::encode_thumbnail(karabo::xms::ImageData thumbnail, unsigned int quality,
+                                       const Timestamp& timestamp) {
+        try {
+            util::encodeThumbnail(thumbnail, quality);
+            this->set("thumbnail.image", thumbnail, timestamp);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not encode the thumbnail: " << e.what();
+        }
+
+        boost::mutex::scoped_lock lock(m_thumbnailMtx);
+        m_thumbnailPending = false;
+    }
+
+
+    void ImageSource::record_frame(const karabo::xms::ImageData& imageData, const Timestamp& timestamp) {
+        if (!isProcessable(imageData.getDimensions().toVector(), imageData.getEncoding())) {
+            return;
+        }
+
+        bool frozen = false;
+        unsigned long long trainId;
+        {
+            boost::mutex::scoped_lock lock(m_ringMtx);
+            if (m_ring.capacity() == 0) {
+                return; // Not enabled
+            }
+
+            try {
+                frozen = m_ring.push(imageData, timestamp);
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_DEBUG << "Could not record the frame: " << e.what();
+            }
+            trainId = m_triggerTrainId;
+        }
+
+        if (frozen) {
+            this->start_snapshot_dump(trainId);
+        }
+    }
+
+
+    void ImageSource::triggerSnapshot() {
+        unsigned int postTriggerFrames;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            postTriggerFrames = m_postTriggerFrames;
+        }
+
+        bool frozen;
+        const unsigned long long trainId = this->getActualTimestamp().getTrainId();
+        {
+            boost::mutex::scoped_lock lock(m_ringMtx);
+            if (m_ring.capacity() == 0) {
+                throw KARABO_PARAMETER_EXCEPTION("Snapshot is not enabled");
+            }
+            if (m_ring.isTriggered() || m_ring.isFrozen()) {
+                throw KARABO_PARAMETER_EXCEPTION("Snapshot is already triggered");
+            }
+
+            m_ring.trigger(postTriggerFrames);
+            m_triggerTrainId = trainId;
+            frozen = m_ring.isFrozen();
+        }
+
+        if (frozen) {
+            this->start_snapshot_dump(trainId);
+        } else {
+            this->set("snapshot.status", "TRIGGERED");
+        }
+    }
+
+
+    void ImageSource::start_snapshot_dump(unsigned long long trainId) {
+        boost::mutex::scoped_lock lock(m_snapshotThreadMtx);
+        if (m_snapshotThread.joinable()) {
+            // The previous dump is over, or about to be: the ring is only frozen again after being released
+            m_snapshotThread.join();
+        }
+        // Write or replay the frames in a dedicated thread: writing a large ring to file would otherwise block
+        // the event loop, or the acquisition thread
+        m_snapshotThread = boost::thread(&ImageSource::dump_snapshot, this, trainId);
+    }
+
+
+    void ImageSource::dump_snapshot(unsigned long long trainId) {
+        this->set("snapshot.status", "FROZEN");
+
+        // The frozen ring is not modified by record_frame: a copy sharing its pixel data can be written without
+        // holding the lock
+        util::FrameRing ring;
+        {
+            boost::mutex::scoped_lock lock(m_ringMtx);
+            ring = m_ring;
+        }
+
+        bool toChannel;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            toChannel = m_snapshotToChannel;
+        }
+
+        try {
+            if (toChannel) {
+                karabo::xms::ImageData imageData;
+                for (unsigned int i = 0; i < ring.size(); ++i) {
+                    const Timestamp timestamp = ring.frame(i, imageData);
+                    this->writeChannel("snapshotOutput", Hash("data.image", imageData), timestamp);
+                }
+                this->signalEndOfStream("snapshotOutput");
+                KARABO_LOG_FRAMEWORK_INFO << ring.size() << " snapshot frames replayed";
+            } else {
+                const std::string& file = this->get<std::string>("snapshot.file");
+                if (file.empty()) {
+                    throw KARABO_PARAMETER_EXCEPTION("The snapshot file is not set");
+                }
+                const std::string filename = file + "." + toString(trainId);
+                ring.save(filename);
+                KARABO_LOG_FRAMEWORK_INFO << ring.size() << " snapshot frames saved to " << filename;
+            }
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_ERROR << "Could not dump the snapshot frames: " << e.what();
+        }
+
+        {
+            boost::mutex::scoped_lock lock(m_ringMtx);
+            m_ring.release();
+        }
+        this->set("snapshot.status", "IDLE");
+    }
+
+
+    void ImageSource::record_raw(const NDArray& data, const Dims& binning, const unsigned short bpp,
+                                 const EncodingType& encoding, const Dims& roiOffsets, const Timestamp& timestamp,
+                                 const Hash& header) {
+        bool failed = false;
+        bool publish = false;
+        unsigned long long frames, bytes;
+        {
+            boost::mutex::scoped_lock lock(m_recorderMtx);
+            if (!m_recorder.isOpen()) {
+                return; // Not enabled
+            }
+
+            try {
+                m_recorder.append(data, binning, bpp, encoding, roiOffsets, timestamp, header);
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_ERROR << "Could not record the frame, the recording is stopped: " << e.what();
+                m_recorder.close();
+                failed = true;
+            }
+
+            // Do not publish the recorded size at frame rate
+            const auto now = std::chrono::steady_clock::now();
+            if (failed || now - m_recorderUpdateTime >= std::chrono::seconds(1)) {
+                m_recorderUpdateTime = now;
+                publish = true;
+            }
+            frames = m_recorder.frames();
+            bytes = m_recorder.bytes();
+        }
+
+        if (failed) {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            m_recorderEnabled = false;
+        }
+
+        if (publish) {
+            Hash properties("recorder.frames", frames, "recorder.bytes", bytes);
+            if (failed) {
+                properties.set("recorder.enable", false);
+            }
+            this->set(properties, timestamp);
+        }
+    }
+
+
+    void ImageSource::share_frame(const karabo::xms::ImageData& imageData, const Timestamp& timestamp,
+                                  util::LatencyTrace& trace) {
+        bool failed = false;
+        bool written = false;
+        bool publish = false;
+        std::string name;
+        unsigned long long ringId = 0, sequence = 0, frames, droppedFrames;
+        unsigned int slot = 0;
+        {
+            boost::mutex::scoped_lock lock(m_sharedMemoryMtx);
+            if (!m_sharedMemoryEnabled) {
+                return;
+            }
+
+            const NDArray& data = imageData.getData();
+            try {
+                // NB A larger frame needs a new ring: the consumers notice its new ID
+                if (!m_sharedMemoryRing.isOpen() || data.byteSize() > m_sharedMemoryRing.slotSize()) {
+                    std::string ringName = m_sharedMemoryName;
+                    if (ringName.empty()) {
+                        ringName = this->getInstanceId();
+                        std::replace(ringName.begin(), ringName.end(), '/', '_');
+                        ringName = "/" + ringName;
+                    }
+                    m_sharedMemoryRing.create(ringName, m_sharedMemorySlots, data.byteSize());
+                }
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_ERROR << "Could not create the shared memory ring, sharing is stopped: "
+                                           << e.what();
+                m_sharedMemoryEnabled = false;
+                failed = true;
+            }
+
+            if (!failed) {
+                try {
+                    written = m_sharedMemoryRing.write(data, static_cast<EncodingType>(imageData.getEncoding()),
+                                                       imageData.getBitsPerPixel(), timestamp, slot, sequence);
+                } catch (const std::exception& e) {
+                    KARABO_LOG_FRAMEWORK_DEBUG << "Could not share the frame: " << e.what();
+                }
+                if (written) {
+                    ++m_sharedFrames;
+                    name = m_sharedMemoryRing.name();
+                    ringId = m_sharedMemoryRing.ringId();
+                } else {
+                    ++m_droppedSharedFrames;
+                }
+            }
+
+            // Do not publish the counters at frame rate
+            const auto now = std::chrono::steady_clock::now();
+            if (failed || now - m_sharedMemoryUpdateTime >= std::chrono::seconds(1)) {
+                m_sharedMemoryUpdateTime = now;
+                publish = true;
+            }
+            frames = m_sharedFrames;
+            droppedFrames = m_droppedSharedFrames;
+        }
+
+        if (written) {
+            Hash notification("data.name", name, "data.ringId", ringId, "data.slot", slot, "data.sequence", sequence);
+            if (!trace.empty()) {
+                trace.mark(util::TraceStage::SHM_OUTPUT);
+                notification.set("data.trace", trace.encode());
+            }
+            this->writeChannel("shmOutput", notification, timestamp);
+        }
+
+        if (publish) {
+            Hash properties("sharedMemory.frames", frames, "sharedMemory.droppedFrames", droppedFrames);
+            if (failed) {
+                properties.set("sharedMemory.enable", false);
+            }
+            this->set(properties, timestamp);
+        }
+    }
+
+
+    void ImageSource::trace_image(karabo::xms::ImageData& imageData, util::LatencyTrace& trace,
+                                  const util::TraceStage& stage) {
+        if (trace.empty()) {
+            return; // Not tracing
+        }
+        trace.mark(stage);
+        Hash header = imageData.getHeader();
+        trace.attach(header);
+        imageData.setHeader(header);
+    }
+
+
+    void ImageSource::aggregate_trace(const util::LatencyTrace& trace, const Timestamp& timestamp) {
+        if (trace.empty()) {
+            return; // Not tracing
+        }
+
+        std::vector<std::string> stages;
+        {
+            boost::mutex::scoped_lock lock(m_tracingMtx);
+            m_latencies.add(trace);
+
+            // Publish the latencies of the last second
+            const auto now = std::chrono::steady_clock::now();
+            if (now - m_tracingUpdateTime < std::chrono::seconds(1)) {
+                return;
+            }
+            m_tracingUpdateTime = now;
+            stages = m_latencies.summary();
+            m_latencies.clear();
+        }
+        this->set(Hash("tracing.stages", stages), timestamp);
+    }
+
+
+    void ImageSource::write_pyramid(const karabo::xms::ImageData& imageData, const Timestamp& timestamp) {
+        std::array<unsigned int, PYRAMID_LEVELS> periods;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_pyramidEnabled) {
+                return;
+            }
+            periods = m_pyramidPeriods;
+        }
+
+        if (!isProcessable(imageData.getDimensions().toVector(), imageData.getEncoding())) {
+            return;
+        }
+
+        // Only the levels up to the lowest resolution due are computed
+        std::array<bool, PYRAMID_LEVELS> due;
+        unsigned int nLevels = 0;
+        {
+            boost::mutex::scoped_lock lock(m_pyramidMtx);
+            const auto now = std::chrono::steady_clock::now();
+            for (unsigned int k = 0; k < PYRAMID_LEVELS; ++k) {
+                due[k] = (now - m_pyramidWriteTimes[k] >= std::chrono::milliseconds(periods[k]));
+                if (due[k]) {
+                    m_pyramidWriteTimes[k] = now;
+                    nLevels = k + 1;
+                }
+            }
+        }
+
+        if (nLevels == 0) {
+            return;
+        }
+
+        std::vector<NDArray> levels;
+        try {
+            util::buildPyramid(imageData.getData(), levels, nLevels);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not downsample the image: " << e.what();
+            return;
+        }
+
+        const Dims binning = imageData.getBinning();
+        for (unsigned int k = 0; k < nLevels; ++k) {
+            if (!due[k]) {
+                continue;
+            }
+
+            karabo::xms::ImageData level(imageData); // NB The metadata are copied, the pixel data are replaced
+            const Dims shape = levels[k].getShape();
+            level.setData(levels[k]);
+            level.setDimensions(shape);
+            level.setBinning(Dims(binning.x1() << (k + 1), binning.x2() << (k + 1)));
+            this->writeChannel(PYRAMID_CHANNELS[k], Hash("data.image", level), timestamp);
+        }
+    }
+
+
+    bool ImageSource::stack_frame(const karabo::xms::ImageData& imageData, const Timestamp& timestamp) {
+        unsigned int depth;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            depth = m_burstDepth;
+        }
+
+        boost::mutex::scoped_lock lock(m_frameStackMtx);
+        if (depth == 0 || !isProcessable(imageData.getDimensions().toVector(), imageData.getEncoding())) {
+            if (m_frameStack.size() > 0) {
+                this->write_stack(); // Burst mode was switched off: do not lose the stacked frames
+            }
+            return false;
+        }
+
+        if (m_frameStack.depth() != depth) {
+            if (m_frameStack.size() > 0) {
+                this->write_stack();
+            }
+            m_frameStack.setDepth(depth);
+        }
+
+        if (!m_frameStack.accepts(imageData, timestamp)) {
+            // New train (or new image shape): the previous train is complete
+            this->write_stack();
+        }
+
+        if (m_frameStack.add(imageData, timestamp)) {
+            this->write_stack();
+        }
+
+        return true;
+    }
+
+
+    void ImageSource::write_stack() {
+        // NB m_frameStackMtx must be locked by the caller
+        karabo::xms::ImageData stack;
+        std::vector<unsigned long long> frameTimestamps;
+        const unsigned int nFrames = m_frameStack.size();
+        const Timestamp timestamp = m_frameStack.take(stack, frameTimestamps);
+
+        // NB DAQ wants fastest changing index first, i.e. (width, height, frames)
+        Dims daqShape = stack.getDimensions();
+        daqShape.reverse();
+        stack.setDimensions(daqShape);
+
+        this->writeChannel("daqOutput",
+                           Hash("data.image", stack, "data.frameTimestamps", frameTimestamps, "data.nFrames", nFrames),
+                           timestamp);
+    }
+
+
+    void ImageSource::signalEOS() {
+        {
+            boost::mutex::scoped_lock lock(m_frameStackMtx);
+            if (m_frameStack.size() > 0) {
+                this->write_stack();
+            }
+        }
+
+        this->signalEndOfStream("output");
+        this->signalEndOfStream("daqOutput");
+        this->signalEndOfStream("shmOutput");
+        for (const char* channel : PYRAMID_CHANNELS) {
+            this->signalEndOfStream(channel);
+        }
+    }
+
+
+    void ImageSource::pinThread(const std::string& role) {
+        std::vector<int> cpus;
+        {
+            boost::mutex::scoped_lock lock(m_placementMtx);
+            cpus = m_pinnedCpus;
+        }
+
+        std::string placement;
+        try {
+            if (!cpus.empty()) {
+                pinCurrentThread(cpus);
+            }
+            placement = role + ": " + describeCurrentThread();
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_ERROR << "Could not pin the " << role << " thread: " << e.what();
+            placement = role + ": not pinned, " + describeCurrentThread();
+        }
+
+        std::vector<std::string> threads;
+        {
+            boost::mutex::scoped_lock lock(m_placementMtx);
+            m_threadPlacement[role] = placement;
+            for (const auto& thread : m_threadPlacement) {
+                threads.push_back(thread.second);
+            }
+        }
+        this->set("placement.threads", threads);
+    }
+
+
+    NDArray ImageSource::allocateFrame(const Dims& shape, const Types::ReferenceType& kType) {
+        NDArray frame = m_framePool.allocate(shape, kType);
+
+        // Do not publish the placement at frame rate
+        MemoryPolicy policy;
+        {
+            boost::mutex::scoped_lock lock(m_placementMtx);
+            const auto now = std::chrono::steady_clock::now();
+            if (now - m_placementUpdateTime < std::chrono::seconds(1)) {
+                return frame;
+            }
+            m_placementUpdateTime = now;
+            policy = m_memoryPolicy;
+        }
+
+        const int node = memoryNode(frame.getData<char>());
+        std::string placement = (node >= 0) ? "node " + std::to_string(node) : "unknown node";
+        if (policy.numaNode >= 0 && node != policy.numaNode) {
+            placement += " (node " + std::to_string(policy.numaNode) + " is full)";
+        }
+        if (policy.hugePages) {
+            placement += transparentHugePagesAvailable() ? ", transparent hugepages"
+                                                         : ", transparent hugepages disabled by the kernel";
+        }
+        this->set("placement.frameMemory", placement);
+
+        return frame;
+    }
+
+
+    MemoryPolicy ImageSource::memoryPolicy() {
+        boost::mutex::scoped_lock lock(m_placementMtx);
+        return m_memoryPolicy;
+    }
+
+
+    void ImageSource::preReconfigure(Hash& incomingReconfiguration) {
+        this->configure_processing(incomingReconfiguration);
+
+        if (affectsOutputSchema(incomingReconfiguration)) {
+            // The output image properties may have changed: the schema is updated as for new image properties,
+            // and the processed frames not matching it are held back meanwhile
+            boost::mutex::scoped_lock lock(m_pendingSchemaMtx);
+            this->request_schema_update();
+        }
+    }
+
+
+    void ImageSource::configure_processing(const Hash& config) {
+        boost::mutex::scoped_lock lock(m_processingMtx);
+
+        // Validate first: whatever can fail is done before any change, so that a failure rejects the new
+        // configuration as a whole, and leaves the processing untouched
+
+        double jpegBudget = m_jpegBudget;
+        RateBudget jpegBudgetUnit = m_jpegBudgetUnit;
+        unsigned int jpegMinQuality = m_jpegMinQuality;
+        unsigned int jpegMaxQuality = m_jpegMaxQuality;
+        unsigned int jpegMaxDownscale = m_jpegMaxDownscale;
+        if (config.has("jpegCompression")) {
+            if (config.has("jpegCompression.budget")) {
+                jpegBudget = config.get<double>("jpegCompression.budget");
+            }
+            if (config.has("jpegCompression.budgetUnit")) {
+                jpegBudgetUnit = (config.get<std::string>("jpegCompression.budgetUnit") == "BYTES_PER_FRAME")
+                                       ? RateBudget::BYTES_PER_FRAME
+                                       : RateBudget::BYTES_PER_SECOND;
+            }
+            if (config.has("jpegCompression.minQuality")) {
+                jpegMinQuality = config.get<unsigned int>("jpegCompression.minQuality");
+            }
+            if (config.has("jpegCompression.maxQuality")) {
+                jpegMaxQuality = config.get<unsigned int>("jpegCompression.maxQuality");
+            }
+            if (config.has("jpegCompression.maxDownscale")) {
+                jpegMaxDownscale = config.get<unsigned int>("jpegCompression.maxDownscale");
+            }
+            util::JpegRateController::validate(jpegBudget, jpegMinQuality, jpegMaxQuality, jpegMaxDownscale);
+        }
+
+        bool sharedMemoryEnabled = false;
+        std::string sharedMemoryName;
+        unsigned int sharedMemorySlots = 0;
+        if (config.has("sharedMemory")) {
+            boost::mutex::scoped_lock sharedMemoryLock(m_sharedMemoryMtx);
+            sharedMemoryEnabled = config.has("sharedMemory.enable") ? config.get<bool>("sharedMemory.enable")
+                                                                    : m_sharedMemoryEnabled;
+            sharedMemoryName = config.has("sharedMemory.name") ? config.get<std::string>("sharedMemory.name")
+                                                               : m_sharedMemoryName;
+            sharedMemorySlots = config.has("sharedMemory.slots") ? config.get<unsigned int>("sharedMemory.slots")
+                                                                 : m_sharedMemorySlots;
+            if (!sharedMemoryName.empty() &&
+                (sharedMemoryName[0] != '/' || sharedMemoryName.find('/', 1) != std::string::npos ||
+                 sharedMemoryName.size() > 255)) {
+                throw KARABO_PARAMETER_EXCEPTION("Invalid shared memory name '" + sharedMemoryName +
+                                                 "', e.g. '/camera' is expected");
+            }
+        }
+
+        std::string placementCpus;
+        std::vector<int> pinnedCpus;
+        MemoryPolicy memoryPolicy;
+        if (config.has("placement")) {
+            boost::mutex::scoped_lock placementLock(m_placementMtx);
+            placementCpus = config.has("placement.cpus") ? config.get<std::string>("placement.cpus")
+                                                         : m_placementCpus;
+            memoryPolicy = m_memoryPolicy;
+            if (config.has("placement.numaNode")) {
+                memoryPolicy.numaNode = config.get<int>("placement.numaNode");
+            }
+            if (config.has("placement.hugePages")) {
+                memoryPolicy.hugePages = config.get<bool>("placement.hugePages");
+            }
+
+            // NB An invalid CPU list or node rejects the new configuration
+            pinnedCpus = parseCpuList(placementCpus);
+            if (pinnedCpus.empty() && memoryPolicy.numaNode >= 0) {
+                pinnedCpus = numaNodeCpus(memoryPolicy.numaNode);
+            } else if (memoryPolicy.numaNode >= 0) {
+                numaNodeCpus(memoryPolicy.numaNode);
+            }
+        }
+
+        // NB Last, as it creates the file
+        bool recorderEnabled = m_recorderEnabled;
+        std::string recorderFile = m_recorderFile;
+        util::FrameRecorder recorder; // The new recording, if any
+        if (config.has("recorder")) {
+            if (config.has("recorder.enable")) {
+                recorderEnabled = config.get<bool>("recorder.enable");
+            }
+            if (config.has("recorder.file")) {
+                recorderFile = config.get<std::string>("recorder.file");
+            }
+
+            boost::mutex::scoped_lock recorderLock(m_recorderMtx);
+            if (recorderEnabled && (!m_recorder.isOpen() || recorderFile != m_recorderFile)) {
+                if (recorderFile.empty()) {
+                    throw KARABO_PARAMETER_EXCEPTION("The recording file is not set");
+                }
+                recorder.open(recorderFile);
+            }
+        }
+
+        // Then apply
+
+        if (affectsOutputSchema(config)) {
+            ++m_configGeneration; // NB Under m_processingMtx, as the configuration applied below
+        }
+
+        if (config.has("softwareRoi.x")) {
+            m_roiOffsets = Dims(m_roiOffsets.x1(), config.get<unsigned int>("softwareRoi.x"));
+        }
+        if (config.has("softwareRoi.y")) {
+            m_roiOffsets = Dims(config.get<unsigned int>("softwareRoi.y"), m_roiOffsets.x2());
+        }
+        if (config.has("softwareRoi.width")) {
+            m_roiSize = Dims(m_roiSize.x1(), config.get<unsigned int>("softwareRoi.width"));
+        }
+        if (config.has("softwareRoi.height")) {
+            m_roiSize = Dims(config.get<unsigned int>("softwareRoi.height"), m_roiSize.x2());
+        }
+
+        if (config.has("softwareBinning.x")) {
+            m_binX = config.get<unsigned int>("softwareBinning.x");
+        }
+        if (config.has("softwareBinning.y")) {
+            m_binY = config.get<unsigned int>("softwareBinning.y");
+        }
+        if (config.has("softwareBinning.mode")) {
+            const std::string& mode = config.get<std::string>("softwareBinning.mode");
+            m_binningMode = (mode == "SUM") ? util::BinningMode::SUM : util::BinningMode::MEAN;
+        }
+
+        if (config.has("flatField.enable")) {
+            m_flatFieldEnabled = config.get<bool>("flatField.enable");
+        }
+        if (config.has("flatField.outputType")) {
+            m_flatFieldToFloat = (config.get<std::string>("flatField.outputType") == "FLOAT");
+        }
+
+        if (config.has("badPixels.enable")) {
+            m_badPixelsEnabled = config.get<bool>("badPixels.enable");
+        }
+
+        if (config.has("accumulation")) {
+            if (config.has("accumulation.enable")) {
+                m_accumulationEnabled = config.get<bool>("accumulation.enable");
+            }
+            if (config.has("accumulation.mode")) {
+                const std::string& mode = config.get<std::string>("accumulation.mode");
+                m_accumulationMode = (mode == "SUM") ? util::AccumulationMode::SUM
+                                                     : ((mode == "EMA") ? util::AccumulationMode::EMA
+                                                                        : util::AccumulationMode::MEAN);
+            }
+            if (config.has("accumulation.nFrames")) {
+                m_accumulationFrames = config.get<unsigned int>("accumulation.nFrames");
+            }
+
+            // Restart the accumulation with the new parameters
+            boost::mutex::scoped_lock accumulatorLock(m_accumulatorMtx);
+            m_accumulator.configure(m_accumulationMode, m_accumulationFrames);
+        }
+
+        if (config.has("burstMode")) {
+            if (config.has("burstMode.enable")) {
+                m_burstEnabled = config.get<bool>("burstMode.enable");
+            }
+            if (config.has("burstMode.framesPerTrain")) {
+                m_framesPerTrain = config.get<unsigned int>("burstMode.framesPerTrain");
+            }
+            m_burstDepth = m_burstEnabled ? m_framesPerTrain : 0;
+        }
+
+        if (config.has("changeDetection")) {
+            if (config.has("changeDetection.enable")) {
+                m_changeDetectionEnabled = config.get<bool>("changeDetection.enable");
+            }
+            if (config.has("changeDetection.tolerance")) {
+                m_changeTolerance = config.get<double>("changeDetection.tolerance");
+            }
+            if (config.has("changeDetection.step")) {
+                m_changeStep = config.get<unsigned int>("changeDetection.step");
+            }
+            if (config.has("changeDetection.heartbeatPeriod")) {
+                m_heartbeatPeriod = config.get<unsigned int>("changeDetection.heartbeatPeriod");
+            }
+
+            // Compare the next frames to a new reference
+            boost::mutex::scoped_lock changeLock(m_changeMtx);
+            m_changeDetector.configure(m_changeTolerance, m_changeStep);
+        }
+
+        if (config.has("pyramid.enable")) {
+            m_pyramidEnabled = config.get<bool>("pyramid.enable");
+        }
+        for (unsigned int k = 0; k < PYRAMID_LEVELS; ++k) {
+            const std::string key = "pyramid.period" + std::to_string(2u << k);
+            if (config.has(key)) {
+                m_pyramidPeriods[k] = config.get<unsigned int>(key);
+            }
+        }
+
+        if (config.has("thumbnail.enable")) {
+            m_thumbnailEnabled = config.get<bool>("thumbnail.enable");
+        }
+        if (config.has("thumbnail.size")) {
+            m_thumbnailSize = config.get<unsigned int>("thumbnail.size");
+        }
+        if (config.has("thumbnail.quality")) {
+            m_thumbnailQuality = config.get<unsigned int>("thumbnail.quality");
+        }
+        if (config.has("thumbnail.updatePeriod")) {
+            m_thumbnailPeriod = config.get<unsigned int>("thumbnail.updatePeriod");
+        }
+
+        if (config.has("snapshot")) {
+            if (config.has("snapshot.enable")) {
+                m_snapshotEnabled = config.get<bool>("snapshot.enable");
+            }
+            if (config.has("snapshot.nFrames")) {
+                m_snapshotFrames = config.get<unsigned int>("snapshot.nFrames");
+            }
+            if (config.has("snapshot.postTriggerFrames")) {
+                m_postTriggerFrames = config.get<unsigned int>("snapshot.postTriggerFrames");
+            }
+            if (config.has("snapshot.action")) {
+                m_snapshotToChannel = (config.get<std::string>("snapshot.action") == "CHANNEL");
+            }
+
+            // The frames are only kept if enabled
+            boost::mutex::scoped_lock ringLock(m_ringMtx);
+            const unsigned int capacity = m_snapshotEnabled ? m_snapshotFrames : 0;
+            if (capacity != m_ring.capacity()) {
+                m_ring.setCapacity(capacity);
+            }
+        }
+
+        if (config.has("recorder")) {
+            boost::mutex::scoped_lock recorderLock(m_recorderMtx);
+            if (!recorderEnabled) {
+                m_recorder.close();
+            } else if (recorder.isOpen()) {
+                m_recorder.swap(recorder); // The previous file, if any, is closed with recorder
+            }
+            m_recorderEnabled = recorderEnabled;
+            m_recorderFile = recorderFile;
+        }
+
+        if (config.has("sharedMemory")) {
+            boost::mutex::scoped_lock sharedMemoryLock(m_sharedMemoryMtx);
+            // The ring is (re)created with the next frame
+            if (!sharedMemoryEnabled || sharedMemoryName != m_sharedMemoryName ||
+                sharedMemorySlots != m_sharedMemorySlots) {
+                m_sharedMemoryRing.close();
+            }
+            m_sharedMemoryEnabled = sharedMemoryEnabled;
+            m_sharedMemoryName = sharedMemoryName;
+            m_sharedMemorySlots = sharedMemorySlots;
+        }
+
+        if (config.has("tracing.enable")) {
+            const bool enable = config.get<bool>("tracing.enable");
+            if (enable && !m_tracingEnabled) {
+                boost::mutex::scoped_lock tracingLock(m_tracingMtx);
+                m_latencies.clear();
+                m_tracingUpdateTime = std::chrono::steady_clock::now();
+            }
+            m_tracingEnabled = enable;
+        }
+
+        if (config.has("placement")) {
+            boost::mutex::scoped_lock placementLock(m_placementMtx);
+            m_placementCpus = placementCpus;
+            m_pinnedCpus = pinnedCpus;
+            m_memoryPolicy = memoryPolicy;
+            m_framePool.setPolicy(memoryPolicy);
+        }
+
+        if (config.has("jpegCompression")) {
+            // Restart the control with the new parameters
+            boost::mutex::scoped_lock jpegLock(m_jpegMtx);
+            m_jpegController.configure(jpegBudget, jpegBudgetUnit, jpegMinQuality, jpegMaxQuality, jpegMaxDownscale);
+            m_jpegBudget = jpegBudget;
+            m_jpegBudgetUnit = jpegBudgetUnit;
+            m_jpegMinQuality = jpegMinQuality;
+            m_jpegMaxQuality = jpegMaxQuality;
+            m_jpegMaxDownscale = jpegMaxDownscale;
+            if (config.has("jpegCompression.enable")) {
+                m_jpegEnabled = config.get<bool>("jpegCompression.enable");
+            }
+        }
+
+        if (config.has("frameStatistics.enable")) {
+            m_statisticsEnabled = config.get<bool>("frameStatistics.enable");
+        }
+        if (config.has("frameStatistics.step")) {
+            m_statisticsStep = config.get<unsigned int>("frameStatistics.step");
+        }
+        if (config.has("frameStatistics.bins")) {
+            m_statisticsBins = config.get<unsigned int>("frameStatistics.bins");
+        }
+        if (config.has("frameStatistics.histogramMin")) {
+            m_histogramMin = config.get<double>("frameStatistics.histogramMin");
+        }
+        if (config.has("frameStatistics.histogramMax")) {
+            m_histogramMax = config.get<double>("frameStatistics.histogramMax");
+        }
+        if (config.has("frameStatistics.saturationLevel")) {
+            m_saturationLevel = config.get<double>("frameStatistics.saturationLevel");
+        }
+        if (config.has("frameStatistics.updatePeriod")) {
+            m_statisticsPeriod = config.get<unsigned int>("frameStatistics.updatePeriod");
+        }
+
+        if (config.has("beamProperties.enable")) {
+            m_beamEnabled = config.get<bool>("beamProperties.enable");
+        }
+        if (config.has("beamProperties.threshold")) {
+            m_beamThreshold = config.get<double>("beamProperties.threshold");
+        }
+        if (config.has("beamProperties.background")) {
+            m_beamBackground = config.get<double>("beamProperties.background");
+        }
+        if (config.has("beamProperties.updatePeriod")) {
+            m_beamPeriod = config.get<unsigned int>("beamProperties.updatePeriod");
+        }
+
+        if (config.has("spotFinder.enable")) {
+            m_spotsEnabled = config.get<bool>("spotFinder.enable");
+        }
+        if (config.has("spotFinder.threshold")) {
+            m_spotThreshold = config.get<double>("spotFinder.threshold");
+        }
+        if (config.has("spotFinder.minArea")) {
+            m_spotMinArea = config.get<unsigned int>("spotFinder.minArea");
+        }
+        if (config.has("spotFinder.maxSpots")) {
+            m_maxSpots = config.get<unsigned int>("spotFinder.maxSpots");
+        }
+        if (config.has("spotFinder.updatePeriod")) {
+            m_spotsPeriod = config.get<unsigned int>("spotFinder.updatePeriod");
+        }
+
+        if (config.has("displayLut.enable")) {
+            m_lutEnabled = config.get<bool>("displayLut.enable");
+        }
+        if (config.has("displayLut.mode")) {
+            const std::string& mode = config.get<std::string>("displayLut.mode");
+            m_lutMode = (mode == "GAMMA") ? util::LutMode::GAMMA
+                                          : ((mode == "LOG") ? util::LutMode::LOG : util::LutMode::LINEAR);
+        }
+        if (config.has("displayLut.gamma")) {
+            m_lutGamma = config.get<double>("displayLut.gamma");
+        }
+        if (config.has("displayLut.range")) {
+            const std::string& range = config.get<std::string>("displayLut.range");
+            m_lutRange = (range == "WINDOW") ? LutRange::WINDOW
+                                             : ((range == "PERCENTILE") ? LutRange::PERCENTILE : LutRange::BPP);
+        }
+        if (config.has("displayLut.windowMin")) {
+            m_windowMin = config.get<double>("displayLut.windowMin");
+        }
+        if (config.has("displayLut.windowMax")) {
+            m_windowMax = config.get<double>("displayLut.windowMax");
+        }
+        if (config.has("displayLut.lowPercentile")) {
+            m_lowPercentile = config.get<double>("displayLut.lowPercentile");
+        }
+        if (config.has("displayLut.highPercentile")) {
+            m_highPercentile = config.get<double>("displayLut.highPercentile");
+        }
+        if (config.has("displayLut.step")) {
+            m_lutStep = config.get<unsigned int>("displayLut.step");
+        }
+    }
+
+
+    void ImageSource::process_image(karabo::xms::ImageData& imageData) {
+        std::vector<unsigned long long> shape = imageData.getDimensions().toVector();
+        if (!isProcessable(shape, imageData.getEncoding())) {
+            return;
+        }
+
+        Dims roiOffsets, roiSize;
+        unsigned int binY, binX;
+        util::BinningMode binningMode;
+        bool crop, flatField, toFloat, badPixels;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            crop = effectiveRoi(shape, m_roiOffsets, m_roiSize, roiOffsets, roiSize);
+            binY = m_binY;
+            binX = m_binX;
+            binningMode = m_binningMode;
+            flatField = m_flatFieldEnabled;
+            toFloat = m_flatFieldToFloat;
+            badPixels = m_badPixelsEnabled;
+        }
+
+        // NB The first processing step creates a new array: the input data are not modified
+        const char* input = imageData.getData().getData<char>();
+        this->correct_flat_field(imageData, flatField, toFloat);
+
+        bool cropped = false, binned = false;
+        try {
+            if (crop) {
+                util::cropImage(imageData, roiOffsets, roiSize, &m_framePool);
+                cropped = true;
+                shape = imageData.getDimensions().toVector();
+            }
+
+            if ((binY > 1 || binX > 1) && shape[0] >= binY && shape[1] >= binX) {
+                util::binImage(imageData, binY, binX, binningMode, &m_framePool);
+                binned = true;
+            }
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not crop or bin the image: " << e.what();
+        }
+
+        if (badPixels) {
+            // The processed image is patched, i.e. the defects are mapped to the ROI and the bins
+            this->patch_bad_pixels(imageData, input, cropped ? roiOffsets : Dims(0, 0), binned ? binY : 1,
+                                   binned ? binX : 1);
+        }
+    }
+
+
+    bool ImageSource::accumulate_image(karabo::xms::ImageData& imageData, unsigned int& accumulatedFrames) {
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_accumulationEnabled) {
+                return true;
+            }
+        }
+
+        if (!isProcessable(imageData.getDimensions().toVector(), imageData.getEncoding())) {
+            return true;
+        }
+
+        boost::mutex::scoped_lock lock(m_accumulatorMtx);
+        try {
+            const bool completed = m_accumulator.add(imageData, &m_framePool);
+            accumulatedFrames = m_accumulator.publishedFrames();
+            return completed;
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not accumulate the image: " << e.what();
+            return true;
+        }
+    }
+
+
+    void ImageSource::analyze_image(const karabo::xms::ImageData& imageData, Hash& header,
+                                    const Timestamp& timestamp) {
+        if (!isProcessable(imageData.getDimensions().toVector(), imageData.getEncoding())) {
+            return;
+        }
+
+        this->compute_statistics(imageData, header, timestamp);
+        this->compute_beam_properties(imageData, header, timestamp);
+        this->find_spots(imageData, header, timestamp);
+    }
+
+
+    void ImageSource::compute_statistics(const karabo::xms::ImageData& imageData, Hash& header,
+                                         const Timestamp& timestamp) {
+        unsigned int step, bins, period;
+        double histogramMin, histogramMax, saturationLevel;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_statisticsEnabled) {
+                return;
+            }
+            step = m_statisticsStep;
+            bins = m_statisticsBins;
+            histogramMin = m_histogramMin;
+            histogramMax = m_histogramMax;
+            saturationLevel = m_saturationLevel;
+            period = m_statisticsPeriod;
+        }
+
+        const NDArray& arr = imageData.getData();
+        const Types::ReferenceType kType = arr.getType();
+        const bool isFloat = (kType == Types::FLOAT || kType == Types::DOUBLE);
+        const unsigned short bpp = imageData.getBitsPerPixel();
+        const unsigned int bits = (bpp > 0) ? bpp : 8 * arr.itemSize();
+
+        if (histogramMax == histogramMin) {
+            if (isFloat) {
+                boost::mutex::scoped_lock lock(m_analysisMtx);
+                histogramMin = m_lastMin;
+                histogramMax = (m_lastMax > m_lastMin) ? m_lastMax : m_lastMin + 1.;
+            } else {
+                histogramMin = 0.;
+                histogramMax = std::ldexp(1., bits);
+            }
+        }
+
+        if (saturationLevel == 0. && !isFloat) {
+            saturationLevel = std::ldexp(1., bits) - 1.;
+        }
+
+        util::FrameStatistics stats;
+        try {
+            util::computeFrameStatistics(arr, stats, bins, histogramMin, histogramMax, saturationLevel, step);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not compute the frame statistics: " << e.what();
+            return;
+        }
+
+        Hash h;
+        h.set("frameStatistics.min", stats.min);
+        h.set("frameStatistics.max", stats.max);
+        h.set("frameStatistics.mean", stats.mean);
+        h.set("frameStatistics.stdDev", stats.stdDev);
+        h.set("frameStatistics.saturatedPixels", stats.saturatedPixels);
+        h.set("frameStatistics.histogramRange", std::vector<double>({stats.histogramMin, stats.histogramMax}));
+        h.set("frameStatistics.histogram", stats.histogram);
+        header.merge(h);
+
+        bool update = false;
+        {
+            boost::mutex::scoped_lock lock(m_analysisMtx);
+            m_lastMin = stats.min;
+            m_lastMax = stats.max;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now - m_statisticsUpdateTime >= std::chrono::milliseconds(period)) {
+                m_statisticsUpdateTime = now;
+                update = true;
+            }
+        }
+
+        if (update) {
+            this->set(h, timestamp);
+        }
+    }
+
+
+    void ImageSource::compute_beam_properties(const karabo::xms::ImageData& imageData, Hash& header,
+                                              const Timestamp& timestamp) {
+        double threshold, background;
+        unsigned int period;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_beamEnabled) {
+                return;
+            }
+            threshold = m_beamThreshold;
+            background = m_beamBackground;
+            period = m_beamPeriod;
+        }
+
+        const NDArray& arr = imageData.getData();
+        if (arr.getShape().rank() != 2) {
+            return; // Monochromatic images only
+        }
+
+        util::BeamProperties props;
+        try {
+            util::computeBeamProperties(arr, props, threshold, background);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not compute the beam properties: " << e.what();
+            return;
+        }
+
+        Hash h;
+        h.set("beamProperties.integral", props.integral);
+        h.set("beamProperties.centroidX", props.centroidX);
+        h.set("beamProperties.centroidY", props.centroidY);
+        h.set("beamProperties.sigmaX", props.sigmaX);
+        h.set("beamProperties.sigmaY", props.sigmaY);
+        h.set("beamProperties.sigmaXY", props.sigmaXY);
+        h.set("beamProperties.tilt", props.tilt);
+        h.set("beamProperties.projectionX", props.projectionX);
+        h.set("beamProperties.projectionY", props.projectionY);
+        header.merge(h);
+
+        bool update = false;
+        {
+            boost::mutex::scoped_lock lock(m_analysisMtx);
+            const auto now = std::chrono::steady_clock::now();
+            if (now - m_beamUpdateTime >= std::chrono::milliseconds(period)) {
+                m_beamUpdateTime = now;
+                update = true;
+            }
+        }
+
+        if (update) {
+            this->set(h, timestamp);
+        }
+    }
+
+
+    void ImageSource::find_spots(const karabo::xms::ImageData& imageData, Hash& header, const Timestamp& timestamp) {
+        double threshold;
+        unsigned int minArea, maxSpots, period;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_spotsEnabled) {
+                return;
+            }
+            threshold = m_spotThreshold;
+            minArea = m_spotMinArea;
+            maxSpots = m_maxSpots;
+            period = m_spotsPeriod;
+        }
+
+        const NDArray& arr = imageData.getData();
+        if (arr.getShape().rank() != 2) {
+            return; // Monochromatic images only
+        }
+
+        std::vector<util::Spot> spots;
+        size_t nSpots;
+        try {
+            nSpots = util::findSpots(arr, spots, threshold, minArea, maxSpots);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not find spots: " << e.what();
+            return;
+        }
+
+        // A compact table: one vector per column
+        std::vector<double> x, y, integral, peak;
+        std::vector<unsigned int> area;
+        x.reserve(spots.size());
+        y.reserve(spots.size());
+        integral.reserve(spots.size());
+        peak.reserve(spots.size());
+        area.reserve(spots.size());
+        for (const util::Spot& spot : spots) {
+            x.push_back(spot.x);
+            y.push_back(spot.y);
+            integral.push_back(spot.integral);
+            peak.push_back(spot.peak);
+            area.push_back(spot.area);
+        }
+
+        Hash h;
+        h.set("spotFinder.nSpots", static_cast<unsigned int>(nSpots));
+        h.set("spotFinder.x", x);
+        h.set("spotFinder.y", y);
+        h.set("spotFinder.integral", integral);
+        h.set("spotFinder.peak", peak);
+        h.set("spotFinder.area", area);
+        header.merge(h);
+
+        bool update = false;
+        {
+            boost::mutex::scoped_lock lock(m_analysisMtx);
+            const auto now = std::chrono::steady_clock::now();
+            if (now - m_spotsUpdateTime >= std::chrono::milliseconds(period)) {
+                m_spotsUpdateTime = now;
+                update = true;
+            }
+        }
+
+        if (update) {
+            this->set(h, timestamp);
+        }
+    }
+
+
+    Types::ReferenceType ImageSource::display_type(const std::vector<unsigned long long>& shape,
+                                                   const EncodingType& encoding, const Types::ReferenceType& kType) {
+        if (!isProcessable(shape, encoding) || (kType != Types::UINT8 && kType != Types::UINT16)) {
+            return kType;
+        }
+
+        boost::mutex::scoped_lock lock(m_processingMtx);
+        return m_lutEnabled ? Types::UINT8 : kType;
+    }
+
+
+    bool ImageSource::map_for_display(karabo::xms::ImageData& imageData, const Timestamp& timestamp) {
+        const NDArray& arr = imageData.getData();
+        const Types::ReferenceType kType = arr.getType();
+        if (!isProcessable(imageData.getDimensions().toVector(), imageData.getEncoding()) ||
+            (kType != Types::UINT8 && kType != Types::UINT16)) {
+            return false;
+        }
+
+        util::LutMode mode;
+        LutRange range;
+        double gamma, low, high, lowPercentile, highPercentile;
+        unsigned int step;
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_lutEnabled) {
+                return false;
+            }
+            mode = m_lutMode;
+            range = m_lutRange;
+            gamma = m_lutGamma;
+            low = m_windowMin;
+            high = m_windowMax;
+            lowPercentile = m_lowPercentile;
+            highPercentile = m_highPercentile;
+            step = m_lutStep;
+        }
+
+        bool publish = false;
+        try {
+            if (range == LutRange::BPP) {
+                const unsigned short bpp = imageData.getBitsPerPixel();
+                const unsigned int bits = (bpp > 0 && bpp <= 8 * arr.itemSize()) ? bpp : 8 * arr.itemSize();
+                low = 0.;
+                high = std::ldexp(1., bits) - 1.;
+            }
+
+            boost::mutex::scoped_lock lock(m_lutMtx);
+            bool windowChanged;
+            if (range == LutRange::PERCENTILE) {
+                util::percentileRange(arr, lowPercentile, highPercentile, low, high, step, m_lutHistogram);
+                // The window moves with the noise: ignore moves smaller than one output level
+                windowChanged = util::displayWindowMoved(m_lutLow, m_lutHigh, low, high);
+            } else {
+                windowChanged = (low != m_lutLow || high != m_lutHigh);
+            }
+
+            // The table is only rebuilt when the mapping changes
+            if (m_lut.empty() || windowChanged || mode != m_lutBuiltMode || gamma != m_lutBuiltGamma) {
+                util::buildDisplayLut(m_lut, low, high, mode, gamma);
+                m_lutLow = low;
+                m_lutHigh = high;
+                m_lutBuiltMode = mode;
+                m_lutBuiltGamma = gamma;
+
+                // Do not publish the window at frame rate, e.g. in PERCENTILE mode
+                const auto now = std::chrono::steady_clock::now();
+                if (now - m_lutUpdateTime >= std::chrono::seconds(1)) {
+                    m_lutUpdateTime = now;
+                    publish = true;
+                }
+            }
+            util::applyDisplayLut(imageData, m_lut);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not map the image for display: " << e.what();
+            return false;
+        }
+
+        if (publish) {
+            this->set("displayLut.window", std::vector<double>({low, high}), timestamp);
+        }
+
+        return true;
+    }
+
+
+    EncodingType ImageSource::output_encoding(const std::vector<unsigned long long>& shape,
+                                              const EncodingType& encoding, const Types::ReferenceType& kType) {
+        if (!isCompressible(shape, encoding, kType)) {
+            return encoding;
+        }
+
+        boost::mutex::scoped_lock lock(m_processingMtx);
+        return m_jpegEnabled ? Encoding::JPEG : encoding;
+    }
+
+
+    void ImageSource::compress_for_output(karabo::xms::ImageData& imageData, const Timestamp& timestamp) {
+        if (!isCompressible(imageData.getDimensions().toVector(), imageData.getEncoding(),
+                            imageData.getData().getType())) {
+            return;
+        }
+
+        {
+            boost::mutex::scoped_lock lock(m_processingMtx);
+            if (!m_jpegEnabled) {
+                return;
+            }
+        }
+
+        Hash properties;
+        {
+            boost::mutex::scoped_lock lock(m_jpegMtx);
+            try {
+                m_jpegController.encode(imageData);
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_DEBUG << "Could not encode the image: " << e.what();
+                return;
+            }
+
+            // Do not publish the parameters at frame rate
+            const auto now = std::chrono::steady_clock::now();
+            if (now - m_jpegUpdateTime >= std::chrono::seconds(1)) {
+                m_jpegUpdateTime = now;
+                properties.set("jpegCompression.quality", m_jpegController.quality());
+                properties.set("jpegCompression.downscale", m_jpegController.downscale());
+                properties.set("jpegCompression.bytesPerFrame", m_jpegController.bytesPerFrame());
+                properties.set("jpegCompression.bytesPerSecond", m_jpegController.bytesPerSecond());
+            }
+        }
+
+        if (!properties.empty()) {
+            this->set(properties, timestamp);
+        }
+    }
+
+
+    void ImageSource::processed_properties(std::vector<unsigned long long>& shape, const EncodingType& encoding,
+                                           Types::ReferenceType& kType) {
+        if (!isProcessable(shape, encoding)) {
+            return;
+        }
+
+        boost::mutex::scoped_lock lock(m_processingMtx);
+
+        if (m_flatFieldEnabled && m_flatFieldToFloat && util::FlatFieldCorrection::isSupported(kType)) {
+            kType = Types::FLOAT;
+        }
+
+        Dims roiOffsets, roiSize;
+        if (effectiveRoi(shape, m_roiOffsets, m_roiSize, roiOffsets, roiSize)) {
+            shape[0] = roiSize.x1();
+            shape[1] = roiSize.x2();
+        }
+
+        if ((m_binY > 1 || m_binX > 1) && shape[0] >= m_binY && shape[1] >= m_binX) {
+            shape[0] /= m_binY;
+            shape[1] /= m_binX;
+            kType = util::binnedType(kType, m_binningMode);
+        }
+
+        if (m_accumulationEnabled) {
+            kType = util::FrameAccumulator::accumulatedType(kType, m_accumulationMode);
+        }
+    }
+
+
+    void ImageSource::acquireDark() {
+        this->acquire_reference(util::FlatFieldCorrection::DARK);
+    }
+
+
+    void ImageSource::acquireFlat() {
+        this->acquire_reference(util::FlatFieldCorrection::FLAT);
+    }
+
+
+    void ImageSource::acquire_reference(util::FlatFieldCorrection::Reference reference) {
+        const unsigned int nFrames = this->get<unsigned int>("flatField.nFrames");
+        {
+            boost::mutex::scoped_lock lock(m_flatFieldMtx);
+            m_flatField.acquire(reference, nFrames);
+        }
+        this->set("flatField.acquiredFrames", 0u);
+    }
+
+
+    void ImageSource::resetFlatField() {
+        {
+            boost::mutex::scoped_lock lock(m_flatFieldMtx);
+            m_flatField.reset();
+        }
+        this->update_flat_field_status();
+    }
+
+
+    void ImageSource::saveFlatField() {
+        const std::string& filename = this->get<std::string>("flatField.referenceFile");
+        if (filename.empty()) {
+            throw KARABO_PARAMETER_EXCEPTION("The reference file is not set");
+        }
+
+        boost::mutex::scoped_lock lock(m_flatFieldMtx);
+        m_flatField.save(filename);
+        KARABO_LOG_FRAMEWORK_INFO << "Flat-field references saved to " << filename;
+    }
+
+
+    void ImageSource::loadFlatField() {
+        const std::string& filename = this->get<std::string>("flatField.referenceFile");
+        if (filename.empty()) {
+            throw KARABO_PARAMETER_EXCEPTION("The reference file is not set");
+        }
+
+        {
+            boost::mutex::scoped_lock lock(m_flatFieldMtx);
+            m_flatField.load(filename);
+        }
+        this->update_flat_field_status();
+        KARABO_LOG_FRAMEWORK_INFO << "Flat-field references loaded from " << filename;
+    }
+
+
+    void ImageSource::correct_flat_field(karabo::xms::ImageData& imageData, bool enabled, bool toFloat) {
+        bool completed = false;
+        unsigned int acquiredFrames = 0;
+        bool acquiring;
+
+        {
+            boost::mutex::scoped_lock lock(m_flatFieldMtx);
+
+            acquiring = m_flatField.isAcquiring();
+            if (acquiring) {
+                // The references are built from the raw frames
+                try {
+                    completed = m_flatField.addFrame(imageData.getData());
+                } catch (const std::exception& e) {
+                    KARABO_LOG_FRAMEWORK_DEBUG << "Could not acquire the flat-field reference: " << e.what();
+                }
+                acquiredFrames = m_flatField.acquiredFrames();
+            }
+
+            if (enabled && util::FlatFieldCorrection::isSupported(imageData.getData().getType())) {
+                try {
+                    if (m_flatField.matches(imageData.getDimensions()) ||
+                        !(m_flatField.hasDark() || m_flatField.hasFlat())) {
+                        m_flatField.apply(imageData, toFloat, &m_framePool);
+                    } else {
+                        KARABO_LOG_FRAMEWORK_DEBUG << "The image shape does not match the flat-field references";
+                        if (toFloat) {
+                            // The output type must match the schema
+                            util::FlatFieldCorrection().apply(imageData, toFloat, &m_framePool);
+                        }
+                    }
+                } catch (const std::exception& e) {
+                    KARABO_LOG_FRAMEWORK_DEBUG << "Could not correct the flat field: " << e.what();
+                }
+            }
+        }
+
+        if (acquiring) {
+            this->set("flatField.acquiredFrames", acquiredFrames);
+        }
+        if (completed) {
+            this->update_flat_field_status();
+        }
+    }
+
+
+    void ImageSource::detectBadPixels() {
+        const double nSigma = this->get<double>("badPixels.nSigma");
+
+        Dims shape;
+        std::vector<float> dark;
+        {
+            boost::mutex::scoped_lock lock(m_flatFieldMtx);
+            shape = m_flatField.shape();
+            dark = m_flatField.dark();
+        }
+        if (dark.empty()) {
+            throw KARABO_PARAMETER_EXCEPTION("No dark reference is available");
+        }
+
+        size_t nDefects;
+        {
+            boost::mutex::scoped_lock lock(m_badPixelMtx);
+            nDefects = m_badPixels.detect(shape, dark.data(), nSigma);
+        }
+        this->set("badPixels.nDefects", static_cast<unsigned int>(nDefects));
+        KARABO_LOG_FRAMEWORK_INFO << nDefects << " bad pixels detected";
+    }
+
+
+    void ImageSource::clearBadPixels() {
+        {
+            boost::mutex::scoped_lock lock(m_badPixelMtx);
+            m_badPixels.setDefects({});
+        }
+        this->set("badPixels.nDefects", 0u);
+    }
+
+
+    void ImageSource::saveBadPixels() {
+        const std::string& filename = this->get<std::string>("badPixels.file");
+        if (filename.empty()) {
+            throw KARABO_PARAMETER_EXCEPTION("The bad pixel file is not set");
+        }
+
+        boost::mutex::scoped_lock lock(m_badPixelMtx);
+        m_badPixels.save(filename);
+        KARABO_LOG_FRAMEWORK_INFO << "Bad pixels saved to " << filename;
+    }
+
+
+    void ImageSource::loadBadPixels() {
+        const std::string& filename = this->get<std::string>("badPixels.file");
+        if (filename.empty()) {
+            throw KARABO_PARAMETER_EXCEPTION("The bad pixel file is not set");
+        }
+
+        size_t nDefects;
+        {
+            boost::mutex::scoped_lock lock(m_badPixelMtx);
+            m_badPixels.load(filename);
+            nDefects = m_badPixels.defects().size();
+        }
+        this->set("badPixels.nDefects", static_cast<unsigned int>(nDefects));
+        KARABO_LOG_FRAMEWORK_INFO << nDefects << " bad pixels loaded from " << filename;
+    }
+
+
+    void ImageSource::patch_bad_pixels(karabo::xms::ImageData& imageData, const char* input, const Dims& roiOffsets,
+                                       unsigned int binY, unsigned int binX) {
+        {
+            boost::mutex::scoped_lock lock(m_badPixelMtx);
+            if (m_badPixels.defects().empty()) {
+                return;
+            }
+        }
+
+        NDArray arr = imageData.getData();
+        if (arr.getData<char>() == input) {
+            // No other processing step: the correction must not modify the input data, a pooled copy is patched.
+            // Otherwise the array created by the last step is patched in place.
+            NDArray copy = m_framePool.allocate(arr.getShape(), arr.getType());
+            std::memcpy(copy.getData<char>(), arr.getData<char>(), arr.byteSize());
+            arr = copy;
+        }
+
+        try {
+            boost::mutex::scoped_lock lock(m_badPixelMtx);
+            m_badPixels.apply(arr, roiOffsets, binY, binX);
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Could not correct the bad pixels: " << e.what();
+            return;
+        }
+
+        const Dims dims = arr.getShape();
+        imageData.setData(arr);
+        imageData.setDimensions(dims);
+    }
+
+
+    void ImageSource::update_flat_field_status() {
+        bool darkAvailable, flatAvailable;
+        {
+            boost::mutex::scoped_lock lock(m_flatFieldMtx);
+            darkAvailable = m_flatField.hasDark();
+            flatAvailable = m_flatField.hasFlat();
+        }
+        this->set(Hash("flatField.darkAvailable", darkAvailable, "flatField.flatAvailable", flatAvailable));
+    }
+
+
+    void util::unpackMono12Packed(const uint8_t* data, const uint32_t width, const uint32_t height,
+                                  uint16_t* unpackedData) {
+        size_t idx = 0, px = 0, image_size = width * height;
+        while (px + 1 < image_size) {
+            unpackedData[px] = (data[idx] << 4) | (data[idx + 1] & 0xF);
+            unpackedData[px + 1] = (data[idx + 2] << 4) | (data[idx + 1] >> 4);
+            idx += 3;
+            px += 2;
+        }
+    }
+
+
+    void util::unpackMonoXXp(const uint8_t* data, const uint32_t width, const uint32_t height, const uint8_t bpp,
+                             uint16_t* unpackedData) {
+        if (bpp < 9 || bpp > 15) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid bpp value: " + std::to_string(bpp) + ". It must be in [9, 15].");
+        }
+
+        const uint16_t mask = 0xFFFF >> (16 - bpp);
+        size_t bits = 0, px = 0, image_size = width * height;
+        while (px < image_size) {
+            const size_t idx = bits / 8;
+            const size_t shift = bits % 8;
+            unpackedData[px] = (*reinterpret_cast<const uint16_t*>(data + idx) >> shift) & mask;
+
+            bits += bpp;
+            px += 1;
+        }
+    }
+
+
+    void util::unpackMono10p(const uint8_t* data, const uint32_t width, const uint32_t height, uint16_t* unpackedData) {
+        util::unpackMonoXXp(data, width, height, 10, unpackedData);
+    }
+
+
+    void util::unpackMono12p(const uint8_t* data, const uint32_t width, const uint32_t height, uint16_t* unpackedData) {
+        util::unpackMonoXXp(data, width, height, 12, unpackedData);
     }
 
 
@@ -9,7 +9,34 @@
 #ifndef KARABO_IMAGESOURCE_HH
 #define KARABO_IMAGESOURCE_HH
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <karabo/karabo.hpp>
+
+#include "BadPixelCorrection.hh"
+#include "BeamProperties.hh"
+#include "ChangeDetector.hh"
+#include "ColorConversion.hh"
+#include "DisplayLut.hh"
+#include "FlatFieldCorrection.hh"
+#include "FrameAccumulator.hh"
+#include "FrameRecorder.hh"
+#include "FrameRing.hh"
+#include "FrameStack.hh"
+#include "FrameStatistics.hh"
+#include "ImageBinning.hh"
+#include "ImagePyramid.hh"
+#include "JpegCodec.hh"
+#include "JpegRateController.hh"
+#include "LatencyTrace.hh"
+#include "NumaPlacement.hh"
+#include "PropertySnapshot.hh"
+#include "SharedMemoryRing.hh"
+#include "SpotFinder.hh"
+#include "Thumbnail.hh"
 #include "version.hh" // provides IMAGESOURCE_PACKAGE_VERSION
 
 /**
@@ -17,6 +44,15 @@
  */
 namespace karabo {
 
+    /**
+     * @brief Base class for devices providing images.
+     *
+     * Before being written to the output channels, the images go through a software processing pipeline, which
+     * can be configured via the device properties (e.g. software ROI and binning). The output schema is updated
+     * accordingly.
+     *
+     * Derived classes overriding preReconfigure must call ImageSource::preReconfigure.
+     */
     class ImageSource : public karabo::core::Device<> {
 
     public:
@@ -32,6 +68,14 @@ namespace karabo {
         /**
          * @brief Update the device output schema according to the image properties.
          *
+         * The shape and type are those of the images passed to writeChannels: the effect of the software
+         * processing pipeline is taken into account here.
+         *
+         * It can be called before every writeChannels: if the image properties did not change, it returns without
+         * locking. Otherwise the schema is updated asynchronously - only the latest properties are applied, if they
+         * change again meanwhile - and writeChannels holds back the images with the new properties until it is.
+         * The reconfigurations of the software processing, e.g. of the ROI, update the schema the same way.
+         *
          * @param shape The shape of the image, e.g. (height, width) for monochromatic- or (height, width, channel) for
          * RGB-images .
          * @param encoding The encoding of the image, e.g. Encoding::GRAY or Encoding::RGB.
@@ -43,6 +87,10 @@ namespace karabo {
         /**
          * @brief Write the image and its metadata to the output channels.
          *
+         * The image is processed by the software pipeline, before being written. The input data are never
+         * modified. If frame accumulation is enabled, the frames completing an accumulation only are written.
+         * The images whose properties wait for an output schema update (see updateOutputSchema) are not written.
+         *
          * @param data The image data.
          * @param binning The image binning, e.g. (binY, binX).
          * @param bpp The pixel depth (bits-per-pixel).
@@ -57,22 +105,349 @@ namespace karabo {
                            const karabo::util::Hash& header);
 
 
+        /**
+         * @brief Restrict the calling thread to the CPUs configured in 'placement', and report its placement.
+         *
+         * To be called by the threads of derived classes, e.g. at the start of the acquisition thread. NB The
+         * software processing runs in writeChannels, i.e. in the thread calling it.
+         *
+         * @param role The thread role, e.g. "acquisition", as reported in 'placement.threads'.
+         */
+        void pinThread(const std::string& role);
+
+        /**
+         * @brief Allocate a frame from a pool of buffers placed as configured in 'placement', e.g. on the NUMA
+         * node of the acquisition thread and backed by hugepages. The content is undefined.
+         *
+         * The buffer returns to the pool when the last copy of the frame is destroyed.
+         *
+         * @param shape The frame shape.
+         * @param kType The frame type, e.g. Types::UINT16.
+         */
+        karabo::util::NDArray allocateFrame(const karabo::util::Dims& shape,
+                                            const karabo::util::Types::ReferenceType& kType);
+
+        /**
+         * @brief The memory placement configured in 'placement', e.g. for scratch buffers (see
+         * util::PlacedBuffer).
+         */
+        karabo::util::MemoryPolicy memoryPolicy();
+
+        /**
+         * @brief Return true if 'tracing' is enabled.
+         *
+         * Derived classes then trace the stages before writeChannels - e.g. acquisition, unpacking and orientation,
+         * see util::LatencyTrace - and attach the trace to the header passed to writeChannels, which appends the
+         * next stages to it.
+         */
+        bool tracingEnabled() const {
+            return m_tracingEnabled.load(std::memory_order_relaxed);
+        }
+
         /**
          * @brief Send an end-of-stream signal to 'output' and 'daqOutput' channels
          *
          */
         void signalEOS();
 
+        void preReconfigure(karabo::util::Hash& incomingReconfiguration) override;
+
     private:
         boost::mutex m_updateSchemaMtx; // Protect from concurrent updateOutputSchema calls
-        std::vector<unsigned long long> m_shape;
+        std::vector<unsigned long long> m_shape; // The output image properties
         int m_encoding;
         int m_kType;
+        int m_outputKType; // The type of the images written to 'output', e.g. after display mapping
+        int m_outputEncoding; // The encoding of the images written to 'output', e.g. after JPEG compression
+        unsigned int m_daqBurstDepth; // The number of frames stacked on 'daqOutput', zero if not stacked
+        std::vector<unsigned long long> m_inputShape; // The properties of the images passed to writeChannels
+        int m_inputEncoding;
+        int m_inputKType;
+        // A copy of m_inputShape, m_inputEncoding and m_inputKType, checked by updateOutputSchema without locking.
+        // It is published under m_updateSchemaMtx.
+        karabo::util::PropertySnapshot m_inputSnapshot;
+        // The output image properties, from m_shape to m_daqBurstDepth, checked by writeChannels without locking.
+        // It is published under m_updateSchemaMtx.
+        karabo::util::PropertySnapshot m_outputSnapshot;
+        unsigned long long m_schemaUpdates; // The number of schema updates applied
+        std::map<std::vector<unsigned long long>, karabo::util::Schema> m_schemaCache; // The schema updates built
+        std::deque<std::vector<unsigned long long>> m_schemaCacheKeys;                // In insertion order
+
+        boost::mutex m_pendingSchemaMtx; // Protect the image properties waiting for a schema update
+        std::vector<unsigned long long> m_pendingShape;
+        int m_pendingEncoding;
+        int m_pendingKType;
+        bool m_schemaUpdateRunning; // apply_schema_updates is posted or running
+        std::atomic<bool> m_schemaPending; // The schema does not match the latest properties yet
+        std::atomic<unsigned long long> m_heldBackFrames;
+        // Incremented by the configuration changes affecting the output schema, under m_processingMtx
+        std::atomic<unsigned long long> m_configGeneration;
+        std::atomic<unsigned long long> m_schemaGeneration; // The configuration generation of the output schema
+
+        boost::mutex m_processingMtx; // Protect the software processing configuration
+        karabo::util::Dims m_roiOffsets; // Software ROI, i.e. (roiY, roiX)
+        karabo::util::Dims m_roiSize;    // Software ROI, i.e. (height, width). Zero for full frame.
+        unsigned int m_binY;
+        unsigned int m_binX;
+        karabo::util::BinningMode m_binningMode;
+        bool m_flatFieldEnabled;
+        bool m_flatFieldToFloat;
+        bool m_badPixelsEnabled;
+        bool m_accumulationEnabled;
+        util::AccumulationMode m_accumulationMode;
+        unsigned int m_accumulationFrames;
+        bool m_burstEnabled;
+        unsigned int m_framesPerTrain;
+        unsigned int m_burstDepth; // zero if burst mode is disabled
+        bool m_changeDetectionEnabled;
+        double m_changeTolerance;
+        unsigned int m_changeStep;
+        unsigned int m_heartbeatPeriod; // ms
+        bool m_jpegEnabled;
+        bool m_pyramidEnabled;
+        std::array<unsigned int, 3> m_pyramidPeriods; // ms, for the 2x, 4x and 8x levels
+        bool m_thumbnailEnabled;
+        unsigned int m_thumbnailSize;
+        unsigned int m_thumbnailQuality;
+        unsigned int m_thumbnailPeriod; // ms
+        bool m_snapshotEnabled;
+        unsigned int m_snapshotFrames;
+        unsigned int m_postTriggerFrames;
+        bool m_snapshotToChannel; // otherwise to file
+        bool m_recorderEnabled;
+        std::string m_recorderFile;
+        bool m_statisticsEnabled;
+        unsigned int m_statisticsStep;
+        unsigned int m_statisticsBins;
+        double m_histogramMin;
+        double m_histogramMax;
+        double m_saturationLevel;
+        unsigned int m_statisticsPeriod; // [ms]
+        bool m_beamEnabled;
+        double m_beamThreshold;
+        double m_beamBackground;
+        unsigned int m_beamPeriod; // [ms]
+        bool m_spotsEnabled;
+        double m_spotThreshold;
+        unsigned int m_spotMinArea;
+        unsigned int m_maxSpots;
+        unsigned int m_spotsPeriod; // [ms]
+        enum class LutRange { BPP = 0, WINDOW, PERCENTILE };
+        bool m_lutEnabled;
+        util::LutMode m_lutMode;
+        double m_lutGamma;
+        LutRange m_lutRange;
+        double m_windowMin;
+        double m_windowMax;
+        double m_lowPercentile;
+        double m_highPercentile;
+        unsigned int m_lutStep;
+
+        boost::mutex m_analysisMtx; // Protect the image analysis state
+        double m_lastMin; // min and max of the previous frame
+        double m_lastMax;
+        std::chrono::steady_clock::time_point m_statisticsUpdateTime;
+        std::chrono::steady_clock::time_point m_beamUpdateTime;
+        std::chrono::steady_clock::time_point m_spotsUpdateTime;
+
+        boost::mutex m_lutMtx; // Protect the display look-up table
+        std::vector<uint8_t> m_lut;
+        std::vector<unsigned int> m_lutHistogram; // kept zeroed, for PERCENTILE mode
+        double m_lutLow; // the parameters m_lut was built with
+        double m_lutHigh;
+        util::LutMode m_lutBuiltMode;
+        double m_lutBuiltGamma;
+        std::chrono::steady_clock::time_point m_lutUpdateTime;
+
+        boost::mutex m_flatFieldMtx; // Protect the flat-field references
+        karabo::util::FlatFieldCorrection m_flatField;
+
+        boost::mutex m_accumulatorMtx; // Protect the frame accumulator
+        karabo::util::FrameAccumulator m_accumulator;
+
+        boost::mutex m_changeMtx; // Protect the change detection state
+        karabo::util::ChangeDetector m_changeDetector;
+        unsigned long long m_suppressedFrames;
+        std::chrono::steady_clock::time_point m_lastWriteTime; // The last time a frame was written to 'output'
+        std::chrono::steady_clock::time_point m_changeUpdateTime;
+
+        boost::mutex m_jpegMtx; // Protect the JPEG compression state
+        karabo::util::JpegRateController m_jpegController;
+        double m_jpegBudget; // The parameters of m_jpegController
+        karabo::util::RateBudget m_jpegBudgetUnit;
+        unsigned int m_jpegMinQuality;
+        unsigned int m_jpegMaxQuality;
+        unsigned int m_jpegMaxDownscale;
+        std::chrono::steady_clock::time_point m_jpegUpdateTime;
+
+        boost::mutex m_pyramidMtx; // Protect the pyramid write times
+        std::array<std::chrono::steady_clock::time_point, 3> m_pyramidWriteTimes;
+
+        boost::mutex m_thumbnailMtx; // Protect the thumbnail state
+        bool m_thumbnailPending; // A thumbnail is being encoded
+        std::chrono::steady_clock::time_point m_thumbnailTime;
+
+        boost::mutex m_ringMtx; // Protect the snapshot ring
+        karabo::util::FrameRing m_ring;
+        unsigned long long m_triggerTrainId;
+        boost::mutex m_snapshotThreadMtx; // Protect m_snapshotThread
+        boost::thread m_snapshotThread;   // Writes the frozen ring, not to block the event loop with file I/O
+
+        boost::mutex m_recorderMtx; // Protect the raw frame recorder
+        karabo::util::FrameRecorder m_recorder;
+        std::chrono::steady_clock::time_point m_recorderUpdateTime;
+
+        boost::mutex m_sharedMemoryMtx; // Protect the shared memory ring and its configuration
+        bool m_sharedMemoryEnabled;
+        std::string m_sharedMemoryName; // Empty for a name derived from the device ID
+        unsigned int m_sharedMemorySlots;
+        karabo::util::SharedMemoryRing m_sharedMemoryRing;
+        unsigned long long m_sharedFrames;
+        unsigned long long m_droppedSharedFrames;
+        std::chrono::steady_clock::time_point m_sharedMemoryUpdateTime;
+
+        std::atomic<bool> m_tracingEnabled;
+        boost::mutex m_tracingMtx; // Protect the latency histograms
+        karabo::util::LatencyHistogram m_latencies;
+        std::chrono::steady_clock::time_point m_tracingUpdateTime;
+
+        boost::mutex m_placementMtx; // Protect the thread and memory placement
+        std::string m_placementCpus; // The configured CPU list, empty for the CPUs of m_memoryPolicy.numaNode
+        std::vector<int> m_pinnedCpus; // The CPUs the threads are pinned to, empty for no pinning
+        karabo::util::MemoryPolicy m_memoryPolicy;
+        std::map<std::string, std::string> m_threadPlacement; // The placement per thread role
+        std::chrono::steady_clock::time_point m_placementUpdateTime;
+        karabo::util::FramePool m_framePool;
+
+        boost::mutex m_frameStackMtx; // Protect the burst mode stack
+        karabo::util::FrameStack m_frameStack;
+
+        boost::mutex m_badPixelMtx; // Protect the bad pixel list
+        karabo::util::BadPixelCorrection m_badPixels;
+
+        void initializeImageSource();
+
+        void acquireDark();
+
+        void acquireFlat();
+
+        void resetFlatField();
+
+        void saveFlatField();
+
+        void loadFlatField();
+
+        void detectBadPixels();
+
+        void clearBadPixels();
+
+        void saveBadPixels();
+
+        void loadBadPixels();
+
+        void triggerSnapshot();
+
+        void acquire_reference(karabo::util::FlatFieldCorrection::Reference reference);
+
+        void correct_flat_field(karabo::xms::ImageData& imageData, bool enabled, bool toFloat);
+
+        void update_flat_field_status();
+
+        void patch_bad_pixels(karabo::xms::ImageData& imageData, const char* input,
+                              const karabo::util::Dims& roiOffsets, unsigned int binY, unsigned int binX);
+
+        void update_output_schema();
+
+        karabo::util::Schema build_schema_update(const std::vector<unsigned long long>& shape,
+                                                 const karabo::xms::EncodingType& encoding,
+                                                 const karabo::util::Types::ReferenceType& kType,
+                                                 const karabo::util::Types::ReferenceType& outputKType,
+                                                 const karabo::xms::EncodingType& outputEncoding,
+                                                 unsigned int burstDepth);
+
+        void request_schema_update();
+
+        void apply_schema_updates();
+
+        void publish_output();
+
+        bool is_input_held_back(const karabo::util::NDArray& data, const karabo::xms::EncodingType& encoding);
+
+        bool is_output_held_back(const karabo::xms::ImageData& imageData);
+
+        void configure_processing(const karabo::util::Hash& config);
+
+        void process_image(karabo::xms::ImageData& imageData);
+
+        bool accumulate_image(karabo::xms::ImageData& imageData, unsigned int& accumulatedFrames);
+
+        bool is_unchanged(const karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp);
+
+        void update_thumbnail(const karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp);
+
+        void encode_thumbnail(karabo::xms::ImageData thumbnail, unsigned int quality,
+                              const karabo::util::Timestamp& timestamp);
+
+        void record_frame(const karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp);
+
+        void start_snapshot_dump(unsigned long long trainId);
+
+        void dump_snapshot(unsigned long long trainId);
+
+        void record_raw(const karabo::util::NDArray& data, const karabo::util::Dims& binning,
+                        const unsigned short bpp, const karabo::xms::EncodingType& encoding,
+                        const karabo::util::Dims& roiOffsets, const karabo::util::Timestamp& timestamp,
+                        const karabo::util::Hash& header);
+
+        void share_frame(const karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp,
+                         karabo::util::LatencyTrace& trace);
+
+        void trace_image(karabo::xms::ImageData& imageData, karabo::util::LatencyTrace& trace,
+                         const karabo::util::TraceStage& stage);
+
+        void aggregate_trace(const karabo::util::LatencyTrace& trace, const karabo::util::Timestamp& timestamp);
+
+        void write_pyramid(const karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp);
+
+        bool stack_frame(const karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp);
+
+        void write_stack();
+
+        void analyze_image(const karabo::xms::ImageData& imageData, karabo::util::Hash& header,
+                           const karabo::util::Timestamp& timestamp);
+
+        void compute_statistics(const karabo::xms::ImageData& imageData, karabo::util::Hash& header,
+                                const karabo::util::Timestamp& timestamp);
+
+        void compute_beam_properties(const karabo::xms::ImageData& imageData, karabo::util::Hash& header,
+                                     const karabo::util::Timestamp& timestamp);
+
+        void find_spots(const karabo::xms::ImageData& imageData, karabo::util::Hash& header,
+                        const karabo::util::Timestamp& timestamp);
+
+        karabo::util::Types::ReferenceType display_type(const std::vector<unsigned long long>& shape,
+                                                        const karabo::xms::EncodingType& encoding,
+                                                        const karabo::util::Types::ReferenceType& kType);
+
+        bool map_for_display(karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp);
+
+        karabo::xms::EncodingType output_encoding(const std::vector<unsigned long long>& shape,
+                                                  const karabo::xms::EncodingType& encoding,
+                                                  const karabo::util::Types::ReferenceType& kType);
+
+        void compress_for_output(karabo::xms::ImageData& imageData, const karabo::util::Timestamp& timestamp);
+
+        void processed_properties(std::vector<unsigned long long>& shape, const karabo::xms::EncodingType& encoding,
+                                  karabo::util::Types::ReferenceType& kType);
+
+        bool is_current_input(const std::vector<unsigned long long>& shape, int encoding, int kType) const;
+
+        void publish_input();
 
         void schema_update_helper(karabo::util::Schema& schemaUpdate, const std::string& nodeKey,
                                   const std::string& displayedName, const std::vector<unsigned long long>& shape,
                                   const karabo::xms::EncodingType& encoding,
-                                  const karabo::util::Types::ReferenceType& kType);
+                                  const karabo::util::Types::ReferenceType& kType, bool burst = false);
     };
 
     namespace util {
@@ -147,23 +522,6 @@ namespace karabo {
         void unpackMono10p(const uint8_t* data, const uint32_t width, const uint32_t height, uint16_t* unpackedData);
         void unpackMono12p(const uint8_t* data, const uint32_t width, const uint32_t height, uint16_t* unpackedData);
 
-        /**
-         * @brief Decode a JPEG image to GRAY.
-         *
-         * @param imd The ImageData object - encoded as JPEG - to be decoded as GRAY
-         */
-        void decodeJPEG(karabo::xms::ImageData& imd);
-
-        /**
-         * @brief Encode a GRAY image to JPEG.
-         *
-         * @param imd The ImageData object - encoded as JPEG - to be decoded as GRAY
-         * @param quality The compression quality. Levels of 90% or higher are considered "high
-         * quality", 80-90% is "medium quality", 70-80% is "low quality".
-         * @param comment An optional comment to be added to the JPEG image. Its maximum length is 65533 Bytes.
-         */
-        void encodeJPEG(karabo::xms::ImageData& imd, unsigned int quality = 100, const std::string& comment = "");
-
         /**
          * @brief Rotate an image by 90, 180 or 270 degrees.
          *
@@ -0,0 +1,166 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <memory>
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+#include "JpegCodec.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    void util::decodeJPEG(karabo::xms::ImageData& imd) {
+        // The array which we assign the decoded JPEG stream to
+        NDArray ndarr(imd.getDimensions(), Types::UINT8);
+
+        NDArray& arr = const_cast<NDArray&>(imd.getData()); // from 2.12 on, can remove the `const_cast`
+        unsigned char* cdata = arr.getData<unsigned char>();
+        struct jpeg_decompress_struct cinfo;
+        struct jpeg_error_mgr jerr;
+
+        const unsigned long jpg_size = arr.byteSize();
+
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_decompress(&cinfo);
+
+        // We can directly source the data, but need to const_cast here as cdata is returned as const.
+        // This is not a problem though, as we create and assign a new NDarray to the image data
+        // object in the process of conversion.
+        jpeg_mem_src(&cinfo, cdata, jpg_size);
+
+        // Test if this is a valid JPEG before we fail miserably
+        const int rc = jpeg_read_header(&cinfo, TRUE);
+
+        if (rc != 1) {
+            throw KARABO_PARAMETER_EXCEPTION("Image advertised as JPEG, but does not seem to be JPEG data");
+        }
+        jpeg_start_decompress(&cinfo);
+        const int width = cinfo.output_width;
+        const int pixel_size = cinfo.output_components;
+
+        // We directly read into the NDArray to avoid further copies
+        unsigned char* bmp_buffer = ndarr.getData<unsigned char>();
+
+        // The row_stride is the total number of bytes it takes to store an
+        // entire scanline (row).
+        const int row_stride = width * pixel_size;
+
+        while (cinfo.output_scanline < cinfo.output_height) {
+            unsigned char* buffer_array[1];
+            buffer_array[0] = bmp_buffer + cinfo.output_scanline * row_stride;
+            jpeg_read_scanlines(&cinfo, buffer_array, 1);
+        }
+
+        // Clean up
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+
+        // Karabo-ize our data.
+        // Any raw pointer referenced to previous NDarray data
+        // of imd have been destroyed at this point.
+        imd.setData(ndarr);
+        imd.setEncoding(Encoding::GRAY);
+    }
+
+
+    void util::encodeJPEG(karabo::xms::ImageData& imd, unsigned int quality, const std::string& comment) {
+        NDArray& arr = const_cast<NDArray&>(imd.getData()); // from 2.12 on, can remove the `const_cast`
+
+        const Types::ReferenceType kType = arr.getType();
+        std::shared_ptr<unsigned char[]> sdata;
+        if (kType == Types::UINT8) {
+            sdata = std::shared_ptr<unsigned char[]>(arr.getData<unsigned char>(), [](unsigned char* p) {});
+        } else if (kType == Types::UINT16) {
+            const size_t pixels = arr.size();
+            sdata = std::shared_ptr<unsigned char[]>(new unsigned char[pixels]);
+            const unsigned short* ldata = arr.getData<unsigned short>();
+
+            if (arr.isBigEndian()) {
+                for (size_t i = 0; i < pixels; ++i) {
+                    sdata[i] = ldata[i] & 0xFF; // MSB is 0
+                }
+            } else {
+                for (size_t i = 0; i < pixels; ++i) {
+                    sdata[i] = ldata[i] >> 8; // MSB is 1
+                }
+            }
+        } else {
+            throw KARABO_PARAMETER_EXCEPTION("Conversion from Type " + toString(kType) + " is not implemented.");
+        }
+
+        struct jpeg_compress_struct cinfo;
+        struct jpeg_error_mgr jerr;
+
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_compress(&cinfo);
+
+        const int encoding = imd.getEncoding();
+        switch (encoding) {
+            case Encoding::GRAY:
+                cinfo.input_components = 1;
+                cinfo.in_color_space = JCS_GRAYSCALE;
+                break;
+            case Encoding::RGB:
+                cinfo.input_components = 3;
+                cinfo.in_color_space = JCS_RGB;
+                break;
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Conversion from " + toString(encoding)
+                                                 + " to JPEG is not implemented.");
+        }
+
+        const Dims& dims = imd.getDimensions();
+        cinfo.image_width = dims.x2();
+        cinfo.image_height = dims.x1();
+
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, quality, TRUE);
+
+        // Instruct libjpeg to encode to memory.
+        // The library will allocate the memory.
+        unsigned char* jpeg_buffer = nullptr;
+        unsigned long jpeg_size;
+        jpeg_mem_dest(&cinfo, &jpeg_buffer, &jpeg_size);
+
+        jpeg_start_compress(&cinfo, TRUE);
+
+        // Add comment section if any
+        if (comment.size() > 0) {
+            // The comment can be (0xFF-2) Bytes long. Truncate if longer.
+            const size_t commentSize = std::min<size_t>(65533, comment.size());
+            jpeg_write_marker(&cinfo, JPEG_COM, (const JOCTET*)comment.data(), commentSize);
+        }
+
+        // The row_stride is the total number of bytes it takes to store an
+        // entire scanline (row).
+        const int row_stride = cinfo.input_components * cinfo.image_width;
+
+        while (cinfo.next_scanline < cinfo.image_height) {
+            unsigned char* buffer_array[1];
+            buffer_array[0] = sdata.get() + cinfo.next_scanline * row_stride;
+            jpeg_write_scanlines(&cinfo, buffer_array, 1);
+        }
+
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        // Karabo-ize our data.
+        NDArray ndarr(jpeg_buffer, jpeg_size);
+        imd.setData(ndarr);
+        imd.setEncoding(Encoding::JPEG);
+        imd.setDimensions(dims);
+    }
+
+} // namespace karabo
@@ -0,0 +1,38 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_JPEGCODEC_HH
+#define KARABO_JPEGCODEC_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Decode a JPEG image to GRAY.
+         *
+         * @param imd The ImageData object - encoded as JPEG - to be decoded as GRAY
+         */
+        void decodeJPEG(karabo::xms::ImageData& imd);
+
+        /**
+         * @brief Encode a GRAY image to JPEG.
+         *
+         * @param imd The ImageData object - encoded as JPEG - to be decoded as GRAY
+         * @param quality The compression quality. Levels of 90% or higher are considered "high
+         * quality", 80-90% is "medium quality", 70-80% is "low quality".
+         * @param comment An optional comment to be added to the JPEG image. Its maximum length is 65533 Bytes.
+         */
+        void encodeJPEG(karabo::xms::ImageData& imd, unsigned int quality = 100, const std::string& comment = "");
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ImageBinning.hh"
+#include "JpegCodec.hh"
+#include "JpegRateController.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        const double AVERAGING_FACTOR = 0.2; // of the moving averages
+
+        // Frames within [LOW_RATIO, 1] of the target size do not change the parameters
+        const double LOW_RATIO = 0.8;
+
+        // Downscaling by 2 reduces the size by roughly 3: upscale only if the frames are well below the target
+        const double UPSCALE_RATIO = 0.25;
+
+    } // namespace
+
+
+    util::JpegRateController::JpegRateController()
+        : m_budget(1.e6),
+          m_unit(RateBudget::BYTES_PER_SECOND),
+          m_minQuality(20),
+          m_maxQuality(95),
+          m_maxDownscale(1),
+          m_quality(95),
+          m_downscale(1),
+          m_bytesPerFrame(0.),
+          m_interval(0.),
+          m_hasLastTime(false) {}
+
+
+    void util::JpegRateController::configure(double budget, RateBudget unit, unsigned int minQuality,
+                                             unsigned int maxQuality, unsigned int maxDownscale) {
+        validate(budget, minQuality, maxQuality, maxDownscale);
+
+        m_budget = budget;
+        m_unit = unit;
+        m_minQuality = minQuality;
+        m_maxQuality = maxQuality;
+        m_maxDownscale = maxDownscale;
+        this->reset();
+    }
+
+
+    void util::JpegRateController::validate(double budget, unsigned int minQuality, unsigned int maxQuality,
+                                            unsigned int maxDownscale) {
+        if (!(budget > 0.)) {
+            throw KARABO_PARAMETER_EXCEPTION("The compression budget must be positive");
+        }
+
+        if (minQuality < 1 || maxQuality > 100 || minQuality > maxQuality) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid JPEG quality range [" + toString(minQuality) + ", " +
+                                             toString(maxQuality) + "]");
+        }
+
+        if (maxDownscale != 1 && maxDownscale != 2 && maxDownscale != 4 && maxDownscale != 8) {
+            throw KARABO_PARAMETER_EXCEPTION("The maximum downscale factor must be 1, 2, 4 or 8");
+        }
+    }
+
+
+    void util::JpegRateController::reset() {
+        m_quality = m_maxQuality;
+        m_downscale = 1;
+        m_bytesPerFrame = 0.;
+        m_interval = 0.;
+        m_hasLastTime = false;
+    }
+
+
+    void util::JpegRateController::encode(karabo::xms::ImageData& imd, const std::string& comment) {
+        if (m_downscale > 1) {
+            const Dims shape = imd.getDimensions();
+            // Do not downscale below 1 pixel
+            const unsigned int factor =
+                  std::min<unsigned long long>(m_downscale, std::min(shape.x1(), shape.x2()));
+            if (factor > 1) {
+                util::binImage(imd, factor, factor, BinningMode::MEAN);
+            }
+        }
+
+        util::encodeJPEG(imd, m_quality, comment);
+        this->update(imd.getData().byteSize(), std::chrono::steady_clock::now());
+    }
+
+
+    void util::JpegRateController::update(size_t bytes, std::chrono::steady_clock::time_point now) {
+        if (m_hasLastTime) {
+            const double interval = std::chrono::duration<double>(now - m_lastTime).count();
+            m_interval = (m_interval > 0.) ? m_interval + AVERAGING_FACTOR * (interval - m_interval) : interval;
+        }
+        m_lastTime = now;
+        m_hasLastTime = true;
+
+        m_bytesPerFrame =
+              (m_bytesPerFrame > 0.) ? m_bytesPerFrame + AVERAGING_FACTOR * (bytes - m_bytesPerFrame) : bytes;
+
+        double target = m_budget;
+        if (m_unit == RateBudget::BYTES_PER_SECOND) {
+            if (!(m_interval > 0.)) {
+                return; // The frame rate is not known yet
+            }
+            target *= m_interval;
+        }
+
+        // Control on the last frame, for a quick reaction to scene changes
+        const double ratio = std::max(static_cast<double>(bytes), 1.) / target;
+        const double log2Ratio = std::log2(ratio);
+        int quality = m_quality;
+        if (ratio > 1.) {
+            // Too large: fast decrease
+            if (quality == static_cast<int>(m_minQuality) && m_downscale < m_maxDownscale) {
+                m_downscale *= 2;
+                quality = (m_minQuality + m_maxQuality) / 2;
+            } else {
+                quality -= std::min(static_cast<int>(std::ceil(10. * log2Ratio)), 20);
+            }
+        } else if (ratio < UPSCALE_RATIO && quality == static_cast<int>(m_maxQuality) && m_downscale > 1) {
+            m_downscale /= 2;
+            quality = (m_minQuality + m_maxQuality) / 2;
+        } else if (ratio < LOW_RATIO) {
+            // Well below the target: slow increase
+            quality += std::min(static_cast<int>(std::ceil(-3. * log2Ratio)), 5);
+        }
+
+        m_quality = std::min(std::max(quality, static_cast<int>(m_minQuality)), static_cast<int>(m_maxQuality));
+    }
+
+} // namespace karabo
@@ -0,0 +1,133 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_JPEGRATECONTROLLER_HH
+#define KARABO_JPEGRATECONTROLLER_HH
+
+#include <chrono>
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief The unit of the JPEG compression budget.
+         */
+        enum class RateBudget {
+            BYTES_PER_SECOND = 0,
+            BYTES_PER_FRAME
+        };
+
+        /**
+         * @brief JPEG encoding within a bandwidth budget.
+         *
+         * The quality is adjusted frame by frame from the size of the encoded frames: it is decreased quickly
+         * when a frame exceeds the budget, and increased slowly when the frames are well below it. If the budget
+         * cannot be met at the minimum quality, the images are also downscaled - by averaging 2x2, 4x4 or 8x8
+         * pixels - and upscaled back when there is enough headroom at the maximum quality.
+         *
+         * For a budget in bytes per second, the frame rate is estimated from the time between the frames.
+         *
+         * The class is not thread-safe.
+         */
+        class JpegRateController {
+           public:
+            JpegRateController();
+
+            /**
+             * @brief Set the budget and the control range. The control is restarted.
+             *
+             * @param budget The budget, in bytes per second or per frame. It must be positive.
+             * @param unit The unit of the budget.
+             * @param minQuality The minimum JPEG quality, in [1, 100].
+             * @param maxQuality The maximum JPEG quality, in [minQuality, 100].
+             * @param maxDownscale The maximum downscale factor: 1 (no downscaling), 2, 4 or 8.
+             * @throw KARABO_PARAMETER_EXCEPTION if the parameters are invalid (see validate).
+             */
+            void configure(double budget, RateBudget unit, unsigned int minQuality, unsigned int maxQuality,
+                           unsigned int maxDownscale = 1);
+
+            /**
+             * @brief Check the parameters of configure, without applying them.
+             *
+             * @throw KARABO_PARAMETER_EXCEPTION if they are invalid.
+             */
+            static void validate(double budget, unsigned int minQuality, unsigned int maxQuality,
+                                 unsigned int maxDownscale);
+
+            /**
+             * @brief Restart the control from the maximum quality and no downscaling.
+             */
+            void reset();
+
+            /**
+             * @brief Downscale and encode an image with the current parameters, then update them from the size
+             * of the encoded image.
+             *
+             * @param imd The ImageData object - to be encoded. See encodeJPEG for the supported images. If it is
+             * downscaled, its binning is updated.
+             * @param comment An optional comment to be added to the JPEG image.
+             */
+            void encode(karabo::xms::ImageData& imd, const std::string& comment = "");
+
+            /**
+             * @brief Update the parameters from the size of an encoded frame.
+             *
+             * @param bytes The size of the encoded frame.
+             * @param now The time the frame was encoded at.
+             */
+            void update(size_t bytes, std::chrono::steady_clock::time_point now);
+
+            /**
+             * @brief The JPEG quality for the next frame.
+             */
+            unsigned int quality() const {
+                return m_quality;
+            }
+
+            /**
+             * @brief The downscale factor for the next frame.
+             */
+            unsigned int downscale() const {
+                return m_downscale;
+            }
+
+            /**
+             * @brief The average size of the encoded frames.
+             */
+            double bytesPerFrame() const {
+                return m_bytesPerFrame;
+            }
+
+            /**
+             * @brief The average rate of the encoded frames. Zero if unknown.
+             */
+            double bytesPerSecond() const {
+                return (m_interval > 0.) ? m_bytesPerFrame / m_interval : 0.;
+            }
+
+           private:
+            double m_budget;
+            RateBudget m_unit;
+            unsigned int m_minQuality;
+            unsigned int m_maxQuality;
+            unsigned int m_maxDownscale;
+
+            unsigned int m_quality;
+            unsigned int m_downscale;
+            double m_bytesPerFrame; // moving averages
+            double m_interval;      // [s]
+            bool m_hasLastTime;
+            std::chrono::steady_clock::time_point m_lastTime;
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
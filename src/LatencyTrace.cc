@@ -0,0 +1,211 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#include "LatencyTrace.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        const unsigned char TRACE_VERSION = 1;
+        const unsigned int MAX_VARINT_BYTES = 10; // 64 bits, 7 per byte
+
+
+        void putVarint(std::vector<unsigned char>& bytes, unsigned long long value) {
+            while (value >= 0x80) {
+                bytes.push_back(static_cast<unsigned char>(value | 0x80));
+                value >>= 7;
+            }
+            bytes.push_back(static_cast<unsigned char>(value));
+        }
+
+
+        bool getVarint(const std::vector<unsigned char>& bytes, size_t& pos, unsigned long long& value) {
+            value = 0;
+            for (unsigned int i = 0; i < MAX_VARINT_BYTES && pos < bytes.size(); ++i) {
+                const unsigned char byte = bytes[pos++];
+                value |= static_cast<unsigned long long>(byte & 0x7f) << (7 * i);
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+
+        std::string formatMs(double us) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.3g ms", 1.e-3 * us);
+            return buffer;
+        }
+
+    } // namespace
+
+
+    const char* util::LatencyTrace::HEADER_KEY = "trace";
+
+
+    std::string util::traceStageName(unsigned char stage) {
+        switch (static_cast<TraceStage>(stage)) {
+            case TraceStage::ACQUIRED:
+                return "acquired";
+            case TraceStage::UNPACKED:
+                return "unpacked";
+            case TraceStage::ORIENTED:
+                return "oriented";
+            case TraceStage::SUBMITTED:
+                return "submitted";
+            case TraceStage::PROCESSED:
+                return "processed";
+            case TraceStage::ENCODED:
+                return "encoded";
+            case TraceStage::OUTPUT:
+                return "output";
+            case TraceStage::DAQ_OUTPUT:
+                return "daqOutput";
+            case TraceStage::SHM_OUTPUT:
+                return "shmOutput";
+            case TraceStage::TOTAL:
+                return "total";
+            default:
+                return "stage " + std::to_string(stage);
+        }
+    }
+
+
+    void util::LatencyTrace::mark(TraceStage stage, const std::chrono::steady_clock::time_point& time) {
+        const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch());
+        m_marks.emplace_back(static_cast<unsigned char>(stage), nanoseconds.count());
+    }
+
+
+    void util::LatencyTrace::mark(unsigned char stage, unsigned long long nanoseconds) {
+        m_marks.emplace_back(stage, nanoseconds);
+    }
+
+
+    std::vector<unsigned char> util::LatencyTrace::encode() const {
+        std::vector<unsigned char> bytes;
+        bytes.reserve(1 + m_marks.size() * 5 + 8);
+        bytes.push_back(TRACE_VERSION);
+        unsigned long long previous = 0;
+        for (const Mark& mark : m_marks) {
+            bytes.push_back(mark.first);
+            // NB The marks are in time order, but a mark before the previous one is encoded as simultaneous
+            putVarint(bytes, mark.second > previous ? mark.second - previous : 0);
+            previous = std::max(previous, mark.second);
+        }
+        return bytes;
+    }
+
+
+    util::LatencyTrace util::LatencyTrace::decode(const std::vector<unsigned char>& bytes) {
+        if (bytes.empty() || bytes[0] != TRACE_VERSION) {
+            throw KARABO_PARAMETER_EXCEPTION("Not a latency trace, or an unsupported version");
+        }
+
+        LatencyTrace trace;
+        unsigned long long time = 0;
+        size_t pos = 1;
+        while (pos < bytes.size()) {
+            const unsigned char stage = bytes[pos++];
+            unsigned long long delta;
+            if (!getVarint(bytes, pos, delta)) {
+                throw KARABO_PARAMETER_EXCEPTION("Truncated latency trace");
+            }
+            time += delta;
+            trace.mark(stage, time);
+        }
+        return trace;
+    }
+
+
+    void util::LatencyTrace::attach(Hash& header) const {
+        header.set(HEADER_KEY, this->encode());
+    }
+
+
+    bool util::LatencyTrace::extract(const Hash& header, LatencyTrace& trace) {
+        if (!header.has(HEADER_KEY)) {
+            return false;
+        }
+        try {
+            trace = decode(header.get<std::vector<unsigned char>>(HEADER_KEY));
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_DEBUG << "Invalid latency trace: " << e.what();
+            return false;
+        }
+        return true;
+    }
+
+
+    double util::LatencyHistogram::binEdge(unsigned int bin) {
+        return bin + 1 < BINS ? std::ldexp(1., bin) : std::numeric_limits<double>::infinity();
+    }
+
+
+    double util::LatencyHistogram::Stage::percentile(double percent) const {
+        const double rank = 0.01 * percent * count;
+        unsigned long long cumulated = 0;
+        for (unsigned int bin = 0; bin < BINS; ++bin) {
+            cumulated += counts[bin];
+            if (cumulated > 0 && cumulated >= rank) {
+                return std::min(binEdge(bin), max);
+            }
+        }
+        return max;
+    }
+
+
+    void util::LatencyHistogram::add(const LatencyTrace& trace) {
+        const std::vector<LatencyTrace::Mark>& marks = trace.marks();
+        if (marks.empty()) {
+            return;
+        }
+
+        auto count = [this](unsigned char stage, unsigned long long from, unsigned long long to) {
+            const double us = to > from ? 1.e-3 * (to - from) : 0.;
+            unsigned int bin = 0;
+            while (bin + 1 < BINS && us >= binEdge(bin)) {
+                ++bin;
+            }
+            Stage& s = m_stages[stage];
+            ++s.counts[bin];
+            ++s.count;
+            s.sum += us;
+            s.max = std::max(s.max, us);
+        };
+
+        for (size_t i = 1; i < marks.size(); ++i) {
+            count(marks[i].first, marks[i - 1].second, marks[i].second);
+        }
+        count(static_cast<unsigned char>(TraceStage::TOTAL), marks.front().second, marks.back().second);
+    }
+
+
+    std::vector<std::string> util::LatencyHistogram::summary() const {
+        std::vector<std::string> lines;
+        for (const auto& stage : m_stages) {
+            const Stage& s = stage.second;
+            lines.push_back(traceStageName(stage.first) + ": " + std::to_string(s.count) + " frames, mean " +
+                            formatMs(s.mean()) + ", median <= " + formatMs(s.percentile(50.)) + ", 99% <= " +
+                            formatMs(s.percentile(99.)) + ", max " + formatMs(s.max));
+        }
+        return lines;
+    }
+
+} // namespace karabo
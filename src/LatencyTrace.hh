@@ -0,0 +1,172 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_LATENCYTRACE_HH
+#define KARABO_LATENCYTRACE_HH
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief The points of the pipeline a frame is traced at.
+         *
+         * Downstream devices may mark their own stages, from USER on.
+         */
+        enum class TraceStage : unsigned char {
+            ACQUIRED = 0,   // The frame was read out of the camera
+            UNPACKED = 1,   // The pixels were unpacked, or copied, to the frame
+            ORIENTED = 2,   // The frame was rotated and/or flipped
+            SUBMITTED = 3,  // writeChannels was called
+            PROCESSED = 4,  // The software processing and analysis were done
+            ENCODED = 5,    // The display mapping and compression were done
+            OUTPUT = 6,     // writeChannel was called for 'output'
+            DAQ_OUTPUT = 7, // writeChannel was called for 'daqOutput'
+            SHM_OUTPUT = 8, // writeChannel was called for 'shmOutput'
+            USER = 128,
+            TOTAL = 255 // Never marked: the LatencyHistogram of the whole traces
+        };
+
+        /**
+         * @brief The name of a stage, e.g. "unpacked", or "stage 130" for the user stages.
+         */
+        std::string traceStageName(unsigned char stage);
+
+        /**
+         * @brief The monotonic timestamps of a frame at the stages of the pipeline.
+         *
+         * The timestamps are those of the steady clock, i.e. CLOCK_MONOTONIC on Linux: they can be compared
+         * between the processes of a host, not between hosts.
+         *
+         * In the image header, the trace is encoded as a VECTOR_UINT8 under the "trace" key: a version byte (1),
+         * then for each mark the stage byte, followed by the nanoseconds since the previous mark - since the clock
+         * epoch for the first one - as an unsigned LEB128 varint. A trace of 8 marks takes about 40 bytes.
+         */
+        class LatencyTrace {
+           public:
+            static const char* HEADER_KEY; // "trace"
+
+            typedef std::pair<unsigned char, unsigned long long> Mark; // (stage, nanoseconds)
+
+            /**
+             * @brief Mark a stage, now or at the given time.
+             */
+            void mark(TraceStage stage,
+                      const std::chrono::steady_clock::time_point& time = std::chrono::steady_clock::now());
+
+            void mark(unsigned char stage, unsigned long long nanoseconds);
+
+            const std::vector<Mark>& marks() const {
+                return m_marks;
+            }
+
+            bool empty() const {
+                return m_marks.empty();
+            }
+
+            void clear() {
+                m_marks.clear();
+            }
+
+            /**
+             * @brief Encode the trace in its compact binary form.
+             */
+            std::vector<unsigned char> encode() const;
+
+            /**
+             * @brief Decode a trace from its compact binary form.
+             *
+             * @throw KARABO_PARAMETER_EXCEPTION if the data are not a valid trace.
+             */
+            static LatencyTrace decode(const std::vector<unsigned char>& bytes);
+
+            /**
+             * @brief Set the encoded trace in an image header, under HEADER_KEY.
+             */
+            void attach(karabo::util::Hash& header) const;
+
+            /**
+             * @brief Read the trace from an image header.
+             *
+             * @return false if the header has no valid trace.
+             */
+            static bool extract(const karabo::util::Hash& header, LatencyTrace& trace);
+
+           private:
+            std::vector<Mark> m_marks;
+        };
+
+        /**
+         * @brief Aggregate traces into latency histograms.
+         *
+         * Each mark of a trace counts the time since the previous mark in the histogram of its stage, and the time
+         * from the first to the last mark in the TOTAL histogram. The bins are logarithmic: bin 0 counts the
+         * latencies below 1 us, bin k the latencies in [2^(k-1), 2^k) us, and the last bin any longer latency.
+         *
+         * The class is not thread-safe.
+         */
+        class LatencyHistogram {
+           public:
+            static const unsigned int BINS = 32;
+
+            /**
+             * @brief The histogram of a stage.
+             */
+            struct Stage {
+                std::array<unsigned long long, BINS> counts{};
+                unsigned long long count = 0;
+                double sum = 0.; // us
+                double max = 0.; // us
+
+                double mean() const {
+                    return count > 0 ? sum / count : 0.;
+                }
+
+                /**
+                 * @brief An upper bound of the given percentile, in us, i.e. the upper edge of its bin.
+                 */
+                double percentile(double percent) const;
+            };
+
+            /**
+             * @brief The upper edge of a bin, in us.
+             */
+            static double binEdge(unsigned int bin);
+
+            void add(const LatencyTrace& trace);
+
+            void clear() {
+                m_stages.clear();
+            }
+
+            /**
+             * @brief The histograms, per stage, in the order of the stages. Empty stages are not listed.
+             */
+            const std::map<unsigned char, Stage>& stages() const {
+                return m_stages;
+            }
+
+            /**
+             * @brief Summarize the histograms, one line per stage, e.g.
+             * "unpacked: 100 frames, mean 0.52 ms, median <= 0.512 ms, 99% <= 0.83 ms, max 0.83 ms".
+             */
+            std::vector<std::string> summary() const;
+
+           private:
+            std::map<unsigned char, Stage> m_stages;
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,358 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "NumaPlacement.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        const size_t HUGE_PAGE_SIZE = 2ul << 20; // Transparent hugepages on x86-64
+        const int MAX_NUMA_NODES = 1024;
+
+
+        std::string readFirstLine(const std::string& filename) {
+            std::ifstream ifs(filename);
+            std::string line;
+            std::getline(ifs, line);
+            return line;
+        }
+
+
+        // Prefer a NUMA node for a memory range. NB glibc has no wrapper, and libnuma is not needed for that.
+        void preferNode(void* data, size_t size, int node) {
+            unsigned long nodeMask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {};
+            nodeMask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+            // NB The kernel expects the number of bits in the mask plus one
+            ::syscall(SYS_mbind, data, size, MPOL_PREFERRED, nodeMask, MAX_NUMA_NODES + 1, 0);
+        }
+
+
+        template <class T>
+        NDArray pooledArray(const std::shared_ptr<util::PlacedBuffer>& buffer, const Dims& shape) {
+            return NDArray(reinterpret_cast<const T*>(buffer->data()), shape.size(), [buffer](const void*) {}, shape);
+        }
+
+    } // namespace
+
+
+    std::vector<int> util::parseCpuList(const std::string& cpuList) {
+        std::vector<int> cpus;
+        std::istringstream iss(cpuList);
+        std::string range;
+        while (std::getline(iss, range, ',')) {
+            range.erase(0, range.find_first_not_of(" \t"));
+            range.erase(range.find_last_not_of(" \t\n") + 1);
+            if (range.empty()) {
+                continue;
+            }
+            try {
+                size_t end;
+                const int first = std::stoi(range, &end);
+                int last = first;
+                if (end < range.size()) {
+                    if (range[end] != '-') {
+                        throw std::invalid_argument(range);
+                    }
+                    size_t lastEnd;
+                    last = std::stoi(range.substr(end + 1), &lastEnd);
+                    if (end + 1 + lastEnd != range.size()) {
+                        throw std::invalid_argument(range);
+                    }
+                }
+                if (first < 0 || last < first || last >= CPU_SETSIZE) {
+                    throw std::invalid_argument(range);
+                }
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            } catch (const std::logic_error&) {
+                throw KARABO_PARAMETER_EXCEPTION("Invalid CPU list '" + cpuList + "', e.g. '0-3,8' is expected");
+            }
+        }
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+        return cpus;
+    }
+
+
+    std::string util::formatCpuList(const std::vector<int>& cpus) {
+        std::ostringstream oss;
+        for (size_t i = 0; i < cpus.size();) {
+            size_t j = i;
+            while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+                ++j;
+            }
+            oss << (i > 0 ? "," : "") << cpus[i];
+            if (j > i) {
+                oss << "-" << cpus[j];
+            }
+            i = j + 1;
+        }
+        return oss.str();
+    }
+
+
+    std::vector<int> util::numaNodeCpus(int node) {
+        const std::string filename = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        if (node < 0 || node >= MAX_NUMA_NODES || !std::ifstream(filename).good()) {
+            throw KARABO_PARAMETER_EXCEPTION("NUMA node " + std::to_string(node) + " does not exist");
+        }
+        return parseCpuList(readFirstLine(filename));
+    }
+
+
+    void util::pinCurrentThread(const std::vector<int>& cpus) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &cpuSet);
+        }
+        const int error = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (error != 0) {
+            throw KARABO_PARAMETER_EXCEPTION("Could not pin the thread to cpus " + formatCpuList(cpus) + ": " +
+                                             std::strerror(error));
+        }
+    }
+
+
+    std::string util::describeCurrentThread() {
+        std::ostringstream oss;
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        if (::pthread_getaffinity_np(::pthread_self(), sizeof(cpuSet), &cpuSet) == 0) {
+            std::vector<int> cpus;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &cpuSet)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            oss << "cpus " << formatCpuList(cpus) << ", ";
+        }
+        unsigned int cpu, node;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+            oss << "on cpu " << cpu << " of node " << node;
+        } else {
+            oss << "on an unknown cpu";
+        }
+        return oss.str();
+    }
+
+
+    int util::memoryNode(const void* address) {
+        int node = -1;
+        if (::syscall(SYS_get_mempolicy, &node, nullptr, 0, address, MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+            return -1;
+        }
+        return node;
+    }
+
+
+    bool util::transparentHugePagesAvailable() {
+        // e.g. "always [madvise] never"
+        const std::string mode = readFirstLine("/sys/kernel/mm/transparent_hugepage/enabled");
+        return !mode.empty() && mode.find("[never]") == std::string::npos;
+    }
+
+
+    util::PlacedBuffer::PlacedBuffer() : m_data(nullptr), m_size(0), m_mappedSize(0) {}
+
+
+    util::PlacedBuffer::PlacedBuffer(size_t size, const MemoryPolicy& policy) : PlacedBuffer() {
+        this->reserve(size, policy);
+    }
+
+
+    util::PlacedBuffer::~PlacedBuffer() {
+        this->release();
+    }
+
+
+    void util::PlacedBuffer::reserve(size_t size, const MemoryPolicy& policy) {
+        if (size <= m_size && policy == m_policy) {
+            return;
+        }
+        this->release();
+        if (size == 0) {
+            m_policy = policy;
+            return;
+        }
+
+        // NB Hugepages need 2 MiB aligned memory: map more, then unmap the unaligned ends
+        const size_t mappedSize = policy.hugePages ? (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE
+                                                   : size;
+        const size_t slack = policy.hugePages ? HUGE_PAGE_SIZE : 0;
+        void* map = ::mmap(nullptr, mappedSize + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            throw KARABO_IO_EXCEPTION("Could not allocate " + std::to_string(size) + " bytes: " +
+                                      std::strerror(errno));
+        }
+        char* data = static_cast<char*>(map);
+        if (slack > 0) {
+            const size_t head = (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(data) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+            if (head > 0) {
+                ::munmap(data, head);
+            }
+            if (slack - head > 0) {
+                ::munmap(data + head + mappedSize, slack - head);
+            }
+            data += head;
+            ::madvise(data, mappedSize, MADV_HUGEPAGE);
+        }
+        if (policy.numaNode >= 0 && policy.numaNode < MAX_NUMA_NODES) {
+            preferNode(data, mappedSize, policy.numaNode);
+        }
+
+        m_data = data;
+        m_size = size;
+        m_mappedSize = mappedSize;
+        m_policy = policy;
+    }
+
+
+    void util::PlacedBuffer::release() {
+        if (m_data) {
+            ::munmap(m_data, m_mappedSize);
+        }
+        m_data = nullptr;
+        m_size = 0;
+        m_mappedSize = 0;
+    }
+
+
+    struct util::FramePool::State {
+        mutable std::mutex mutex;
+        MemoryPolicy policy;
+        size_t maxIdle;
+        std::vector<std::unique_ptr<PlacedBuffer>> idle;
+        unsigned long long allocations = 0;
+    };
+
+
+    util::FramePool::FramePool(size_t maxIdle) : m_state(std::make_shared<State>()) {
+        m_state->maxIdle = maxIdle;
+    }
+
+
+    void util::FramePool::setPolicy(const MemoryPolicy& policy) {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if (policy != m_state->policy) {
+            m_state->policy = policy;
+            m_state->idle.clear();
+        }
+    }
+
+
+    util::MemoryPolicy util::FramePool::policy() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        return m_state->policy;
+    }
+
+
+    NDArray util::FramePool::allocate(const Dims& shape, Types::ReferenceType kType) {
+        size_t itemSize;
+        switch (kType) {
+            case Types::UINT8:
+            case Types::INT8:
+                itemSize = 1;
+                break;
+            case Types::UINT16:
+            case Types::INT16:
+                itemSize = 2;
+                break;
+            case Types::UINT32:
+            case Types::INT32:
+            case Types::FLOAT:
+                itemSize = 4;
+                break;
+            case Types::UINT64:
+            case Types::INT64:
+            case Types::DOUBLE:
+                itemSize = 8;
+                break;
+            default:
+                throw KARABO_NOT_IMPLEMENTED_EXCEPTION("Frames of type " + toString(kType) + " are not supported");
+        }
+        const size_t byteSize = shape.size() * itemSize;
+
+        std::unique_ptr<PlacedBuffer> buffer;
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            for (auto it = m_state->idle.begin(); it != m_state->idle.end(); ++it) {
+                if ((*it)->size() == byteSize) {
+                    buffer = std::move(*it);
+                    m_state->idle.erase(it);
+                    break;
+                }
+            }
+            if (!buffer) {
+                buffer.reset(new PlacedBuffer(byteSize, m_state->policy));
+                ++m_state->allocations;
+            }
+        }
+
+        // The buffer returns to the pool - if it still exists and the policy did not change - with the last frame
+        const std::weak_ptr<State> weakState(m_state);
+        const std::shared_ptr<PlacedBuffer> pooled(buffer.release(), [weakState](PlacedBuffer* b) {
+            std::unique_ptr<PlacedBuffer> owned(b);
+            if (std::shared_ptr<State> state = weakState.lock()) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (owned->policy() == state->policy && state->idle.size() < state->maxIdle) {
+                    state->idle.push_back(std::move(owned));
+                }
+            }
+        });
+
+        switch (kType) {
+            case Types::UINT8:
+                return pooledArray<uint8_t>(pooled, shape);
+            case Types::INT8:
+                return pooledArray<int8_t>(pooled, shape);
+            case Types::UINT16:
+                return pooledArray<uint16_t>(pooled, shape);
+            case Types::INT16:
+                return pooledArray<int16_t>(pooled, shape);
+            case Types::UINT32:
+                return pooledArray<uint32_t>(pooled, shape);
+            case Types::INT32:
+                return pooledArray<int32_t>(pooled, shape);
+            case Types::FLOAT:
+                return pooledArray<float>(pooled, shape);
+            case Types::UINT64:
+                return pooledArray<unsigned long long>(pooled, shape);
+            case Types::INT64:
+                return pooledArray<long long>(pooled, shape);
+            default:
+                return pooledArray<double>(pooled, shape);
+        }
+    }
+
+
+    unsigned long long util::FramePool::allocations() const {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        return m_state->allocations;
+    }
+
+} // namespace karabo
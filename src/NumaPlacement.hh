@@ -0,0 +1,173 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_NUMAPLACEMENT_HH
+#define KARABO_NUMAPLACEMENT_HH
+
+#include <memory>
+#include <mutex>
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief Where memory is allocated.
+         */
+        struct MemoryPolicy {
+            int numaNode = -1;      // The preferred NUMA node, -1 for no preference
+            bool hugePages = false; // Back the memory with transparent hugepages
+
+            bool operator==(const MemoryPolicy& other) const {
+                return numaNode == other.numaNode && hugePages == other.hugePages;
+            }
+
+            bool operator!=(const MemoryPolicy& other) const {
+                return !(*this == other);
+            }
+        };
+
+        /**
+         * @brief Parse a CPU list, e.g. "0-3,8".
+         *
+         * @return The CPUs, in increasing order. Empty for an empty list.
+         */
+        std::vector<int> parseCpuList(const std::string& cpuList);
+
+        /**
+         * @brief Format a CPU list, e.g. "0-3,8", i.e. the inverse of parseCpuList.
+         */
+        std::string formatCpuList(const std::vector<int>& cpus);
+
+        /**
+         * @brief The CPUs of a NUMA node, as listed in /sys/devices/system/node.
+         *
+         * @throw KARABO_PARAMETER_EXCEPTION if the node does not exist.
+         */
+        std::vector<int> numaNodeCpus(int node);
+
+        /**
+         * @brief Restrict the calling thread to a set of CPUs.
+         *
+         * @throw KARABO_PARAMETER_EXCEPTION if the affinity cannot be set, e.g. the CPUs do not exist.
+         */
+        void pinCurrentThread(const std::vector<int>& cpus);
+
+        /**
+         * @brief Describe where the calling thread runs, e.g. "cpus 0-7, on cpu 3 of node 0".
+         */
+        std::string describeCurrentThread();
+
+        /**
+         * @brief The NUMA node of the memory page containing an address, -1 if unknown.
+         *
+         * The page is allocated if it was not yet.
+         */
+        int memoryNode(const void* address);
+
+        /**
+         * @brief Return true if the kernel can back memory with transparent hugepages on request.
+         */
+        bool transparentHugePagesAvailable();
+
+        /**
+         * @brief A memory buffer placed according to a MemoryPolicy.
+         *
+         * The memory is mapped anonymously, bound to the preferred NUMA node, and - with hugePages - aligned to and
+         * advised for transparent hugepages. The pages are allocated when first touched, i.e. on the node of the
+         * thread touching them if no node is preferred. The placement is best effort: it is not an error if the
+         * kernel does not support it.
+         *
+         * The class is not thread-safe.
+         */
+        class PlacedBuffer {
+           public:
+            PlacedBuffer();
+
+            PlacedBuffer(size_t size, const MemoryPolicy& policy);
+
+            PlacedBuffer(const PlacedBuffer&) = delete;
+
+            PlacedBuffer& operator=(const PlacedBuffer&) = delete;
+
+            ~PlacedBuffer();
+
+            /**
+             * @brief Make the buffer at least size bytes large, with the given policy.
+             *
+             * The memory is only reallocated if the buffer is smaller, or the policy differs. The content is not
+             * preserved.
+             */
+            void reserve(size_t size, const MemoryPolicy& policy);
+
+            void* data() const {
+                return m_data;
+            }
+
+            size_t size() const {
+                return m_size;
+            }
+
+            const MemoryPolicy& policy() const {
+                return m_policy;
+            }
+
+           private:
+            void release();
+
+            void* m_data;
+            size_t m_size;
+            size_t m_mappedSize;
+            MemoryPolicy m_policy;
+        };
+
+        /**
+         * @brief A pool of frame buffers, placed according to a MemoryPolicy.
+         *
+         * The frames are NDArrays whose memory returns to the pool when their last copy is destroyed: frames of
+         * the same size reuse the buffers, whose pages are already allocated on the right node.
+         *
+         * The class is thread-safe.
+         */
+        class FramePool {
+           public:
+            /**
+             * @param maxIdle The maximum number of idle buffers kept in the pool.
+             */
+            explicit FramePool(size_t maxIdle = 8);
+
+            /**
+             * @brief Set the placement of the buffers. The idle buffers are released.
+             */
+            void setPolicy(const MemoryPolicy& policy);
+
+            MemoryPolicy policy() const;
+
+            /**
+             * @brief Return a frame from the pool. The content is undefined.
+             *
+             * @param shape The frame shape.
+             * @param kType The frame type.
+             */
+            karabo::util::NDArray allocate(const karabo::util::Dims& shape, karabo::util::Types::ReferenceType kType);
+
+            /**
+             * @brief The number of buffers allocated, i.e. not reused, since the pool was created.
+             */
+            unsigned long long allocations() const;
+
+           private:
+            struct State;
+            std::shared_ptr<State> m_state; // Shared with the frames, which may outlive the pool
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
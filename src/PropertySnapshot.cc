@@ -0,0 +1,93 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include "PropertySnapshot.hh"
+
+namespace karabo {
+
+    namespace {
+
+        // Never matches a number of values
+        const unsigned long long INVALID = ~0ull;
+
+    } // namespace
+
+
+    util::PropertySnapshot::PropertySnapshot() : m_sequence(0) {
+        for (std::atomic<unsigned long long>& value : m_values) {
+            value.store(INVALID, std::memory_order_relaxed);
+        }
+    }
+
+
+    void util::PropertySnapshot::publish(const unsigned long long* values, size_t size) {
+        const unsigned long long sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (size > CAPACITY) {
+            m_values[0].store(INVALID, std::memory_order_relaxed);
+        } else {
+            m_values[0].store(size, std::memory_order_relaxed);
+            for (size_t k = 0; k < size; ++k) {
+                m_values[k + 1].store(values[k], std::memory_order_relaxed);
+            }
+        }
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+
+    void util::PropertySnapshot::invalidate() {
+        const unsigned long long sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_values[0].store(INVALID, std::memory_order_relaxed);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+
+    bool util::PropertySnapshot::matches(const unsigned long long* values, size_t size) const {
+        if (size > CAPACITY) {
+            return false;
+        }
+
+        const unsigned long long sequence = m_sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            return false; // Being published
+        }
+        bool same = m_values[0].load(std::memory_order_relaxed) == size;
+        for (size_t k = 0; k < size; ++k) {
+            same &= m_values[k + 1].load(std::memory_order_relaxed) == values[k];
+        }
+
+        // NB The values read are only valid if no publish started meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return same && m_sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+
+    bool util::PropertySnapshot::read(std::vector<unsigned long long>& values) const {
+        const unsigned long long sequence = m_sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            return false;
+        }
+        const unsigned long long size = m_values[0].load(std::memory_order_relaxed);
+        if (size > CAPACITY) {
+            return false;
+        }
+        values.resize(size);
+        for (size_t k = 0; k < size; ++k) {
+            values[k] = m_values[k + 1].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+} // namespace karabo
@@ -0,0 +1,81 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_PROPERTYSNAPSHOT_HH
+#define KARABO_PROPERTYSNAPSHOT_HH
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief A small set of values - e.g. the properties of the images an output schema was built for - which
+         * can be compared without locking, from any thread.
+         *
+         * The values are read as a sequence lock: the sequence number is odd while they are being published, and
+         * a reader only trusts the values if the sequence did not change while it read them. The readers never
+         * block, nor are blocked; a snapshot being published matches nothing.
+         *
+         * The publishers must be serialized by the caller, e.g. with a mutex.
+         */
+        class PropertySnapshot {
+           public:
+            static const size_t CAPACITY = 8; // The maximum number of values
+
+            /**
+             * @brief Construct an invalid snapshot, which matches nothing.
+             */
+            PropertySnapshot();
+
+            PropertySnapshot(const PropertySnapshot&) = delete;
+            PropertySnapshot& operator=(const PropertySnapshot&) = delete;
+
+            /**
+             * @brief Publish new values. More than CAPACITY values invalidate the snapshot.
+             */
+            void publish(const unsigned long long* values, size_t size);
+
+            void publish(const std::vector<unsigned long long>& values) {
+                this->publish(values.data(), values.size());
+            }
+
+            /**
+             * @brief Invalidate the snapshot, i.e. it matches nothing until the next publish.
+             */
+            void invalidate();
+
+            /**
+             * @brief Return true if the published values are the given ones.
+             */
+            bool matches(const unsigned long long* values, size_t size) const;
+
+            bool matches(const std::vector<unsigned long long>& values) const {
+                return this->matches(values.data(), values.size());
+            }
+
+            /**
+             * @brief Read a consistent copy of the published values.
+             *
+             * @return false if the snapshot is invalid, or being published.
+             */
+            bool read(std::vector<unsigned long long>& values) const;
+
+           private:
+            std::atomic<unsigned long long> m_sequence;
+            std::array<std::atomic<unsigned long long>, CAPACITY + 1> m_values; // (size, values...)
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include "ReplayImageSource.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    KARABO_REGISTER_FOR_CONFIGURATION(BaseDevice, Device<>, ImageSource, ReplayImageSource)
+
+
+    namespace {
+
+        // The time between two frames, in seconds
+        double timeBetween(const Timestamp& from, const Timestamp& to) {
+            return (static_cast<double>(to.getSeconds()) - static_cast<double>(from.getSeconds())) +
+                   (static_cast<double>(to.getFractionalSeconds()) -
+                    static_cast<double>(from.getFractionalSeconds())) * 1.e-18;
+        }
+
+    } // namespace
+
+
+    void ReplayImageSource::expectedParameters(Schema& expected) {
+        STRING_ELEMENT(expected).key("recordingFile")
+            .displayedName("Recording File")
+            .description("The file written by the 'recorder' of an ImageSource.")
+            .assignmentOptional().defaultValue("")
+            .reconfigurable()
+            .allowedStates(State::ON)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("speedup")
+            .displayedName("Speedup")
+            .description("The replay speed, relative to the recording: 1 for the original timing, 2 for twice as "
+                         "fast. Zero to replay the frames as fast as possible.")
+            .assignmentOptional().defaultValue(1.)
+            .minInc(0.)
+            .reconfigurable()
+            .commit();
+
+        BOOL_ELEMENT(expected).key("loop")
+            .displayedName("Loop")
+            .description("Restart from the first frame at the end of the recording.")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        BOOL_ELEMENT(expected).key("originalTimestamps")
+            .displayedName("Original Timestamps")
+            .description("Write the frames with their recorded timestamps, instead of the current ones.")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .allowedStates(State::ON)
+            .commit();
+
+        UINT64_ELEMENT(expected).key("nFrames")
+            .displayedName("Recorded Frames")
+            .readOnly().initialValue(0)
+            .commit();
+
+        UINT64_ELEMENT(expected).key("framesSent")
+            .displayedName("Frames Sent")
+            .readOnly().initialValue(0)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("frameRate")
+            .displayedName("Frame Rate")
+            .unit(Unit::HERTZ)
+            .readOnly().initialValue(0.)
+            .commit();
+
+        SLOT_ELEMENT(expected).key("acquire")
+            .displayedName("Acquire")
+            .description("Replay the recording.")
+            .allowedStates(State::ON)
+            .commit();
+
+        SLOT_ELEMENT(expected).key("stop")
+            .displayedName("Stop")
+            .allowedStates(State::ACQUIRING)
+            .commit();
+    }
+
+
+    ReplayImageSource::ReplayImageSource(const karabo::util::Hash& config) : ImageSource(config), m_running(false) {
+        KARABO_SLOT(acquire)
+        KARABO_SLOT(stop)
+
+        KARABO_INITIAL_FUNCTION(initialize)
+    }
+
+
+    ReplayImageSource::~ReplayImageSource() {
+        m_running = false;
+        if (m_replayThread.joinable()) {
+            m_replayThread.join();
+        }
+    }
+
+
+    void ReplayImageSource::initialize() {
+        this->updateState(State::ON);
+    }
+
+
+    void ReplayImageSource::acquire() {
+        if (m_replayThread.joinable()) {
+            m_replayThread.join(); // The previous replay is over
+        }
+
+        const std::string& filename = this->get<std::string>("recordingFile");
+        m_recording.open(filename);
+        if (m_recording.size() == 0) {
+            m_recording.close();
+            throw KARABO_PARAMETER_EXCEPTION("File " + filename + " contains no frames");
+        }
+
+        this->set(Hash("nFrames", static_cast<unsigned long long>(m_recording.size()), "framesSent", 0ull));
+        this->updateState(State::ACQUIRING);
+
+        m_running = true;
+        m_replayThread = boost::thread(&ReplayImageSource::replay, this);
+    }
+
+
+    void ReplayImageSource::stop() {
+        m_running = false;
+        if (m_replayThread.joinable()) {
+            m_replayThread.join();
+        }
+    }
+
+
+    void ReplayImageSource::replay() {
+        this->pinThread("replay");
+
+        unsigned long long framesSent = 0;
+        try {
+            do {
+                this->replay_frames(framesSent);
+            } while (m_running && this->get<bool>("loop"));
+        } catch (const std::exception& e) {
+            KARABO_LOG_FRAMEWORK_ERROR << "Replay failed: " << e.what();
+        }
+
+        m_running = false;
+        m_recording.close(); // NB The frames still in use keep the file mapped
+        this->signalEOS();
+        this->set(Hash("framesSent", framesSent, "frameRate", 0.));
+        this->updateState(State::ON);
+    }
+
+
+    void ReplayImageSource::replay_frames(unsigned long long& framesSent) {
+        const bool originalTimestamps = this->get<bool>("originalTimestamps");
+
+        std::vector<unsigned long long> shape;
+        int encoding = Encoding::UNDEFINED;
+        int kType = Types::UNKNOWN;
+
+        // The frames are scheduled relative to an anchor, which is moved when the speedup changes
+        double speedup = -1.;
+        std::chrono::steady_clock::time_point anchorTime;
+        Timestamp anchorStamp;
+
+        auto rateTime = std::chrono::steady_clock::now();
+        unsigned long long rateFrames = 0;
+
+        util::RecordedFrame frame;
+        for (size_t i = 0; i < m_recording.size() && m_running; ++i) {
+            m_recording.frame(i, frame);
+
+            const double newSpeedup = this->get<double>("speedup");
+            if (newSpeedup != speedup) {
+                speedup = newSpeedup;
+                anchorTime = std::chrono::steady_clock::now();
+                anchorStamp = frame.timestamp;
+            }
+
+            if (speedup > 0.) {
+                const auto due = anchorTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                    std::chrono::duration<double>(
+                                                          timeBetween(anchorStamp, frame.timestamp) / speedup));
+                // Sleep in short steps, not to delay stop on gaps in the recording
+                for (auto now = std::chrono::steady_clock::now(); now < due && m_running;
+                     now = std::chrono::steady_clock::now()) {
+                    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                          due - now, std::chrono::milliseconds(100)));
+                }
+                if (!m_running) {
+                    break;
+                }
+            }
+
+            const std::vector<unsigned long long> frameShape = frame.data.getShape().toVector();
+            if (frameShape != shape || frame.encoding != encoding || frame.data.getType() != kType) {
+                shape = frameShape;
+                encoding = frame.encoding;
+                kType = frame.data.getType();
+                this->updateOutputSchema(shape, frame.encoding, frame.data.getType());
+            }
+
+            // NB A recorded trace is stale: the replayed frames are traced from their release
+            const bool tracing = this->tracingEnabled();
+            if (tracing || frame.header.has(util::LatencyTrace::HEADER_KEY)) {
+                frame.header.erase(util::LatencyTrace::HEADER_KEY);
+                if (tracing) {
+                    util::LatencyTrace trace;
+                    trace.mark(util::TraceStage::ACQUIRED);
+                    trace.attach(frame.header);
+                }
+            }
+
+            const Timestamp timestamp = originalTimestamps ? frame.timestamp : this->getActualTimestamp();
+            this->writeChannels(frame.data, frame.binning, frame.bitsPerPixel, frame.encoding, frame.roiOffsets,
+                                timestamp, frame.header);
+            ++framesSent;
+            ++rateFrames;
+
+            const auto now = std::chrono::steady_clock::now();
+            const std::chrono::duration<double> elapsed = now - rateTime;
+            if (elapsed.count() >= 1.) {
+                this->set(Hash("framesSent", framesSent, "frameRate", rateFrames / elapsed.count()));
+                rateTime = now;
+                rateFrames = 0;
+            }
+        }
+    }
+
+} // namespace karabo
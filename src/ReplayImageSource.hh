@@ -0,0 +1,59 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_REPLAYIMAGESOURCE_HH
+#define KARABO_REPLAYIMAGESOURCE_HH
+
+#include <atomic>
+#include <karabo/karabo.hpp>
+
+#include "ImageSource.hh"
+#include "version.hh" // provides IMAGESOURCE_PACKAGE_VERSION
+
+/**
+ * The main Karabo namespace
+ */
+namespace karabo {
+
+    /**
+     * @brief Replay the frames recorded by an ImageSource (see 'recorder'), at their original timing or faster.
+     *
+     * The recording is memory-mapped, and the frames are passed to writeChannels without being copied, i.e. they
+     * go through the same software processing pipeline as the recorded ones. This allows repeatable end-to-end
+     * throughput tests, with no camera attached.
+     */
+    class ReplayImageSource : public ImageSource {
+
+    public:
+        KARABO_CLASSINFO(ReplayImageSource, "ReplayImageSource", IMAGESOURCE_PACKAGE_VERSION)
+
+        static void expectedParameters(karabo::util::Schema& expected);
+
+        explicit ReplayImageSource(const karabo::util::Hash& config);
+
+        virtual ~ReplayImageSource();
+
+    private:
+        util::FrameRecording m_recording;
+        boost::thread m_replayThread;
+        std::atomic<bool> m_running;
+
+        void initialize();
+
+        void acquire();
+
+        void stop();
+
+        void replay();
+
+        void replay_frames(unsigned long long& framesSent);
+    };
+
+} // namespace karabo
+
+#endif
@@ -49,4 +49,20 @@ namespace karabo {
             "";
         return output.str();
     }
+
+
+    std::string CameraImageSource::overviewScene() {
+        const std::string& instanceId = this->getInstanceId();
+        std::ostringstream output;
+        output << ""
+            "<?xml version=\"1.0\" ?>"
+            "<svg:svg height=\"340\" krb:uuid=\"5c0d3a4e-8f6b-4f2e-9a51-2b7c6e1d9f03\" krb:version=\"2\" width=\"290\" xmlns:krb=\"http://karabo.eu/scene\" xmlns:svg=\"http://www.w3.org/2000/svg\">"
+            "	<svg:rect expression=\"x.split('/')[-1]\" height=\"27\" krb:class=\"DisplayComponent\" krb:keys=\"" << instanceId << ".deviceId\" krb:widget=\"Evaluator\" width=\"180\" x=\"5\" y=\"5\"/>"
+            "	<svg:rect height=\"27\" krb:class=\"DisplayComponent\" krb:keys=\"" << instanceId << ".state\" krb:staticText=\"\" krb:widget=\"DisplayStateColor\" width=\"95\" x=\"190\" y=\"5\"/>"
+            "	<svg:rect height=\"27\" krb:class=\"DisplayComponent\" krb:keys=\"" << instanceId << ".state\" krb:widget=\"DisplayLabel\" width=\"95\" x=\"190\" y=\"5\"/>"
+            "	<svg:rect height=\"300\" krb:class=\"DisplayComponent\" krb:keys=\"" << instanceId << ".thumbnail.image\" krb:colormap=\"viridis\" krb:widget=\"WebCamGraph\" width=\"280\" x=\"5\" y=\"36\"/>"
+            "</svg:svg>"
+            "";
+        return output.str();
+    }
 }
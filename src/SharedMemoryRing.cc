@@ -0,0 +1,347 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SharedMemoryRing.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+                      "The ring needs lock-free, i.e. address-free, atomics in shared memory");
+
+        const char RING_MAGIC[8] = {'K', 'S', 'H', 'M', 'R', 'N', 'G', '1'};
+        const size_t PAGE_SIZE = 4096;
+        const unsigned int MAX_RANK = 4;
+        const uint32_t WRITER = 0x80000000u; // Set in the slot state while the producer writes the slot
+
+
+        struct RingHeader {
+            char magic[8];
+            uint32_t slots;
+            uint32_t reserved;
+            uint64_t slotSize;
+            uint64_t ringId;
+        };
+
+
+        // The slot state counts the consumers holding the slot. The producer only writes a slot nobody holds, and
+        // the consumers back off from a slot being written, or whose sequence number changed.
+        struct SlotHeader {
+            std::atomic<uint32_t> state;
+            uint32_t reserved;
+            std::atomic<uint64_t> sequence; // Zero while the slot is empty
+            uint64_t dataSize;
+            uint64_t seconds;
+            uint64_t fractionalSeconds;
+            uint64_t trainId;
+            int32_t kType;
+            int32_t encoding;
+            uint16_t bitsPerPixel;
+            uint16_t rank;
+            uint64_t shape[MAX_RANK];
+        };
+
+
+        size_t aligned(size_t size) {
+            return (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+        }
+
+
+        // The ring header and the slot headers share the first pages, the slot data follow, page aligned
+        size_t dataOffset(unsigned int slots) {
+            return aligned(sizeof(RingHeader) + slots * sizeof(SlotHeader));
+        }
+
+
+        SlotHeader* slotHeader(char* map, unsigned int slot) {
+            return reinterpret_cast<SlotHeader*>(map + sizeof(RingHeader)) + slot;
+        }
+
+
+        template <class T>
+        NDArray sharedArray(const char* data, size_t dataSize, const Dims& shape, const std::shared_ptr<void>& holder) {
+            const size_t size = shape.rank() > 0 ? shape.size() : 0;
+            if (size * sizeof(T) != dataSize) {
+                throw KARABO_IO_EXCEPTION("The shared pixel data do not match their shape");
+            }
+            return NDArray(reinterpret_cast<const T*>(data), size, [holder](const void*) {}, shape);
+        }
+
+    } // namespace
+
+
+    util::SharedMemoryRing::SharedMemoryRing()
+        : m_map(nullptr), m_mapSize(0), m_slots(0), m_slotSize(0), m_ringId(0), m_sequence(0), m_next(0) {}
+
+
+    util::SharedMemoryRing::~SharedMemoryRing() {
+        this->close();
+    }
+
+
+    void util::SharedMemoryRing::create(const std::string& name, unsigned int slots, size_t slotSize) {
+        this->close();
+        if (slots == 0 || slots >= WRITER) {
+            throw KARABO_PARAMETER_EXCEPTION("Invalid number of shared memory slots: " + toString(slots));
+        }
+
+        // NB A ring with the same name, e.g. left over by a crash, is replaced: its consumers keep their mapping
+        ::shm_unlink(name.c_str());
+        const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            throw KARABO_IO_EXCEPTION("Could not create shared memory " + name + ": " + std::strerror(errno));
+        }
+
+        const size_t alignedSlotSize = aligned(std::max(slotSize, size_t(1)));
+        const size_t mapSize = dataOffset(slots) + slots * alignedSlotSize;
+        void* map = MAP_FAILED;
+        if (::ftruncate(fd, mapSize) == 0) {
+            map = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        const int error = errno;
+        ::close(fd); // NB The mapping remains valid
+        if (map == MAP_FAILED) {
+            ::shm_unlink(name.c_str());
+            throw KARABO_IO_EXCEPTION("Could not map " + toString(mapSize) + " bytes of shared memory " + name +
+                                      ": " + std::strerror(error));
+        }
+
+        m_name = name;
+        m_map = static_cast<char*>(map);
+        m_mapSize = mapSize;
+        m_slots = slots;
+        m_slotSize = alignedSlotSize;
+        m_ringId = std::chrono::system_clock::now().time_since_epoch().count() ^ ::getpid();
+        m_sequence = 0;
+        m_next = 0;
+
+        // NB The new object is zero-filled, i.e. all the slots are free and empty
+        RingHeader& header = *reinterpret_cast<RingHeader*>(m_map);
+        header.slots = m_slots;
+        header.slotSize = m_slotSize;
+        header.ringId = m_ringId;
+        // The ring is valid once its magic is set
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header.magic, RING_MAGIC, sizeof(RING_MAGIC));
+    }
+
+
+    void util::SharedMemoryRing::close() {
+        if (!m_map) {
+            return;
+        }
+        ::munmap(m_map, m_mapSize);
+        ::shm_unlink(m_name.c_str());
+        m_map = nullptr;
+        m_mapSize = 0;
+        m_slots = 0;
+        m_slotSize = 0;
+    }
+
+
+    bool util::SharedMemoryRing::write(const NDArray& data, const EncodingType& encoding, unsigned short bitsPerPixel,
+                                       const Timestamp& timestamp, unsigned int& slot, unsigned long long& sequence) {
+        if (!m_map) {
+            throw KARABO_PARAMETER_EXCEPTION("No shared memory ring is open");
+        }
+        const Dims shape = data.getShape();
+        const size_t dataSize = data.byteSize();
+        if (dataSize > m_slotSize || shape.rank() > MAX_RANK) {
+            throw KARABO_PARAMETER_EXCEPTION("A frame of " + toString(dataSize) + " bytes and rank " +
+                                             toString(shape.rank()) + " does not fit in the shared memory slots");
+        }
+
+        // Take the next slot no consumer holds
+        SlotHeader* sh = nullptr;
+        for (unsigned int i = 0; i < m_slots; ++i) {
+            const unsigned int candidate = (m_next + i) % m_slots;
+            SlotHeader* candidateHeader = slotHeader(m_map, candidate);
+            uint32_t free = 0;
+            if (candidateHeader->state.compare_exchange_strong(free, WRITER, std::memory_order_acquire)) {
+                slot = candidate;
+                sh = candidateHeader;
+                break;
+            }
+        }
+        if (!sh) {
+            return false;
+        }
+
+        sh->sequence.store(0, std::memory_order_relaxed);
+        sh->dataSize = dataSize;
+        sh->seconds = timestamp.getSeconds();
+        sh->fractionalSeconds = timestamp.getFractionalSeconds();
+        sh->trainId = timestamp.getTrainId();
+        sh->kType = data.getType();
+        sh->encoding = encoding;
+        sh->bitsPerPixel = bitsPerPixel;
+        sh->rank = shape.rank();
+        for (unsigned int i = 0; i < MAX_RANK; ++i) {
+            sh->shape[i] = i < shape.rank() ? shape.extentIn(i) : 0;
+        }
+        std::memcpy(m_map + dataOffset(m_slots) + slot * m_slotSize, data.getData<char>(), dataSize);
+
+        sequence = ++m_sequence;
+        sh->sequence.store(sequence, std::memory_order_relaxed);
+        sh->state.fetch_and(~WRITER, std::memory_order_release);
+        m_next = (slot + 1) % m_slots;
+        return true;
+    }
+
+
+    class util::SharedMemoryReader::Mapping {
+       public:
+        Mapping(char* data, size_t size) : m_data(data), m_size(size) {}
+
+        ~Mapping() {
+            ::munmap(m_data, m_size);
+        }
+
+        char* data() const {
+            return m_data;
+        }
+
+        size_t size() const {
+            return m_size;
+        }
+
+       private:
+        char* m_data;
+        size_t m_size;
+    };
+
+
+    util::SharedMemoryReader::SharedMemoryReader() {}
+
+
+    void util::SharedMemoryReader::open(const std::string& name) {
+        this->close();
+
+        // NB The consumers write the slot states, i.e. they need the ring writable
+        const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            throw KARABO_IO_EXCEPTION("Could not open shared memory " + name + ": " + std::strerror(errno));
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < dataOffset(0)) {
+            ::close(fd);
+            throw KARABO_IO_EXCEPTION("Shared memory " + name + " is not a frame ring");
+        }
+
+        const size_t size = st.st_size;
+        void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd); // NB The mapping remains valid
+        if (map == MAP_FAILED) {
+            throw KARABO_IO_EXCEPTION("Could not map shared memory " + name + ": " + std::strerror(errno));
+        }
+        m_mapping = std::make_shared<Mapping>(static_cast<char*>(map), size);
+
+        const RingHeader& header = *reinterpret_cast<const RingHeader*>(m_mapping->data());
+        const bool valid = std::memcmp(header.magic, RING_MAGIC, sizeof(RING_MAGIC)) == 0;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!valid || header.slots == 0 || dataOffset(header.slots) + header.slots * header.slotSize > size) {
+            this->close();
+            throw KARABO_IO_EXCEPTION("Shared memory " + name + " is not a frame ring");
+        }
+    }
+
+
+    void util::SharedMemoryReader::close() {
+        m_mapping.reset(); // NB The frames still in use keep the ring mapped
+    }
+
+
+    unsigned long long util::SharedMemoryReader::ringId() const {
+        if (!m_mapping) {
+            throw KARABO_PARAMETER_EXCEPTION("No shared memory ring is open");
+        }
+        return reinterpret_cast<const RingHeader*>(m_mapping->data())->ringId;
+    }
+
+
+    bool util::SharedMemoryReader::read(unsigned int slot, unsigned long long sequence, SharedFrame& frame) {
+        if (!m_mapping) {
+            throw KARABO_PARAMETER_EXCEPTION("No shared memory ring is open");
+        }
+        const RingHeader& header = *reinterpret_cast<const RingHeader*>(m_mapping->data());
+        if (slot >= header.slots) {
+            throw KARABO_PARAMETER_EXCEPTION("Shared memory slot " + toString(slot) + " out of range [0, " +
+                                             toString(header.slots) + ")");
+        }
+
+        // Hold the slot, unless it is being written or holds another frame
+        SlotHeader* sh = slotHeader(m_mapping->data(), slot);
+        const uint32_t state = sh->state.fetch_add(1, std::memory_order_acquire);
+        if ((state & WRITER) != 0 || sh->sequence.load(std::memory_order_relaxed) != sequence) {
+            sh->state.fetch_sub(1, std::memory_order_release);
+            return false;
+        }
+
+        // The slot is released with the last copy of the data
+        const std::shared_ptr<Mapping> mapping(m_mapping);
+        const std::shared_ptr<void> holder(sh, [mapping](SlotHeader* held) {
+            held->state.fetch_sub(1, std::memory_order_release);
+        });
+
+        frame.timestamp = Timestamp(Epochstamp(sh->seconds, sh->fractionalSeconds), Trainstamp(sh->trainId));
+        frame.encoding = static_cast<EncodingType>(sh->encoding);
+        frame.bitsPerPixel = sh->bitsPerPixel;
+
+        const char* data = m_mapping->data() + dataOffset(header.slots) + slot * header.slotSize;
+        const unsigned int rank = std::min<unsigned int>(sh->rank, MAX_RANK);
+        const Dims shape(std::vector<unsigned long long>(sh->shape, sh->shape + rank));
+        switch (sh->kType) {
+            case Types::UINT8:
+                frame.data = sharedArray<uint8_t>(data, sh->dataSize, shape, holder);
+                break;
+            case Types::INT8:
+                frame.data = sharedArray<int8_t>(data, sh->dataSize, shape, holder);
+                break;
+            case Types::UINT16:
+                frame.data = sharedArray<uint16_t>(data, sh->dataSize, shape, holder);
+                break;
+            case Types::INT16:
+                frame.data = sharedArray<int16_t>(data, sh->dataSize, shape, holder);
+                break;
+            case Types::UINT32:
+                frame.data = sharedArray<uint32_t>(data, sh->dataSize, shape, holder);
+                break;
+            case Types::INT32:
+                frame.data = sharedArray<int32_t>(data, sh->dataSize, shape, holder);
+                break;
+            case Types::FLOAT:
+                frame.data = sharedArray<float>(data, sh->dataSize, shape, holder);
+                break;
+            case Types::DOUBLE:
+                frame.data = sharedArray<double>(data, sh->dataSize, shape, holder);
+                break;
+            default:
+                throw KARABO_NOT_IMPLEMENTED_EXCEPTION("Shared data type " + toString(sh->kType) +
+                                                       " is not supported");
+        }
+        return true;
+    }
+
+} // namespace karabo
@@ -0,0 +1,163 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_SHAREDMEMORYRING_HH
+#define KARABO_SHAREDMEMORYRING_HH
+
+#include <memory>
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief A frame read from a SharedMemoryRing.
+         */
+        struct SharedFrame {
+            karabo::util::NDArray data; // The pixel data, in the shared memory
+            karabo::xms::EncodingType encoding;
+            unsigned short bitsPerPixel;
+            karabo::util::Timestamp timestamp;
+        };
+
+        /**
+         * @brief A ring of frames in POSIX shared memory, for consumers on the same host.
+         *
+         * The ring has a fixed number of slots of a fixed size. Each frame is copied into the next free slot, and
+         * gets a sequence number: the consumers are notified of the (slot, sequence) pair by other means, e.g. an
+         * output channel, and read the frame without copying it with a SharedMemoryReader.
+         *
+         * The slots are reference-counted: a slot read by a consumer is not overwritten before the consumer
+         * releases it. A consumer which dies while holding a slot blocks it until the ring is re-created.
+         *
+         * The class is not thread-safe.
+         */
+        class SharedMemoryRing {
+           public:
+            SharedMemoryRing();
+
+            SharedMemoryRing(const SharedMemoryRing&) = delete;
+
+            SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+            ~SharedMemoryRing();
+
+            /**
+             * @brief Create the ring, replacing any shared memory object with the same name.
+             *
+             * @param name The shared memory object name, e.g. "/karabo-camera".
+             * @param slots The number of slots.
+             * @param slotSize The maximum size of the frames, in bytes.
+             * @throw KARABO_IO_EXCEPTION if the shared memory cannot be created.
+             */
+            void create(const std::string& name, unsigned int slots, size_t slotSize);
+
+            /**
+             * @brief Unmap and remove the ring. The consumers can still read the frames they hold.
+             */
+            void close();
+
+            bool isOpen() const {
+                return m_map != nullptr;
+            }
+
+            const std::string& name() const {
+                return m_name;
+            }
+
+            /**
+             * @brief The identifier of the ring, which changes each time it is created.
+             */
+            unsigned long long ringId() const {
+                return m_ringId;
+            }
+
+            size_t slotSize() const {
+                return m_slotSize;
+            }
+
+            /**
+             * @brief Copy a frame into the next free slot.
+             *
+             * @param data The pixel data. At most slotSize bytes, and 4 dimensions.
+             * @param encoding The image encoding.
+             * @param bitsPerPixel The pixel depth.
+             * @param timestamp The frame timestamp.
+             * @param slot The slot the frame was written to.
+             * @param sequence The sequence number of the frame.
+             * @return false if all the slots are being read, i.e. the frame was not written.
+             * @throw KARABO_PARAMETER_EXCEPTION if the frame does not fit in a slot.
+             */
+            bool write(const karabo::util::NDArray& data, const karabo::xms::EncodingType& encoding,
+                       unsigned short bitsPerPixel, const karabo::util::Timestamp& timestamp, unsigned int& slot,
+                       unsigned long long& sequence);
+
+           private:
+            std::string m_name;
+            char* m_map;
+            size_t m_mapSize;
+            unsigned int m_slots;
+            size_t m_slotSize;
+            unsigned long long m_ringId;
+            unsigned long long m_sequence;
+            unsigned int m_next;
+        };
+
+        /**
+         * @brief Read frames from a SharedMemoryRing, without copying them.
+         *
+         * The class is not thread-safe, but the frames read may be used from any thread.
+         */
+        class SharedMemoryReader {
+           public:
+            SharedMemoryReader();
+
+            /**
+             * @brief Map a ring.
+             *
+             * @throw KARABO_IO_EXCEPTION if the ring does not exist, or is invalid.
+             */
+            void open(const std::string& name);
+
+            /**
+             * @brief Unmap the ring. The frames read remain valid.
+             */
+            void close();
+
+            bool isOpen() const {
+                return static_cast<bool>(m_mapping);
+            }
+
+            /**
+             * @brief The identifier of the ring, to detect that it was re-created.
+             */
+            unsigned long long ringId() const;
+
+            /**
+             * @brief Read a frame.
+             *
+             * The slot is held - i.e. not overwritten by the producer - until the last copy of frame.data is
+             * destroyed.
+             *
+             * @param slot The slot, as notified by the producer.
+             * @param sequence The sequence number, as notified by the producer.
+             * @param frame The frame.
+             * @return false if the frame was overwritten meanwhile.
+             */
+            bool read(unsigned int slot, unsigned long long sequence, SharedFrame& frame);
+
+           private:
+            class Mapping;
+            std::shared_ptr<Mapping> m_mapping; // Shared with the frames read, which may outlive the reader
+        };
+
+    } // namespace util
+} // namespace karabo
+
+#endif
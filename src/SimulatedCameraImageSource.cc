@@ -0,0 +1,443 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <cstring>
+#include <thread>
+
+#include "SimulatedCameraImageSource.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    KARABO_REGISTER_FOR_CONFIGURATION(BaseDevice, Device<>, ImageSource, CameraImageSource, SimulatedCameraImageSource)
+
+
+    namespace {
+
+        // Sleep until shortly before a deadline, then spin, as the wake-up from sleep is late by tens of us
+        const std::chrono::microseconds SPIN_TIME(100);
+
+        // Not to delay stop on long periods
+        const std::chrono::milliseconds MAX_SLEEP(100);
+
+    } // namespace
+
+
+    void SimulatedCameraImageSource::expectedParameters(Schema& expected) {
+        UINT32_ELEMENT(expected).key("width")
+            .displayedName("Width")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(1024)
+            .minInc(2).maxInc(16384)
+            .reconfigurable()
+            .allowedStates(State::ON)
+            .commit();
+
+        UINT32_ELEMENT(expected).key("height")
+            .displayedName("Height")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(1024)
+            .minInc(2).maxInc(16384)
+            .reconfigurable()
+            .allowedStates(State::ON)
+            .commit();
+
+        STRING_ELEMENT(expected).key("pixelFormat")
+            .displayedName("Pixel Format")
+            .description("The format of the frames delivered by the simulated camera. The packed formats are "
+                         "unpacked to 16 bits before being written.")
+            .assignmentOptional().defaultValue("Mono12Packed")
+            .options("Mono8,Mono16,Mono12Packed,Mono10p,Mono12p,RGB8")
+            .reconfigurable()
+            .allowedStates(State::ON)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("frameRate")
+            .displayedName("Frame Rate")
+            .unit(Unit::HERTZ)
+            .assignmentOptional().defaultValue(10.)
+            .minExc(0.).maxInc(10000.)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("rotation")
+            .displayedName("Rotation")
+            .description("The rotation applied to the monochromatic frames after unpacking.")
+            .unit(Unit::DEGREE)
+            .assignmentOptional().defaultValue(0)
+            .options("0,90,180,270")
+            .reconfigurable()
+            .commit();
+
+        BOOL_ELEMENT(expected).key("flipX")
+            .displayedName("Flip X")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        BOOL_ELEMENT(expected).key("flipY")
+            .displayedName("Flip Y")
+            .assignmentOptional().defaultValue(false)
+            .reconfigurable()
+            .commit();
+
+        NODE_ELEMENT(expected).key("pattern")
+            .displayedName("Pattern")
+            .description("The content of the synthetic frames.")
+            .commit();
+
+        BOOL_ELEMENT(expected).key("pattern.gradient")
+            .displayedName("Gradient")
+            .description("A gradient up to half the full scale, otherwise a zero background.")
+            .assignmentOptional().defaultValue(true)
+            .reconfigurable()
+            .commit();
+
+        UINT32_ELEMENT(expected).key("pattern.nSpots")
+            .displayedName("Spots")
+            .description("The number of moving Gaussian spots.")
+            .assignmentOptional().defaultValue(2)
+            .maxInc(100)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("pattern.spotSigma")
+            .displayedName("Spot Sigma")
+            .unit(Unit::PIXEL)
+            .assignmentOptional().defaultValue(20.)
+            .minExc(0.).maxInc(1000.)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("pattern.spotSpeed")
+            .displayedName("Spot Speed")
+            .description("The approximate speed of the spots, in pixels per frame.")
+            .assignmentOptional().defaultValue(2.)
+            .minInc(0.)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("pattern.noise")
+            .displayedName("Noise")
+            .description("The noise amplitude, relative to the full scale.")
+            .assignmentOptional().defaultValue(0.02)
+            .minInc(0.).maxInc(1.)
+            .reconfigurable()
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("actualFrameRate")
+            .displayedName("Actual Frame Rate")
+            .unit(Unit::HERTZ)
+            .readOnly().initialValue(0.)
+            .commit();
+
+        UINT64_ELEMENT(expected).key("lateFrames")
+            .displayedName("Late Frames")
+            .description("The number of frames which could not be produced on time, since the acquisition "
+                         "started.")
+            .readOnly().initialValue(0)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("generationTime")
+            .displayedName("Generation Time")
+            .description("The mean time spent generating a frame.")
+            .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+            .readOnly().initialValue(0.)
+            .commit();
+
+        DOUBLE_ELEMENT(expected).key("processingTime")
+            .displayedName("Processing Time")
+            .description("The mean time from a generated frame to the end of writeChannels, i.e. unpacking, "
+                         "transform and the ImageSource processing and output.")
+            .unit(Unit::SECOND).metricPrefix(MetricPrefix::MILLI)
+            .readOnly().initialValue(0.)
+            .commit();
+
+        SLOT_ELEMENT(expected).key("acquire")
+            .displayedName("Acquire")
+            .allowedStates(State::ON)
+            .commit();
+
+        SLOT_ELEMENT(expected).key("stop")
+            .displayedName("Stop")
+            .allowedStates(State::ACQUIRING)
+            .commit();
+    }
+
+
+    SimulatedCameraImageSource::SimulatedCameraImageSource(const karabo::util::Hash& config)
+        : CameraImageSource(config),
+          m_pixelFormat(util::PixelFormat::MONO16),
+          m_width(0),
+          m_height(0),
+          m_rotation(0),
+          m_flipX(false),
+          m_flipY(false),
+          m_frameRate(10.),
+          m_running(false),
+          m_frameEncoding(Encoding::UNDEFINED),
+          m_frameKType(Types::UNKNOWN) {
+        this->configure_generator(config);
+
+        KARABO_SLOT(acquire)
+        KARABO_SLOT(stop)
+
+        KARABO_INITIAL_FUNCTION(initialize)
+    }
+
+
+    SimulatedCameraImageSource::~SimulatedCameraImageSource() {
+        m_running = false;
+        if (m_acquisitionThread.joinable()) {
+            m_acquisitionThread.join();
+        }
+    }
+
+
+    void SimulatedCameraImageSource::initialize() {
+        this->updateState(State::ON);
+    }
+
+
+    void SimulatedCameraImageSource::preReconfigure(Hash& incomingReconfiguration) {
+        this->configure_generator(incomingReconfiguration);
+        ImageSource::preReconfigure(incomingReconfiguration);
+    }
+
+
+    void SimulatedCameraImageSource::configure_generator(const Hash& config) {
+        // The keys not in config keep their current values
+        auto value = [this, &config](const std::string& key, auto current) {
+            return config.has(key) ? config.get<decltype(current)>(key) : this->get<decltype(current)>(key);
+        };
+
+        if (config.has("frameRate")) {
+            m_frameRate = config.get<double>("frameRate");
+        }
+
+        boost::mutex::scoped_lock lock(m_generatorMtx);
+
+        if (config.has("width") || config.has("height") || config.has("pixelFormat")) {
+            const unsigned int width = value("width", m_width);
+            const unsigned int height = value("height", m_height);
+            const util::PixelFormat format = util::toPixelFormat(value("pixelFormat", std::string()));
+            m_generator.configure(width, height, format); // NB throws on invalid size, leaving the previous one
+            m_width = width;
+            m_height = height;
+            m_pixelFormat = format;
+        }
+
+        if (config.has("pattern")) {
+            m_generator.setPattern(value("pattern.gradient", bool()), value("pattern.nSpots", 0u),
+                                   value("pattern.spotSigma", 0.), value("pattern.spotSpeed", 0.),
+                                   value("pattern.noise", 0.));
+        }
+
+        if (config.has("rotation")) {
+            m_rotation = config.get<unsigned int>("rotation");
+        }
+        if (config.has("flipX")) {
+            m_flipX = config.get<bool>("flipX");
+        }
+        if (config.has("flipY")) {
+            m_flipY = config.get<bool>("flipY");
+        }
+    }
+
+
+    void SimulatedCameraImageSource::acquire() {
+        if (m_acquisitionThread.joinable()) {
+            m_acquisitionThread.join();
+        }
+
+        // Force a schema update on the first frame
+        m_frameShape.clear();
+        m_frameEncoding = Encoding::UNDEFINED;
+        m_frameKType = Types::UNKNOWN;
+
+        this->set("lateFrames", 0ull);
+        this->updateState(State::ACQUIRING);
+
+        m_running = true;
+        m_acquisitionThread = boost::thread(&SimulatedCameraImageSource::acquisition_loop, this);
+    }
+
+
+    void SimulatedCameraImageSource::stop() {
+        m_running = false;
+        if (m_acquisitionThread.joinable()) {
+            m_acquisitionThread.join();
+        }
+
+        this->signalEOS();
+        this->set("actualFrameRate", 0.);
+        this->updateState(State::ON);
+    }
+
+
+    void SimulatedCameraImageSource::acquisition_loop() {
+        this->pinThread("acquisition");
+
+        unsigned long long frameNumber = 0;
+        unsigned long long lateFrames = 0;
+
+        auto statsTime = std::chrono::steady_clock::now();
+        unsigned long long statsFrames = 0;
+        double generationTime = 0.;
+        double processingTime = 0.;
+
+        // The frames are due on absolute deadlines, so that the rate does not drift
+        auto due = std::chrono::steady_clock::now();
+        while (this->wait_until(due)) {
+            try {
+                this->produce_frame(frameNumber, generationTime, processingTime);
+            } catch (const std::exception& e) {
+                KARABO_LOG_FRAMEWORK_DEBUG << "Could not produce frame " << frameNumber << ": " << e.what();
+            }
+            ++frameNumber;
+            ++statsFrames;
+
+            const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(1. / m_frameRate));
+            due += period;
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now > due) {
+                // Late: restart the schedule from now, rather than producing a burst of frames
+                lateFrames += 1 + (now - due) / period;
+                due = now;
+            }
+
+            const std::chrono::duration<double> elapsed = now - statsTime;
+            if (elapsed.count() >= 1.) {
+                this->set(Hash("actualFrameRate", statsFrames / elapsed.count(), "lateFrames", lateFrames,
+                               "generationTime", 1.e3 * generationTime / statsFrames, "processingTime",
+                               1.e3 * processingTime / statsFrames));
+                statsTime = now;
+                statsFrames = 0;
+                generationTime = 0.;
+                processingTime = 0.;
+            }
+        }
+    }
+
+
+    bool SimulatedCameraImageSource::wait_until(const std::chrono::steady_clock::time_point& due) {
+        while (m_running) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= due) {
+                return true;
+            }
+            const auto remaining = due - now;
+            if (remaining > SPIN_TIME) {
+                std::this_thread::sleep_for(
+                      std::min<std::chrono::steady_clock::duration>(remaining - SPIN_TIME, MAX_SLEEP));
+            }
+        }
+        return false;
+    }
+
+
+    void SimulatedCameraImageSource::produce_frame(unsigned long long frameNumber, double& generationTime,
+                                                   double& processingTime) {
+        const auto start = std::chrono::steady_clock::now();
+        const Timestamp timestamp = this->getActualTimestamp();
+
+        NDArray data;
+        EncodingType encoding = Encoding::GRAY;
+        unsigned short bpp;
+        unsigned int rotation;
+        bool flipX, flipY;
+        std::chrono::steady_clock::time_point generated;
+        util::LatencyTrace trace;
+        const bool tracing = this->tracingEnabled();
+        {
+            boost::mutex::scoped_lock lock(m_generatorMtx);
+            const std::vector<uint8_t>& frame = m_generator.generate(frameNumber);
+            generated = std::chrono::steady_clock::now();
+            if (tracing) {
+                trace.mark(util::TraceStage::ACQUIRED, generated);
+            }
+
+            // As a camera driver would do with the frame buffer
+            const Dims shape(m_height, m_width);
+            bpp = util::bitsPerPixel(m_pixelFormat);
+            switch (m_pixelFormat) {
+                case util::PixelFormat::MONO8:
+                    data = this->allocateFrame(shape, Types::UINT8);
+                    std::memcpy(data.getData<uint8_t>(), frame.data(), data.byteSize());
+                    break;
+                case util::PixelFormat::MONO16:
+                    data = this->allocateFrame(shape, Types::UINT16);
+                    std::memcpy(data.getData<uint16_t>(), frame.data(), data.byteSize());
+                    break;
+                case util::PixelFormat::MONO12_PACKED:
+                    data = this->allocateFrame(shape, Types::UINT16);
+                    util::unpackMono12Packed(frame.data(), m_width, m_height, data.getData<uint16_t>());
+                    break;
+                case util::PixelFormat::MONO10P:
+                    data = this->allocateFrame(shape, Types::UINT16);
+                    util::unpackMono10p(frame.data(), m_width, m_height, data.getData<uint16_t>());
+                    break;
+                case util::PixelFormat::MONO12P:
+                    data = this->allocateFrame(shape, Types::UINT16);
+                    util::unpackMono12p(frame.data(), m_width, m_height, data.getData<uint16_t>());
+                    break;
+                case util::PixelFormat::RGB8:
+                    data = this->allocateFrame(Dims(m_height, m_width, 3), Types::UINT8);
+                    std::memcpy(data.getData<uint8_t>(), frame.data(), data.byteSize());
+                    encoding = Encoding::RGB;
+                    break;
+            }
+            if (tracing) {
+                trace.mark(util::TraceStage::UNPACKED);
+            }
+            rotation = m_rotation;
+            flipX = m_flipX;
+            flipY = m_flipY;
+        }
+
+        karabo::xms::ImageData imageData(data, encoding);
+        if (encoding == Encoding::GRAY && (rotation != 0 || flipX || flipY)) {
+            m_transformBuffer.reserve(data.byteSize(), this->memoryPolicy());
+            if (rotation != 0) {
+                util::rotateImage(imageData, rotation, m_transformBuffer.data());
+            }
+            if (flipX || flipY) {
+                util::flipImage(imageData, flipX, flipY, m_transformBuffer.data());
+            }
+            if (tracing) {
+                trace.mark(util::TraceStage::ORIENTED);
+            }
+        }
+
+        const NDArray& image = imageData.getData();
+        const std::vector<unsigned long long> shape = image.getShape().toVector();
+        if (shape != m_frameShape || encoding != m_frameEncoding || image.getType() != m_frameKType) {
+            m_frameShape = shape;
+            m_frameEncoding = encoding;
+            m_frameKType = image.getType();
+            this->updateOutputSchema(shape, encoding, image.getType());
+        }
+
+        Hash header("frameNumber", frameNumber);
+        if (tracing) {
+            trace.attach(header);
+        }
+        this->writeChannels(image, imageData.getBinning(), bpp, encoding, imageData.getROIOffsets(), timestamp,
+                            header);
+
+        const auto end = std::chrono::steady_clock::now();
+        generationTime += std::chrono::duration<double>(generated - start).count();
+        processingTime += std::chrono::duration<double>(end - generated).count();
+    }
+
+} // namespace karabo
@@ -0,0 +1,83 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_SIMULATEDCAMERAIMAGESOURCE_HH
+#define KARABO_SIMULATEDCAMERAIMAGESOURCE_HH
+
+#include <atomic>
+#include <chrono>
+#include <karabo/karabo.hpp>
+
+#include "CameraImageSource.hh"
+#include "FrameGenerator.hh"
+#include "version.hh" // provides IMAGESOURCE_PACKAGE_VERSION
+
+/**
+ * The main Karabo namespace
+ */
+namespace karabo {
+
+    /**
+     * @brief A simulated camera, generating synthetic frames at a given rate, for load testing.
+     *
+     * The frames (a gradient, moving Gaussian spots and noise) are generated in the camera pixel format, e.g.
+     * packed 12-bit, and then take the same path as the frames of a real camera: unpacking, rotation and flip,
+     * and writeChannels. The frames are scheduled on absolute deadlines by a dedicated thread, and the achieved
+     * rate, the frames which could not be produced on time, and the time spent per frame are published.
+     */
+    class SimulatedCameraImageSource : public CameraImageSource {
+
+    public:
+        KARABO_CLASSINFO(SimulatedCameraImageSource, "SimulatedCameraImageSource", IMAGESOURCE_PACKAGE_VERSION)
+
+        static void expectedParameters(karabo::util::Schema& expected);
+
+        explicit SimulatedCameraImageSource(const karabo::util::Hash& config);
+
+        virtual ~SimulatedCameraImageSource();
+
+    protected:
+        void preReconfigure(karabo::util::Hash& incomingReconfiguration) override;
+
+    private:
+        boost::mutex m_generatorMtx; // Protect the frame generator and the transform parameters
+        util::FrameGenerator m_generator;
+        util::PixelFormat m_pixelFormat;
+        unsigned int m_width;
+        unsigned int m_height;
+        unsigned int m_rotation;
+        bool m_flipX;
+        bool m_flipY;
+
+        std::atomic<double> m_frameRate;
+        std::atomic<bool> m_running;
+        boost::thread m_acquisitionThread;
+        // Only used by the acquisition thread
+        util::PlacedBuffer m_transformBuffer;
+        std::vector<unsigned long long> m_frameShape; // The properties of the frames passed to writeChannels
+        int m_frameEncoding;
+        int m_frameKType;
+
+        void initialize();
+
+        void acquire();
+
+        void stop();
+
+        void configure_generator(const karabo::util::Hash& config);
+
+        void acquisition_loop();
+
+        bool wait_until(const std::chrono::steady_clock::time_point& due);
+
+        void produce_frame(unsigned long long frameNumber, double& generationTime, double& processingTime);
+    };
+
+} // namespace karabo
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include "SpotFinder.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    namespace {
+
+        // The moments of the pixels with a given provisional label
+        struct Moments {
+            double sum = 0.;
+            double sumX = 0.;
+            double sumY = 0.;
+            double posX = 0.; // unweighted sums of the coordinates
+            double posY = 0.;
+            double peak = std::numeric_limits<double>::lowest();
+            unsigned int area = 0;
+
+            void merge(const Moments& other) {
+                sum += other.sum;
+                sumX += other.sumX;
+                sumY += other.sumY;
+                posX += other.posX;
+                posY += other.posY;
+                peak = std::max(peak, other.peak);
+                area += other.area;
+            }
+        };
+
+
+        class UnionFind {
+           public:
+            // Label 0 is the background
+            UnionFind() : m_parent(1, 0) {}
+
+            uint32_t add() {
+                const uint32_t label = m_parent.size();
+                m_parent.push_back(label);
+                return label;
+            }
+
+            uint32_t find(uint32_t label) {
+                while (m_parent[label] != label) {
+                    m_parent[label] = m_parent[m_parent[label]]; // path halving
+                    label = m_parent[label];
+                }
+                return label;
+            }
+
+            // Return the root of the merged set: the smaller label, so that labels only decrease
+            uint32_t unite(uint32_t a, uint32_t b) {
+                a = this->find(a);
+                b = this->find(b);
+                if (a < b) {
+                    m_parent[b] = a;
+                    return a;
+                } else {
+                    m_parent[a] = b;
+                    return b;
+                }
+            }
+
+            size_t size() const {
+                return m_parent.size();
+            }
+
+           private:
+            std::vector<uint32_t> m_parent;
+        };
+
+
+        template <class T>
+        T maskThreshold(double threshold) {
+            if (std::is_integral<T>::value) {
+                // v > threshold <=> v > floor(threshold), for integer v
+                const double lo = static_cast<double>(std::numeric_limits<T>::lowest());
+                const double hi = static_cast<double>(std::numeric_limits<T>::max());
+                return static_cast<T>(std::min(std::max(std::floor(threshold), lo), hi));
+            } else {
+                return static_cast<T>(threshold);
+            }
+        }
+
+    } // namespace
+
+
+    size_t util::findSpots(const NDArray& arr, std::vector<Spot>& spots, double threshold, unsigned int minArea,
+                           unsigned int maxSpots) {
+        switch (arr.getType()) {
+            case Types::UINT8:
+                return util::find_spots<uint8_t>(arr, spots, threshold, minArea, maxSpots);
+            case Types::INT8:
+                return util::find_spots<int8_t>(arr, spots, threshold, minArea, maxSpots);
+            case Types::UINT16:
+                return util::find_spots<uint16_t>(arr, spots, threshold, minArea, maxSpots);
+            case Types::INT16:
+                return util::find_spots<int16_t>(arr, spots, threshold, minArea, maxSpots);
+            case Types::UINT32:
+                return util::find_spots<uint32_t>(arr, spots, threshold, minArea, maxSpots);
+            case Types::INT32:
+                return util::find_spots<int32_t>(arr, spots, threshold, minArea, maxSpots);
+            case Types::FLOAT:
+                return util::find_spots<float>(arr, spots, threshold, minArea, maxSpots);
+            case Types::DOUBLE:
+                return util::find_spots<double>(arr, spots, threshold, minArea, maxSpots);
+            default:
+                throw KARABO_PARAMETER_EXCEPTION("Cannot find spots in images of type " + toString(arr.getType()));
+        }
+    }
+
+
+    template <class T>
+    size_t util::find_spots(const NDArray& arr, std::vector<Spot>& spots, double threshold, unsigned int minArea,
+                            unsigned int maxSpots) {
+        const Dims shape = arr.getShape();
+        if (shape.rank() != 2) {
+            throw KARABO_NOT_IMPLEMENTED_EXCEPTION("Can only find spots in monochromatic images");
+        }
+
+        const size_t height = shape.x1();
+        const size_t width = shape.x2();
+        const T* data = arr.getData<T>();
+        const T thr = maskThreshold<T>(threshold);
+        // NB integer images with a threshold below their range: every pixel is above threshold
+        const bool all = std::is_integral<T>::value && threshold < static_cast<double>(std::numeric_limits<T>::lowest());
+
+        UnionFind labels;
+        std::vector<Moments> moments(1);
+
+        // Labels of the previous and current row, padded by one column on each side
+        std::vector<uint32_t> prevRow(width + 2, 0), curRow(width + 2, 0);
+        std::vector<uint8_t> mask(width);
+
+        for (size_t y = 0; y < height; ++y) {
+            const T* row = data + y * width;
+            uint8_t* m = mask.data();
+            for (size_t x = 0; x < width; ++x) {
+                m[x] = (row[x] > thr) | all;
+            }
+
+            uint32_t* prev = prevRow.data() + 1;
+            uint32_t* cur = curRow.data() + 1;
+            for (size_t x = 0; x < width; ++x) {
+                if (!m[x]) {
+                    cur[x] = 0;
+                    continue;
+                }
+
+                // The already visited 8-neighbours: left, upper-left, up, upper-right
+                uint32_t label = 0;
+                for (const uint32_t neighbour : {cur[x - 1], prev[x - 1], prev[x], prev[x + 1]}) {
+                    if (neighbour == 0) continue;
+                    label = (label == 0) ? neighbour : labels.unite(label, neighbour);
+                }
+                if (label == 0) {
+                    label = labels.add();
+                    moments.emplace_back();
+                }
+                cur[x] = label;
+
+                const double v = static_cast<double>(row[x]);
+                Moments& mom = moments[label];
+                mom.sum += v;
+                mom.sumX += v * x;
+                mom.sumY += v * y;
+                mom.posX += x;
+                mom.posY += y;
+                mom.peak = std::max(mom.peak, v);
+                ++mom.area;
+            }
+
+            prevRow.swap(curRow);
+        }
+
+        // Sum up the moments of each connected component in its root label
+        for (size_t label = 1; label < labels.size(); ++label) {
+            const uint32_t root = labels.find(label);
+            if (root != label) {
+                moments[root].merge(moments[label]);
+                moments[label].area = 0;
+            }
+        }
+
+        spots.clear();
+        for (size_t label = 1; label < labels.size(); ++label) {
+            const Moments& mom = moments[label];
+            if (mom.area == 0 || mom.area < minArea) {
+                continue;
+            }
+            Spot spot;
+            spot.integral = mom.sum;
+            spot.peak = mom.peak;
+            spot.area = mom.area;
+            if (mom.sum > 0.) {
+                spot.x = mom.sumX / mom.sum;
+                spot.y = mom.sumY / mom.sum;
+            } else {
+                // e.g. negative threshold: use the geometric centre
+                spot.x = mom.posX / mom.area;
+                spot.y = mom.posY / mom.area;
+            }
+            spots.push_back(spot);
+        }
+
+        const size_t nSpots = spots.size();
+        if (nSpots > maxSpots) {
+            std::partial_sort(spots.begin(), spots.begin() + maxSpots, spots.end(),
+                              [](const Spot& a, const Spot& b) { return a.integral > b.integral; });
+            spots.resize(maxSpots);
+        } else {
+            std::sort(spots.begin(), spots.end(), [](const Spot& a, const Spot& b) { return a.integral > b.integral; });
+        }
+
+        return nSpots;
+    }
+
+} // namespace karabo
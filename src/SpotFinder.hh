@@ -0,0 +1,61 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_SPOTFINDER_HH
+#define KARABO_SPOTFINDER_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief A bright spot, i.e. a connected set of pixels above threshold. Positions are in pixels of the
+         * image.
+         */
+        struct Spot {
+            double x = 0.;        // intensity-weighted centroid
+            double y = 0.;
+            double integral = 0.; // sum of the pixel values
+            double peak = 0.;     // largest pixel value
+            unsigned int area = 0; // number of pixels
+        };
+
+        /**
+         * @brief Find the bright spots in an image.
+         *
+         * The pixels above threshold are labelled in a single pass, with 8-connectivity: each row is first
+         * converted into a mask, then the labels are propagated from the left and the previous row, and the
+         * labels meeting each other are merged with a union-find structure. The moments are accumulated per label
+         * during the scan, and summed up per connected component at the end. Only two rows of labels are kept.
+         *
+         * @param arr The NDArray object - to be analysed. It must be a monochromatic image.
+         * @param spots The spots found, sorted by decreasing integral. The vector is reused, to avoid allocations.
+         * @param threshold The pixels with value larger than threshold belong to spots.
+         * @param minArea The spots with smaller area are discarded.
+         * @param maxSpots The maximum number of spots returned.
+         * @return The total number of spots found, which can be larger than maxSpots.
+         */
+        size_t findSpots(const karabo::util::NDArray& arr, std::vector<Spot>& spots, double threshold,
+                         unsigned int minArea = 1, unsigned int maxSpots = 100);
+
+        /**
+         * @brief Find the bright spots in an image.
+         *
+         * @param T The pixel data type, e.g. uint16_t.
+         * See findSpots for the other parameters.
+         */
+        template <class T>
+        size_t find_spots(const karabo::util::NDArray& arr, std::vector<Spot>& spots, double threshold,
+                          unsigned int minArea, unsigned int maxSpots);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
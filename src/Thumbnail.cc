@@ -0,0 +1,65 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "DisplayLut.hh"
+#include "ImageBinning.hh"
+#include "JpegCodec.hh"
+#include "Thumbnail.hh"
+
+using namespace std;
+
+USING_KARABO_NAMESPACES;
+
+namespace karabo {
+
+    unsigned int util::thumbnailFactor(const Dims& shape, unsigned int maxSize) {
+        if (maxSize == 0) {
+            throw KARABO_PARAMETER_EXCEPTION("The thumbnail size must be positive");
+        }
+
+        const unsigned long long size = std::max(shape.x1(), shape.x2());
+        return std::max<unsigned long long>((size + maxSize - 1) / maxSize, 1);
+    }
+
+
+    void util::downscaleImage(karabo::xms::ImageData& imd, unsigned int maxSize) {
+        if (!imd.isIndexable()) {
+            throw KARABO_PARAMETER_EXCEPTION("Cannot downscale non-indexable image");
+        }
+
+        const unsigned int factor = util::thumbnailFactor(imd.getDimensions(), maxSize);
+        if (factor > 1) {
+            util::binImage(imd, factor, factor, BinningMode::MEAN);
+            return;
+        }
+
+        const NDArray& arr = imd.getData();
+        NDArray copy(arr.getShape(), arr.getType());
+        std::memcpy(copy.getData<char>(), arr.getData<char>(), arr.byteSize());
+        const Dims dims = copy.getShape();
+        imd.setData(copy);
+        imd.setDimensions(dims);
+    }
+
+
+    void util::encodeThumbnail(karabo::xms::ImageData& imd, unsigned int quality) {
+        if (imd.getData().getType() == Types::UINT16) {
+            const unsigned short bpp = imd.getBitsPerPixel();
+            const unsigned int bits = (bpp > 0 && bpp <= 16) ? bpp : 16;
+            std::vector<uint8_t> lut;
+            util::buildDisplayLut(lut, 0., std::ldexp(1., bits) - 1., LutMode::LINEAR);
+            util::applyDisplayLut(imd, lut);
+        }
+
+        util::encodeJPEG(imd, quality);
+    }
+
+} // namespace karabo
@@ -0,0 +1,52 @@
+/*
+ * Author: <parenti>
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+#ifndef KARABO_THUMBNAIL_HH
+#define KARABO_THUMBNAIL_HH
+
+#include <karabo/karabo.hpp>
+
+namespace karabo {
+
+    namespace util {
+
+        /**
+         * @brief The smallest integer downscale factor, so that an image fits in a square of a given size.
+         *
+         * @param shape The image shape, i.e. (height, width) or (height, width, channel).
+         * @param maxSize The maximum height and width of the downscaled image. It must be positive.
+         */
+        unsigned int thumbnailFactor(const karabo::util::Dims& shape, unsigned int maxSize);
+
+        /**
+         * @brief Downscale an image, so that it fits in a square of a given size.
+         *
+         * The image is binned in MEAN mode by thumbnailFactor, and its binning is updated. The input data are
+         * never modified: if no downscaling is needed, the pixel data are copied.
+         *
+         * @param imd The ImageData object - to be downscaled. It must be indexable, with shape (height, width) or
+         * (height, width, channel).
+         * @param maxSize The maximum height and width of the downscaled image.
+         */
+        void downscaleImage(karabo::xms::ImageData& imd, unsigned int maxSize);
+
+        /**
+         * @brief Encode a thumbnail image as JPEG.
+         *
+         * UINT16 images are first mapped linearly to 8 bits, from the range given by their bits-per-pixel,
+         * rather than only keeping their most significant byte as encodeJPEG does.
+         *
+         * @param imd The ImageData object - to be encoded. It must be a GRAY or RGB image of type UINT8 or UINT16.
+         * @param quality The JPEG quality, in [1, 100].
+         */
+        void encodeThumbnail(karabo::xms::ImageData& imd, unsigned int quality);
+
+    } // namespace util
+} // namespace karabo
+
+#endif
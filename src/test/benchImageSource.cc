@@ -0,0 +1,221 @@
+/*
+ * Author: parenti
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+/*
+ * Benchmarks of the image utilities, from VGA to 25 MP images.
+ *
+ * Every benchmark reports the throughput in bytes per second - the size of the input image, or of the decoded
+ * image for decodeJPEG - and in frames per second ('fps'). Run with
+ *
+ *     bench-imageSource --benchmark_out=bench.json --benchmark_out_format=json
+ *
+ * to archive the results.
+ */
+
+#include <benchmark/benchmark.h>
+#include <random>
+
+#include "FrameGenerator.hh"
+#include "ImageSource.hh"
+
+using namespace karabo::util;
+using karabo::xms::Encoding;
+using karabo::xms::ImageData;
+
+
+namespace {
+
+    // (width, height): VGA, 1.3 MP, 5 MP, 25 MP
+    const std::vector<std::pair<int, int>> IMAGE_SIZES = {{640, 480}, {1280, 1024}, {2448, 2048}, {5120, 5120}};
+
+
+    void imageSizes(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"width", "height"});
+        for (const auto& size : IMAGE_SIZES) {
+            b->Args({size.first, size.second});
+        }
+    }
+
+
+    void imageSizesAndBpp(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"width", "height", "bpp"});
+        for (int bpp = 9; bpp <= 15; ++bpp) {
+            for (const auto& size : IMAGE_SIZES) {
+                b->Args({size.first, size.second, bpp});
+            }
+        }
+    }
+
+
+    void imageSizesAndQuality(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"width", "height", "quality"});
+        for (int quality : {50, 75, 90, 100}) {
+            for (const auto& size : IMAGE_SIZES) {
+                b->Args({size.first, size.second, quality});
+            }
+        }
+    }
+
+
+    void imageSizesAndAngle(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"width", "height", "angle"});
+        for (int angle : {90, 180, 270}) {
+            for (const auto& size : IMAGE_SIZES) {
+                b->Args({size.first, size.second, angle});
+            }
+        }
+    }
+
+
+    // flip: 1 for X, 2 for Y, 3 for both
+    void imageSizesAndFlip(benchmark::internal::Benchmark* b) {
+        b->ArgNames({"width", "height", "flip"});
+        for (int flip : {1, 2, 3}) {
+            for (const auto& size : IMAGE_SIZES) {
+                b->Args({size.first, size.second, flip});
+            }
+        }
+    }
+
+
+    void setThroughput(benchmark::State& state, size_t frameBytes) {
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * frameBytes);
+        state.counters["fps"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+    }
+
+
+    std::vector<uint8_t> randomBytes(size_t size) {
+        std::vector<uint8_t> bytes(size);
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<int> distribution(0, 255);
+        for (uint8_t& byte : bytes) {
+            byte = distribution(generator);
+        }
+        return bytes;
+    }
+
+
+    // A camera-like frame, as JPEG compression depends on the content
+    ImageData syntheticImage(unsigned int width, unsigned int height) {
+        FrameGenerator generator;
+        generator.configure(width, height, PixelFormat::MONO8);
+        generator.setPattern(true, 3, 0.02 * width, 0., 0.02);
+        const std::vector<uint8_t>& frame = generator.generate(0);
+        return ImageData(NDArray(frame.data(), generator.frameSize(), Dims(height, width)), Encoding::GRAY);
+    }
+
+
+    template <class T>
+    NDArray randomArray(unsigned int width, unsigned int height) {
+        const std::vector<uint8_t> bytes = randomBytes(static_cast<size_t>(width) * height * sizeof(T));
+        return NDArray(reinterpret_cast<const T*>(bytes.data()), static_cast<size_t>(width) * height,
+                       Dims(height, width));
+    }
+
+} // namespace
+
+
+static void BM_unpackMono12Packed(benchmark::State& state) {
+    const unsigned int width = state.range(0);
+    const unsigned int height = state.range(1);
+    const std::vector<uint8_t> packed = randomBytes(static_cast<size_t>(width) * height * 3 / 2);
+    std::vector<uint16_t> unpacked(static_cast<size_t>(width) * height);
+
+    for (auto _ : state) {
+        unpackMono12Packed(packed.data(), width, height, unpacked.data());
+        benchmark::DoNotOptimize(unpacked.data());
+        benchmark::ClobberMemory();
+    }
+    setThroughput(state, packed.size());
+}
+BENCHMARK(BM_unpackMono12Packed)->Apply(imageSizes)->Unit(benchmark::kMillisecond);
+
+
+static void BM_unpackMonoXXp(benchmark::State& state) {
+    const unsigned int width = state.range(0);
+    const unsigned int height = state.range(1);
+    const uint8_t bpp = state.range(2);
+    // NB unpackMonoXXp reads 16 bits at a time
+    const std::vector<uint8_t> packed = randomBytes((static_cast<size_t>(width) * height * bpp + 7) / 8 + 2);
+    std::vector<uint16_t> unpacked(static_cast<size_t>(width) * height);
+
+    for (auto _ : state) {
+        unpackMonoXXp(packed.data(), width, height, bpp, unpacked.data());
+        benchmark::DoNotOptimize(unpacked.data());
+        benchmark::ClobberMemory();
+    }
+    setThroughput(state, packed.size() - 2);
+}
+BENCHMARK(BM_unpackMonoXXp)->Apply(imageSizesAndBpp)->Unit(benchmark::kMillisecond);
+
+
+static void BM_encodeJPEG(benchmark::State& state) {
+    const ImageData image = syntheticImage(state.range(0), state.range(1));
+    const unsigned int quality = state.range(2);
+
+    for (auto _ : state) {
+        ImageData imd(image); // NB The input pixel data are shared, and not modified
+        encodeJPEG(imd, quality);
+        benchmark::DoNotOptimize(imd.getData().getData<uint8_t>());
+    }
+    setThroughput(state, image.getData().byteSize());
+}
+BENCHMARK(BM_encodeJPEG)->Apply(imageSizesAndQuality)->Unit(benchmark::kMillisecond);
+
+
+static void BM_decodeJPEG(benchmark::State& state) {
+    const ImageData image = syntheticImage(state.range(0), state.range(1));
+    ImageData encoded(image);
+    encodeJPEG(encoded, state.range(2));
+
+    for (auto _ : state) {
+        ImageData imd(encoded); // NB The input pixel data are shared, and not modified
+        decodeJPEG(imd);
+        benchmark::DoNotOptimize(imd.getData().getData<uint8_t>());
+    }
+    setThroughput(state, image.getData().byteSize());
+}
+BENCHMARK(BM_decodeJPEG)->Apply(imageSizesAndQuality)->Unit(benchmark::kMillisecond);
+
+
+template <class T>
+static void BM_rotateImage(benchmark::State& state) {
+    ImageData imd(randomArray<T>(state.range(0), state.range(1)), Encoding::GRAY);
+    const unsigned int angle = state.range(2);
+    std::vector<T> buffer(imd.getData().size());
+
+    for (auto _ : state) {
+        rotateImage(imd, angle, buffer.data()); // NB A 90-degree rotation alternates the shape
+        benchmark::ClobberMemory();
+    }
+    setThroughput(state, imd.getData().byteSize());
+}
+BENCHMARK_TEMPLATE(BM_rotateImage, uint8_t)->Apply(imageSizesAndAngle)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_rotateImage, uint16_t)->Apply(imageSizesAndAngle)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_rotateImage, uint32_t)->Apply(imageSizesAndAngle)->Unit(benchmark::kMillisecond);
+
+
+template <class T>
+static void BM_flipImage(benchmark::State& state) {
+    ImageData imd(randomArray<T>(state.range(0), state.range(1)), Encoding::GRAY);
+    const bool flipX = state.range(2) & 1;
+    const bool flipY = state.range(2) & 2;
+    std::vector<T> buffer(imd.getData().size());
+
+    for (auto _ : state) {
+        flipImage(imd, flipX, flipY, buffer.data());
+        benchmark::ClobberMemory();
+    }
+    setThroughput(state, imd.getData().byteSize());
+}
+BENCHMARK_TEMPLATE(BM_flipImage, uint8_t)->Apply(imageSizesAndFlip)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_flipImage, uint16_t)->Apply(imageSizesAndFlip)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_flipImage, uint32_t)->Apply(imageSizesAndFlip)->Unit(benchmark::kMillisecond);
+
+
+BENCHMARK_MAIN();
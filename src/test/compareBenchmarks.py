@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+#
+# Author: parenti
+#
+# Created on October 19, 2026
+#
+# Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+#
+"""Compare the results of bench-imageSource with a baseline.
+
+The throughput (bytes per second, or frames per second) of every benchmark is
+compared with the baseline, and the comparison is written as a table. The
+exit code is 1 if the throughput of any benchmark dropped by more than the
+tolerance, 2 on error, 77 (SKIPPED) if the baseline is empty, i.e. has not
+been recorded yet, and 0 otherwise.
+
+Benchmarks which are not in the baseline, e.g. new ones, are reported but
+cannot fail. With --update, the results replace the baseline.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+# The exit code of a skipped test, see the SKIP_RETURN_CODE property of CTest
+SKIPPED = 77
+
+
+def read_results(path):
+    """Return the context and the throughput per benchmark in a Google
+    Benchmark JSON file.
+
+    With repetitions, the median is used if it was reported, and the best
+    repetition otherwise.
+    """
+    with open(path) as f:
+        content = json.load(f)
+    medians = {}
+    best = {}
+    for bench in content.get("benchmarks", []):
+        if bench.get("error_occurred"):
+            continue
+        value = bench.get("bytes_per_second", bench.get("fps"))
+        if value is None:
+            continue
+        name = bench.get("run_name", bench["name"])
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[name] = value
+        else:
+            best[name] = max(value, best.get(name, 0.))
+    best.update(medians)
+    return content.get("context", {}), best
+
+
+def format_rate(value):
+    if value is None:
+        return "-"
+    for scale, unit in ((1e9, "G/s"), (1e6, "M/s"), (1e3, "k/s")):
+        if value >= scale:
+            return f"{value / scale:.2f} {unit}"
+    return f"{value:.2f} /s"
+
+
+def compare(baseline, current, tolerance):
+    """Return the table rows, and the number of regressions."""
+    rows = []
+    regressions = 0
+    for name in sorted(set(baseline) | set(current)):
+        old = baseline.get(name)
+        new = current.get(name)
+        if old is None:
+            change, status = "", "new"
+        elif new is None:
+            change, status = "", "not run"
+        else:
+            ratio = new / old - 1.
+            change = f"{100. * ratio:+.1f}%"
+            if ratio < -tolerance:
+                status = "REGRESSION"
+                regressions += 1
+            elif ratio > tolerance:
+                status = "faster"
+            else:
+                status = "ok"
+        rows.append((name, format_rate(old), format_rate(new), change,
+                     status))
+    return rows, regressions
+
+
+def format_table(rows):
+    header = ("Benchmark", "Baseline", "Current", "Change", "Status")
+    widths = [max(len(row[i]) for row in rows + [header])
+              for i in range(len(header))]
+    lines = []
+    for row in [header, tuple("-" * w for w in widths)] + rows:
+        cells = [row[0].ljust(widths[0])]
+        cells += [cell.rjust(width) for cell, width in
+                  zip(row[1:4], widths[1:4])]
+        cells.append(row[4])
+        lines.append("  ".join(cells))
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--baseline", required=True,
+                        help="The baseline JSON file")
+    parser.add_argument("--results", required=True,
+                        help="The results JSON file, written if --benchmark "
+                             "is given")
+    parser.add_argument("--benchmark",
+                        help="The benchmark executable to run first")
+    parser.add_argument("--tolerance", type=float, default=0.1,
+                        help="The relative throughput drop considered as a "
+                             "regression, e.g. 0.1 for 10%%")
+    parser.add_argument("--table", help="The file to write the table to")
+    parser.add_argument("--update", action="store_true",
+                        help="Replace the baseline with the results")
+    parser.add_argument("args", nargs="*",
+                        help="Further arguments to the benchmark executable, "
+                             "after '--'")
+    args = parser.parse_args()
+
+    try:
+        if not args.update:
+            # Do not run the benchmarks for nothing
+            baseline_context, baseline = read_results(args.baseline)
+            if not baseline:
+                message = (f"SKIPPED: the baseline {args.baseline} is empty: "
+                           f"record it with the update-bench-baseline "
+                           f"target.\n")
+                sys.stdout.write(message)
+                if args.table:
+                    with open(args.table, "w") as f:
+                        f.write(message)
+                return SKIPPED
+        if args.benchmark:
+            subprocess.run([args.benchmark,
+                            f"--benchmark_out={args.results}",
+                            "--benchmark_out_format=json"] + args.args,
+                           check=True)
+        context, current = read_results(args.results)
+        if args.update:
+            with open(args.results) as f:
+                content = json.load(f)
+            with open(args.baseline, "w") as f:
+                json.dump(content, f, indent=2)
+                f.write("\n")
+            print(f"Updated {args.baseline} with {len(current)} benchmarks")
+            return 0
+    except (OSError, ValueError, KeyError,
+            subprocess.CalledProcessError) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        return 2
+
+    rows, regressions = compare(baseline, current, args.tolerance)
+    table = format_table(rows) if rows else "No benchmark results\n"
+    notes = []
+    if baseline_context.get("host_name") != context.get("host_name"):
+        notes.append(f"The baseline was recorded on "
+                     f"'{baseline_context.get('host_name')}', not on "
+                     f"'{context.get('host_name')}': the comparison may be "
+                     f"meaningless.")
+    notes.append(f"{regressions} regression(s) of more than "
+                 f"{100. * args.tolerance:.0f}%.")
+    table += "\n" + "\n".join(notes) + "\n"
+
+    sys.stdout.write(table)
+    if args.table:
+        with open(args.table, "w") as f:
+            f.write(table)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -8,10 +8,17 @@
 
 #include "CameraImageSource.hh"
 #include "ImageSource.hh"
+#include "SimulatedCameraImageSource.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/shared_ptr.hpp>
+#include <chrono>
+#include <condition_variable>
 #include <gtest/gtest.h>
+#include <mutex>
 #include <thread>
+#include <unistd.h>
 #include <utility>
 
 #include "karabo/util/Hash.hh"
@@ -81,6 +88,149 @@ TEST_F(ImageSourceFixture, testDeviceInstantiation) {
     ASSERT_STREQ(cls.c_str(), "ImageSource");
 }
 
+
+namespace karabo {
+
+    /**
+     * @brief An ImageSource exposing its interface to the derived classes, for the tests.
+     */
+    class SchemaTestImageSource : public ImageSource {
+       public:
+        KARABO_CLASSINFO(SchemaTestImageSource, "SchemaTestImageSource", IMAGESOURCE_PACKAGE_VERSION)
+
+        static void expectedParameters(karabo::util::Schema& expected) {}
+
+        explicit SchemaTestImageSource(const karabo::util::Hash& config) : ImageSource(config) {}
+
+        using ImageSource::preReconfigure;
+        using ImageSource::updateOutputSchema;
+        using ImageSource::writeChannels;
+    };
+
+    KARABO_REGISTER_FOR_CONFIGURATION(core::BaseDevice, core::Device<>, ImageSource, SchemaTestImageSource)
+
+} // namespace karabo
+
+
+/**
+ * @brief Occupy all the threads of the event loop, i.e. delay the output schema updates, until released.
+ */
+class EventLoopBlocker {
+   public:
+    EventLoopBlocker() : m_threads(karabo::net::EventLoop::getNumberOfThreads()), m_blocked(0), m_released(false) {
+        for (size_t i = 0; i < m_threads; ++i) {
+            karabo::net::EventLoop::getIOService().post([this]() {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                ++m_blocked;
+                m_condition.notify_all();
+                m_condition.wait(lock, [this]() { return m_released; });
+                --m_blocked;
+                m_condition.notify_all();
+            });
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_blocked == m_threads; });
+    }
+
+    ~EventLoopBlocker() {
+        this->release();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_blocked == 0; });
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_released = true;
+        m_condition.notify_all();
+    }
+
+   private:
+    const size_t m_threads;
+    size_t m_blocked;
+    bool m_released;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+
+/**
+ * @brief Test fixture for the output schema updates.
+ */
+class SchemaUpdateFixture : public KaraboDeviceFixture {
+   protected:
+    void SetUp() override {
+        karabo::core::BaseDevice::Pointer base_device;
+        // The statistics of every frame written are published
+        const karabo::util::Hash devCfg("_deviceId_", TEST_DEVICE_ID "Schema", "frameStatistics.enable", true,
+                                        "frameStatistics.updatePeriod", 0u);
+        instantiateAndGetPointer("SchemaTestImageSource", TEST_DEVICE_ID "Schema", devCfg, base_device);
+        device = boost::dynamic_pointer_cast<karabo::SchemaTestImageSource>(base_device);
+        ASSERT_TRUE(device);
+    }
+
+    std::vector<unsigned long long> outputDims() const {
+        return device->getFullSchema().getDefaultValue<std::vector<unsigned long long>>(
+              "output.schema.data.image.dims");
+    }
+
+    unsigned long long schemaUpdates() const {
+        return device->get<unsigned long long>("outputSchemaUpdates");
+    }
+
+    // Write a uniform GRAY UINT16 frame
+    void writeFrame(const std::vector<unsigned long long>& shape, unsigned short value) {
+        using namespace karabo::util;
+        std::vector<unsigned short> pixels(shape[0] * shape[1], value);
+        const NDArray data(pixels.data(), pixels.size(), NDArray::NullDeleter(), Dims(shape));
+        device->writeChannels(data, Dims(1, 1), 16, karabo::xms::Encoding::GRAY, Dims(0, 0), Timestamp(), Hash());
+    }
+
+    // Wait for the condition to be true, for at most 5 s
+    template <class Condition>
+    static bool waitFor(Condition condition) {
+        for (int i = 0; i < 500; ++i) {
+            if (condition()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return condition();
+    }
+
+    boost::shared_ptr<karabo::SchemaTestImageSource> device;
+};
+
+
+TEST_F(SchemaUpdateFixture, RepeatedProperties) {
+    using karabo::util::Types;
+    using karabo::xms::Encoding;
+
+    const std::vector<unsigned long long> shape = {100, 200};
+    device->updateOutputSchema(shape, Encoding::GRAY, Types::UINT16);
+    ASSERT_TRUE(waitFor([&]() { return this->outputDims() == shape && this->schemaUpdates() == 1ull; }));
+
+    // The same properties again: no further update
+    for (int i = 0; i < 1000; ++i) {
+        device->updateOutputSchema(shape, Encoding::GRAY, Types::UINT16);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(1ull, this->schemaUpdates());
+    ASSERT_EQ(shape, this->outputDims());
+
+    // Changed properties: the schema follows
+    const std::vector<unsigned long long> other = {120, 160};
+    device->updateOutputSchema(other, Encoding::GRAY, Types::UINT8);
+    ASSERT_TRUE(waitFor([&]() { return this->outputDims() == other && this->schemaUpdates() == 2ull; }));
+    ASSERT_EQ(static_cast<int>(Types::UINT8),
+              device->getFullSchema().getDefaultValue<int>("output.schema.data.image.pixels.type"));
+
+    // ... and back, e.g. from the cached update
+    device->updateOutputSchema(shape, Encoding::GRAY, Types::UINT16);
+    ASSERT_TRUE(waitFor([&]() { return this->outputDims() == shape && this->schemaUpdates() == 3ull; }));
+    ASSERT_EQ(static_cast<int>(Types::UINT16),
+              device->getFullSchema().getDefaultValue<int>("output.schema.data.image.pixels.type"));
+}
+
 // arguments to TEST are just strings to name your tests
 TEST(UnpackTests, Mono12Packed) {
     std::vector<uint8_t> packedData(3);
@@ -641,3 +791,1332 @@ TEST(FlipTests, Flip) {
         }
     }
 }
+
+TEST(BinningTests, Crop) {
+    using namespace karabo::util;
+    using namespace karabo::xms;
+
+    uint16_t data_in[] = {
+        0x01, 0x02, 0x03, 0x04, 0x05,
+        0x06, 0x07, 0x08, 0x09, 0x0A,
+        0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+        0x10, 0x11, 0x12, 0x13, 0x14};
+
+    uint16_t expected_data[] = {
+        0x08, 0x09, 0x0A,
+        0x0D, 0x0E, 0x0F};
+
+    const Dims shape(4, 5);
+    NDArray arr_in(data_in, shape.size(), NDArray::NullDeleter(), shape);
+    ImageData imd(arr_in);
+    imd.setBinning(Dims(2, 2));
+    imd.setROIOffsets(Dims(10, 20));
+
+    karabo::util::cropImage(imd, Dims(1, 2), Dims(2, 3));
+
+    const NDArray& arr_out = imd.getData();
+    const uint16_t* data_out = arr_out.getData<uint16_t>();
+    ASSERT_EQ(2ull, arr_out.getShape().x1());
+    ASSERT_EQ(3ull, arr_out.getShape().x2());
+    ASSERT_EQ((int)karabo::util::Types::UINT16, (int)arr_out.getType());
+    // ROI offsets are in sensor pixels, i.e. unbinned
+    ASSERT_EQ(12ull, imd.getROIOffsets().x1());
+    ASSERT_EQ(24ull, imd.getROIOffsets().x2());
+    for (size_t i = 0; i < 6; ++i) {
+        ASSERT_EQ(expected_data[i], data_out[i]);
+    }
+
+    // The ROI must be inside the image
+    ImageData imd2(arr_in);
+    ASSERT_THROW(karabo::util::cropImage(imd2, Dims(3, 0), Dims(2, 2)), karabo::util::ParameterException);
+}
+
+TEST(BinningTests, Bin) {
+    using namespace karabo::util;
+    using namespace karabo::xms;
+
+    uint16_t data_in[] = {
+        0x01, 0x02, 0x03, 0x04, 0x05,
+        0x06, 0x07, 0x08, 0x09, 0x0A,
+        0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+        0x10, 0x11, 0x12, 0x13, 0x14};
+    const Dims shape(4, 5);
+
+    // Test SUM mode: the type is widened, the last column is discarded
+    {
+        NDArray arr_in(data_in, shape.size(), NDArray::NullDeleter(), shape);
+        ImageData imd(arr_in, Encoding::GRAY, 12);
+
+        karabo::util::binImage(imd, 2, 2, BinningMode::SUM);
+
+        uint32_t expected_data[] = {
+            0x01 + 0x02 + 0x06 + 0x07, 0x03 + 0x04 + 0x08 + 0x09,
+            0x0B + 0x0C + 0x10 + 0x11, 0x0D + 0x0E + 0x12 + 0x13};
+
+        const NDArray& arr_out = imd.getData();
+        const uint32_t* data_out = arr_out.getData<uint32_t>();
+        ASSERT_EQ((int)karabo::util::Types::UINT32, (int)arr_out.getType());
+        ASSERT_EQ(2ull, arr_out.getShape().x1());
+        ASSERT_EQ(2ull, arr_out.getShape().x2());
+        ASSERT_EQ(2ull, imd.getBinning().x1());
+        ASSERT_EQ(2ull, imd.getBinning().x2());
+        ASSERT_EQ(14, imd.getBitsPerPixel());
+        for (size_t i = 0; i < 4; ++i) {
+            ASSERT_EQ(expected_data[i], data_out[i]);
+        }
+    }
+
+    // Test MEAN mode: the type is kept
+    {
+        NDArray arr_in(data_in, shape.size(), NDArray::NullDeleter(), shape);
+        ImageData imd(arr_in, Encoding::GRAY, 12);
+
+        karabo::util::binImage(imd, 1, 3, BinningMode::MEAN);
+
+        uint16_t expected_data[] = {0x02, 0x07, 0x0C, 0x11};
+
+        const NDArray& arr_out = imd.getData();
+        const uint16_t* data_out = arr_out.getData<uint16_t>();
+        ASSERT_EQ((int)karabo::util::Types::UINT16, (int)arr_out.getType());
+        ASSERT_EQ(4ull, arr_out.getShape().x1());
+        ASSERT_EQ(1ull, arr_out.getShape().x2());
+        ASSERT_EQ(12, imd.getBitsPerPixel());
+        for (size_t i = 0; i < 4; ++i) {
+            ASSERT_EQ(expected_data[i], data_out[i]);
+        }
+    }
+
+    // Test RGB image: the channels are binned separately
+    {
+        uint8_t rgb_in[] = {
+            0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+            0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C};
+        const Dims rgbShape(2, 2, 3);
+        NDArray arr_in(rgb_in, rgbShape.size(), NDArray::NullDeleter(), rgbShape);
+        ImageData imd(arr_in, Encoding::RGB);
+
+        karabo::util::binImage(imd, 2, 2, BinningMode::SUM);
+
+        const NDArray& arr_out = imd.getData();
+        const uint32_t* data_out = arr_out.getData<uint32_t>();
+        ASSERT_EQ(3ull, arr_out.getShape().x3());
+        ASSERT_EQ(22u, data_out[0]);
+        ASSERT_EQ(26u, data_out[1]);
+        ASSERT_EQ(30u, data_out[2]);
+    }
+
+    {
+        NDArray arr_in(data_in, shape.size(), NDArray::NullDeleter(), shape);
+        ImageData imd(arr_in);
+
+        ASSERT_THROW(karabo::util::binImage(imd, 0, 2), karabo::util::ParameterException);
+    }
+}
+
+TEST(FlatFieldTests, Correction) {
+    using namespace karabo::util;
+    using namespace karabo::xms;
+
+    uint16_t dark[] = {
+        0x10, 0x10,
+        0x10, 0x10};
+
+    uint16_t flat[] = {
+        0x74, 0xD8,
+        0x10, 0x42};
+
+    // flat - dark = {100, 200, 0, 50}, its mean over the responding pixels is 350 / 3
+    uint16_t raw[] = {
+        0x42, 0x74,
+        0x20, 0x29};
+
+    const Dims shape(2, 2);
+    NDArray darkArr(dark, shape.size(), NDArray::NullDeleter(), shape);
+    NDArray flatArr(flat, shape.size(), NDArray::NullDeleter(), shape);
+    NDArray rawArr(raw, shape.size(), NDArray::NullDeleter(), shape);
+
+    FlatFieldCorrection ffc;
+    ASSERT_FALSE(ffc.matches(shape));
+
+    ffc.acquire(FlatFieldCorrection::DARK, 2);
+    ASSERT_TRUE(ffc.isAcquiring());
+    ASSERT_FALSE(ffc.addFrame(darkArr));
+    ASSERT_TRUE(ffc.addFrame(darkArr));
+    ASSERT_FALSE(ffc.isAcquiring());
+    ASSERT_TRUE(ffc.hasDark());
+
+    ffc.acquire(FlatFieldCorrection::FLAT, 1);
+    ASSERT_TRUE(ffc.addFrame(flatArr));
+    ASSERT_TRUE(ffc.hasFlat());
+    ASSERT_TRUE(ffc.matches(shape));
+
+    // Output in the input type: rounded and clipped
+    {
+        ImageData imd(rawArr);
+        ffc.apply(imd, false);
+
+        const NDArray& arr_out = imd.getData();
+        const uint16_t* data_out = arr_out.getData<uint16_t>();
+        ASSERT_EQ((int)karabo::util::Types::UINT16, (int)arr_out.getType());
+        ASSERT_EQ(58, data_out[0]);
+        ASSERT_EQ(58, data_out[1]);
+        ASSERT_EQ(0, data_out[2]); // not responding pixel
+        ASSERT_EQ(58, data_out[3]);
+        // input data are untouched
+        ASSERT_EQ(0x42, raw[0]);
+    }
+
+    // Output as FLOAT
+    {
+        ImageData imd(rawArr);
+        ffc.apply(imd, true);
+
+        const NDArray& arr_out = imd.getData();
+        const float* data_out = arr_out.getData<float>();
+        ASSERT_EQ((int)karabo::util::Types::FLOAT, (int)arr_out.getType());
+        ASSERT_NEAR(50.f * 350.f / 300.f, data_out[0], 1e-3);
+    }
+
+    // Save and load the references
+    const std::string filename("flat_field_test.ref");
+    ASSERT_NO_THROW(ffc.save(filename));
+    FlatFieldCorrection ffc2;
+    ASSERT_NO_THROW(ffc2.load(filename));
+    ASSERT_TRUE(ffc2.hasDark());
+    ASSERT_TRUE(ffc2.hasFlat());
+    ASSERT_TRUE(ffc2.matches(shape));
+    std::remove(filename.c_str());
+
+    // Wrong shape
+    {
+        NDArray arr(Dims(3, 3), karabo::util::Types::UINT16);
+        ImageData imd(arr);
+        ASSERT_THROW(ffc.apply(imd, false), karabo::util::ParameterException);
+    }
+
+    // DOUBLE is supported, 64-bit integers are not
+    {
+        NDArray arr(shape, karabo::util::Types::DOUBLE);
+        ImageData imd(arr);
+        ASSERT_NO_THROW(ffc.apply(imd, false));
+        ASSERT_EQ((int)karabo::util::Types::DOUBLE, (int)imd.getData().getType());
+    }
+    {
+        ASSERT_FALSE(FlatFieldCorrection::isSupported(karabo::util::Types::INT64));
+        NDArray arr(shape, karabo::util::Types::INT64);
+        ImageData imd(arr);
+        ASSERT_THROW(ffc.apply(imd, false), karabo::util::ParameterException);
+        ffc.acquire(FlatFieldCorrection::DARK, 1);
+        ASSERT_THROW(ffc.addFrame(arr), karabo::util::ParameterException);
+        ASSERT_FALSE(ffc.isAcquiring());
+    }
+
+    // No references: the image is only converted
+    {
+        FlatFieldCorrection empty;
+        ImageData imd(rawArr);
+        empty.apply(imd, false);
+        ASSERT_EQ(static_cast<const void*>(raw), static_cast<const void*>(imd.getData().getData<uint16_t>()));
+
+        empty.apply(imd, true);
+        const NDArray& arr_out = imd.getData();
+        ASSERT_EQ((int)karabo::util::Types::FLOAT, (int)arr_out.getType());
+        ASSERT_FLOAT_EQ(0x29, arr_out.getData<float>()[3]);
+    }
+}
+
+TEST(StatisticsTests, FrameStatistics) {
+    using namespace karabo::util;
+
+    uint16_t data_in[] = {
+        0x000, 0x00A, 0x014, 0xFFF,
+        0x005, 0x00F, 0x019, 0xFFF,
+        0x001, 0x002, 0x003, 0x004};
+
+    const Dims shape(3, 4);
+    NDArray arr(data_in, shape.size(), NDArray::NullDeleter(), shape);
+
+    FrameStatistics stats;
+    ASSERT_NO_THROW(karabo::util::computeFrameStatistics(arr, stats, 16, 0., 4096., 4095.));
+    ASSERT_EQ(12ull, stats.pixels);
+    ASSERT_DOUBLE_EQ(0., stats.min);
+    ASSERT_DOUBLE_EQ(4095., stats.max);
+    ASSERT_DOUBLE_EQ(8275. / 12., stats.mean);
+    ASSERT_EQ(2ull, stats.saturatedPixels);
+    ASSERT_EQ(16ul, stats.histogram.size());
+    ASSERT_EQ(10u, stats.histogram[0]);
+    ASSERT_EQ(2u, stats.histogram[15]);
+
+    // Subsampled grid: rows 0 and 2, columns 0 and 2
+    ASSERT_NO_THROW(karabo::util::computeFrameStatistics(arr, stats, 16, 0., 4096., 4095., 2));
+    ASSERT_EQ(4ull, stats.pixels);
+    ASSERT_DOUBLE_EQ(20., stats.max);
+    ASSERT_DOUBLE_EQ(6., stats.mean);
+    ASSERT_EQ(0ull, stats.saturatedPixels);
+
+    // Standard deviation of a signed image
+    int8_t signed_in[] = {-3, 3};
+    NDArray signedArr(signed_in, 2, NDArray::NullDeleter(), Dims(1, 2));
+    ASSERT_NO_THROW(karabo::util::computeFrameStatistics(signedArr, stats, 4, -4., 4., 0.));
+    ASSERT_DOUBLE_EQ(0., stats.mean);
+    ASSERT_DOUBLE_EQ(3., stats.stdDev);
+
+    ASSERT_THROW(karabo::util::computeFrameStatistics(arr, stats, 0, 0., 4096., 4095.),
+                 karabo::util::ParameterException);
+    ASSERT_THROW(karabo::util::computeFrameStatistics(arr, stats, 16, 1., 1., 4095.),
+                 karabo::util::ParameterException);
+}
+
+
+TEST(BeamPropertiesTests, Moments) {
+    using namespace karabo::util;
+
+    uint16_t data_in[] = {
+        2,  2,  2, 2,
+        2, 12,  2, 2,
+        2,  2, 12, 2,
+        2,  2,  2, 2};
+
+    const Dims shape(4, 4);
+    NDArray arr(data_in, shape.size(), NDArray::NullDeleter(), shape);
+
+    BeamProperties props;
+    ASSERT_NO_THROW(karabo::util::computeBeamProperties(arr, props, 1., 2.));
+    ASSERT_EQ(4ul, props.projectionX.size());
+    ASSERT_EQ(4ul, props.projectionY.size());
+    ASSERT_DOUBLE_EQ(10., props.projectionX[1]);
+    ASSERT_DOUBLE_EQ(0., props.projectionX[3]);
+    ASSERT_DOUBLE_EQ(10., props.projectionY[2]);
+    ASSERT_DOUBLE_EQ(20., props.integral);
+    ASSERT_DOUBLE_EQ(1.5, props.centroidX);
+    ASSERT_DOUBLE_EQ(1.5, props.centroidY);
+    ASSERT_DOUBLE_EQ(0.5, props.sigmaX);
+    ASSERT_DOUBLE_EQ(0.5, props.sigmaY);
+    ASSERT_DOUBLE_EQ(0.25, props.sigmaXY);
+    ASSERT_DOUBLE_EQ(45., props.tilt);
+
+    // Everything below threshold
+    ASSERT_NO_THROW(karabo::util::computeBeamProperties(arr, props, 100.));
+    ASSERT_DOUBLE_EQ(0., props.integral);
+    ASSERT_DOUBLE_EQ(0., props.centroidX);
+
+    NDArray rgb(data_in, 12, NDArray::NullDeleter(), Dims(2, 2, 3));
+    ASSERT_THROW(karabo::util::computeBeamProperties(rgb, props), karabo::util::NotImplementedException);
+
+    // Wide, bright rows: the sums exceed the float precision
+    std::vector<uint16_t> wide(2 * 4096, 65000);
+    NDArray wideArr(wide.data(), wide.size(), NDArray::NullDeleter(), Dims(2, 4096));
+    ASSERT_NO_THROW(karabo::util::computeBeamProperties(wideArr, props));
+    ASSERT_DOUBLE_EQ(4096. * 65000., props.projectionY[0]);
+    ASSERT_DOUBLE_EQ(2047.5, props.centroidX);
+    ASSERT_DOUBLE_EQ(0.5, props.centroidY);
+    ASSERT_NEAR(0., props.sigmaXY, 1e-6);
+}
+
+
+TEST(SpotFinderTests, FindSpots) {
+    using namespace karabo::util;
+
+    // A U-shaped spot (its branches are only merged on the third row), a diagonal one and a single pixel
+    uint16_t data_in[] = {
+        9, 0, 9, 0, 0, 0,
+        9, 0, 9, 0, 0, 5,
+        9, 9, 9, 0, 0, 0,
+        0, 0, 0, 0, 7, 0,
+        0, 0, 0, 0, 0, 7};
+
+    const Dims shape(5, 6);
+    NDArray arr(data_in, shape.size(), NDArray::NullDeleter(), shape);
+
+    std::vector<Spot> spots;
+    ASSERT_EQ(3ul, karabo::util::findSpots(arr, spots, 1.));
+    ASSERT_EQ(3ul, spots.size());
+    ASSERT_EQ(7u, spots[0].area);
+    ASSERT_DOUBLE_EQ(63., spots[0].integral);
+    ASSERT_DOUBLE_EQ(1., spots[0].x);
+    ASSERT_DOUBLE_EQ(8. / 7., spots[0].y);
+    ASSERT_EQ(2u, spots[1].area);
+    ASSERT_DOUBLE_EQ(4.5, spots[1].x);
+    ASSERT_DOUBLE_EQ(3.5, spots[1].y);
+    ASSERT_DOUBLE_EQ(7., spots[1].peak);
+    ASSERT_EQ(1u, spots[2].area);
+    ASSERT_DOUBLE_EQ(5., spots[2].x);
+    ASSERT_DOUBLE_EQ(1., spots[2].y);
+
+    // Minimum area and maximum number of spots
+    ASSERT_EQ(2ul, karabo::util::findSpots(arr, spots, 1., 2, 1));
+    ASSERT_EQ(1ul, spots.size());
+    ASSERT_EQ(7u, spots[0].area);
+
+    ASSERT_EQ(0ul, karabo::util::findSpots(arr, spots, 10.));
+    ASSERT_TRUE(spots.empty());
+}
+
+
+TEST(DisplayLutTests, Mapping) {
+    using namespace karabo::util;
+
+    std::vector<uint8_t> lut;
+    ASSERT_NO_THROW(karabo::util::buildDisplayLut(lut, 100., 1100., LutMode::LINEAR));
+    ASSERT_EQ(65536ul, lut.size());
+    ASSERT_EQ(0, lut[0]);
+    ASSERT_EQ(0, lut[100]);
+    ASSERT_EQ(128, lut[600]);
+    ASSERT_EQ(255, lut[1100]);
+    ASSERT_EQ(255, lut[65535]);
+
+    ASSERT_NO_THROW(karabo::util::buildDisplayLut(lut, 0., 100., LutMode::GAMMA, 0.5));
+    ASSERT_EQ(128, lut[25]);
+    ASSERT_THROW(karabo::util::buildDisplayLut(lut, 0., 100., LutMode::GAMMA, 0.), karabo::util::ParameterException);
+
+    uint16_t data_in[100];
+    for (int i = 0; i < 100; ++i) {
+        data_in[i] = 10 * i;
+    }
+    const Dims shape(10, 10);
+    NDArray arr(data_in, shape.size(), NDArray::NullDeleter(), shape);
+
+    double low, high;
+    ASSERT_NO_THROW(karabo::util::percentileRange(arr, 10., 50., low, high, 1));
+    ASSERT_DOUBLE_EQ(90., low);
+    ASSERT_DOUBLE_EQ(490., high);
+
+    // A reused histogram gives the same window, and is left zeroed between frames
+    std::vector<unsigned int> histogram;
+    for (unsigned int step : {1u, 1u, 3u}) {
+        double expectedLow, expectedHigh;
+        karabo::util::percentileRange(arr, 10., 50., expectedLow, expectedHigh, step);
+        ASSERT_NO_THROW(karabo::util::percentileRange(arr, 10., 50., low, high, step, histogram));
+        ASSERT_DOUBLE_EQ(expectedLow, low);
+        ASSERT_DOUBLE_EQ(expectedHigh, high);
+        ASSERT_EQ(65536ul, histogram.size());
+        ASSERT_EQ(histogram.end(),
+                  std::find_if(histogram.begin(), histogram.end(), [](unsigned int n) { return n != 0; }));
+    }
+
+    // The look-up table is not rebuilt for moves smaller than one output level of the window
+    ASSERT_FALSE(karabo::util::displayWindowMoved(0., 2560., 5., 2555.));
+    ASSERT_TRUE(karabo::util::displayWindowMoved(0., 2560., 11., 2560.));
+    ASSERT_TRUE(karabo::util::displayWindowMoved(0., 2560., 0., 2549.));
+    ASSERT_TRUE(karabo::util::displayWindowMoved(0., 0., 0., 1.));
+
+    karabo::xms::ImageData imd(arr, karabo::xms::Encoding::GRAY);
+    imd.setBitsPerPixel(12);
+    ASSERT_NO_THROW(karabo::util::buildDisplayLut(lut, 0., 990., LutMode::LINEAR));
+    ASSERT_NO_THROW(karabo::util::applyDisplayLut(imd, lut));
+    ASSERT_EQ(karabo::util::Types::UINT8, imd.getData().getType());
+    ASSERT_EQ(8, imd.getBitsPerPixel());
+    ASSERT_EQ(shape, imd.getDimensions());
+    const uint8_t* mapped = imd.getData().getData<uint8_t>();
+    ASSERT_EQ(0, mapped[0]);
+    ASSERT_EQ(255, mapped[99]);
+    // The input data are not modified
+    ASSERT_EQ(990, data_in[99]);
+}
+
+
+TEST(BadPixelTests, Correction) {
+    using namespace karabo::util;
+
+    uint16_t data_in[] = {
+        10, 10,  10, 10,
+        10, 999, 10, 10,
+        10, 10,  0,  10,
+        12, 10,  10, 10};
+
+    const Dims shape(4, 4);
+    NDArray arr(data_in, shape.size(), NDArray::NullDeleter(), shape);
+
+    // Detection from a dark reference: one hot and one dead pixel
+    std::vector<float> dark(data_in, data_in + shape.size());
+    dark[12] = 10.f;
+    BadPixelCorrection bpc;
+    ASSERT_EQ(2ul, bpc.detect(shape, dark.data(), 5.));
+    ASSERT_EQ(1u, bpc.defects()[0].x);
+    ASSERT_EQ(1u, bpc.defects()[0].y);
+    ASSERT_EQ(2u, bpc.defects()[1].x);
+    ASSERT_EQ(2u, bpc.defects()[1].y);
+
+    // Adjacent defects are not used as neighbours of each other
+    ASSERT_NO_THROW(bpc.apply(arr));
+    ASSERT_EQ(10, data_in[5]);
+    ASSERT_EQ(10, data_in[10]);
+    ASSERT_EQ(12, data_in[12]);
+
+    // Defects outside the image are ignored; corner pixels have three neighbours
+    bpc.setDefects({{0, 3}, {7, 7}});
+    ASSERT_NO_THROW(bpc.apply(arr));
+    ASSERT_EQ(10, data_in[12]);
+
+    NDArray rgb(data_in, 12, NDArray::NullDeleter(), Dims(2, 2, 3));
+    bpc.setDefects({{0, 0}});
+    ASSERT_NO_THROW(bpc.apply(rgb));
+
+    NDArray vector(data_in, 16, NDArray::NullDeleter(), Dims(16));
+    ASSERT_THROW(bpc.apply(vector), karabo::util::ParameterException);
+
+    // The defects are given in full-frame coordinates: a ROI at (2, 1), i.e. (roiY, roiX)
+    uint16_t roi_in[] = {
+        10, 10,  10,
+        10, 999, 10,
+        10, 10,  10};
+    NDArray roi(roi_in, 9, NDArray::NullDeleter(), Dims(3, 3));
+    bpc.setDefects({{0, 0}, {2, 3}, {4, 1}});
+    ASSERT_NO_THROW(bpc.apply(roi, Dims(2, 1), 1, 1));
+    ASSERT_EQ(10, roi_in[4]);
+    roi_in[4] = 999;
+    ASSERT_NO_THROW(bpc.apply(roi)); // The stencils are recompiled
+    ASSERT_EQ(999, roi_in[4]);
+
+    // A binned image, e.g. summed to 64 bits: both defects are in the bin (0, 1)
+    unsigned long long binned_in[] = {
+        40, 4000, 40,
+        40, 40,   40};
+    NDArray binned(binned_in, 6, NDArray::NullDeleter(), Dims(2, 3));
+    bpc.setDefects({{2, 0}, {3, 1}, {7, 7}});
+    ASSERT_NO_THROW(bpc.apply(binned, Dims(0, 0), 2, 2));
+    ASSERT_EQ(40ull, binned_in[1]);
+    ASSERT_EQ(40ull, binned_in[4]);
+}
+
+
+TEST(ColorConversionTests, Convert) {
+    using namespace karabo::util;
+    using karabo::xms::Encoding;
+    using karabo::xms::ImageData;
+
+    // Bayer to GRAY, at half resolution
+    uint16_t bayer_in[] = {
+        100,   50,  100,  50,
+         50,   10,   50,  10,
+        1000, 1000,   0,   0,
+        1000, 1000,   0,   0};
+    ImageData bayer(NDArray(bayer_in, 16, NDArray::NullDeleter(), Dims(4, 4)), Encoding::BAYER);
+    ASSERT_NO_THROW(karabo::util::bayerToGray(bayer, BayerPattern::RGGB));
+    ASSERT_EQ(Dims(2, 2), bayer.getDimensions());
+    ASSERT_EQ(Encoding::GRAY, bayer.getEncoding());
+    ASSERT_EQ(Dims(2, 2), bayer.getBinning());
+    const uint16_t* gray = bayer.getData().getData<uint16_t>();
+    ASSERT_EQ(61, gray[0]); // (77 * 100 + 75 * (50 + 50) + 29 * 10 + 128) / 256
+    ASSERT_EQ(61, gray[1]);
+    ASSERT_EQ(1000, gray[2]);
+    ASSERT_EQ(0, gray[3]);
+
+    // Bayer to RGB: a uniform image stays uniform
+    std::vector<uint8_t> uniform(16, 100);
+    ImageData demosaiced(NDArray(uniform.data(), 16, NDArray::NullDeleter(), Dims(4, 4)), Encoding::BAYER);
+    ASSERT_NO_THROW(karabo::util::demosaicBayer(demosaiced, BayerPattern::GRBG));
+    ASSERT_EQ(Dims(4, 4, 3), demosaiced.getDimensions());
+    ASSERT_EQ(Encoding::RGB, demosaiced.getEncoding());
+    ASSERT_EQ(100, demosaiced.getData().getData<uint8_t>()[20]);
+
+    // YUV 4:2:2 to RGB: white, black, then two grey pixels
+    uint8_t yuv_in[] = {128, 235, 128, 16, 128, 126, 128, 126};
+    ImageData yuv(NDArray(yuv_in, 8, NDArray::NullDeleter(), Dims(2, 4)), Encoding::YUV);
+    ASSERT_NO_THROW(karabo::util::yuv422ToRgb(yuv, YuvOrder::UYVY));
+    ASSERT_EQ(Dims(2, 2, 3), yuv.getDimensions());
+    ASSERT_EQ(Encoding::RGB, yuv.getEncoding());
+    const uint8_t* rgb = yuv.getData().getData<uint8_t>();
+    ASSERT_EQ(255, rgb[0]);
+    ASSERT_EQ(255, rgb[2]);
+    ASSERT_EQ(0, rgb[3]);
+    ASSERT_EQ(128, rgb[6]);
+    ASSERT_EQ(128, rgb[11]);
+
+    // RGB to GRAY
+    uint8_t rgb_in[] = {255, 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 255};
+    ImageData color(NDArray(rgb_in, 12, NDArray::NullDeleter(), Dims(2, 2, 3)), Encoding::RGB);
+    ASSERT_NO_THROW(karabo::util::rgbToGray(color));
+    ASSERT_EQ(Dims(2, 2), color.getDimensions());
+    ASSERT_EQ(Encoding::GRAY, color.getEncoding());
+    const uint8_t* luma = color.getData().getData<uint8_t>();
+    ASSERT_EQ(77, luma[0]);
+    ASSERT_EQ(149, luma[1]);
+    ASSERT_EQ(29, luma[2]);
+    ASSERT_EQ(255, luma[3]);
+
+    float float_in[12] = {};
+    ImageData floatImage(NDArray(float_in, 12, NDArray::NullDeleter(), Dims(2, 2, 3)), Encoding::RGB);
+    ASSERT_THROW(karabo::util::rgbToGray(floatImage), karabo::util::ParameterException);
+}
+
+
+TEST(AccumulationTests, FrameAccumulator) {
+    using namespace karabo::util;
+    using karabo::xms::ImageData;
+
+    uint16_t frames[3][4] = {{1, 2, 3, 65535}, {1, 2, 3, 65535}, {1, 2, 4, 65535}};
+    const Dims shape(2, 2);
+
+    FrameAccumulator accumulator;
+    ASSERT_THROW(accumulator.configure(AccumulationMode::SUM, 0), karabo::util::ParameterException);
+
+    // Sum, in a wider type
+    ASSERT_NO_THROW(accumulator.configure(AccumulationMode::SUM, 3));
+    for (int i = 0; i < 3; ++i) {
+        ImageData imd(NDArray(frames[i], 4, NDArray::NullDeleter(), shape));
+        imd.setBitsPerPixel(16);
+        ASSERT_EQ(i == 2, accumulator.add(imd));
+        if (i == 2) {
+            ASSERT_EQ(karabo::util::Types::UINT32, imd.getData().getType());
+            ASSERT_EQ(shape, imd.getDimensions());
+            ASSERT_EQ(18, imd.getBitsPerPixel());
+            ASSERT_EQ(3u, accumulator.publishedFrames());
+            const uint32_t* sum = imd.getData().getData<uint32_t>();
+            ASSERT_EQ(10u, sum[2]);
+            ASSERT_EQ(3u * 65535u, sum[3]);
+        }
+    }
+    ASSERT_EQ(0u, accumulator.count());
+
+    // Mean, the type is kept
+    ASSERT_NO_THROW(accumulator.configure(AccumulationMode::MEAN, 3));
+    for (int i = 0; i < 3; ++i) {
+        ImageData imd(NDArray(frames[i], 4, NDArray::NullDeleter(), shape));
+        if (accumulator.add(imd)) {
+            ASSERT_EQ(karabo::util::Types::UINT16, imd.getData().getType());
+            ASSERT_EQ(3, imd.getData().getData<uint16_t>()[2]); // 10 / 3, rounded
+            ASSERT_EQ(65535, imd.getData().getData<uint16_t>()[3]);
+        }
+    }
+
+    // Exponential moving average: an image at every frame
+    ASSERT_NO_THROW(accumulator.configure(AccumulationMode::EMA, 2));
+    for (int i = 0; i < 3; ++i) {
+        ImageData imd(NDArray(frames[i], 4, NDArray::NullDeleter(), shape));
+        ASSERT_TRUE(accumulator.add(imd));
+        ASSERT_EQ(i == 2 ? 4 : 3, imd.getData().getData<uint16_t>()[2]); // 3 + (4 - 3) / 2, rounded
+    }
+
+    // The input data are not modified
+    ASSERT_EQ(4, frames[2][2]);
+
+    // With a frame pool, the published images reuse its buffers once released
+    FramePool pool;
+    FrameAccumulator heapAccumulator;
+    for (AccumulationMode mode : {AccumulationMode::EMA, AccumulationMode::MEAN, AccumulationMode::SUM}) {
+        ASSERT_NO_THROW(accumulator.configure(mode, 2));
+        ASSERT_NO_THROW(heapAccumulator.configure(mode, 2));
+        const unsigned long long allocations = pool.allocations();
+        for (int i = 0; i < 6; ++i) {
+            ImageData imd(NDArray(frames[i % 3], 4, NDArray::NullDeleter(), shape));
+            ImageData heap(NDArray(frames[i % 3], 4, NDArray::NullDeleter(), shape));
+            const bool completed = accumulator.add(imd, &pool);
+            ASSERT_EQ(completed, heapAccumulator.add(heap));
+            if (completed) {
+                ASSERT_EQ(heap.getData().getType(), imd.getData().getType());
+                ASSERT_EQ(shape, imd.getDimensions());
+                ASSERT_EQ(0, std::memcmp(heap.getData().getData<char>(), imd.getData().getData<char>(),
+                                         heap.getData().byteSize()));
+            }
+        }
+        ASSERT_LE(pool.allocations(), allocations + 1); // at most the first image
+    }
+}
+
+
+TEST(BurstTests, FrameStack) {
+    using namespace karabo::util;
+    using karabo::xms::ImageData;
+
+    ASSERT_THROW(FrameStack(0), karabo::util::ParameterException);
+
+    uint16_t a[4] = {1, 2, 3, 4}, b[4] = {5, 6, 7, 8};
+    const Timestamp train1(Epochstamp(10, 500000000000000000ull), Trainstamp(100));
+    const Timestamp train2(Epochstamp(11, 0), Trainstamp(101));
+    ImageData first(NDArray(a, 4, NDArray::NullDeleter(), Dims(2, 2)));
+    ImageData second(NDArray(b, 4, NDArray::NullDeleter(), Dims(2, 2)));
+
+    FrameStack stack(3);
+    ASSERT_FALSE(stack.add(first, train1));
+    ASSERT_FALSE(stack.add(second, train1));
+    ASSERT_FALSE(stack.accepts(first, train2)); // new train
+    ASSERT_EQ(2u, stack.size());
+
+    // The missing frame is filled with zeros
+    ImageData imd;
+    std::vector<unsigned long long> frameTimestamps;
+    const Timestamp timestamp = stack.take(imd, frameTimestamps);
+    ASSERT_EQ(100ull, timestamp.getTrainId());
+    ASSERT_EQ(Dims(3, 2, 2), imd.getDimensions());
+    const uint16_t* data = imd.getData().getData<uint16_t>();
+    ASSERT_EQ(1, data[0]);
+    ASSERT_EQ(5, data[4]);
+    ASSERT_EQ(0, data[8]);
+    ASSERT_EQ(3u, frameTimestamps.size());
+    ASSERT_EQ(10500000000ull, frameTimestamps[0]);
+    ASSERT_EQ(0ull, frameTimestamps[2]);
+
+    // A new stack is started
+    ASSERT_EQ(0u, stack.size());
+    ASSERT_TRUE(stack.accepts(first, train2));
+}
+
+
+TEST(ChangeDetectionTests, ChangeDetector) {
+    using namespace karabo::util;
+
+    uint16_t reference[16], noisy[16], changed[16];
+    for (int i = 0; i < 16; ++i) {
+        reference[i] = 100;
+        noisy[i] = 101;
+        changed[i] = 110;
+    }
+
+    ChangeDetector detector;
+    ASSERT_THROW(detector.configure(-1., 1), karabo::util::ParameterException);
+    ASSERT_NO_THROW(detector.configure(2., 1));
+
+    // The first frame is the reference
+    ASSERT_TRUE(detector.hasChanged(NDArray(reference, 16, NDArray::NullDeleter(), Dims(4, 4))));
+    ASSERT_FALSE(detector.hasChanged(NDArray(noisy, 16, NDArray::NullDeleter(), Dims(4, 4))));
+    ASSERT_DOUBLE_EQ(1., detector.difference());
+    ASSERT_TRUE(detector.hasChanged(NDArray(changed, 16, NDArray::NullDeleter(), Dims(4, 4))));
+    ASSERT_DOUBLE_EQ(10., detector.difference());
+
+    // A new shape is a change
+    ASSERT_TRUE(detector.hasChanged(NDArray(changed, 16, NDArray::NullDeleter(), Dims(2, 8))));
+
+    // Only the sampled pixels are compared
+    ASSERT_NO_THROW(detector.configure(2., 2));
+    ASSERT_TRUE(detector.hasChanged(NDArray(reference, 16, NDArray::NullDeleter(), Dims(4, 4))));
+    noisy[5] = 1000;
+    ASSERT_FALSE(detector.hasChanged(NDArray(noisy, 16, NDArray::NullDeleter(), Dims(4, 4))));
+}
+
+
+TEST(JpegCompressionTests, RateController) {
+    using namespace karabo::util;
+
+    JpegRateController controller;
+    ASSERT_THROW(controller.configure(0., RateBudget::BYTES_PER_FRAME, 10, 90), karabo::util::ParameterException);
+    ASSERT_THROW(controller.configure(1000., RateBudget::BYTES_PER_FRAME, 90, 10), karabo::util::ParameterException);
+    ASSERT_THROW(controller.configure(1000., RateBudget::BYTES_PER_FRAME, 10, 90, 3),
+                 karabo::util::ParameterException);
+    ASSERT_THROW(JpegRateController::validate(1000., 0, 90, 1), karabo::util::ParameterException);
+    ASSERT_NO_THROW(JpegRateController::validate(1000., 10, 90, 8));
+
+    // A simple model of the encoded size: proportional to the quality, and to the number of pixels
+    auto encodedSize = [&controller](double bytesPerQuality) {
+        const unsigned int downscale = controller.downscale();
+        return static_cast<size_t>(controller.quality() * bytesPerQuality / (downscale * downscale));
+    };
+
+    auto now = std::chrono::steady_clock::now();
+    ASSERT_NO_THROW(controller.configure(1000., RateBudget::BYTES_PER_FRAME, 10, 90, 4));
+    ASSERT_EQ(90u, controller.quality());
+    ASSERT_EQ(1u, controller.downscale());
+
+    // Within budget at the minimum quality
+    for (int i = 0; i < 20; ++i) {
+        controller.update(encodedSize(50.), now);
+    }
+    ASSERT_EQ(1u, controller.downscale());
+    ASSERT_LE(encodedSize(50.), 1000u);
+    ASSERT_GE(encodedSize(50.), 800u);
+
+    // Busier scene: downscaled
+    for (int i = 0; i < 20; ++i) {
+        controller.update(encodedSize(200.), now);
+    }
+    ASSERT_EQ(2u, controller.downscale());
+    ASSERT_LE(encodedSize(200.), 1000u);
+
+    // Simpler scene: back to full resolution and maximum quality
+    for (int i = 0; i < 40; ++i) {
+        controller.update(encodedSize(2.), now);
+    }
+    ASSERT_EQ(1u, controller.downscale());
+    ASSERT_EQ(90u, controller.quality());
+
+    // Budget in bytes per second, at 10 frames per second
+    ASSERT_NO_THROW(controller.configure(10000., RateBudget::BYTES_PER_SECOND, 10, 90));
+    for (int i = 0; i < 30; ++i) {
+        now += std::chrono::milliseconds(100);
+        controller.update(encodedSize(20.), now);
+    }
+    ASSERT_EQ(50u, controller.quality());
+    ASSERT_NEAR(10000., controller.bytesPerSecond(), 100.);
+}
+
+
+TEST(PyramidTests, BuildPyramid) {
+    using namespace karabo::util;
+    using karabo::xms::ImageData;
+
+    std::vector<NDArray> levels;
+    ASSERT_THROW(buildPyramid(NDArray(Dims(7, 100), karabo::util::Types::UINT16), levels, 3),
+                 karabo::util::ParameterException);
+    ASSERT_THROW(buildPyramid(NDArray(Dims(64, 64), karabo::util::Types::UINT16), levels, 0),
+                 karabo::util::ParameterException);
+
+    // The levels are the same as the images binned in MEAN mode
+    const Dims shape(37, 53);
+    NDArray arr(shape, karabo::util::Types::UINT16);
+    uint16_t* data = arr.getData<uint16_t>();
+    for (size_t i = 0; i < arr.size(); ++i) {
+        data[i] = static_cast<uint16_t>((i * 7919) % 4096);
+    }
+
+    ASSERT_NO_THROW(buildPyramid(arr, levels, 3));
+    ASSERT_EQ(3u, levels.size());
+    for (unsigned int k = 0; k < 3; ++k) {
+        const unsigned int factor = 2u << k;
+        ImageData imd(arr);
+        binImage(imd, factor, factor, BinningMode::MEAN);
+        const NDArray& binned = imd.getData();
+        ASSERT_EQ(Dims(37 / factor, 53 / factor), levels[k].getShape());
+        ASSERT_EQ(karabo::util::Types::UINT16, levels[k].getType());
+        for (size_t i = 0; i < binned.size(); ++i) {
+            ASSERT_EQ(binned.getData<uint16_t>()[i], levels[k].getData<uint16_t>()[i]) << "level " << factor;
+        }
+    }
+}
+
+
+TEST(ThumbnailTests, Downscale) {
+    using namespace karabo::util;
+    using karabo::xms::ImageData;
+
+    ASSERT_THROW(thumbnailFactor(Dims(100, 100), 0), karabo::util::ParameterException);
+    ASSERT_EQ(10u, thumbnailFactor(Dims(2048, 2448), 256));
+    ASSERT_EQ(2u, thumbnailFactor(Dims(512, 256), 256));
+    ASSERT_EQ(1u, thumbnailFactor(Dims(100, 200, 3), 256));
+
+    uint16_t data[16];
+    for (int i = 0; i < 16; ++i) {
+        data[i] = i;
+    }
+
+    // Small enough: the pixels are copied
+    ImageData imd(NDArray(data, 16, NDArray::NullDeleter(), Dims(4, 4)));
+    ASSERT_NO_THROW(downscaleImage(imd, 4));
+    ASSERT_NE(data, imd.getData().getData<uint16_t>());
+    ASSERT_EQ(Dims(4, 4), imd.getDimensions());
+    ASSERT_EQ(5, imd.getData().getData<uint16_t>()[5]);
+
+    ASSERT_NO_THROW(downscaleImage(imd, 2));
+    ASSERT_EQ(Dims(2, 2), imd.getDimensions());
+    ASSERT_EQ(Dims(2, 2), imd.getBinning());
+    ASSERT_EQ(3, imd.getData().getData<uint16_t>()[0]); // (0 + 1 + 4 + 5) / 4, rounded
+
+    // Mapped to 8 bits and encoded
+    imd.setBitsPerPixel(4);
+    ASSERT_NO_THROW(encodeThumbnail(imd, 75));
+    ASSERT_EQ((int)karabo::xms::Encoding::JPEG, imd.getEncoding());
+}
+
+
+TEST(SnapshotTests, FrameRing) {
+    using namespace karabo::util;
+    using karabo::xms::ImageData;
+
+    FrameRing ring(3);
+    uint16_t data[4];
+    for (unsigned int f = 0; f < 5; ++f) {
+        for (unsigned int i = 0; i < 4; ++i) {
+            data[i] = 10 * f + i;
+        }
+        ImageData imd(NDArray(data, 4, NDArray::NullDeleter(), Dims(2, 2)));
+        imd.setBitsPerPixel(12);
+        ASSERT_FALSE(ring.push(imd, Timestamp(Epochstamp(f, 0), Trainstamp(100 + f))));
+    }
+    ASSERT_EQ(3u, ring.size());
+
+    // The oldest frames were replaced, and the data were copied
+    ImageData frame;
+    ASSERT_EQ(102ull, ring.frame(0, frame).getTrainId());
+    ASSERT_EQ(21, frame.getData().getData<uint16_t>()[1]);
+    ASSERT_EQ(12, frame.getBitsPerPixel());
+    ASSERT_THROW(ring.frame(3, frame), karabo::util::ParameterException);
+
+    // Two more frames after the trigger
+    ImageData imd(NDArray(data, 4, NDArray::NullDeleter(), Dims(2, 2)));
+    ring.trigger(2);
+    ASSERT_TRUE(ring.isTriggered());
+    ASSERT_FALSE(ring.push(imd, Timestamp(Epochstamp(5, 0), Trainstamp(105))));
+    ASSERT_TRUE(ring.push(imd, Timestamp(Epochstamp(6, 0), Trainstamp(106))));
+    ASSERT_TRUE(ring.isFrozen());
+    ASSERT_FALSE(ring.push(imd, Timestamp(Epochstamp(7, 0), Trainstamp(107))));
+    ASSERT_EQ(104ull, ring.frame(0, frame).getTrainId());
+
+    // Save and load
+    const std::string filename("frame_ring_test.bin");
+    ASSERT_NO_THROW(ring.save(filename));
+    FrameRing loaded(1);
+    ASSERT_NO_THROW(loaded.load(filename));
+    ASSERT_EQ(3u, loaded.size());
+    ASSERT_TRUE(loaded.isFrozen());
+    ASSERT_EQ(106ull, loaded.frame(2, frame).getTrainId());
+    ASSERT_EQ(43, frame.getData().getData<uint16_t>()[3]);
+    std::remove(filename.c_str());
+
+    // Recording resumes after release
+    ring.release();
+    ASSERT_FALSE(ring.push(imd, Timestamp(Epochstamp(7, 0), Trainstamp(107))));
+    ASSERT_EQ(107ull, ring.frame(2, frame).getTrainId());
+}
+
+
+TEST(RecorderTests, RecordAndRead) {
+    using namespace karabo::util;
+    using karabo::xms::Encoding;
+
+    const std::string filename("frame_recorder_test.bin");
+    std::remove(filename.c_str());
+
+    uint16_t data[6];
+    {
+        FrameRecorder recorder;
+        ASSERT_THROW(recorder.append(NDArray(Dims(2, 3), karabo::util::Types::UINT16), Dims(1, 1), 12, Encoding::GRAY,
+                                     Dims(0, 0), Timestamp(), Hash()),
+                     karabo::util::ParameterException);
+        ASSERT_NO_THROW(recorder.open(filename));
+        for (unsigned int f = 0; f < 3; ++f) {
+            for (unsigned int i = 0; i < 6; ++i) {
+                data[i] = 10 * f + i;
+            }
+            recorder.append(NDArray(data, 6, NDArray::NullDeleter(), Dims(2, 3)), Dims(1, 2), 12, Encoding::GRAY,
+                            Dims(4, 8), Timestamp(Epochstamp(f, 0), Trainstamp(100 + f)), Hash("gain", f));
+        }
+        ASSERT_EQ(3ull, recorder.frames());
+    }
+
+    // The frames are appended to an existing recording
+    {
+        FrameRecorder opened;
+        ASSERT_NO_THROW(opened.open(filename));
+        FrameRecorder recorder;
+        recorder.swap(opened);
+        ASSERT_FALSE(opened.isOpen());
+        ASSERT_TRUE(recorder.isOpen());
+        ASSERT_EQ(3ull, recorder.frames());
+        const uint8_t rgb[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+        recorder.append(NDArray(rgb, 12, NDArray::NullDeleter(), Dims(2, 2, 3)), Dims(1, 1), 8, Encoding::RGB,
+                        Dims(0, 0), Timestamp(Epochstamp(3, 0), Trainstamp(103)), Hash());
+        ASSERT_EQ(4ull, recorder.frames());
+    }
+
+    RecordedFrame frame;
+    {
+        FrameRecording recording;
+        ASSERT_NO_THROW(recording.open(filename));
+        ASSERT_EQ(4u, recording.size());
+        ASSERT_EQ(102ull, recording.timestamp(2).getTrainId());
+
+        recording.frame(1, frame);
+        ASSERT_EQ(karabo::util::Types::UINT16, frame.data.getType());
+        ASSERT_EQ(Dims(2, 3), frame.data.getShape());
+        ASSERT_EQ(15, frame.data.getData<uint16_t>()[5]);
+        ASSERT_EQ(Dims(1, 2), frame.binning);
+        ASSERT_EQ(Dims(4, 8), frame.roiOffsets);
+        ASSERT_EQ(12, frame.bitsPerPixel);
+        ASSERT_EQ(Encoding::GRAY, frame.encoding);
+        ASSERT_EQ(1u, frame.header.get<unsigned int>("gain"));
+        ASSERT_EQ(101ull, frame.timestamp.getTrainId());
+
+        RecordedFrame rgbFrame;
+        recording.frame(3, rgbFrame);
+        ASSERT_EQ(karabo::util::Types::UINT8, rgbFrame.data.getType());
+        ASSERT_EQ(Dims(2, 2, 3), rgbFrame.data.getShape());
+        ASSERT_EQ(12, rgbFrame.data.getData<uint8_t>()[11]);
+        ASSERT_TRUE(rgbFrame.header.empty());
+
+        ASSERT_THROW(recording.frame(4, rgbFrame), karabo::util::ParameterException);
+    }
+
+    // The pixel data remain valid after the recording is closed
+    ASSERT_EQ(10, frame.data.getData<uint16_t>()[0]);
+    std::remove(filename.c_str());
+}
+
+
+TEST(SimulationTests, FrameGenerator) {
+    using namespace karabo::util;
+
+    const unsigned int width = 30;
+    const unsigned int height = 21;
+    FrameGenerator generator;
+    ASSERT_THROW(generator.generate(0), karabo::util::ParameterException);
+    ASSERT_THROW(generator.configure(3, 3, PixelFormat::MONO12_PACKED), karabo::util::ParameterException);
+    ASSERT_THROW(toPixelFormat("Mono14"), karabo::util::ParameterException);
+
+    // The packed frames are unpacked to the generated pixels
+    std::vector<uint16_t> unpacked(width * height);
+    for (const char* name : {"Mono12Packed", "Mono10p", "Mono12p"}) {
+        const PixelFormat format = toPixelFormat(name);
+        generator.configure(width, height, format);
+        generator.setPattern(true, 2, 3., 2., 0.05);
+        const std::vector<uint8_t>& frame = generator.generate(7);
+        if (format == PixelFormat::MONO12_PACKED) {
+            ASSERT_EQ(width * height * 3 / 2, generator.frameSize());
+            unpackMono12Packed(frame.data(), width, height, unpacked.data());
+        } else {
+            ASSERT_EQ((width * height * bitsPerPixel(format) + 7) / 8, generator.frameSize());
+            unpackMonoXXp(frame.data(), width, height, bitsPerPixel(format), unpacked.data());
+        }
+        ASSERT_EQ(generator.pixels(), unpacked) << name;
+        ASSERT_LE(*std::max_element(unpacked.begin(), unpacked.end()), (1 << bitsPerPixel(format)) - 1);
+    }
+
+    // The spots move
+    generator.configure(width, height, PixelFormat::MONO16);
+    generator.setPattern(false, 1, 2., 5., 0.);
+    generator.generate(0);
+    const std::vector<uint16_t> frame0 = generator.pixels();
+    generator.generate(1);
+    ASSERT_NE(frame0, generator.pixels());
+    ASSERT_GT(*std::max_element(frame0.begin(), frame0.end()), 30000);
+
+    // Without spots nor noise, the frames are the gradient
+    generator.configure(width, height, PixelFormat::RGB8);
+    generator.setPattern(true, 0, 1., 0., 0.);
+    const std::vector<uint8_t>& rgb = generator.generate(0);
+    ASSERT_EQ(3u * width * height, generator.frameSize());
+    ASSERT_EQ(0, rgb[0]);
+    ASSERT_EQ(127, rgb[3 * (width - 1)]); // red at the right edge
+    ASSERT_EQ(63, rgb[2]); // constant blue
+}
+
+
+TEST(PlacementTests, FramePool) {
+    using namespace karabo::util;
+
+    ASSERT_EQ(std::vector<int>({0, 1, 2, 3, 8}), parseCpuList("0-3, 8,2"));
+    ASSERT_EQ("0-3,8", formatCpuList(parseCpuList("8,0-3")));
+    ASSERT_TRUE(parseCpuList("").empty());
+    ASSERT_THROW(parseCpuList("3-1"), karabo::util::ParameterException);
+    ASSERT_THROW(parseCpuList("1,a"), karabo::util::ParameterException);
+    ASSERT_THROW(numaNodeCpus(-1), karabo::util::ParameterException);
+
+    MemoryPolicy policy;
+    policy.numaNode = 0;
+    policy.hugePages = true;
+    PlacedBuffer buffer(3 << 20, policy);
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.data()) % (2 << 20)); // aligned for hugepages
+    std::memset(buffer.data(), 1, buffer.size());
+
+    // The buffers are reused once the frames are destroyed
+    FramePool pool;
+    pool.setPolicy(policy);
+    const void* first;
+    {
+        NDArray frame = pool.allocate(Dims(20, 30), karabo::util::Types::UINT16);
+        first = frame.getData<uint16_t>();
+        ASSERT_EQ(600u, frame.size());
+        ASSERT_NE(first, pool.allocate(Dims(20, 30), karabo::util::Types::UINT16).getData<uint16_t>());
+    }
+    ASSERT_EQ(2u, pool.allocations());
+    NDArray frame = pool.allocate(Dims(20, 30), karabo::util::Types::UINT16);
+    ASSERT_EQ(2u, pool.allocations());
+
+    // ... unless the policy changes
+    policy.hugePages = false;
+    pool.setPolicy(policy);
+    pool.allocate(Dims(20, 30), karabo::util::Types::UINT16);
+    ASSERT_EQ(3u, pool.allocations());
+
+    // The frames may outlive the pool
+    {
+        FramePool other;
+        frame = other.allocate(Dims(4, 4), karabo::util::Types::DOUBLE);
+    }
+    frame.getData<double>()[15] = 1.;
+
+    // The processing allocates its results from the pool too, with the same results
+    std::vector<uint16_t> pixels(24);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = static_cast<uint16_t>(i);
+    }
+    const NDArray raw(pixels.data(), pixels.size(), NDArray::NullDeleter(), Dims(4, 6));
+    FramePool processingPool;
+    karabo::xms::ImageData pooled(raw), plain(raw);
+    FlatFieldCorrection().apply(pooled, true, &processingPool);
+    FlatFieldCorrection().apply(plain, true);
+    cropImage(pooled, Dims(0, 1), Dims(4, 4), &processingPool);
+    cropImage(plain, Dims(0, 1), Dims(4, 4));
+    binImage(pooled, 2, 2, BinningMode::MEAN, &processingPool);
+    binImage(plain, 2, 2, BinningMode::MEAN);
+    ASSERT_EQ(3u, processingPool.allocations());
+    ASSERT_EQ(plain.getDimensions().toVector(), pooled.getDimensions().toVector());
+    ASSERT_EQ(karabo::util::Types::FLOAT, pooled.getData().getType());
+    ASSERT_EQ(0, std::memcmp(plain.getData().getData<float>(), pooled.getData().getData<float>(),
+                             plain.getData().byteSize()));
+
+    // ... also for the 64-bit types, e.g. the SUM binning of 32-bit images
+    std::vector<uint32_t> wide(24);
+    for (size_t i = 0; i < wide.size(); ++i) {
+        wide[i] = 0xfffffff0u + static_cast<uint32_t>(i % 8);
+    }
+    karabo::xms::ImageData pooledSum(NDArray(wide.data(), wide.size(), NDArray::NullDeleter(), Dims(4, 6)));
+    karabo::xms::ImageData plainSum(pooledSum);
+    binImage(pooledSum, 2, 2, BinningMode::SUM, &processingPool);
+    binImage(plainSum, 2, 2, BinningMode::SUM);
+    ASSERT_EQ(karabo::util::Types::UINT64, pooledSum.getData().getType());
+    ASSERT_EQ(plainSum.getDimensions().toVector(), pooledSum.getDimensions().toVector());
+    ASSERT_EQ(0, std::memcmp(plainSum.getData().getData<unsigned long long>(),
+                             pooledSum.getData().getData<unsigned long long>(), plainSum.getData().byteSize()));
+
+    std::vector<unsigned long long> large(24);
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = (1ull << 40) + i;
+    }
+    karabo::xms::ImageData pooledCrop(NDArray(large.data(), large.size(), NDArray::NullDeleter(), Dims(4, 6)));
+    karabo::xms::ImageData plainCrop(pooledCrop);
+    cropImage(pooledCrop, Dims(1, 2), Dims(2, 3), &processingPool);
+    cropImage(plainCrop, Dims(1, 2), Dims(2, 3));
+    ASSERT_EQ(karabo::util::Types::UINT64, pooledCrop.getData().getType());
+    ASSERT_EQ(plainCrop.getDimensions().toVector(), pooledCrop.getDimensions().toVector());
+    ASSERT_EQ(0, std::memcmp(plainCrop.getData().getData<unsigned long long>(),
+                             pooledCrop.getData().getData<unsigned long long>(), plainCrop.getData().byteSize()));
+}
+
+
+TEST(SharedMemoryTests, RingAndReader) {
+    using namespace karabo::util;
+
+    const std::string name = "/imageSourceTest" + std::to_string(::getpid());
+    SharedMemoryRing ring;
+    ring.create(name, 2, 20 * 30 * sizeof(uint16_t));
+
+    std::vector<uint16_t> pixels(20 * 30);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = i;
+    }
+    const NDArray data(pixels.data(), pixels.size(), Dims(20, 30));
+    const Timestamp timestamp(Epochstamp(1, 2), Trainstamp(3));
+    unsigned int slot;
+    unsigned long long sequence;
+    ASSERT_TRUE(ring.write(data, karabo::xms::Encoding::GRAY, 12, timestamp, slot, sequence));
+    ASSERT_EQ(0u, slot);
+    ASSERT_EQ(1ull, sequence);
+
+    // The frame is mapped, not copied
+    SharedMemoryReader reader;
+    reader.open(name);
+    ASSERT_EQ(ring.ringId(), reader.ringId());
+    SharedFrame frame;
+    ASSERT_TRUE(reader.read(slot, sequence, frame));
+    ASSERT_EQ(30ull, frame.data.getShape().extentIn(1));
+    ASSERT_EQ(599, frame.data.getData<uint16_t>()[599]);
+    ASSERT_EQ(12, frame.bitsPerPixel);
+    ASSERT_EQ(3ull, frame.timestamp.getTrainId());
+
+    // The held slot is skipped, then the overwritten frame cannot be read
+    ASSERT_TRUE(ring.write(data, karabo::xms::Encoding::GRAY, 12, timestamp, slot, sequence));
+    ASSERT_TRUE(ring.write(data, karabo::xms::Encoding::GRAY, 12, timestamp, slot, sequence));
+    ASSERT_EQ(1u, slot);
+    ASSERT_EQ(3ull, sequence);
+    SharedFrame other;
+    ASSERT_FALSE(reader.read(1, 2, other));
+    ASSERT_TRUE(reader.read(1, 3, other));
+
+    // All the slots are held
+    ASSERT_FALSE(ring.write(data, karabo::xms::Encoding::GRAY, 12, timestamp, slot, sequence));
+    frame = SharedFrame();
+    ASSERT_TRUE(ring.write(data, karabo::xms::Encoding::GRAY, 12, timestamp, slot, sequence));
+    ASSERT_EQ(0u, slot);
+    ASSERT_THROW(ring.write(NDArray(Dims(100, 30), uint16_t(0)), karabo::xms::Encoding::GRAY, 12, timestamp, slot,
+                            sequence),
+                 karabo::util::ParameterException);
+
+    // The frames read outlive the ring
+    reader.close();
+    ring.close();
+    ASSERT_EQ(99, other.data.getData<uint16_t>()[99]);
+    ASSERT_THROW(reader.open(name), karabo::util::IOException);
+}
+
+
+TEST(TracingTests, LatencyTrace) {
+    using namespace karabo::util;
+
+    const auto acquired = std::chrono::steady_clock::now();
+    LatencyTrace trace;
+    trace.mark(TraceStage::ACQUIRED, acquired);
+    trace.mark(TraceStage::UNPACKED, acquired + std::chrono::microseconds(300));
+    trace.mark(TraceStage::OUTPUT, acquired + std::chrono::milliseconds(5));
+    trace.mark(static_cast<unsigned char>(TraceStage::USER) + 2, trace.marks().back().second + 1);
+
+    // The trace round-trips through the image header, in a compact form
+    Hash header("frameNumber", 1ull);
+    trace.attach(header);
+    ASSERT_GT(32u, header.get<std::vector<unsigned char>>(LatencyTrace::HEADER_KEY).size());
+    LatencyTrace decoded;
+    ASSERT_TRUE(LatencyTrace::extract(header, decoded));
+    ASSERT_EQ(trace.marks(), decoded.marks());
+    ASSERT_FALSE(LatencyTrace::extract(Hash("trace", std::vector<unsigned char>({1, 0, 0x80})), decoded));
+    ASSERT_THROW(LatencyTrace::decode(std::vector<unsigned char>({2})), karabo::util::ParameterException);
+
+    // Each stage is counted from the previous one
+    LatencyHistogram histogram;
+    for (int i = 0; i < 100; ++i) {
+        histogram.add(trace);
+    }
+    const LatencyHistogram::Stage& unpacked = histogram.stages().at(static_cast<unsigned char>(TraceStage::UNPACKED));
+    ASSERT_EQ(100ull, unpacked.count);
+    ASSERT_EQ(100ull, unpacked.counts[9]); // [256, 512) us
+    ASSERT_DOUBLE_EQ(300., unpacked.percentile(50.));
+    ASSERT_NEAR(4700., histogram.stages().at(static_cast<unsigned char>(TraceStage::OUTPUT)).mean(), 1.e-6);
+    ASSERT_NEAR(5000.001, histogram.stages().at(static_cast<unsigned char>(TraceStage::TOTAL)).max, 1.e-6);
+    ASSERT_EQ(4u, histogram.summary().size());
+    ASSERT_EQ("stage 130", histogram.summary()[2].substr(0, 9));
+}
+
+
+TEST(PropertySnapshotTests, ConcurrentReadWrite) {
+    using karabo::util::PropertySnapshot;
+
+    PropertySnapshot snapshot;
+    const std::vector<unsigned long long> values = {1024, 768, 1, 13};
+    ASSERT_FALSE(snapshot.matches(values)); // Invalid until published
+    snapshot.publish(values);
+    ASSERT_TRUE(snapshot.matches(values));
+    ASSERT_FALSE(snapshot.matches({1024, 768, 1}));
+    ASSERT_FALSE(snapshot.matches({1024, 768, 1, 14}));
+    std::vector<unsigned long long> copy;
+    ASSERT_TRUE(snapshot.read(copy));
+    ASSERT_EQ(values, copy);
+    snapshot.invalidate();
+    ASSERT_FALSE(snapshot.matches(values));
+    ASSERT_FALSE(snapshot.read(copy));
+    const std::vector<unsigned long long> tooMany(PropertySnapshot::CAPACITY + 1, 1);
+    snapshot.publish(tooMany);
+    ASSERT_FALSE(snapshot.matches(tooMany));
+
+    // The writer only publishes sets of equal values: a torn snapshot would mix two of them
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        std::vector<unsigned long long> set(PropertySnapshot::CAPACITY);
+        for (unsigned long long n = 0; !stop; ++n) {
+            std::fill(set.begin(), set.end(), n);
+            snapshot.publish(set);
+        }
+    });
+
+    std::atomic<unsigned long long> consistent(0);
+    std::atomic<unsigned long long> torn(0);
+    auto reader = [&]() {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+        std::vector<unsigned long long> copy;
+        std::vector<unsigned long long> mixed(PropertySnapshot::CAPACITY);
+        while (std::chrono::steady_clock::now() < end) {
+            if (snapshot.read(copy)) {
+                if (copy.size() == PropertySnapshot::CAPACITY &&
+                    std::count(copy.begin(), copy.end(), copy.front()) == static_cast<long>(copy.size())) {
+                    ++consistent;
+                } else {
+                    ++torn;
+                }
+                // A set half-published, i.e. the next one over this one, is never matched
+                std::fill(mixed.begin(), mixed.begin() + mixed.size() / 2, copy.front() + 1);
+                std::fill(mixed.begin() + mixed.size() / 2, mixed.end(), copy.front());
+                if (snapshot.matches(mixed)) {
+                    ++torn;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back(reader);
+    }
+    for (std::thread& thread : readers) {
+        thread.join();
+    }
+    stop = true;
+    writer.join();
+
+    ASSERT_EQ(0ull, torn.load());
+    ASSERT_LT(0ull, consistent.load());
+}
+
+
+TEST_F(SchemaUpdateFixture, CoalescedUpdates) {
+    using karabo::util::Types;
+    using karabo::xms::Encoding;
+
+    device->updateOutputSchema({100, 200}, Encoding::GRAY, Types::UINT16);
+    ASSERT_TRUE(waitFor([this]() { return this->schemaUpdates() == 1ull; }));
+
+    {
+        // The updates cannot be applied while the event loop is busy
+        EventLoopBlocker blocker;
+        for (unsigned long long height = 101; height <= 200; ++height) {
+            device->updateOutputSchema({height, 200}, Encoding::GRAY, Types::UINT16);
+        }
+        ASSERT_EQ(1ull, this->schemaUpdates());
+    }
+
+    // Only the latest properties are applied
+    const std::vector<unsigned long long> latest = {200, 200};
+    ASSERT_TRUE(waitFor([&]() { return this->outputDims() == latest && this->schemaUpdates() == 2ull; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(2ull, this->schemaUpdates());
+}
+
+
+TEST_F(SchemaUpdateFixture, HeldBackFrames) {
+    using karabo::util::Hash;
+    using karabo::util::Types;
+    using karabo::xms::Encoding;
+
+    const std::vector<unsigned long long> shape = {100, 200};
+    const std::vector<unsigned long long> other = {120, 160};
+    device->updateOutputSchema(shape, Encoding::GRAY, Types::UINT16);
+    ASSERT_TRUE(waitFor([&]() { return this->outputDims() == shape && this->schemaUpdates() == 1ull; }));
+
+    {
+        EventLoopBlocker blocker;
+        device->updateOutputSchema(other, Encoding::GRAY, Types::UINT16);
+
+        // The frames matching the current schema are still written, not those with the new properties
+        this->writeFrame(shape, 10);
+        ASSERT_DOUBLE_EQ(10., device->get<double>("frameStatistics.mean"));
+        this->writeFrame(other, 30);
+
+        // Nor those processed with a new configuration, e.g. binned
+        Hash binning("softwareBinning.x", 2u, "softwareBinning.y", 2u);
+        device->preReconfigure(binning);
+        this->writeFrame(shape, 20);
+        ASSERT_DOUBLE_EQ(10., device->get<double>("frameStatistics.mean"));
+    }
+
+    // The new properties and configuration are applied at once
+    const std::vector<unsigned long long> binned = {60, 80};
+    ASSERT_TRUE(waitFor([&]() {
+        return this->outputDims() == binned && this->schemaUpdates() == 2ull &&
+               device->get<unsigned long long>("heldBackFrames") == 2ull;
+    }));
+
+    this->writeFrame(other, 40);
+    ASSERT_DOUBLE_EQ(40., device->get<double>("frameStatistics.mean"));
+}
+
+
+TEST_F(SchemaUpdateFixture, CacheEviction) {
+    using karabo::util::Types;
+    using karabo::xms::Encoding;
+
+    // More shapes than the cached schema updates
+    const unsigned long long nShapes = 20;
+    for (unsigned long long k = 0; k < nShapes; ++k) {
+        const std::vector<unsigned long long> shape = {64 + k, 64};
+        device->updateOutputSchema(shape, Encoding::GRAY, Types::UINT16);
+        ASSERT_TRUE(waitFor([&]() { return this->outputDims() == shape && this->schemaUpdates() == k + 1; }));
+    }
+
+    // The evicted schema updates are built again, the cached ones reused
+    for (unsigned long long k : {0ull, nShapes - 2, 1ull}) {
+        const std::vector<unsigned long long> shape = {64 + k, 64};
+        const unsigned long long schemaUpdates = this->schemaUpdates();
+        device->updateOutputSchema(shape, Encoding::GRAY, Types::UINT16);
+        ASSERT_TRUE(waitFor([&]() {
+            return this->outputDims() == shape && this->schemaUpdates() == schemaUpdates + 1;
+        }));
+        ASSERT_EQ(static_cast<int>(Types::UINT16),
+                  device->getFullSchema().getDefaultValue<int>("output.schema.data.image.pixels.type"));
+        ASSERT_EQ(static_cast<int>(Encoding::GRAY),
+                  device->getFullSchema().getDefaultValue<int>("output.schema.data.image.encoding"));
+    }
+}
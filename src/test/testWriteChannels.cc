@@ -0,0 +1,257 @@
+/*
+ * Author: parenti
+ *
+ * Created on October 19, 2026
+ *
+ * Copyright (c) European XFEL GmbH Schenefeld. All rights reserved.
+ */
+
+/*
+ * A harness measuring how writeChannels delivers frames to local receivers.
+ *
+ * A SimulatedCameraImageSource produces frames at a fixed rate, and input channels of the same process receive
+ * them from 'output' or 'daqOutput'. The latency from the acquisition timestamp to the receipt of a frame, and
+ * the sustained rates of the producer and of the receivers, are printed. The slow-receiver variants show the
+ * effect of back-pressure, i.e. whether the output channel waits for the receiver or drops frames.
+ */
+
+#include "SimulatedCameraImageSource.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#include "karabo/util/Hash.hh"
+#include "karabo/xms/InputChannel.hh"
+#include "karabo/xms/SignalSlotable.hh"
+
+#include "testrunner.hh"
+
+
+#define PRODUCER_ID "testWriteChannelsProducer"
+
+namespace {
+
+    const unsigned int FRAME_WIDTH = 1024;
+    const unsigned int FRAME_HEIGHT = 1024;
+    const double FRAME_RATE = 100.;                   // Hz
+    const std::chrono::seconds WARM_UP_TIME(1);       // not measured
+    const std::chrono::seconds MEASUREMENT_TIME(3);
+    const std::chrono::milliseconds SLOW_PROCESSING(20); // per frame, in the slow receiver
+
+    /**
+     * @brief An input channel, connected to an output channel of the producer, which records the latency and the
+     * receipt time of every frame.
+     */
+    class Receiver {
+       public:
+        Receiver(const std::string& instanceId, const std::string& outputChannel, const std::string& onSlowness,
+                 std::chrono::microseconds processingTime = std::chrono::microseconds(0))
+            : m_processingTime(processingTime) {
+            using karabo::util::Hash;
+
+            m_signalSlotable = boost::make_shared<karabo::xms::SignalSlotable>(instanceId);
+            m_signalSlotable->start();
+            const Hash config("input", Hash("connectedOutputChannels", std::vector<std::string>{outputChannel},
+                                            "onSlowness", onSlowness));
+            m_input = m_signalSlotable->createInputChannel(
+                  "input", config, [this](const Hash& data, const karabo::xms::InputChannel::MetaData& meta) {
+                      this->on_data(meta.getTimestamp());
+                  });
+        }
+
+        bool connect() {
+            auto connected = std::make_shared<std::promise<bool>>();
+            std::future<bool> future = connected->get_future();
+            m_signalSlotable->asyncConnectInputChannel(m_input, [connected](bool success) {
+                connected->set_value(success);
+            });
+            return future.wait_for(std::chrono::seconds(10)) == std::future_status::ready && future.get();
+        }
+
+        /**
+         * @brief Start recording the received frames, e.g. after warm-up.
+         */
+        void start() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_latencies.clear();
+            m_start = std::chrono::steady_clock::now();
+            m_recording = true;
+        }
+
+        /**
+         * @brief Stop recording the received frames.
+         */
+        void finish() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_end = std::chrono::steady_clock::now();
+            m_recording = false;
+        }
+
+        size_t frames() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_latencies.size();
+        }
+
+        /**
+         * @brief The rate of the frames received between start and finish, in Hz.
+         */
+        double rate() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_latencies.size() / std::chrono::duration<double>(m_end - m_start).count();
+        }
+
+        /**
+         * @brief The latency percentile, in ms.
+         *
+         * @param p The percentile, in [0, 100].
+         */
+        double latency(double p) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_latencies.empty()) {
+                return 0.;
+            }
+            std::vector<double> latencies(m_latencies);
+            const size_t k = std::min(latencies.size() - 1, static_cast<size_t>(p / 100. * latencies.size()));
+            std::nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+            return latencies[k];
+        }
+
+        void report(const std::string& title) const {
+            std::cout << std::fixed << std::setprecision(2) << title << ": " << frames() << " frames, "
+                      << rate() << " Hz, latency (ms) p50 " << latency(50.) << ", p90 " << latency(90.) << ", p99 "
+                      << latency(99.) << ", max " << latency(100.) << std::endl;
+        }
+
+       private:
+        void on_data(const karabo::util::Timestamp& timestamp) {
+            const karabo::util::Epochstamp now;
+            // NB The fractional seconds are in attoseconds
+            const double latency =
+                  1.e3 * (static_cast<double>(now.getSeconds()) - static_cast<double>(timestamp.getSeconds())) +
+                  1.e-15 * (static_cast<double>(now.getFractionalSeconds()) -
+                            static_cast<double>(timestamp.getFractionalSeconds()));
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_recording) {
+                    m_latencies.push_back(latency);
+                }
+            }
+            if (m_processingTime.count() > 0) {
+                std::this_thread::sleep_for(m_processingTime);
+            }
+        }
+
+        const std::chrono::microseconds m_processingTime;
+        mutable std::mutex m_mutex;
+        std::vector<double> m_latencies; // in ms
+        bool m_recording = false;
+        std::chrono::steady_clock::time_point m_start;
+        std::chrono::steady_clock::time_point m_end;
+        // NB Declared last, to be destroyed before the members used by the data handler
+        karabo::xms::SignalSlotable::Pointer m_signalSlotable;
+        karabo::xms::InputChannel::Pointer m_input;
+    };
+
+} // namespace
+
+
+/**
+ * @brief Test fixture running a SimulatedCameraImageSource as producer.
+ */
+class WriteChannelsFixture : public KaraboDeviceFixture {
+   protected:
+    WriteChannelsFixture() = default;
+
+    void SetUp() override {
+        // NB One producer per test, as the devices are not killed
+        m_producerId = std::string(PRODUCER_ID) + "_" +
+                       ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        const karabo::util::Hash devCfg("_deviceId_", m_producerId, "width", FRAME_WIDTH, "height", FRAME_HEIGHT,
+                                        "pixelFormat", std::string("Mono12Packed"), "frameRate", FRAME_RATE);
+        instantiateAndGetPointer("SimulatedCameraImageSource", m_producerId, devCfg, base_device);
+    }
+
+    /**
+     * @brief Acquire for the warm-up and the measurement times, and print the rates and latencies.
+     */
+    void measure(const std::string& title, const std::vector<Receiver*>& receivers) {
+        for (Receiver* receiver : receivers) {
+            ASSERT_TRUE(receiver->connect()) << "Failed to connect " << title;
+        }
+
+        m_deviceCli->execute(m_producerId, "acquire", DEV_CLI_TIMEOUT_SEC);
+        std::this_thread::sleep_for(WARM_UP_TIME);
+        for (Receiver* receiver : receivers) {
+            receiver->start();
+        }
+        const unsigned long long lateFrames = m_deviceCli->get<unsigned long long>(m_producerId, "lateFrames");
+        std::this_thread::sleep_for(MEASUREMENT_TIME);
+        for (Receiver* receiver : receivers) {
+            receiver->finish();
+        }
+        m_producerRate = m_deviceCli->get<double>(m_producerId, "actualFrameRate");
+        m_lateFrames = m_deviceCli->get<unsigned long long>(m_producerId, "lateFrames") - lateFrames;
+
+        std::cout << std::endl << std::fixed << std::setprecision(2) << title << std::endl;
+        std::cout << "producer: " << m_producerRate << " Hz (" << FRAME_RATE << " Hz requested), " << m_lateFrames
+                  << " late frames, " << m_deviceCli->get<double>(m_producerId, "processingTime")
+                  << " ms per frame in writeChannels" << std::endl;
+        for (size_t i = 0; i < receivers.size(); ++i) {
+            receivers[i]->report("receiver " + std::to_string(i));
+        }
+
+        m_deviceCli->execute(m_producerId, "stop", DEV_CLI_TIMEOUT_SEC);
+    }
+
+    karabo::core::BaseDevice::Pointer base_device;
+    std::string m_producerId;
+    double m_producerRate = 0.;
+    unsigned long long m_lateFrames = 0;
+};
+
+
+TEST_F(WriteChannelsFixture, Output) {
+    Receiver first("testWriteChannelsOutput_0", m_producerId + ":output", "drop");
+    Receiver second("testWriteChannelsOutput_1", m_producerId + ":output", "drop");
+    measure("output, 2 receivers", {&first, &second});
+
+    EXPECT_GT(first.frames(), 0ul);
+    EXPECT_GT(second.frames(), 0ul);
+}
+
+
+TEST_F(WriteChannelsFixture, DaqOutput) {
+    Receiver receiver("testWriteChannelsDaqOutput", m_producerId + ":daqOutput", "wait");
+    measure("daqOutput, 1 receiver", {&receiver});
+
+    EXPECT_GT(receiver.frames(), 0ul);
+}
+
+
+TEST_F(WriteChannelsFixture, SlowReceiverWait) {
+    // The output channel waits for the slow receiver: writeChannels, hence the producer, slows down
+    Receiver slow("testWriteChannelsSlowWait", m_producerId + ":output", "wait", SLOW_PROCESSING);
+    measure("output, slow receiver (wait)", {&slow});
+
+    const double maxRate = 1. / std::chrono::duration<double>(SLOW_PROCESSING).count();
+    EXPECT_GT(slow.frames(), 0ul);
+    EXPECT_LT(slow.rate(), 1.1 * maxRate);
+}
+
+
+TEST_F(WriteChannelsFixture, SlowReceiverDrop) {
+    // The output channel drops the frames for the slow receiver, while the fast one gets all of them
+    Receiver slow("testWriteChannelsSlowDrop_0", m_producerId + ":output", "drop", SLOW_PROCESSING);
+    Receiver fast("testWriteChannelsSlowDrop_1", m_producerId + ":output", "drop");
+    measure("output, slow (drop) and fast receivers", {&slow, &fast});
+
+    const double maxRate = 1. / std::chrono::duration<double>(SLOW_PROCESSING).count();
+    EXPECT_GT(slow.frames(), 0ul);
+    EXPECT_LT(slow.rate(), 1.1 * maxRate);
+    EXPECT_GT(fast.frames(), slow.frames());
+}